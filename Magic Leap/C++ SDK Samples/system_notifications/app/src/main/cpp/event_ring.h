@@ -0,0 +1,96 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+/*!
+  \brief Bounded lock free queue of fixed size records with many producers and one consumer.
+
+  Every slot carries a sequence number telling whether it is free for the producer
+  at a given position or holds a record for the consumer, so producers on any
+  thread claim a position with a single compare and swap and never wait for each
+  other, and the consumer pops without atomic read-modify-write operations. All
+  storage is allocated with the ring, so neither side ever allocates. TryPush
+  fails instead of blocking or overwriting when the ring is full. Records must be
+  trivially copyable. TryPop must only be called from one thread at a time.
+*/
+template <typename T, size_t Capacity>
+class EventRing {
+public:
+  static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+  static_assert(std::is_trivially_copyable<T>::value, "Records must be trivially copyable");
+
+  EventRing() {
+    for (size_t i = 0; i < Capacity; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+  EventRing(const EventRing &) = delete;
+  EventRing &operator=(const EventRing &) = delete;
+
+  // Appends record. Returns false if the ring is full. Callable from any thread.
+  bool TryPush(const T &record) {
+    size_t position = tail_.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+      slot = &slots_[position & (Capacity - 1)];
+      const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        // The slot is free for this position; on failure position is reloaded
+        if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          break;
+        }
+      } else if (difference < 0) {
+        // The slot still holds the record from one lap ago
+        return false;
+      } else {
+        position = tail_.load(std::memory_order_relaxed);
+      }
+    }
+    slot->record = record;
+    slot->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Removes the oldest record into *out_record. Returns false if the ring is empty or its
+  // oldest record is still being written.
+  bool TryPop(T *out_record) {
+    Slot &slot = slots_[head_ & (Capacity - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != head_ + 1) {
+      return false;
+    }
+    *out_record = slot.record;
+    slot.sequence.store(head_ + Capacity, std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+private:
+  // Slots on separate cache lines, so producers writing neighbouring records do not contend
+  struct alignas(64) Slot {
+    std::atomic<size_t> sequence;
+    T record;
+  };
+
+  std::array<Slot, Capacity> slots_;
+  alignas(64) std::atomic<size_t> tail_{0};
+  // Only touched by the consumer
+  alignas(64) size_t head_ = 0;
+};
@@ -21,16 +21,138 @@
 #include <app_framework/ml_macros.h>
 #include <app_framework/toolset.h>
 #include <app_framework/version.h>
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <utility>
 #include <ml_audio.h>
 #include <ml_system_notification_manager.h>
 #include <ml_head_tracking.h>
 #include <ml_power_manager.h>
 
+#include "event_ring.h"
+#include "system_status_monitor.h"
+
 
 using namespace ml::app_framework;
 
 namespace {
+  // Sources of the status monitor, in the order they are added
+  enum StatusSource : size_t {
+    StatusSource_Network,
+    StatusSource_Internet,
+    StatusSource_ComputePackBattery,
+    StatusSource_ControllerBattery,
+    StatusSource_DiskSpace,
+    StatusSource_Volume,
+    StatusSource_ComputePackTemperature,
+    StatusSource_HeadTracking,
+    StatusSource_MemoryTrim,
+    StatusSource_Count
+  };
+  static_assert(StatusSource_Count <= SystemStatusMonitor::kMaxSources, "Too many status sources");
+
+  // Reported for the controller battery while no controller is present
+  constexpr double kControllerNotPresent = -1.0;
+
+  enum SystemEventCode : uint16_t {
+    SystemEvent_LowMemory,
+    SystemEvent_IncompatibleCharger,
+    SystemEvent_ControllerPowerState,
+    SystemEvent_ControllerInvalidPowerState,
+    SystemEvent_ControllerConnectionState,
+    SystemEvent_NetworkConnected,
+    SystemEvent_NetworkDisconnected,
+    SystemEvent_InternetConnected,
+    SystemEvent_InternetDisconnected,
+    SystemEvent_ComputePackBatteryLow,
+    SystemEvent_ControllerBatteryLow,
+    SystemEvent_DiskSpaceLow,
+    SystemEvent_HighVolume,
+    SystemEvent_ComputePackTemperatureHigh,
+    SystemEvent_HeadTrackingLowLight,
+    SystemEvent_HeadTrackingNotEnoughFeatures,
+    SystemEvent_HeadTrackingExcessiveMotion,
+    SystemEvent_HeadTrackingUnknownError,
+    SystemEvent_HeadTrackingRestored,
+    SystemEvent_MemoryRunningLow,
+    SystemEvent_MemoryRunningCritical
+  };
+
+  // Event as queued by any thread and kept for display, without owning memory
+  struct SystemEvent {
+    SystemEventCode code;
+    // Steady clock time of the event, in nanoseconds
+    int64_t timestamp;
+    // What the event refers to, e.g. the new power state or the battery level
+    float value;
+  };
+
+  // Events queued between two frames beyond this are dropped and counted
+  constexpr size_t kEventQueueCapacity = 64;
+
+  int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  const char *GetSystemEventString(const SystemEvent &event) {
+    switch (event.code) {
+      case SystemEvent_LowMemory:
+        return "Memory Warning: APP_CMD_LOW_MEMORY lifecycle event occurred.\n";
+      case SystemEvent_IncompatibleCharger:
+        return "Incompatible charger: cannot use this controller SKU with this compute pack SKU.\n";
+      case SystemEvent_ControllerPowerState:
+        switch (static_cast<MLPowerManagerPowerState>(event.value)) {
+          case MLPowerManagerPowerState_Normal:
+            return "Controller entered normal power state.\n";
+          case MLPowerManagerPowerState_DisabledWhileCharging:
+            return "Controller cannot be used while connected to charging for this SKU.\n";
+          default:
+            return "Controller entered standby power state.\n";
+        }
+      case SystemEvent_ControllerInvalidPowerState:
+        return "Invalid power state detected for controller.\n";
+      case SystemEvent_ControllerConnectionState:
+        return event.value == MLPowerManagerConnectionState_Connected ? "Controller has been connected.\n" :
+                                                                        "Controller has been disconnected.\n";
+      case SystemEvent_NetworkConnected:
+        return "Network Connected.\n";
+      case SystemEvent_NetworkDisconnected:
+        return "Network Disconnected.\n";
+      case SystemEvent_InternetConnected:
+        return "Internet Connected.\n";
+      case SystemEvent_InternetDisconnected:
+        return "Internet Disconnected.\n";
+      case SystemEvent_ComputePackBatteryLow:
+        return "Compute Pack Battery Critically Low (less than %5).\n";
+      case SystemEvent_ControllerBatteryLow:
+        return "Controller Battery Critically Low (less than %5).\n";
+      case SystemEvent_DiskSpaceLow:
+        return "Available space is critically low (less than 10%).\n";
+      case SystemEvent_HighVolume:
+        return "High volume warning: consider lowering volume. \n";
+      case SystemEvent_ComputePackTemperatureHigh:
+        return "Compute Pack Temperature Warning: greater than 40 degrees Celsius.\n";
+      case SystemEvent_HeadTrackingLowLight:
+        return "Head tracking lost due to low light conditions.\n";
+      case SystemEvent_HeadTrackingNotEnoughFeatures:
+        return "Head tracking lost because there are not enough features.\n";
+      case SystemEvent_HeadTrackingExcessiveMotion:
+        return "Head tracking lost because of excessive motion.\n";
+      case SystemEvent_HeadTrackingUnknownError:
+        return "Head tracking lost due to unknown error.\n";
+      case SystemEvent_HeadTrackingRestored:
+        return "Head tracking restored.\n";
+      case SystemEvent_MemoryRunningLow:
+        return "Memory warning: memory running low.\n";
+      case SystemEvent_MemoryRunningCritical:
+        return "Memory warning: memory running critically low.\n";
+      default:
+        return "Unknown event.\n";
+    }
+  }
+
     std::string GetMLHeadTrackingErrorString(uint32_t error) {
       std::string result;
       if (error & MLHeadTrackingErrorFlag_NotEnoughFeatures) result += "MLHeadTrackingErrorFlag_NotEnoughFeatures\n";
@@ -95,25 +217,13 @@ class SystemNotificationsApp : public Application {
  public:
   SystemNotificationsApp(struct android_app *state)
     : ml::app_framework::Application(state,USE_GUI),
-      available_space_ratio_(0.0),
-      compute_critical_(false),
-      compute_pack_battery_level_(0),
-      compute_pack_battery_temperature_(0.0),
-      compute_pack_battery_temperature_warning_(false),
-      controller_battery_level_(0),
-      controller_critical_(false),
       controller_connection_state_{MLPowerManagerConnectionState_Connected},
       controller_power_state_{MLPowerManagerPowerState_Normal},
       head_tracker_(ML_INVALID_HANDLE),
-      head_tracker_error_(MLHeadTrackingErrorFlag_None),
-      internet_connection_(false),
-      network_connection_(false),
       power_manager_handle_(ML_INVALID_HANDLE),
-      space_warning_(false),
       system_ui_comms_suppressed_(false),
       system_ui_tracker_(ML_INVALID_HANDLE),
-      volume_warning_(false) {
-    events_.reserve(SYS_NUM_EVENTS);
+      start_time_(Now()) {
   }
 
   void OnResume() override {
@@ -126,14 +236,17 @@ class SystemNotificationsApp : public Application {
       GetRoot()->AddChild(light_node);
       GetGui().Show();
     }
+    status_monitor_.Start();
+  }
+
+  void OnPause() override {
+    status_monitor_.Stop();
   }
 
   void OnCreate(const void*, size_t) override {
     UNWRAP_MLRESULT(MLSystemNotificationManagerCreate(&system_ui_tracker_));
     UNWRAP_MLRESULT(MLPowerManagerCreate(MLPowerManagerComponent_Controller, &power_manager_handle_));
-    //set initial states;
-    network_connection_ = IsNetworkConnected();
-    internet_connection_ =  IsInternetAvailable();
+    AddStatusSources();
 
     // Set up callbacks for controller connection/status errors
     MLPowerManagerCallbacks callbacks = {};
@@ -193,14 +306,14 @@ class SystemNotificationsApp : public Application {
   }
 
   void OnLowMemory() override {
-    AddEvent("Memory Warning: APP_CMD_LOW_MEMORY lifecycle event occurred.\n");
+    AddEvent(SystemEvent_LowMemory);
   }
 
   static void OnControllerError(MLPowerManagerError error, void *context) {
     SystemNotificationsApp *app = static_cast<SystemNotificationsApp *>(context);
     if (app) {
       if (error == MLPowerManagerError_InvalidSKU) {
-        app->AddEvent("Incompatible charger: cannot use this controller SKU with this compute pack SKU.\n");
+        app->AddEvent(SystemEvent_IncompatibleCharger);
       } else {
         ALOGE("ERROR: Unknown MLPowerManagerError: %s\n",
               GetMLPowerManagerErrorString(error).c_str());
@@ -211,27 +324,22 @@ class SystemNotificationsApp : public Application {
     }
   }
 
+  // Power manager callbacks may run on another thread, so state changes travel with their
+  // events and are applied when OnUpdate drains them
   static void OnControllerPowerStateChange(MLPowerManagerPowerState state, void *context) {
     SystemNotificationsApp *app = static_cast<SystemNotificationsApp *>(context);
     if (app) {
       switch (state) {
         case MLPowerManagerPowerState_Normal:
-          app->AddEvent("Controller entered normal power state.\n");
-          app->controller_power_state_ = MLPowerManagerPowerState_Normal;
-          break;
         case MLPowerManagerPowerState_DisabledWhileCharging:
-          app->AddEvent("Controller cannot be used while connected to charging for this SKU.\n");
-          app->controller_power_state_ = MLPowerManagerPowerState_DisabledWhileCharging;
-          break;
         case MLPowerManagerPowerState_Standby:
-          app->AddEvent("Controller entered standby power state.\n");
-          app->controller_power_state_ = MLPowerManagerPowerState_Standby;
+          app->AddEvent(SystemEvent_ControllerPowerState, state);
           break;
         case MLPowerManagerPowerState_None:
         case MLPowerManagerPowerState_Sleep:
         case MLPowerManagerPowerState_Ensure32Bits:
         default:
-          app->AddEvent("Invalid power state detected for controller.\n");
+          app->AddEvent(SystemEvent_ControllerInvalidPowerState, state);
           break;
       }
     }
@@ -248,12 +356,8 @@ class SystemNotificationsApp : public Application {
         if (properties->property_type == MLPowerManagerPropertyType_ConnectionState) {
           switch (properties->connection_state) {
             case MLPowerManagerConnectionState_Connected:
-              app->AddEvent("Controller has been disconnected.\n");
-              app->controller_connection_state_ = MLPowerManagerConnectionState_Connected;
-              break;
             case MLPowerManagerConnectionState_Disconnected:
-              app->AddEvent("Controller has been connected.\n");
-              app->controller_connection_state_ = MLPowerManagerConnectionState_Disconnected;
+              app->AddEvent(SystemEvent_ControllerConnectionState, properties->connection_state);
               break;
             default:
               ALOGW("WARNING: unexpected property found: %d", properties->connection_state);
@@ -269,7 +373,9 @@ class SystemNotificationsApp : public Application {
   }
 
   void OnUpdate(float) override {
-    CheckSystemEvents();
+    // Only sources that changed since the last frame produce events
+    status_monitor_.Dispatch();
+    DrainEvents();
     auto & gui = GetGui();
     bool continue_running = true;
     gui.BeginUpdate();
@@ -283,25 +389,36 @@ class SystemNotificationsApp : public Application {
     }
     ImGui::NewLine();
     ImGui::Text("System Status:");
-    ImGui::Text("Internet: %s", internet_connection_ ? "connected" : "disconnected");
-    ImGui::Text("Network: %s", network_connection_ ? "connected" : "disconnected");
-    ImGui::Text("Controller Battery Percentage: %s ", IsControllerPresent() ? std::to_string(controller_battery_level_).c_str() : "not connected");
-    ImGui::Text("Compute Pack Battery Percentage: %d ", compute_pack_battery_level_);
-    ImGui::Text("Compute Pack Battery Temperature: %f ", compute_pack_battery_temperature_);
-    ImGui::Text("Available Disk Space Free Ratio: %f (status: %s)", available_space_ratio_, available_space_ratio_ <= 0.1 ? "Critical" : "OK");
-    ImGui::Text("Head Tracking Status: %s", GetMLHeadTrackingErrorString(head_tracker_error_).c_str());
+    ImGui::Text("Internet: %s", ConnectionStatusString(StatusSource_Internet));
+    ImGui::Text("Network: %s", ConnectionStatusString(StatusSource_Network));
+    const double controller_battery_level = Status(StatusSource_ControllerBattery);
+    if (controller_battery_level == kControllerNotPresent) {
+      ImGui::Text("Controller Battery Percentage: not connected ");
+    } else {
+      ImGui::Text("Controller Battery Percentage: %d ", static_cast<int>(controller_battery_level));
+    }
+    ImGui::Text("Compute Pack Battery Percentage: %d ", static_cast<int>(Status(StatusSource_ComputePackBattery)));
+    ImGui::Text("Compute Pack Battery Temperature: %f ", Status(StatusSource_ComputePackTemperature));
+    const double available_space_ratio = Status(StatusSource_DiskSpace);
+    ImGui::Text("Available Disk Space Free Ratio: %f (status: %s)", available_space_ratio, available_space_ratio <= 0.1 ? "Critical" : "OK");
+    ImGui::Text("Head Tracking Status: %s", GetMLHeadTrackingErrorString(static_cast<uint32_t>(Status(StatusSource_HeadTracking))).c_str());
     ImGui::Text("Controller Power State: %s", GetMLPowerManagerPowerStateString(controller_power_state_).c_str());
     ImGui::Text("Controller Connection State: %s", GetMLPowerManagerConnectionStateString(controller_connection_state_).c_str());
 
     ImGui::NewLine();
     if (ImGui::Button("Clear Event Stream")) {
-      events_.clear();
+      event_history_count_ = 0;
     }
     ImGui::NewLine();
     ImGui::Text("System Notification Event Stream:");
-    
-    for (const auto& event : events_) {
-      ImGui::Text("%s", event.c_str());
+    const uint64_t dropped_events = dropped_events_.load(std::memory_order_relaxed);
+    if (dropped_events > 0) {
+      ImGui::Text("(%llu events dropped)", static_cast<unsigned long long>(dropped_events));
+    }
+
+    for (size_t i = 0; i < event_history_count_; ++i) {
+      const SystemEvent &event = event_history_[(event_history_begin_ + i) % SYS_NUM_EVENTS];
+      ImGui::Text("%.1f s: %s", (event.timestamp - start_time_) / 1e9, GetSystemEventString(event));
     }
     gui.EndDialog();
     gui.EndUpdate();
@@ -311,13 +428,13 @@ class SystemNotificationsApp : public Application {
     }
   }
 
-  void AddEvent(const std::string& event) {
-    if ((int)events_.size() > SYS_NUM_EVENTS) {
-      events_.erase(events_.begin());
+  // Queues an event for the next frame. Lock free, callable from any thread.
+  void AddEvent(SystemEventCode code, float value = 0.0f) {
+    if (!event_queue_.TryPush(SystemEvent{code, Now(), value})) {
+      dropped_events_.fetch_add(1, std::memory_order_relaxed);
     }
-    events_.push_back(event);
   }
-  
+
 private:
   void SuppressSysUiComms(const bool suppress) {
     MLResult result = MLSystemNotificationManagerSetNotifications(system_ui_tracker_, suppress);
@@ -333,133 +450,172 @@ private:
           MLGetResultString(result));
   }
 
-  void CheckSystemEvents() {
-    bool previous_network_connection = network_connection_;
-    network_connection_ = IsNetworkConnected();
-    if (previous_network_connection != network_connection_) {
-      if (network_connection_) {
-        AddEvent("Network Connected.\n");
+  // Applies the queued events and keeps the last SYS_NUM_EVENTS for display.
+  void DrainEvents() {
+    SystemEvent event;
+    while (event_queue_.TryPop(&event)) {
+      if (event.code == SystemEvent_ControllerPowerState) {
+        controller_power_state_ = static_cast<MLPowerManagerPowerState>(event.value);
+      } else if (event.code == SystemEvent_ControllerConnectionState) {
+        controller_connection_state_ = static_cast<MLPowerManagerConnectionState>(event.value);
       }
-      else {
-        AddEvent("Network Disconnected.\n");
+      if (event_history_count_ == SYS_NUM_EVENTS) {
+        event_history_begin_ = (event_history_begin_ + 1) % SYS_NUM_EVENTS;
+        --event_history_count_;
       }
+      event_history_[(event_history_begin_ + event_history_count_) % SYS_NUM_EVENTS] = event;
+      ++event_history_count_;
     }
+  }
 
-    bool previous_internet_connection = internet_connection_;
-    internet_connection_ = IsInternetAvailable();
-    if (previous_internet_connection != internet_connection_) {
-      if (internet_connection_) {
-        AddEvent("Internet Connected.\n");
-      }
-      else {
-        AddEvent("Internet Disconnected.\n");
-      }
-    }
-
-    compute_pack_battery_level_ = GetComputePackBatteryLevel();
-    if (compute_pack_battery_level_ <= 5 && !compute_critical_) {
-      AddEvent("Compute Pack Battery Critically Low (less than %5).\n");
-      compute_critical_ = true;
-    }
-    if (compute_critical_ && compute_pack_battery_level_ > 5) {
-      compute_critical_ = false;
-    }
-
-    if (IsControllerPresent()) {
-      controller_battery_level_ = GetControllerBatteryLevel();
-      if (controller_battery_level_ <= 5 && !controller_critical_) {
-        AddEvent("Controller Battery Critically Low (less than %5).\n");
-        controller_critical_ = true;
-      }
-      if (controller_critical_ && controller_battery_level_ > 5) {
-        controller_critical_ = false;
-      }
-    }
-
-    available_space_ratio_ = float(GetAvailableDiskBytes()+GetAvailableExternalBytes())/float(GetTotalDiskBytes()+GetTotalExternalBytes());
-    if (available_space_ratio_ <= 0.1 && !space_warning_) {
-      AddEvent("Available space is critically low (less than 10%).\n");
-      space_warning_ = true;
-    }
-    if (space_warning_ && available_space_ratio_ > 0.1) {
-      space_warning_ = false;
-    }
-
-    float audio_volume;
-    MLAudioGetMasterVolume(&audio_volume);
-    if ((audio_volume >= 75.0) && !volume_warning_) {
-      AddEvent("High volume warning: consider lowering volume. \n");
-      volume_warning_ = true;
-    }
-    if (volume_warning_ && audio_volume < 75.0) {
-      volume_warning_ = false;
-    }
-
-    compute_pack_battery_temperature_ = GetComputePackBatteryTemperature();
-    if (!compute_pack_battery_temperature_warning_ & (compute_pack_battery_temperature_>=40.0)) {
-      AddEvent("Compute Pack Temperature Warning: greater than 40 degrees Celsius.\n");
-      compute_pack_battery_temperature_warning_ = true;
-    }
+  double Status(StatusSource source) const {
+    return status_monitor_.Value(source);
+  }
 
-    if (compute_pack_battery_temperature_warning_ & (compute_pack_battery_temperature_ < 40.0)) {
-      compute_pack_battery_temperature_warning_ = false;
+  const char *ConnectionStatusString(StatusSource source) const {
+    const double status = Status(source);
+    if (SystemStatusMonitor::IsUnknown(status)) {
+      return "unknown";
     }
+    return status ? "connected" : "disconnected";
+  }
 
-    MLHeadTrackingStateEx cur_state;
-    UNWRAP_MLRESULT(MLHeadTrackingGetStateEx(head_tracker_, &cur_state));
-    uint32_t previous_head_tracker_error = head_tracker_error_;
-    head_tracker_error_ = cur_state.error;
-    if (previous_head_tracker_error != head_tracker_error_) {
-      if (head_tracker_error_ & MLHeadTrackingErrorFlag_LowLight) {
-        AddEvent("Head tracking lost due to low light conditions.\n");
-      }
-      if (head_tracker_error_ & MLHeadTrackingErrorFlag_NotEnoughFeatures) {
-        AddEvent("Head tracking lost because there are not enough features.\n");
-      }
-      if (head_tracker_error_ & MLHeadTrackingErrorFlag_ExcessiveMotion) {
-        AddEvent("Head tracking lost because of excessive motion.\n");
-      }
-      if (head_tracker_error_ & MLHeadTrackingErrorFlag_Unknown) {
-        AddEvent("Head tracking lost due to unknown error.\n");
-      }
-      if (head_tracker_error_ == MLHeadTrackingError_None) {
-        AddEvent("Head tracking restored.\n");
-      }
+  void AddStatusSource(StatusSource source, std::chrono::milliseconds interval, double initial,
+                       SystemStatusMonitor::Sampler sampler, SystemStatusMonitor::ChangeCallback on_change,
+                       SystemStatusMonitor::SampledOn sampled_on = SystemStatusMonitor::SampledOn::Monitor) {
+    if (status_monitor_.AddSource(interval, initial, std::move(sampler), std::move(on_change), sampled_on) !=
+        source) {
+      ALOGE("ERROR: could not add status source %zu", static_cast<size_t>(source));
     }
+  }
 
-    int previous_memory_trim_level_ = memory_trim_level_;
-    memory_trim_level_ = GetLastTrimLevel();
-    if (previous_memory_trim_level_!=memory_trim_level_)
-    {
-      if (memory_trim_level_ == 10) {
-        AddEvent("Memory warning: memory running low.\n");
-      }
-      if (memory_trim_level_ == 15) {
-        AddEvent("Memory warning: memory running critically low.\n");
-      }
-    }
+  // Each source is polled at an interval matching how fast it changes and how much the query
+  // costs, and raises events on the threshold crossings CheckSystemEvents used to look for
+  // every frame. Initial values are the states in which no event is due; connectivity is
+  // unknown until first sampled, and its first sample raises no event.
+  // The queries of the app framework (connectivity, batteries, temperature, disk space and
+  // memory trim) make no thread safety promise, so they all run on the UI thread, from
+  // Dispatch, at their intervals. Only the ML C API queries, volume and head tracking, which
+  // may be called from any thread, run on the monitor thread.
+  void AddStatusSources() {
+    using std::chrono::milliseconds;
+    AddStatusSource(StatusSource_Network, milliseconds(1000), SystemStatusMonitor::kUnknown,
+        [this] { return IsNetworkConnected(); },
+        [this](double previous, double current) {
+          if (!SystemStatusMonitor::IsUnknown(previous)) {
+            AddEvent(current ? SystemEvent_NetworkConnected : SystemEvent_NetworkDisconnected);
+          }
+        },
+        SystemStatusMonitor::SampledOn::Dispatch);
+    AddStatusSource(StatusSource_Internet, milliseconds(2000), SystemStatusMonitor::kUnknown,
+        [this] { return IsInternetAvailable(); },
+        [this](double previous, double current) {
+          if (!SystemStatusMonitor::IsUnknown(previous)) {
+            AddEvent(current ? SystemEvent_InternetConnected : SystemEvent_InternetDisconnected);
+          }
+        },
+        SystemStatusMonitor::SampledOn::Dispatch);
+    AddStatusSource(StatusSource_ComputePackBattery, milliseconds(5000), 100.0,
+        [this] { return GetComputePackBatteryLevel(); },
+        [this](double previous, double current) {
+          if (current <= 5 && previous > 5) {
+            AddEvent(SystemEvent_ComputePackBatteryLow, current);
+          }
+        },
+        SystemStatusMonitor::SampledOn::Dispatch);
+    AddStatusSource(StatusSource_ControllerBattery, milliseconds(5000), 100.0,
+        [this] { return IsControllerPresent() ? GetControllerBatteryLevel() : kControllerNotPresent; },
+        [this](double previous, double current) {
+          // The last level still counts while the controller is away
+          if (current != kControllerNotPresent && current <= 5 && previous > 5) {
+            AddEvent(SystemEvent_ControllerBatteryLow, current);
+          }
+        },
+        SystemStatusMonitor::SampledOn::Dispatch);
+    AddStatusSource(StatusSource_DiskSpace, milliseconds(10000), 1.0,
+        [this] {
+          return float(GetAvailableDiskBytes()+GetAvailableExternalBytes())/float(GetTotalDiskBytes()+GetTotalExternalBytes());
+        },
+        [this](double previous, double current) {
+          if (current <= 0.1 && previous > 0.1) {
+            AddEvent(SystemEvent_DiskSpaceLow, current);
+          }
+        },
+        SystemStatusMonitor::SampledOn::Dispatch);
+    AddStatusSource(StatusSource_Volume, milliseconds(250), 0.0,
+        [this] {
+          float audio_volume = 0.0f;
+          if (MLAudioGetMasterVolume(&audio_volume) != MLResult_Ok) {
+            return Status(StatusSource_Volume);
+          }
+          return double(audio_volume);
+        },
+        [this](double previous, double current) {
+          if (current >= 75.0 && previous < 75.0) {
+            AddEvent(SystemEvent_HighVolume, current);
+          }
+        });
+    AddStatusSource(StatusSource_ComputePackTemperature, milliseconds(5000), 0.0,
+        [this] { return GetComputePackBatteryTemperature(); },
+        [this](double previous, double current) {
+          if (current >= 40.0 && previous < 40.0) {
+            AddEvent(SystemEvent_ComputePackTemperatureHigh, current);
+          }
+        },
+        SystemStatusMonitor::SampledOn::Dispatch);
+    AddStatusSource(StatusSource_HeadTracking, milliseconds(100), MLHeadTrackingErrorFlag_None,
+        [this] {
+          MLHeadTrackingStateEx cur_state;
+          if (MLHeadTrackingGetStateEx(head_tracker_, &cur_state) != MLResult_Ok) {
+            return Status(StatusSource_HeadTracking);
+          }
+          return double(cur_state.error);
+        },
+        [this](double, double current) {
+          const uint32_t head_tracker_error = static_cast<uint32_t>(current);
+          if (head_tracker_error & MLHeadTrackingErrorFlag_LowLight) {
+            AddEvent(SystemEvent_HeadTrackingLowLight, current);
+          }
+          if (head_tracker_error & MLHeadTrackingErrorFlag_NotEnoughFeatures) {
+            AddEvent(SystemEvent_HeadTrackingNotEnoughFeatures, current);
+          }
+          if (head_tracker_error & MLHeadTrackingErrorFlag_ExcessiveMotion) {
+            AddEvent(SystemEvent_HeadTrackingExcessiveMotion, current);
+          }
+          if (head_tracker_error & MLHeadTrackingErrorFlag_Unknown) {
+            AddEvent(SystemEvent_HeadTrackingUnknownError, current);
+          }
+          if (head_tracker_error == MLHeadTrackingError_None) {
+            AddEvent(SystemEvent_HeadTrackingRestored);
+          }
+        });
+    AddStatusSource(StatusSource_MemoryTrim, milliseconds(500), 0.0,
+        [this] { return GetLastTrimLevel(); },
+        [this](double, double current) {
+          if (current == 10) {
+            AddEvent(SystemEvent_MemoryRunningLow, current);
+          }
+          if (current == 15) {
+            AddEvent(SystemEvent_MemoryRunningCritical, current);
+          }
+        },
+        SystemStatusMonitor::SampledOn::Dispatch);
   }
 
-  float available_space_ratio_;
-  bool compute_critical_;
-  int compute_pack_battery_level_;
-  float compute_pack_battery_temperature_;
-  bool compute_pack_battery_temperature_warning_;
-  int controller_battery_level_;
-  bool controller_critical_;
   MLPowerManagerConnectionState controller_connection_state_;
   MLPowerManagerPowerState controller_power_state_;
-  std::vector<std::string> events_;
+  EventRing<SystemEvent, kEventQueueCapacity> event_queue_;
+  std::atomic<uint64_t> dropped_events_{0};
+  // Last SYS_NUM_EVENTS events in a ring, oldest first from event_history_begin_
+  std::array<SystemEvent, SYS_NUM_EVENTS> event_history_ = {};
+  size_t event_history_begin_ = 0;
+  size_t event_history_count_ = 0;
   MLHandle head_tracker_;
-  uint32_t head_tracker_error_;
-  bool internet_connection_;
-  bool network_connection_;
   MLHandle power_manager_handle_;
-  bool space_warning_;
+  SystemStatusMonitor status_monitor_;
   bool system_ui_comms_suppressed_;
   MLHandle system_ui_tracker_;
-  int memory_trim_level_;
-  bool volume_warning_;
+  int64_t start_time_;
 
 
 };
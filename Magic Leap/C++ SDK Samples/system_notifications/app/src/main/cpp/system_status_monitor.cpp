@@ -0,0 +1,134 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "system_status_monitor.h"
+
+#include <algorithm>
+#include <utility>
+
+SystemStatusMonitor::~SystemStatusMonitor() {
+  Stop();
+}
+
+size_t SystemStatusMonitor::AddSource(std::chrono::milliseconds interval, double initial, Sampler sampler,
+                                      ChangeCallback on_change, SampledOn sampled_on) {
+  if (IsRunning() || source_count_ == kMaxSources || !sampler) {
+    return kMaxSources;
+  }
+  Source &source = sources_[source_count_];
+  source.interval = std::max<Clock::duration>(interval, std::chrono::milliseconds(1));
+  source.sampler = std::move(sampler);
+  source.on_change = std::move(on_change);
+  source.sampled_on = sampled_on;
+  source.value.store(initial, std::memory_order_relaxed);
+  source.dispatched = initial;
+  return source_count_++;
+}
+
+void SystemStatusMonitor::Start() {
+  if (IsRunning()) {
+    return;
+  }
+  // Nothing is sampled here: the monitor thread takes the first samples
+  const Clock::time_point now = Clock::now();
+  for (size_t i = 0; i < source_count_; ++i) {
+    sources_[i].due = now;
+  }
+  dispatch_due_ = now;
+  stopping_ = false;
+  thread_ = std::thread(&SystemStatusMonitor::Run, this);
+}
+
+void SystemStatusMonitor::Stop() {
+  if (!IsRunning()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  thread_.join();
+}
+
+double SystemStatusMonitor::Value(size_t source) const {
+  return source < source_count_ ? sources_[source].value.load(std::memory_order_relaxed) : 0.0;
+}
+
+void SystemStatusMonitor::Dispatch() {
+  if (dispatch_due_ != Clock::time_point::max() && IsRunning()) {
+    const Clock::time_point now = Clock::now();
+    if (dispatch_due_ <= now) {
+      dispatch_due_ = SampleDue(SampledOn::Dispatch, now);
+    }
+  }
+  const uint64_t version = version_.load(std::memory_order_acquire);
+  if (version == dispatched_version_) {
+    return;
+  }
+  dispatched_version_ = version;
+  for (size_t i = 0; i < source_count_; ++i) {
+    Source &source = sources_[i];
+    const double current = source.value.load(std::memory_order_relaxed);
+    if (!Same(current, source.dispatched)) {
+      const double previous = source.dispatched;
+      source.dispatched = current;
+      if (source.on_change) {
+        source.on_change(previous, current);
+      }
+    }
+  }
+}
+
+SystemStatusMonitor::Clock::time_point SystemStatusMonitor::SampleDue(SampledOn sampled_on, Clock::time_point now) {
+  Clock::time_point next = Clock::time_point::max();
+  bool changed = false;
+  for (size_t i = 0; i < source_count_; ++i) {
+    Source &source = sources_[i];
+    if (source.sampled_on != sampled_on) {
+      continue;
+    }
+    if (source.due <= now) {
+      const double value = source.sampler();
+      sample_count_.fetch_add(1, std::memory_order_relaxed);
+      if (!Same(value, source.value.load(std::memory_order_relaxed))) {
+        source.value.store(value, std::memory_order_relaxed);
+        changed = true;
+      }
+      source.due += source.interval;
+      // A late sample does not cause a burst of catch up samples
+      if (source.due <= now) {
+        source.due = now + source.interval;
+      }
+    }
+    next = std::min(next, source.due);
+  }
+  if (changed) {
+    version_.fetch_add(1, std::memory_order_release);
+  }
+  return next;
+}
+
+void SystemStatusMonitor::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!stopping_) {
+    lock.unlock();
+    const Clock::time_point next = SampleDue(SampledOn::Monitor, Clock::now());
+    lock.lock();
+    if (next == Clock::time_point::max()) {
+      wake_.wait(lock, [this] { return stopping_; });
+    } else {
+      wake_.wait_until(lock, next, [this] { return stopping_; });
+    }
+  }
+}
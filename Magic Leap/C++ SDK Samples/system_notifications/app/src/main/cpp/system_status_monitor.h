@@ -0,0 +1,123 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+
+/*!
+  \brief Samples system status sources on a background thread and reports changes.
+
+  Every source is a function returning its current value, sampled at its own
+  interval, so expensive queries such as network probes or IPC run rarely and off
+  the UI thread while cheap ones stay responsive. The latest value of each source
+  is cached and can be read lock free from any thread. Dispatch, called from the
+  UI thread, invokes the change callbacks of the sources whose value changed since
+  the previous call and costs a single atomic load when nothing changed, plus a
+  clock read if it samples sources itself. Changes that revert before Dispatch runs
+  are not reported.
+
+  Sources are added before Start. They are sampled on the monitor thread, including
+  the first time, so Start never waits for a query. Sources reading state that only
+  the UI thread may touch are sampled by Dispatch instead, when due.
+*/
+class SystemStatusMonitor {
+ public:
+  static constexpr size_t kMaxSources = 16;
+  // Value of a source that has not been sampled yet
+  static constexpr double kUnknown = std::numeric_limits<double>::quiet_NaN();
+
+  // Thread a source is sampled on
+  enum class SampledOn {
+    Monitor,
+    // The thread calling Dispatch, for sources that are not safe to call from others
+    Dispatch
+  };
+
+  using Sampler = std::function<double()>;
+  // Called by Dispatch with the value last dispatched and the current value
+  using ChangeCallback = std::function<void(double previous, double current)>;
+
+  SystemStatusMonitor() = default;
+  SystemStatusMonitor(const SystemStatusMonitor &) = delete;
+  SystemStatusMonitor &operator=(const SystemStatusMonitor &) = delete;
+  ~SystemStatusMonitor();
+
+  // Adds a source sampled every interval and returns its id. The source holds initial,
+  // e.g. kUnknown, until first sampled, and the first change is reported relative to it.
+  // Returns kMaxSources if the monitor is running or full.
+  size_t AddSource(std::chrono::milliseconds interval, double initial, Sampler sampler,
+                   ChangeCallback on_change, SampledOn sampled_on = SampledOn::Monitor);
+
+  // Starts the monitor thread, which samples its sources right away and then at their
+  // intervals. Sources sampled on Dispatch are due at its next call.
+  void Start();
+  void Stop();
+  bool IsRunning() const { return thread_.joinable(); }
+
+  // Latest value of a source. Lock free, callable from any thread.
+  double Value(size_t source) const;
+  // Samples the due sources sampled on Dispatch while running, then reports the changes
+  // since the previous call to the change callbacks. Call from one thread only.
+  void Dispatch();
+
+  static bool IsUnknown(double value) { return std::isnan(value); }
+
+  // Samples taken so far, to keep track of what the monitoring costs.
+  uint64_t SampleCount() const { return sample_count_.load(std::memory_order_relaxed); }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Source {
+    Clock::duration interval{};
+    Sampler sampler;
+    ChangeCallback on_change;
+    SampledOn sampled_on = SampledOn::Monitor;
+    std::atomic<double> value{0.0};
+    // Value last passed to on_change, only touched by Dispatch
+    double dispatched = 0.0;
+    // Only touched by the thread sampling the sources
+    Clock::time_point due;
+  };
+
+  // Samples the sources of a thread due at now and returns when the next one is due.
+  Clock::time_point SampleDue(SampledOn sampled_on, Clock::time_point now);
+  // Values are equal, or both unknown
+  static bool Same(double a, double b) { return a == b || (IsUnknown(a) && IsUnknown(b)); }
+  void Run();
+
+  std::array<Source, kMaxSources> sources_;
+  size_t source_count_ = 0;
+  // Incremented whenever a sampled value differs from the cached one
+  std::atomic<uint64_t> version_{0};
+  uint64_t dispatched_version_ = 0;
+  // When the next source sampled on Dispatch is due, only touched by Start and Dispatch
+  Clock::time_point dispatch_due_ = Clock::time_point::max();
+  std::atomic<uint64_t> sample_count_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+  std::thread thread_;
+};
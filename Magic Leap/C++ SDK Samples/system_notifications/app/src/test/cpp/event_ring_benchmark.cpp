@@ -0,0 +1,119 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_ring.h"
+#include "system_notifications_test.h"
+
+/*
+  Compares raising events through EventRing with the formatted strings behind a mutex
+  that AddEvent used before, on one thread, and measures ring throughput with several
+  producers and one consumer that yield when the ring is full or empty.
+*/
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+
+  struct Event {
+    uint32_t code;
+    int64_t timestamp;
+    float value;
+  };
+
+  constexpr size_t kCapacity = 64;
+  constexpr uint32_t kEvents = 1'000'000;
+
+  double Nanoseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::nano>(duration).count();
+  }
+
+  void SingleThreadRing() {
+    EventRing<Event, kCapacity> ring;
+    Event event = {};
+    float sum = 0.0f;
+    const Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < kEvents; ++i) {
+      CHECK(ring.TryPush({i % 16, static_cast<int64_t>(i), 0.5f}));
+      CHECK(ring.TryPop(&event));
+      sum += event.value;
+    }
+    const double ns = Nanoseconds(Clock::now() - start) / kEvents;
+    std::printf("%-34s %7.1f ns per event (%g)\n", "ring push and pop", ns, sum);
+  }
+
+  void SingleThreadStrings() {
+    std::mutex mutex;
+    std::deque<std::string> events;
+    size_t length = 0;
+    const Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < kEvents; ++i) {
+      char text[96];
+      std::snprintf(text, sizeof(text), "Warning: event %u occurred with value %f.\n", i % 16, 0.5);
+      std::lock_guard<std::mutex> lock(mutex);
+      if (events.size() >= 10) {
+        length += events.front().size();
+        events.pop_front();
+      }
+      events.emplace_back(text);
+    }
+    const double ns = Nanoseconds(Clock::now() - start) / kEvents;
+    std::printf("%-34s %7.1f ns per event (%zu)\n", "formatted string behind mutex", ns, length);
+  }
+
+  void Producers(uint32_t producer_count) {
+    static EventRing<Event, kCapacity> ring;
+    const uint32_t per_producer = kEvents / producer_count;
+    std::vector<std::thread> producers;
+    const Clock::time_point start = Clock::now();
+    for (uint32_t producer = 0; producer < producer_count; ++producer) {
+      producers.emplace_back([per_producer, producer] {
+        for (uint32_t i = 0; i < per_producer; ++i) {
+          while (!ring.TryPush({producer, static_cast<int64_t>(i), 0.0f})) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+    Event event = {};
+    for (uint64_t popped = 0; popped < static_cast<uint64_t>(per_producer) * producer_count;) {
+      if (ring.TryPop(&event)) {
+        ++popped;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    const Clock::duration elapsed = Clock::now() - start;
+    for (auto &producer : producers) {
+      producer.join();
+    }
+    char name[48];
+    std::snprintf(name, sizeof(name), "ring with %u producer%s", producer_count, producer_count == 1 ? "" : "s");
+    std::printf("%-34s %7.1f M events/s\n", name, per_producer * producer_count / (Nanoseconds(elapsed) / 1e9) / 1e6);
+  }
+}
+
+int main() {
+  SingleThreadRing();
+  SingleThreadStrings();
+  Producers(1);
+  Producers(4);
+  return 0;
+}
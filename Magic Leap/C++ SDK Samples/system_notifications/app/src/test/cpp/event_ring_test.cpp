@@ -0,0 +1,160 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "event_ring.h"
+#include "system_notifications_test.h"
+
+/*
+  Checks the ring on one thread, including full and empty rings and wrapping around,
+  and stresses it with several producers pushing into a small ring while one consumer
+  pops, checking that every record arrives intact and in order per producer. Meant to
+  be run under ThreadSanitizer as well, e.g. with -DCMAKE_CXX_FLAGS=-fsanitize=thread.
+*/
+
+namespace {
+  struct Record {
+    uint32_t producer;
+    uint32_t sequence;
+    // Derived from the other fields, so a torn record is detected
+    uint64_t check;
+  };
+
+  uint64_t Check(uint32_t producer, uint32_t sequence) {
+    return (static_cast<uint64_t>(producer) << 32 | sequence) * 0x9E3779B97F4A7C15ull;
+  }
+
+  void TestSingleThread() {
+    EventRing<Record, 8> ring;
+    Record record = {};
+    CHECK(!ring.TryPop(&record));
+    // Several laps, so positions wrap around the slots and sequence numbers keep growing
+    uint32_t pushed = 0;
+    uint32_t popped = 0;
+    for (int lap = 0; lap < 5; ++lap) {
+      while (ring.TryPush({0, pushed, Check(0, pushed)})) {
+        ++pushed;
+      }
+      CHECK(pushed - popped == 8);
+      for (int i = 0; i < 3 + lap; ++i) {
+        CHECK(ring.TryPop(&record));
+        CHECK(record.sequence == popped && record.check == Check(0, popped));
+        ++popped;
+      }
+    }
+    while (ring.TryPop(&record)) {
+      CHECK(record.sequence == popped);
+      ++popped;
+    }
+    CHECK(popped == pushed);
+    CHECK(!ring.TryPop(&record));
+  }
+
+  // Producers retry when the ring is full, so every record must come through.
+  void TestProducers(uint32_t producer_count, uint32_t records_per_producer) {
+    static EventRing<Record, 64> ring;
+    std::atomic<bool> start{false};
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < producer_count; ++producer) {
+      producers.emplace_back([&, producer] {
+        while (!start.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        for (uint32_t sequence = 0; sequence < records_per_producer; ++sequence) {
+          while (!ring.TryPush({producer, sequence, Check(producer, sequence)})) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+
+    std::vector<uint32_t> expected(producer_count, 0);
+    const uint64_t total = static_cast<uint64_t>(producer_count) * records_per_producer;
+    uint64_t popped = 0;
+    start.store(true, std::memory_order_release);
+    Record record = {};
+    while (popped < total) {
+      if (!ring.TryPop(&record)) {
+        std::this_thread::yield();
+        continue;
+      }
+      CHECK(record.producer < producer_count);
+      CHECK(record.sequence == expected[record.producer]);
+      CHECK(record.check == Check(record.producer, record.sequence));
+      ++expected[record.producer];
+      ++popped;
+    }
+    for (auto &producer : producers) {
+      producer.join();
+    }
+    CHECK(!ring.TryPop(&record));
+    for (uint32_t count : expected) {
+      CHECK(count == records_per_producer);
+    }
+  }
+
+  // Producers that give up on a full ring, as AddEvent does: what was accepted is what arrives.
+  void TestDroppingProducers() {
+    static EventRing<Record, 16> ring;
+    constexpr uint32_t kProducers = 4;
+    constexpr uint32_t kAttempts = 20000;
+    std::atomic<uint64_t> accepted{0};
+    std::atomic<uint32_t> running{kProducers};
+    std::vector<std::thread> producers;
+    for (uint32_t producer = 0; producer < kProducers; ++producer) {
+      producers.emplace_back([&, producer] {
+        for (uint32_t sequence = 0; sequence < kAttempts; ++sequence) {
+          if (ring.TryPush({producer, sequence, Check(producer, sequence)})) {
+            accepted.fetch_add(1, std::memory_order_relaxed);
+          }
+        }
+        running.fetch_sub(1, std::memory_order_release);
+      });
+    }
+
+    std::vector<int64_t> last(kProducers, -1);
+    uint64_t popped = 0;
+    Record record = {};
+    for (;;) {
+      const bool done = running.load(std::memory_order_acquire) == 0;
+      while (ring.TryPop(&record)) {
+        CHECK(record.producer < kProducers);
+        CHECK(record.check == Check(record.producer, record.sequence));
+        CHECK(static_cast<int64_t>(record.sequence) > last[record.producer]);
+        last[record.producer] = record.sequence;
+        ++popped;
+      }
+      if (done) {
+        break;
+      }
+      std::this_thread::yield();
+    }
+    for (auto &producer : producers) {
+      producer.join();
+    }
+    CHECK(popped == accepted.load());
+  }
+}
+
+int main() {
+  TestSingleThread();
+  TestProducers(1, 100000);
+  TestProducers(4, 50000);
+  TestDroppingProducers();
+  return 0;
+}
@@ -0,0 +1,127 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <dirent.h>
+#include <sys/statvfs.h>
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+/*
+  Linux stand-ins for the status queries of the app, for host benchmarks. Each reads the
+  sysfs, procfs or filesystem state closest to the query it replaces, so it costs the same
+  kind of system calls; sources missing on the host report a fixed value.
+*/
+
+namespace linux_status {
+
+  // Reads the first number in a file, or returns fallback if it cannot be read
+  inline double ReadNumber(const char *path, double fallback) {
+    FILE *file = std::fopen(path, "r");
+    if (!file) {
+      return fallback;
+    }
+    double value = fallback;
+    if (std::fscanf(file, "%lf", &value) != 1) {
+      value = fallback;
+    }
+    std::fclose(file);
+    return value;
+  }
+
+  // IsNetworkConnected: whether any interface but loopback is up
+  inline double NetworkConnected() {
+    DIR *dir = opendir("/sys/class/net");
+    if (!dir) {
+      return 0.0;
+    }
+    bool connected = false;
+    while (dirent *entry = readdir(dir)) {
+      if (entry->d_name[0] == '.' || std::strcmp(entry->d_name, "lo") == 0) {
+        continue;
+      }
+      const std::string path = std::string("/sys/class/net/") + entry->d_name + "/operstate";
+      char state[16] = {};
+      if (FILE *file = std::fopen(path.c_str(), "r")) {
+        connected |= std::fscanf(file, "%15s", state) == 1 && std::strcmp(state, "up") == 0;
+        std::fclose(file);
+      }
+    }
+    closedir(dir);
+    return connected ? 1.0 : 0.0;
+  }
+
+  // IsInternetAvailable: whether there is a default route
+  inline double InternetAvailable() {
+    FILE *file = std::fopen("/proc/net/route", "r");
+    if (!file) {
+      return 0.0;
+    }
+    bool available = false;
+    char line[256];
+    while (!available && std::fgets(line, sizeof(line), file)) {
+      char name[32];
+      unsigned long destination = 1;
+      available = std::sscanf(line, "%31s %lx", name, &destination) == 2 && destination == 0;
+    }
+    std::fclose(file);
+    return available ? 1.0 : 0.0;
+  }
+
+  // GetComputePackBatteryLevel and GetControllerBatteryLevel, in percent
+  inline double BatteryLevel() {
+    return ReadNumber("/sys/class/power_supply/BAT0/capacity", 100.0);
+  }
+
+  // GetComputePackBatteryTemperature, in degrees Celsius
+  inline double Temperature() {
+    return ReadNumber("/sys/class/thermal/thermal_zone0/temp", 30000.0) / 1000.0;
+  }
+
+  // Available over total disk bytes
+  inline double DiskSpace() {
+    struct statvfs stats;
+    if (statvfs("/", &stats) != 0 || stats.f_blocks == 0) {
+      return 1.0;
+    }
+    return double(stats.f_bavail) / double(stats.f_blocks);
+  }
+
+  // GetLastTrimLevel: 15 when available memory is critical, 10 when low, 0 otherwise
+  inline double TrimLevel() {
+    FILE *file = std::fopen("/proc/meminfo", "r");
+    if (!file) {
+      return 0.0;
+    }
+    double total = 0.0, available = 0.0;
+    char line[128];
+    while (std::fgets(line, sizeof(line), file)) {
+      std::sscanf(line, "MemTotal: %lf", &total);
+      std::sscanf(line, "MemAvailable: %lf", &available);
+    }
+    std::fclose(file);
+    if (total <= 0.0) {
+      return 0.0;
+    }
+    return available < total * 0.05 ? 15.0 : available < total * 0.1 ? 10.0 : 0.0;
+  }
+
+  // MLAudioGetMasterVolume and MLHeadTrackingGetStateEx are served by other processes on the
+  // device; reading the load average stands in for one such cheap system call
+  inline double ServiceQuery() {
+    return ReadNumber("/proc/loadavg", 0.0);
+  }
+}
@@ -0,0 +1,113 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "linux_status_sources.h"
+#include "system_notifications_test.h"
+#include "system_status_monitor.h"
+
+/*
+  Measures the status cost of a frame on the UI thread, at 90 frames per second, with the
+  sources of the app backed by Linux stand-ins: querying every source every frame as
+  CheckSystemEvents did before, the monitor with the app framework sources sampled on
+  Dispatch as the app runs it, and the monitor with every source on its thread. Each run
+  lasts long enough for the slowest source, disk space, to be sampled twice.
+*/
+
+namespace {
+  using Clock = std::chrono::steady_clock;
+  using std::chrono::milliseconds;
+
+  constexpr auto kFrameInterval = std::chrono::microseconds(11'111);
+  constexpr size_t kFrames = 1'000;
+
+  struct Source {
+    milliseconds interval;
+    double (*sampler)();
+    // Queries of the app framework, which make no thread safety promise
+    bool framework;
+  };
+
+  // The sources of AddStatusSources, in order
+  const Source kSources[] = {
+      {milliseconds(1000), linux_status::NetworkConnected, true},
+      {milliseconds(2000), linux_status::InternetAvailable, true},
+      {milliseconds(5000), linux_status::BatteryLevel, true},
+      {milliseconds(5000), linux_status::BatteryLevel, true},
+      {milliseconds(10000), linux_status::DiskSpace, true},
+      {milliseconds(250), linux_status::ServiceQuery, false},
+      {milliseconds(5000), linux_status::Temperature, true},
+      {milliseconds(100), linux_status::ServiceQuery, false},
+      {milliseconds(500), linux_status::TrimLevel, true},
+  };
+
+  enum class Mode { EveryFrame, FrameworkOnDispatch, AllOnMonitor };
+
+  void Run(const char *name, Mode mode) {
+    SystemStatusMonitor monitor;
+    size_t changes = 0;
+    for (const Source &source : kSources) {
+      const bool on_dispatch = mode == Mode::FrameworkOnDispatch && source.framework;
+      CHECK(monitor.AddSource(source.interval, SystemStatusMonitor::kUnknown, source.sampler,
+                              [&changes](double, double) { ++changes; },
+                              on_dispatch ? SystemStatusMonitor::SampledOn::Dispatch
+                                          : SystemStatusMonitor::SampledOn::Monitor) < SystemStatusMonitor::kMaxSources);
+    }
+    if (mode != Mode::EveryFrame) {
+      monitor.Start();
+    }
+
+    std::vector<double> frame_us;
+    frame_us.reserve(kFrames);
+    double sum = 0.0;
+    Clock::time_point frame = Clock::now();
+    for (size_t i = 0; i < kFrames; ++i) {
+      const Clock::time_point start = Clock::now();
+      if (mode == Mode::EveryFrame) {
+        for (const Source &source : kSources) {
+          sum += source.sampler();
+        }
+      } else {
+        monitor.Dispatch();
+      }
+      frame_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+      frame += kFrameInterval;
+      std::this_thread::sleep_until(frame);
+    }
+    monitor.Stop();
+
+    const uint64_t samples = mode == Mode::EveryFrame ? kFrames * std::size(kSources) : monitor.SampleCount();
+    double mean = 0.0;
+    for (double us : frame_us) {
+      mean += us;
+    }
+    mean /= frame_us.size();
+    std::sort(frame_us.begin(), frame_us.end());
+    std::printf("%-34s %7.2f us mean %8.2f us p99 %8.2f us max %7llu samples (%zu, %g)\n", name, mean,
+                frame_us[frame_us.size() * 99 / 100], frame_us.back(), static_cast<unsigned long long>(samples),
+                changes, sum);
+  }
+}
+
+int main() {
+  Run("every source every frame", Mode::EveryFrame);
+  Run("monitor, framework on Dispatch", Mode::FrameworkOnDispatch);
+  Run("monitor, every source on thread", Mode::AllOnMonitor);
+  return 0;
+}
@@ -0,0 +1,140 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2023 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "system_notifications_test.h"
+#include "system_status_monitor.h"
+
+/*
+  Checks that starting the monitor samples nothing on the calling thread, that sources
+  hold their initial value, possibly unknown, until the monitor thread samples them,
+  that changes reach the callbacks once, and that sources sampled on Dispatch only run
+  on the dispatching thread while the monitor is running.
+*/
+
+namespace {
+  using std::chrono::milliseconds;
+
+  struct Change {
+    double previous;
+    double current;
+  };
+
+  void TestFirstSampleOnMonitorThread() {
+    SystemStatusMonitor monitor;
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> release{false};
+    std::atomic<bool> sampled_on_caller{false};
+    std::atomic<int> samples{0};
+    std::vector<Change> changes;
+    const size_t source = monitor.AddSource(
+        milliseconds(1),
+        SystemStatusMonitor::kUnknown,
+        [&] {
+          sampled_on_caller = sampled_on_caller || std::this_thread::get_id() == caller;
+          // A slow query, such as a network probe, does not hold up Start
+          while (!release) {
+            std::this_thread::sleep_for(milliseconds(1));
+          }
+          return ++samples >= 3 ? 1.0 : 0.0;
+        },
+        [&](double previous, double current) { changes.push_back({previous, current}); });
+    CHECK(source == 0);
+
+    monitor.Start();
+    CHECK(monitor.IsRunning());
+    CHECK(SystemStatusMonitor::IsUnknown(monitor.Value(source)));
+    // An unknown value that stays unknown is not a change
+    monitor.Dispatch();
+    monitor.Dispatch();
+    CHECK(changes.empty());
+
+    release = true;
+    CHECK(WaitFor([&] { return monitor.Value(source) == 1.0; }));
+    monitor.Stop();
+    CHECK(!sampled_on_caller);
+    monitor.Dispatch();
+    // Changes that happened between two calls are reported once, against the last dispatched value
+    CHECK(changes.size() == 1);
+    CHECK(SystemStatusMonitor::IsUnknown(changes[0].previous) && changes[0].current == 1.0);
+    monitor.Dispatch();
+    CHECK(changes.size() == 1);
+    CHECK(monitor.SampleCount() >= 3);
+  }
+
+  void TestSampledOnDispatch() {
+    SystemStatusMonitor monitor;
+    const std::thread::id caller = std::this_thread::get_id();
+    std::atomic<bool> sampled_elsewhere{false};
+    std::atomic<int> samples{0};
+    int dispatched = 0;
+    const size_t source = monitor.AddSource(
+        milliseconds(1), 0.0,
+        [&] {
+          sampled_elsewhere = sampled_elsewhere || std::this_thread::get_id() != caller;
+          return static_cast<double>(++samples);
+        },
+        [&](double, double) { ++dispatched; }, SystemStatusMonitor::SampledOn::Dispatch);
+    const size_t background = monitor.AddSource(milliseconds(1), 0.0, [] { return 2.0; }, nullptr);
+    CHECK(source == 0 && background == 1);
+
+    // Not sampled before the monitor runs
+    monitor.Dispatch();
+    CHECK(samples == 0);
+
+    monitor.Start();
+    CHECK(WaitFor([&] { return monitor.Value(background) == 2.0; }));
+    CHECK(samples == 0);
+    for (int i = 0; i < 5; ++i) {
+      monitor.Dispatch();
+      std::this_thread::sleep_for(milliseconds(2));
+    }
+    monitor.Stop();
+    CHECK(samples == 5);
+    CHECK(dispatched == 5);
+    CHECK(monitor.Value(source) == 5.0);
+    CHECK(!sampled_elsewhere);
+
+    // Stopped monitors sample nothing, not even on Dispatch
+    monitor.Dispatch();
+    CHECK(samples == 5);
+  }
+
+  void TestAddSource() {
+    SystemStatusMonitor monitor;
+    for (size_t i = 0; i < SystemStatusMonitor::kMaxSources; ++i) {
+      CHECK(monitor.AddSource(milliseconds(1000), 0.0, [] { return 0.0; }, nullptr) == i);
+    }
+    CHECK(monitor.AddSource(milliseconds(1000), 0.0, [] { return 0.0; }, nullptr) ==
+          SystemStatusMonitor::kMaxSources);
+
+    SystemStatusMonitor running;
+    CHECK(running.AddSource(milliseconds(1000), 0.0, nullptr, nullptr) == SystemStatusMonitor::kMaxSources);
+    running.Start();
+    CHECK(running.AddSource(milliseconds(1000), 0.0, [] { return 0.0; }, nullptr) ==
+          SystemStatusMonitor::kMaxSources);
+    running.Stop();
+    CHECK(!running.IsRunning());
+  }
+}
+
+int main() {
+  TestFirstSampleOnMonitorThread();
+  TestSampledOnDispatch();
+  TestAddSource();
+  return 0;
+}
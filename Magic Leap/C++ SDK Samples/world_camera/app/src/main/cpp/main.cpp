@@ -22,7 +22,12 @@
 #include <app_framework/registry.h>
 #include <app_framework/toolset.h>
 
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <map>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <utility>
 
@@ -30,6 +35,21 @@
 #include <ml_time.h>
 #include <ml_world_camera.h>
 
+#include "world_camera_allocation_counter.h"
+#include "world_camera_bundler.h"
+#include "world_camera_change_detector.h"
+#include "world_camera_gl_texture_backend.h"
+#include "world_camera_label.h"
+#include "world_camera_pose_history.h"
+#include "world_camera_recorder.h"
+#include "world_camera_replay.h"
+#include "world_camera_sequence_tracker.h"
+#include "world_camera_stats.h"
+#include "world_camera_stream.h"
+#include "world_camera_texture_atlas.h"
+#include "world_camera_texture_streamer.h"
+#include "world_camera_undistort.h"
+
 
 using namespace ml::app_framework;
 
@@ -64,6 +84,37 @@ namespace {
           return "Error";
       }
     }
+
+    // Frames queued per camera and frame type when delivering all buffered frames
+    constexpr uint32_t kBufferedQueueDepth = 4;
+
+    // Every fourth row is enough to judge exposure and blur at a quarter of the cost
+    constexpr uint32_t kStatsRowStep = 4;
+
+    // The atlas keeps the arrangement of separate previews: cameras left to right, low exposure on top
+    constexpr uint32_t kAtlasColumns = 3;
+    constexpr uint32_t kAtlasRows = 2;
+    // Size of the atlas quad, so each cell matches the size of a separate preview
+    constexpr float kAtlasWidth = 1.5f;
+    constexpr float kAtlasHeight = 1.0f;
+
+    size_t AtlasCell(MLWorldCameraIdentifier camera, MLWorldCameraFrameType mode) {
+      size_t column = 0;
+      switch (camera) {
+        case MLWorldCameraIdentifier_Left: column = 0; break;
+        case MLWorldCameraIdentifier_Center: column = 1; break;
+        default: column = 2; break;
+      }
+      const size_t row = mode == MLWorldCameraFrameType_LowExposure ? 0 : 1;
+      return row * kAtlasColumns + column;
+    }
+
+    WorldCameraBundler::Settings GetBundlerSettings() {
+      WorldCameraBundler::Settings settings;
+      // Only bundle timing is inspected, so the pixels need not outlive the camera data
+      settings.copy_pixels = false;
+      return settings;
+    }
 }
 
 class WorldCameraApp : public Application {
@@ -71,8 +122,13 @@ public:
     WorldCameraApp(struct android_app *state)
             : Application(state, std::vector<std::string>{"android.permission.CAMERA"}, USE_GUI),
               preview_initialized_(false),
+              undistort_preview_(false),
+              buffered_polling_(false),
+              atlas_preview_(false),
               texture_width_(1016),
               texture_height_(1016),
+              capture_path_(std::string(state->activity->externalDataPath) + "/world_camera.wcap"),
+              bundler_(GetBundlerSettings()),
               world_camera_handle_(ML_INVALID_HANDLE) {
       // Start with all cameras and modes active
       available_cameras_[MLWorldCameraIdentifier_Left] = true;
@@ -84,11 +140,6 @@ public:
       for (const auto& [camera, _] : available_cameras_) {
         for (const auto& [mode, __] : available_modes_) {
           const auto camera_mode_pair = std::make_pair(camera, mode);
-          texture_ids_[camera_mode_pair] = 0;
-
-          // Set to -1 to signify we haven't seen any frames before
-          last_frame_num_[camera_mode_pair] = -1;
-          dropped_frame_count[camera_mode_pair] = 0;
           text_offsets_[camera_mode_pair] = glm::vec3{-.5f, 0.77f, 0.f};
 
           // Change these to tune location of displays
@@ -122,6 +173,7 @@ public:
       world_camera_settings_.cameras = MLWorldCameraIdentifier_All;
       world_camera_settings_.mode =
               MLWorldCameraFrameType_LowExposure | MLWorldCameraFrameType_NormalExposure;
+      world_camera_schedule_ = WorldCameraSchedule();
     }
 
     void OnResume() override {
@@ -132,39 +184,43 @@ public:
     }
 
     void OnPause() override {
+      if (recorder_.IsRecording() && !recorder_.Stop()) {
+        ALOGE("ERROR: failed to finish recording %s", capture_path_.c_str());
+      }
+      if (replay_.IsConnected()) {
+        UNWRAP_MLRESULT(replay_.Disconnect());
+      }
       if (MLHandleIsValid(world_camera_handle_)) {
         UNWRAP_MLRESULT(MLWorldCameraDisconnect(world_camera_handle_));
         world_camera_handle_ = ML_INVALID_HANDLE;
       }
       // Need to reset the last frame number so that those frames are not counted as dropped
-      for (auto& [_,last_frame_num] : last_frame_num_) {
-        last_frame_num = -1;
-      }
+      frame_sequences_.ResetAll();
+      bundler_.Reset();
+      pose_history_.Reset();
     }
 
     void OnPreRender() override {
-      if (!MLHandleIsValid(world_camera_handle_)) {
+      if (!MLHandleIsValid(world_camera_handle_) && !replay_.IsConnected()) {
         return;
       }
+      const uint64_t allocations = WorldCameraAllocationCount();
       MLWorldCameraData data;
       MLWorldCameraData *data_ptr = &data;
       MLWorldCameraDataInit(data_ptr);
-      MLResult result = MLWorldCameraGetLatestWorldCameraData(world_camera_handle_, 0, &data_ptr);
-
-      // Push frames into map to check each camera has 1 frame per data object,
-      // and to ensure order of cameras in GUI is always the same
-      std::map<CameraIdModePair, MLWorldCameraFrame> processed_cameras;
-
-      if (result == MLResult_Ok) {
-        if (data.frame_count < 1) {
-          ALOGW("ERROR: received MLWorldCameraData with less than 1 frame count. Cannot process this data.");
-          UNWRAP_MLRESULT(MLWorldCameraReleaseCameraData(world_camera_handle_, &data));
-          return;
-        }
-
-        // Update display to preview image
-        for (int current_frame = 0; current_frame < data.frame_count; current_frame++) {
-          const auto frame = &data.frames[current_frame];
+      MLResult result = PollWorldCameraData(&data_ptr);
+
+      // Newest frame of each stream, to check each camera has 1 frame per latest data object
+      // and to preview it. The frames stay valid until the data is released, so they are
+      // referenced rather than copied
+      std::array<const MLWorldCameraFrame *, kWorldCameraStreamCount> processed_frames = {};
+
+      if (result == MLResult_Ok && data_ptr->frame_count < 1) {
+        ALOGW("ERROR: received MLWorldCameraData with less than 1 frame count. Cannot process this data.");
+        ReleaseWorldCameraData(data_ptr);
+      } else if (result == MLResult_Ok) {
+        for (int current_frame = 0; current_frame < data_ptr->frame_count; current_frame++) {
+          const auto frame = &data_ptr->frames[current_frame];
           const auto camera =  frame->id;
           const auto mode = frame->frame_type;
 
@@ -181,88 +237,180 @@ public:
             continue;
           }
 
-          const auto camera_mode_pair = std::make_pair(camera, mode);
-          if (processed_cameras.insert(std::make_pair(camera_mode_pair, *frame)).second == false) {
+          const auto stream = WorldCameraStreamIndex(*frame);
+          if (stream == kWorldCameraStreamCount) {
+            ALOGE("ERROR: cannot process unknown camera, skipping frame.");
+            continue;
+          }
+          if (processed_frames[stream] && !IsPollingBuffered()) {
             ALOGW("WARNING: camera: %s mode: %s had two frames processed. It is expected that each MLWorldCameraData has only 1 frame for each camera. Not processing second this frame.",
                   GetMLWorldCameraIdentifierString(camera), GetMLWorldCameraFrameTypeString(mode));
             continue;
           }
+          processed_frames[stream] = frame;
 
-          glBindTexture(GL_TEXTURE_2D, texture_ids_[camera_mode_pair]);
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, texture_width_, texture_height_, 0, GL_RED,
-                       GL_UNSIGNED_BYTE, frame->frame_buffer.data);
-          glBindTexture(GL_TEXTURE_2D, 0);
+          // Recorder copies the frame and persists it on its own thread
+          if (recorder_.IsRecording()) {
+            recorder_.Submit(*frame);
+          }
+          bundler_.Submit(*frame, [](const WorldCameraBundler::Bundle &) {});
+          CheckFrameSequence(*frame);
+          pose_history_.Add(*frame);
+        }
 
-          const std::string label = std::string(GetMLWorldCameraIdentifierString(camera)) + "\n" +
-                              std::string(GetMLWorldCameraFrameTypeString(mode)) +
-                              "\nFrame Number: " + std::to_string(frame->frame_number);
+        // Update display to preview image
+        for (const auto frame : processed_frames) {
+          if (!frame) {
+            continue;
+          }
+          const auto camera = frame->id;
+          const auto mode = frame->frame_type;
+          const auto camera_mode_pair = std::make_pair(camera, mode);
+          const auto stream = WorldCameraStreamIndex(*frame);
+          ComputeWorldCameraFrameStats(frame->frame_buffer, kStatsRowStep, &frame_stats_[stream]);
+
+          auto &tile = preview_tiles_[stream];
+          if (undistort_preview_) {
+            // Undistort straight into the upload buffer rather than through an intermediate image
+            const auto &buffer = frame->frame_buffer;
+            uint32_t stride = buffer.width;
+            uint8_t *staging = atlas_ ? atlas_->BeginCell(tile.atlas_cell, buffer.width, buffer.height, &stride) :
+                                        tile.streamer->BeginUpload(buffer.width, buffer.height, stride);
+            if (staging) {
+              if (!undistorter_.Undistort(*frame, staging, stride)) {
+                for (uint32_t row = 0; row < buffer.height; ++row) {
+                  memcpy(staging + row * stride, buffer.data + row * buffer.stride, buffer.width);
+                }
+              }
+              if (!atlas_) {
+                tile.streamer->EndUpload();
+              }
+            }
+            // The texture no longer holds the raw frame the change detector compares against
+            change_detector_.Invalidate(camera, mode);
+          } else if (const auto tiles = change_detector_.Update(*frame)) {
+            // Only tiles that changed since the last upload are copied to the texture
+            const bool uploaded = atlas_ ? atlas_->Upload(tile.atlas_cell, frame->frame_buffer, *tiles) :
+                                           tile.streamer->Upload(frame->frame_buffer, *tiles);
+            if (!uploaded) {
+              change_detector_.Invalidate(camera, mode);
+            }
+          }
 
-          SetNodeText(camera_mode_pair, label.c_str());
+          // Only the frame number is reformatted, in place
+          if (tile.label.SetNumber(frame->frame_number) && tile.text) {
+            tile.text->SetText(tile.label.c_str());
+          }
 
           // Save new frame data to member variable for display on GUI
           last_frame_info_[camera_mode_pair] = *frame;
         }
-        UNWRAP_MLRESULT(MLWorldCameraReleaseCameraData(world_camera_handle_, &data));
-        CheckDroppedFrames(processed_cameras);
+        ReleaseWorldCameraData(data_ptr);
       } else {
-        ALOGW("MLWorldCameraGetLatestWorldCameraData returned error: %s!",
+        ALOGW("%s%s returned error: %s!", replay_.IsConnected() ? "Replay " : "",
+              IsPollingBuffered() ? "GetBufferedWorldCameraData" : "GetLatestWorldCameraData",
               MLGetResultString(result));
       }
       UpdateGuiConsole();
+      // All previews of the atlas, and cells the GUI cleared, are transferred in one upload.
+      // Flushing every frame also ends an upload that was begun, so it never stays mapped
+      if (atlas_) {
+        atlas_->Flush();
+      }
+
+      // Steady state frames are expected not to touch the heap
+      frame_allocations_ = WorldCameraAllocationCount() - allocations;
+      if (frame_allocations_ > 0) {
+        ++allocating_frames_;
+      }
     }
 
 private:
-    void SetNodeText(CameraIdModePair camera_mode_pair, const char * label) {
-      // Display_nodes_ contains preview_node_
-      for (const auto& first_child : display_nodes_[camera_mode_pair]->GetChildren()) {
-        for (const auto& second_child : first_child->GetChildren()) {
-          auto component = second_child->GetComponent<TextComponent>();
-          if (component) {
-            component->SetText(label);
-          }
-        }
+    // Scene graph handles of the preview of one stream. They are resolved once when the
+    // preview is built, so per frame updates need no tree walk or component lookup
+    struct PreviewTile {
+      // Root of the preview, holding the image and label nodes that own the components
+      std::shared_ptr<Node> node;
+      TextComponent *text = nullptr;
+      // Every renderable of the image and label nodes, hidden and shown together
+      std::array<RenderableComponent *, 2> renderables = {};
+      GLuint texture_id = 0;
+      std::unique_ptr<WorldCameraTextureStreamer> streamer;
+      // Cell of the preview when all previews share the atlas, which has neither texture nor streamer
+      size_t atlas_cell = 0;
+      WorldCameraLabel label;
+    };
+
+    // Only the replay queues frames; the device is always polled for the latest ones
+    bool IsPollingBuffered() const {
+      return buffered_polling_ && replay_.IsConnected();
+    }
+
+    // Queue depths are output settings of the replay, which devices do not have
+    WorldCameraReplay::OutputSettings GetReplayOutputSettings() const {
+      WorldCameraReplay::OutputSettings settings;
+      settings.queue_depth.fill(buffered_polling_ ? kBufferedQueueDepth : 1);
+      return settings;
+    }
+
+    // Frames come from the replay of the last recording while it is connected, otherwise from the device
+    MLResult PollWorldCameraData(MLWorldCameraData **inout_data) {
+      if (replay_.IsConnected()) {
+        // Buffered polls return every queued frame rather than only the latest one
+        return buffered_polling_ ? replay_.GetBufferedWorldCameraData(0, inout_data) :
+                                   replay_.GetLatestWorldCameraData(0, inout_data);
       }
+      return MLWorldCameraGetLatestWorldCameraData(world_camera_handle_, 0, inout_data);
     }
 
-    void CheckDroppedFrames(const std::map<CameraIdModePair, MLWorldCameraFrame> &processed_cameras) {
-      for (const auto& [camera_mode_pair, frame] : processed_cameras) {
-        if ((available_cameras_[camera_mode_pair.first] == false) ||
-            (available_modes_[camera_mode_pair.second] == false)) {
-          continue;
-        }
+    void ReleaseWorldCameraData(MLWorldCameraData *data) {
+      if (replay_.IsConnected()) {
+        UNWRAP_MLRESULT(replay_.ReleaseCameraData(data));
+      } else {
+        UNWRAP_MLRESULT(MLWorldCameraReleaseCameraData(world_camera_handle_, data));
+      }
+    }
 
-        if (frame.frame_number < 0) {
-          ALOGE("ERROR: %s %s returned an invalid frame number: %ld",
-                GetMLWorldCameraIdentifierString(camera_mode_pair.first),
-                GetMLWorldCameraFrameTypeString(camera_mode_pair.second), frame.frame_number);
-          continue;
+    void SetReplaying(bool replaying) {
+      if (replaying) {
+        // The capture is memory mapped by the replay, so it must not be written meanwhile
+        if (recorder_.IsRecording() && !recorder_.Stop()) {
+          ALOGE("ERROR: failed to finish recording %s", capture_path_.c_str());
+        }
+        const MLResult result = replay_.Connect(capture_path_.c_str(), &world_camera_settings_,
+                                                WorldCameraReplay::Timing::Recorded, true);
+        if (result != MLResult_Ok) {
+          ALOGE("ERROR: failed to replay %s: %s", capture_path_.c_str(), MLGetResultString(result));
+          return;
         }
+        const WorldCameraReplay::OutputSettings output_settings = GetReplayOutputSettings();
+        UNWRAP_MLRESULT(replay_.SetOutputSettings(&output_settings));
+        UNWRAP_MLRESULT(replay_.SetSchedule(&world_camera_schedule_));
+      } else if (replay_.IsConnected()) {
+        UNWRAP_MLRESULT(replay_.Disconnect());
+      } else {
+        return;
+      }
+      // Frames of the other source are not a continuation of the ones seen so far
+      frame_sequences_.ResetAll();
+      bundler_.Reset();
+      pose_history_.Reset();
+    }
 
-        // Check for dropped frames only if last_frame_num_ has been initialized
-        if (last_frame_num_[camera_mode_pair] != -1) {
-          if (frame.frame_number == last_frame_num_[camera_mode_pair]) {
-            ALOGE("ERROR: %s %s received the same frame number twice: %ld",
-                  GetMLWorldCameraIdentifierString(camera_mode_pair.first),
-                  GetMLWorldCameraFrameTypeString(camera_mode_pair.second), frame.frame_number);
-            continue;
-          }
+    void CheckFrameSequence(const MLWorldCameraFrame &frame) {
+      if ((available_cameras_[frame.id] == false) || (available_modes_[frame.frame_type] == false)) {
+        return;
+      }
 
-          int64_t frame_num_diff;
-          // Detect if frame number rolled over
-          if (frame.frame_number < last_frame_num_[camera_mode_pair]) {
-            frame_num_diff = (INT64_MAX - last_frame_num_[camera_mode_pair]) + frame.frame_number;
-            // Frame rolls over to 0 so add 1
-            frame_num_diff += 1;
-          } else {
-            frame_num_diff = frame.frame_number - last_frame_num_[camera_mode_pair];
-          }
-          // Deal with both normal increment by 1 and rollover to 0 (add 1 above)
-          if (frame_num_diff > 1) {
-            dropped_frame_count[camera_mode_pair] = dropped_frame_count[camera_mode_pair] + frame_num_diff;
-          }
-        }
-        // Always update last_frame_num_
-        last_frame_num_[camera_mode_pair] = frame.frame_number;
+      const auto result = frame_sequences_.Update(frame.id, frame.frame_type, frame.frame_number);
+      if (result == WorldCameraSequenceTracker::Result::Invalid) {
+        ALOGE("ERROR: %s %s returned an invalid frame number: %ld",
+              GetMLWorldCameraIdentifierString(frame.id),
+              GetMLWorldCameraFrameTypeString(frame.frame_type), frame.frame_number);
+      } else if (result == WorldCameraSequenceTracker::Result::Duplicate) {
+        ALOGE("ERROR: %s %s received the same frame number twice: %ld",
+              GetMLWorldCameraIdentifierString(frame.id),
+              GetMLWorldCameraFrameTypeString(frame.frame_type), frame.frame_number);
       }
     }
 
@@ -293,13 +441,42 @@ private:
                       GetMLWorldCameraFrameTypeString(mode));
                 continue;
               }
-              const auto label = std::string(GetMLWorldCameraIdentifierString(camera)) + " " +
-                           GetMLWorldCameraFrameTypeString(mode);
+              const WorldCameraLabel label({GetMLWorldCameraIdentifierString(camera), " ",
+                                            GetMLWorldCameraFrameTypeString(mode)});
               if (ImGui::CollapsingHeader(label.c_str())) {
                 const auto frame = it->second;
 
                 ImGui::Text("\tFrame number: %ld", frame.frame_number);
-                ImGui::Text("\tDropped frames: %d", dropped_frame_count[camera_mode_pair]);
+                const auto &sequence = frame_sequences_.Stream(camera, mode);
+                const auto last_gap = frame_sequences_.LastGap(camera, mode);
+                if (last_gap) {
+                  ImGui::Text("\tDropped frames: %lu, last missing: %ld-%ld", sequence.dropped,
+                              last_gap->first, last_gap->last);
+                } else {
+                  ImGui::Text("\tDropped frames: %lu", sequence.dropped);
+                }
+                if (recorder_.IsRecording()) {
+                  const auto counters = recorder_.GetCounters(camera, mode);
+                  ImGui::Text("\tRecorded frames: %lu (%lu bytes), dropped by recorder: %lu",
+                              counters.frames_written, counters.bytes_written, counters.frames_dropped);
+                }
+                const auto &streamer = preview_tiles_[WorldCameraStreamIndex(camera, mode)].streamer;
+                if (streamer) {
+                  const auto &uploads = streamer->GetCounters();
+                  ImGui::Text("\tTexture uploads: %lu (%lu bytes), skipped: %lu, stalls: %lu, rejected: %lu",
+                              uploads.uploads, uploads.bytes_copied, uploads.skipped, uploads.stalls,
+                              uploads.rejected);
+                }
+                const auto &stats = frame_stats_[WorldCameraStreamIndex(camera, mode)];
+                if (stats.pixel_count > 0) {
+                  const auto clipped = stats.histogram[0] + stats.histogram[WorldCameraFrameStats::kBinCount - 1];
+                  ImGui::Text("\tMean: %.1f, std dev: %.1f, clipped: %.1f%%, sharpness: %.0f", stats.mean,
+                              std::sqrt(stats.variance), 100.0 * clipped / stats.pixel_count, stats.sharpness);
+                }
+                const auto &changes = change_detector_.GetCounters(camera, mode);
+                if (changes.tiles > 0) {
+                  ImGui::Text("\tChanged tiles: %.1f%%", 100.0 * changes.dirty_tiles / changes.tiles);
+                }
 
                 timespec ts = {};
                 UNWRAP_MLRESULT(MLTimeConvertMLTimeToSystemTime(frame.timestamp, &ts));
@@ -311,6 +488,8 @@ private:
                 ImGui::Text("\tCamera rotation xyzw: (%.2f, %.2f, %.2f, %.2f)",
                             frame.camera_pose.rotation.x, frame.camera_pose.rotation.y,
                             frame.camera_pose.rotation.z, frame.camera_pose.rotation.w);
+                ImGui::Text("\tPose history: %zu poses over %.1f ms", pose_history_.Size(camera),
+                            (pose_history_.Newest(camera) - pose_history_.Oldest(camera)) / 1e6);
 
                 ImGui::NewLine();
                 DrawIntrinsicDetails("Intrinsics:", frame.intrinsics);
@@ -352,9 +531,8 @@ private:
         if (status == false) {
           continue;
         }
-        const auto camera_mode_pair = std::make_pair(camera, mode);
-        SetPreviewVisibility(display_nodes_[camera_mode_pair], state);
-        last_frame_num_[camera_mode_pair] = -1;
+        SetPreviewVisibility(preview_tiles_[WorldCameraStreamIndex(camera, mode)], state);
+        frame_sequences_.Reset(camera, mode);
       }
       if (state) {
         world_camera_settings_.mode = world_camera_settings_.mode | mode;
@@ -369,9 +547,8 @@ private:
         if (status == false) {
           continue;
         }
-        const auto camera_mode_pair = std::make_pair(id, mode);
-        SetPreviewVisibility(display_nodes_[camera_mode_pair], state);
-        last_frame_num_[camera_mode_pair] = -1;
+        SetPreviewVisibility(preview_tiles_[WorldCameraStreamIndex(id, mode)], state);
+        frame_sequences_.Reset(id, mode);
       }
       if (state) {
         world_camera_settings_.cameras = world_camera_settings_.cameras | id;
@@ -380,17 +557,16 @@ private:
       }
     }
 
-    void SetPreviewVisibility(std::shared_ptr<Node> node, bool state) {
-      // Display_nodes_ contains preview_node_
-      for (auto first_child : node->GetChildren()) {
-        // Preview_node contains gui and text
-        for (auto second_child : first_child->GetChildren()) {
-          auto component = second_child->GetComponent<RenderableComponent>();
-          if (component) {
-            component->SetVisible(state);
-          }
+    void SetPreviewVisibility(const PreviewTile &tile, bool state) {
+      for (auto renderable : tile.renderables) {
+        if (renderable) {
+          renderable->SetVisible(state);
         }
       }
+      // The atlas quad stays visible, so a hidden preview is blanked instead
+      if (atlas_ && !state) {
+        atlas_->Clear(tile.atlas_cell);
+      }
     }
 
     void DrawSettingsDialog() {
@@ -398,7 +574,7 @@ private:
       ImGui::Text("Modes:");
       ImGui::SameLine();
       for (const auto& [mode, _] : available_modes_) {
-        const std::string label = std::string(GetMLWorldCameraFrameTypeString(mode)) + " Mode";
+        const WorldCameraLabel label({GetMLWorldCameraFrameTypeString(mode), " Mode"});
         ImGui::SameLine();
         if (ImGui::Checkbox(label.c_str(), &available_modes_[mode])) {
           UpdateCameraMode(mode, available_modes_[mode]);
@@ -417,8 +593,96 @@ private:
         }
       }
 
+      // Frames are queued by the replay so a slow frame does not lose the ones captured meanwhile
+      const bool replay_settings_updated = ImGui::Checkbox("Deliver all buffered frames of replay", &buffered_polling_);
+
       if (settings_updated) {
         UNWRAP_MLRESULT(MLWorldCameraUpdateSettings(world_camera_handle_, &world_camera_settings_));
+        bundler_.SetCameras(world_camera_settings_.cameras);
+      }
+      if (settings_updated && replay_.IsConnected()) {
+        UNWRAP_MLRESULT(replay_.UpdateSettings(&world_camera_settings_));
+      }
+      if (replay_settings_updated && replay_.IsConnected()) {
+        const WorldCameraReplay::OutputSettings output_settings = GetReplayOutputSettings();
+        UNWRAP_MLRESULT(replay_.SetOutputSettings(&output_settings));
+      }
+
+      // The schedule thins the frames of the replay. The same target rate applies to every
+      // camera; 0 shares the slots left by the other mode
+      bool schedule_updated = false;
+      for (const auto& [mode, _] : available_modes_) {
+        // Frame types are numbered from 1 in the order of the schedule's mode entries
+        const size_t mode_index = static_cast<size_t>(mode) - 1;
+        const WorldCameraLabel label({GetMLWorldCameraFrameTypeString(mode), " replay rate"});
+        float rate = world_camera_schedule_.target_rate[0][mode_index];
+        if (ImGui::SliderFloat(label.c_str(), &rate, 0.0f, 60.0f, rate > 0.0f ? "%.0f Hz" : "shared")) {
+          for (auto &camera_rates : world_camera_schedule_.target_rate) {
+            camera_rates[mode_index] = rate;
+          }
+          schedule_updated = true;
+        }
+      }
+      bool prioritize_low_exposure = world_camera_schedule_.priority_mode == MLWorldCameraMode_LowExposure;
+      if (ImGui::Checkbox("Prioritize low exposure latency", &prioritize_low_exposure)) {
+        world_camera_schedule_.priority_mode =
+                prioritize_low_exposure ? MLWorldCameraMode_LowExposure : MLWorldCameraMode_Unknown;
+        schedule_updated = true;
+      }
+      if (schedule_updated && replay_.IsConnected()) {
+        UNWRAP_MLRESULT(replay_.SetSchedule(&world_camera_schedule_));
+      }
+
+      ImGui::Checkbox("Undistort preview", &undistort_preview_);
+      ImGui::SameLine();
+      if (ImGui::Checkbox("Single atlas preview", &atlas_preview_) && preview_initialized_) {
+        SetupPreview();
+      }
+
+      bool recording = recorder_.IsRecording();
+      if (ImGui::Checkbox("Record to file", &recording)) {
+        if (recording) {
+          SetReplaying(false);
+          if (!recorder_.Start(capture_path_.c_str())) {
+            ALOGE("ERROR: failed to start recording to %s", capture_path_.c_str());
+          }
+        } else if (!recorder_.Stop()) {
+          ALOGE("ERROR: failed to finish recording %s", capture_path_.c_str());
+        }
+      }
+      if (recorder_.IsRecording()) {
+        ImGui::SameLine();
+        ImGui::Text("Queued frames: %zu%s", recorder_.QueueDepth(), recorder_.IsDirectIO() ? " (direct I/O)" : "");
+      }
+      ImGui::SameLine();
+      bool replaying = replay_.IsConnected();
+      if (ImGui::Checkbox("Replay recording", &replaying)) {
+        SetReplaying(replaying);
+      }
+
+      const auto &bundles = bundler_.GetStatistics();
+      const uint64_t bundle_count = bundles.bundles_complete + bundles.bundles_partial;
+      ImGui::Text("%s bundles: %lu complete, %lu partial, %lu unmatched frames, skew mean %.3f ms max %.3f ms",
+                  GetMLWorldCameraFrameTypeString(bundler_.GetSettings().frame_type),
+                  bundles.bundles_complete, bundles.bundles_partial, bundles.frames_unmatched,
+                  bundle_count ? bundles.total_skew / 1e6 / bundle_count : 0.0, bundles.max_skew / 1e6);
+
+      // Only the replay serves frames from a pool whose status can be read
+      WorldCameraReplay::PoolStatus pool;
+      if (replay_.IsConnected() && replay_.GetPoolStatus(&pool) == MLResult_Ok) {
+        ImGui::Text("Frame pool: data %u/%u (peak %u), buffers %u/%u (peak %u, leased %u), exhausted: %lu polls, %lu frames",
+                    pool.data_in_use, pool.data_capacity, pool.data_peak, pool.buffers_in_use, pool.buffer_capacity,
+                    pool.buffers_peak, pool.buffers_leased, pool.exhausted_polls, pool.exhausted_frames);
+      }
+      if (atlas_) {
+        const auto &atlas = atlas_->GetCounters();
+        ImGui::Text("Atlas uploads: %lu (%lu rects, %lu bytes), skipped: %lu, stalls: %lu, rejected: %lu",
+                    atlas.uploads, atlas.rects, atlas.bytes_copied, atlas.skipped, atlas.stalls, atlas.rejected);
+      }
+      if (WorldCameraCountsAllocations()) {
+        ImGui::Text("Heap allocations: %lu last frame, %lu frames allocated", frame_allocations_, allocating_frames_);
+      } else {
+        ImGui::Text("Heap allocations: not counted in release builds");
       }
     }
 
@@ -434,12 +698,45 @@ private:
     void DestroyPreview() {
       for (const auto& [camera, _] : available_cameras_) {
         for (const auto& [mode, __] : available_modes_) {
-          const auto camera_mode_pair = std::make_pair(camera, mode);
-          GetRoot()->RemoveChild(display_nodes_[camera_mode_pair]);
-          display_nodes_[camera_mode_pair].reset();
-          texture_ids_[camera_mode_pair] = 0;
+          auto &tile = preview_tiles_[WorldCameraStreamIndex(camera, mode)];
+          GetRoot()->RemoveChild(tile.node);
+          tile = PreviewTile();
         }
       }
+      GetRoot()->RemoveChild(atlas_node_);
+      atlas_node_.reset();
+      // The atlas ends an upload it began before its texture is deleted
+      atlas_.reset();
+    }
+
+    // Creates a texture without storage, which is allocated by the streamer or atlas on first upload
+    GLuint CreatePreviewTexture() {
+      GLuint texture_id = 0;
+      glGenTextures(1, &texture_id);
+      glBindTexture(GL_TEXTURE_2D, texture_id);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glBindTexture(GL_TEXTURE_2D, 0);
+      return texture_id;
+    }
+
+    // Node with a quad showing texture, width x height in size
+    std::shared_ptr<Node> CreateImageNode(GLuint texture_id, int texture_width, int texture_height, float width,
+                                          float height, std::shared_ptr<RenderableComponent> *out_renderable) {
+      // Textures are owned so are destroyed/cleared when Texture destructor is called
+      auto tex = std::make_shared<Texture>(GL_TEXTURE_2D, texture_id, texture_width, texture_height, true);
+      auto quad = Registry::GetInstance()->GetResourcePool()->GetMesh<QuadMesh>();
+      auto gui_mat = std::make_shared<TexturedGrayscaleMaterial>(tex);
+      gui_mat->SetPolygonMode(GL_FILL);
+      auto gui_renderable = std::make_shared<RenderableComponent>(quad, gui_mat);
+      auto gui_node = std::make_shared<Node>();
+      gui_node->AddComponent(gui_renderable);
+      // SetLocalScale with - y axis due to order of pixel data and glTexImage2D orientation mismatch
+      gui_node->SetLocalScale(glm::vec3{width, -height, 1.0f});
+      *out_renderable = gui_renderable;
+      return gui_node;
     }
 
     void SetupPreview() {
@@ -448,63 +745,79 @@ private:
         DestroyPreview();
       }
 
+      const auto head_pose_opt = GetHeadPoseOrigin();
+      if (!head_pose_opt.has_value()) {
+        ALOGW("No head pose available at application start! For best experience, start the application while wearing the ML2.");
+      }
+      const Pose head_pose = head_pose_opt.value_or(
+              GetRoot()->GetWorldPose()).HorizontalRotationOnly();
+
+      // In atlas mode a single quad shows the cells of all previews and the tiles only carry labels
+      const glm::vec3 atlas_center{0.f, 0.05f, -2.5f};
+      if (atlas_preview_) {
+        WorldCameraAtlasLayout layout;
+        layout.cell_width = texture_width_;
+        layout.cell_height = texture_height_;
+        layout.columns = kAtlasColumns;
+        layout.rows = kAtlasRows;
+        const GLuint texture_id = CreatePreviewTexture();
+        atlas_ = std::make_unique<WorldCameraTextureAtlas>(
+                std::make_unique<WorldCameraGLTextureBackend>(texture_id), layout);
+        std::shared_ptr<RenderableComponent> renderable;
+        auto image = CreateImageNode(texture_id, layout.Width(), layout.Height(), kAtlasWidth, kAtlasHeight,
+                                     &renderable);
+        image->SetLocalTranslation(atlas_center);
+        atlas_node_ = std::make_shared<Node>();
+        atlas_node_->AddChild(image);
+        atlas_node_->SetWorldPose(head_pose);
+        GetRoot()->AddChild(atlas_node_);
+      }
+
       for (const auto& [camera, camera_state] : available_cameras_) {
         for (const auto& [mode, mode_state] : available_modes_) {
           const auto camera_mode_pair = std::make_pair(camera, mode);
-          display_nodes_[camera_mode_pair] = std::make_shared<Node>();
+          auto &tile = preview_tiles_[WorldCameraStreamIndex(camera, mode)];
+          tile.node = std::make_shared<Node>();
           // Node for both preview and label
           auto preview_combined_ = std::make_shared<Node>();
-
-          // Generate texture IDs for each camera
-          glGenTextures(1, &texture_ids_[camera_mode_pair]);
-          // Bind the texture IDs to a texture
-          glBindTexture(GL_TEXTURE_2D, texture_ids_[camera_mode_pair]);
-          // Set up the texture
-          glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, texture_width_, texture_height_, 0, GL_RED, GL_UNSIGNED_BYTE, nullptr);
-          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-          glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-
-          // Set up texture to be rendered by app framework and add to preview_combined_
-          // Textures are owned so are destroyed/cleared when Texture destructor is called
-          auto tex = std::make_shared<Texture>(GL_TEXTURE_2D, texture_ids_[camera_mode_pair], texture_width_, texture_height_,true);
-          auto quad = Registry::GetInstance()->GetResourcePool()->GetMesh<QuadMesh>();
-          auto gui_mat = std::make_shared<TexturedGrayscaleMaterial>(tex);
-          gui_mat->SetPolygonMode(GL_FILL);
-          auto gui_renderable = std::make_shared<RenderableComponent>(quad, gui_mat);
-          auto gui_node = std::make_shared<Node>();
-          gui_node->AddComponent(gui_renderable);
-          // SetLocalScale with - y axis due to order of pixel data and glTexImage2D orientation mismatch
-          gui_node->SetLocalScale(glm::vec3{1.0f, -1.0f, 1.0f});
-          preview_combined_->AddChild(gui_node);
+          auto preview_offset = preview_offsets_[camera_mode_pair];
+
+          std::shared_ptr<RenderableComponent> image_renderable;
+          if (atlas_) {
+            // Labels sit where they would above separate previews of the cell's size
+            tile.atlas_cell = AtlasCell(camera, mode);
+            const auto uv = atlas_->Layout().Uv(tile.atlas_cell);
+            preview_offset = atlas_center + glm::vec3{((uv.u0 + uv.u1) / 2 - 0.5f) * kAtlasWidth,
+                                                      (0.5f - (uv.v0 + uv.v1) / 2) * kAtlasHeight, 0.f};
+          } else {
+            tile.texture_id = CreatePreviewTexture();
+            tile.streamer = std::make_unique<WorldCameraTextureStreamer>(
+                    std::make_unique<WorldCameraGLTextureBackend>(tile.texture_id));
+            // Set up texture to be rendered by app framework and add to preview_combined_
+            preview_combined_->AddChild(CreateImageNode(tile.texture_id, texture_width_, texture_height_, 1.0f,
+                                                        1.0f, &image_renderable));
+          }
 
           // Create label and add to preview_combined_
           auto text = ml::app_framework::CreatePresetNode(ml::app_framework::NodeType::Text);
-          const std::string label = std::string(GetMLWorldCameraIdentifierString(camera)) + "\n" +
-                              std::string(GetMLWorldCameraFrameTypeString(mode)) +
-                              "\nFrame Number: ";
-          text->GetComponent<ml::app_framework::TextComponent>()->SetText(label.c_str());
+          tile.label.SetText({GetMLWorldCameraIdentifierString(camera), "\n", GetMLWorldCameraFrameTypeString(mode),
+                              "\nFrame Number: "});
+          tile.text = text->GetComponent<ml::app_framework::TextComponent>().get();
+          tile.text->SetText(tile.label.c_str());
           text->SetLocalScale(glm::vec3{0.008f, -0.008f, 1.f});
           text->SetLocalTranslation(text_offsets_[camera_mode_pair]);
 
           preview_combined_->AddChild(text);
+          tile.renderables = {image_renderable.get(), text->GetComponent<RenderableComponent>().get()};
 
-          // Add the preview and label to display_nodes_
-          preview_combined_->SetLocalTranslation(preview_offsets_[camera_mode_pair]);
+          // Add the preview and label to the tile
+          preview_combined_->SetLocalTranslation(preview_offset);
           preview_combined_->SetLocalScale(glm::vec3(0.5, 0.5, 0.5));
-          display_nodes_[camera_mode_pair]->AddChild(preview_combined_);
-
-          const auto head_pose_opt = GetHeadPoseOrigin();
-          if (!head_pose_opt.has_value()) {
-            ALOGW("No head pose available at application start! For best experience, start the application while wearing the ML2.");
-          }
-          const Pose head_pose = head_pose_opt.value_or(
-                  GetRoot()->GetWorldPose()).HorizontalRotationOnly();
-          display_nodes_[camera_mode_pair]->SetWorldPose(head_pose);
+          tile.node->AddChild(preview_combined_);
+          tile.node->SetWorldPose(head_pose);
 
-          GetRoot()->AddChild(display_nodes_[camera_mode_pair]);
-          SetPreviewVisibility(display_nodes_[camera_mode_pair], mode_state && camera_state);
+          GetRoot()->AddChild(tile.node);
+          SetPreviewVisibility(tile, mode_state && camera_state);
         }
       }
       preview_initialized_ = true;
@@ -512,16 +825,30 @@ private:
 
     std::unordered_map<MLWorldCameraIdentifier, bool> available_cameras_;
     std::unordered_map<MLWorldCameraFrameType, bool> available_modes_;
-    std::map<CameraIdModePair, std::shared_ptr<Node>> display_nodes_;
-    std::map<CameraIdModePair, int64_t> last_frame_num_;
+    WorldCameraSequenceTracker frame_sequences_;
     std::map<CameraIdModePair, MLWorldCameraFrame> last_frame_info_;
     std::map<CameraIdModePair, glm::vec3> preview_offsets_, text_offsets_;
-    std::map<CameraIdModePair, int> dropped_frame_count;
-    std::map<CameraIdModePair, GLuint> texture_ids_;
+    std::array<PreviewTile, kWorldCameraStreamCount> preview_tiles_;
     bool preview_initialized_;
+    bool undistort_preview_;
+    bool buffered_polling_;
+    bool atlas_preview_;
+    std::unique_ptr<WorldCameraTextureAtlas> atlas_;
+    std::shared_ptr<Node> atlas_node_;
+    WorldCameraUndistorter undistorter_;
+    WorldCameraChangeDetector change_detector_;
     int texture_width_, texture_height_;
+    std::string capture_path_;
+    WorldCameraRecorder recorder_;
+    WorldCameraReplay replay_;
+    WorldCameraBundler bundler_;
+    WorldCameraPoseHistory pose_history_;
+    std::array<WorldCameraFrameStats, kWorldCameraStreamCount> frame_stats_ = {};
+    uint64_t frame_allocations_ = 0;
+    uint64_t allocating_frames_ = 0;
     MLHandle world_camera_handle_;
     MLWorldCameraSettings world_camera_settings_;
+    WorldCameraSchedule world_camera_schedule_;
 };
 
 void android_main(struct android_app *state) {
@@ -0,0 +1,166 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_allocation_counter.h"
+
+#ifndef NDEBUG
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+  thread_local uint64_t allocation_count = 0;
+}
+
+uint64_t WorldCameraAllocationCount() {
+  return allocation_count;
+}
+
+bool WorldCameraCountsAllocations() {
+  return true;
+}
+
+// The array forms forward to these, so they are counted too
+void *operator new(std::size_t size) {
+  ++allocation_count;
+  if (size == 0) {
+    size = 1;
+  }
+  while (true) {
+    if (void *pointer = malloc(size)) {
+      return pointer;
+    }
+    // The handler may free memory and return, or throw or terminate itself
+    const std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  try {
+    return operator new(size);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size) {
+  return operator new(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  return operator new(size, std::nothrow);
+}
+
+// Over-aligned types, such as alignas(64) buffers, come here instead
+void *operator new(std::size_t size, std::align_val_t alignment) {
+  ++allocation_count;
+  if (size == 0) {
+    size = 1;
+  }
+  // posix_memalign takes powers of two no smaller than a pointer
+  const std::size_t bytes = std::max(static_cast<std::size_t>(alignment), sizeof(void *));
+  while (true) {
+    void *pointer = nullptr;
+    if (posix_memalign(&pointer, bytes, size) == 0) {
+      return pointer;
+    }
+    const std::new_handler handler = std::get_new_handler();
+    if (!handler) {
+      throw std::bad_alloc();
+    }
+    handler();
+  }
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  try {
+    return operator new(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+  return operator new(size, alignment, std::nothrow);
+}
+
+void operator delete(void *pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+  free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+  free(pointer);
+}
+
+// posix_memalign memory is released with free as well
+void operator delete(void *pointer, std::align_val_t) noexcept {
+  free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+  free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+  free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+  free(pointer);
+}
+
+#else
+
+uint64_t WorldCameraAllocationCount() {
+  return 0;
+}
+
+bool WorldCameraCountsAllocations() {
+  return false;
+}
+
+#endif
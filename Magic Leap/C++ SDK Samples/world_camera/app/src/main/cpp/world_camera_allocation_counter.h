@@ -0,0 +1,36 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstdint>
+
+/*!
+  \brief Number of heap allocations made through operator new by the calling thread.
+
+  Builds without NDEBUG replace the global operator new and delete with versions
+  that count before forwarding to malloc and free. Like the library versions they
+  call the new handler until malloc succeeds and throw std::bad_alloc when there is
+  none, and the nothrow forms return nullptr instead. The std::align_val_t forms
+  used for over-aligned types are replaced as well, on top of posix_memalign, so
+  an alignas(64) buffer counts like any other. The count is per thread, so
+  the difference between two calls on the render thread gives the allocations of
+  the code in between without the recorder's or the framework's other threads.
+  Allocations that bypass operator new, such as malloc, are not counted.
+
+  Release builds keep the library operators and always return 0.
+*/
+uint64_t WorldCameraAllocationCount();
+
+// Whether this build counts allocations.
+bool WorldCameraCountsAllocations();
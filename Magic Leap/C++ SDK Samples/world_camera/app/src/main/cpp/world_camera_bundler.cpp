@@ -0,0 +1,163 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_bundler.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+  const MLWorldCameraIdentifier kCameras[kWorldCameraCount] = {
+          MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right, MLWorldCameraIdentifier_Center};
+}
+
+WorldCameraBundler::WorldCameraBundler(const Settings &settings) : settings_(settings) {
+  settings_.ring_depth = std::min(std::max<size_t>(settings_.ring_depth, 1), kMaxRingDepth);
+  if (settings_.copy_pixels) {
+    pixels_.resize(kWorldCameraCount * settings_.ring_depth * settings_.max_frame_size);
+  }
+}
+
+void WorldCameraBundler::SetCameras(uint32_t cameras) {
+  settings_.cameras = cameras;
+  Reset();
+}
+
+void WorldCameraBundler::Reset() {
+  for (auto &ring : rings_) {
+    ring.head = 0;
+    ring.count = 0;
+  }
+  newest_timestamp_ = 0;
+}
+
+size_t WorldCameraBundler::QueuedFrames(MLWorldCameraIdentifier camera) const {
+  const size_t camera_index = WorldCameraIndex(camera);
+  return camera_index < kWorldCameraCount ? rings_[camera_index].count : 0;
+}
+
+bool WorldCameraBundler::Push(const MLWorldCameraFrame &frame) {
+  ++statistics_.frames_submitted;
+  const size_t camera_index = WorldCameraIndex(frame.id);
+  if (camera_index == kWorldCameraCount || !IsRequired(camera_index) || frame.frame_type != settings_.frame_type ||
+      (settings_.copy_pixels && frame.frame_buffer.size > settings_.max_frame_size)) {
+    ++statistics_.frames_rejected;
+    return false;
+  }
+
+  Ring &ring = rings_[camera_index];
+  if (ring.count == settings_.ring_depth) {
+    ring.head = (ring.head + 1) % settings_.ring_depth;
+    --ring.count;
+    ++statistics_.frames_overwritten;
+  }
+  const size_t slot = (ring.head + ring.count) % settings_.ring_depth;
+  MLWorldCameraFrame &queued = ring.frames[slot];
+  queued = frame;
+  if (settings_.copy_pixels && frame.frame_buffer.data) {
+    uint8_t *copy = pixels_.data() + (camera_index * settings_.ring_depth + slot) * settings_.max_frame_size;
+    memcpy(copy, frame.frame_buffer.data, frame.frame_buffer.size);
+    queued.frame_buffer.data = copy;
+  }
+  ++ring.count;
+  newest_timestamp_ = std::max(newest_timestamp_, frame.timestamp);
+  return true;
+}
+
+bool WorldCameraBundler::NextBundle(Bundle *bundle) {
+  for (;;) {
+    bool all_queued = true;
+    bool any_queued = false;
+    MLTime oldest = std::numeric_limits<MLTime>::max();
+    MLTime newest = std::numeric_limits<MLTime>::min();
+    for (size_t i = 0; i < kWorldCameraCount; ++i) {
+      if (!IsRequired(i)) {
+        continue;
+      }
+      if (rings_[i].count == 0) {
+        all_queued = false;
+        continue;
+      }
+      any_queued = true;
+      oldest = std::min(oldest, Head(i).timestamp);
+      newest = std::max(newest, Head(i).timestamp);
+    }
+    if (!any_queued) {
+      return false;
+    }
+
+    if (all_queued && newest - oldest > settings_.tolerance) {
+      // Later frames of the camera with the newest head are even newer, so heads older
+      // than it by more than the tolerance can never be part of a bundle
+      for (size_t i = 0; i < kWorldCameraCount; ++i) {
+        while (IsRequired(i) && rings_[i].count > 0 && newest - Head(i).timestamp > settings_.tolerance) {
+          Pop(i);
+          ++statistics_.frames_unmatched;
+        }
+      }
+      continue;
+    }
+    if (!all_queued && newest_timestamp_ - oldest <= settings_.max_wait) {
+      return false;
+    }
+
+    // Either every camera is within tolerance, or the oldest frame gave up waiting and is
+    // bundled with whatever is close to it
+    bundle->timestamp = oldest;
+    bundle->skew = 0;
+    bundle->cameras = 0;
+    bundle->frame_count = 0;
+    for (size_t i = 0; i < kWorldCameraCount; ++i) {
+      if (!IsRequired(i) || rings_[i].count == 0 || Head(i).timestamp - oldest > settings_.tolerance) {
+        continue;
+      }
+      bundle->frames[bundle->frame_count++] = Head(i);
+      bundle->cameras |= kCameras[i];
+      bundle->skew = std::max(bundle->skew, Head(i).timestamp - oldest);
+    }
+    if (all_queued) {
+      ++statistics_.bundles_complete;
+    } else {
+      ++statistics_.bundles_partial;
+    }
+    statistics_.last_skew = bundle->skew;
+    statistics_.max_skew = std::max(statistics_.max_skew, bundle->skew);
+    statistics_.total_skew += bundle->skew;
+    return true;
+  }
+}
+
+void WorldCameraBundler::PopBundle(const Bundle &bundle) {
+  for (size_t i = 0; i < kWorldCameraCount; ++i) {
+    if (bundle.cameras & kCameras[i]) {
+      Pop(i);
+    }
+  }
+}
+
+void WorldCameraBundler::Pop(size_t camera_index) {
+  Ring &ring = rings_[camera_index];
+  ring.head = (ring.head + 1) % settings_.ring_depth;
+  --ring.count;
+}
+
+bool WorldCameraBundler::IsRequired(size_t camera_index) const {
+  return (settings_.cameras & kCameras[camera_index]) != 0;
+}
+
+const MLWorldCameraFrame &WorldCameraBundler::Head(size_t camera_index) const {
+  const Ring &ring = rings_[camera_index];
+  return ring.frames[ring.head];
+}
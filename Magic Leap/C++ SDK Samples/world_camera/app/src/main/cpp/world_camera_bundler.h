@@ -0,0 +1,133 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_stream.h"
+
+/*!
+  \brief Groups frames of several world cameras into time aligned bundles.
+
+  Frames of one frame type are queued in a fixed size ring per camera, from any
+  source: MLWorldCameraGetLatestWorldCameraData, a subscription or a replay. Once
+  every camera of the configured set has a queued frame and the oldest frames lie
+  within the tolerance of each other they are emitted as a complete bundle. Frames
+  that can no longer be matched are discarded. If a camera stops delivering, the
+  frames of the other cameras are emitted as partial bundles after max_wait.
+
+  With copy_pixels set, frame buffers are copied into storage preallocated by the
+  constructor, so the caller may release its frames right after Submit. Otherwise
+  the frame buffers must stay valid until their bundle has been emitted. Submit
+  does not allocate. Not thread safe.
+*/
+class WorldCameraBundler {
+public:
+  static constexpr size_t kMaxRingDepth = 8;
+
+  struct Settings {
+    // Cameras of a complete bundle, a combination of MLWorldCameraIdentifier values.
+    uint32_t cameras = MLWorldCameraIdentifier_All;
+    MLWorldCameraFrameType frame_type = MLWorldCameraFrameType_NormalExposure;
+    // Maximum difference between the timestamps of a bundle's frames, in nanoseconds.
+    MLTime tolerance = 2000000;
+    // How long the oldest queued frame waits for missing cameras before a partial
+    // bundle is emitted, measured against the newest timestamp submitted.
+    MLTime max_wait = 100000000;
+    // Frames queued per camera, at most kMaxRingDepth.
+    size_t ring_depth = 4;
+    bool copy_pixels = true;
+    // Largest frame buffer that can be copied; bigger frames are rejected when copy_pixels is set.
+    size_t max_frame_size = 1016 * 1016;
+  };
+
+  struct Bundle {
+    // Timestamp of the earliest frame and distance to the latest one.
+    MLTime timestamp;
+    MLTime skew;
+    // Cameras present in this bundle.
+    uint32_t cameras;
+    size_t frame_count;
+    // frame_count frames in left, right, center order.
+    MLWorldCameraFrame frames[kWorldCameraCount];
+  };
+
+  struct Statistics {
+    uint64_t frames_submitted;
+    // Frames of another frame type or camera, or too large to copy.
+    uint64_t frames_rejected;
+    // Frames pushed out of a full ring before they could be bundled.
+    uint64_t frames_overwritten;
+    // Frames discarded because no frame of another camera was close enough in time.
+    uint64_t frames_unmatched;
+    uint64_t bundles_complete;
+    uint64_t bundles_partial;
+    MLTime last_skew;
+    MLTime max_skew;
+    MLTime total_skew;
+  };
+
+  WorldCameraBundler() : WorldCameraBundler(Settings()) {}
+  explicit WorldCameraBundler(const Settings &settings);
+
+  // Queues frame and calls on_bundle(const Bundle &) for every bundle it completes.
+  // Pointers in a bundle are valid only during the callback. Returns false if the
+  // frame was rejected.
+  template <typename Callback>
+  bool Submit(const MLWorldCameraFrame &frame, Callback &&on_bundle) {
+    if (!Push(frame)) {
+      return false;
+    }
+    Bundle bundle;
+    while (NextBundle(&bundle)) {
+      on_bundle(static_cast<const Bundle &>(bundle));
+      PopBundle(bundle);
+    }
+    return true;
+  }
+
+  // Changes the cameras of a complete bundle. Discards queued frames.
+  void SetCameras(uint32_t cameras);
+  // Discards queued frames, e.g. after a pause or a settings change.
+  void Reset();
+
+  const Settings &GetSettings() const { return settings_; }
+  const Statistics &GetStatistics() const { return statistics_; }
+  size_t QueuedFrames(MLWorldCameraIdentifier camera) const;
+
+private:
+  struct Ring {
+    size_t head;
+    size_t count;
+    std::array<MLWorldCameraFrame, kMaxRingDepth> frames;
+  };
+
+  bool Push(const MLWorldCameraFrame &frame);
+  bool NextBundle(Bundle *bundle);
+  void PopBundle(const Bundle &bundle);
+  void Pop(size_t camera_index);
+  bool IsRequired(size_t camera_index) const;
+  const MLWorldCameraFrame &Head(size_t camera_index) const;
+
+  Settings settings_;
+  Statistics statistics_ = {};
+  std::array<Ring, kWorldCameraCount> rings_ = {};
+  std::vector<uint8_t> pixels_;
+  MLTime newest_timestamp_ = 0;
+};
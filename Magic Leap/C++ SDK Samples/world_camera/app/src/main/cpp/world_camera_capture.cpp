@@ -0,0 +1,267 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+  const uint8_t kZeroPadding[kWorldCameraCaptureAlignment] = {};
+
+  bool WriteAll(int fd, const void *data, size_t size, uint64_t offset) {
+    iovec iov = {const_cast<void *>(data), size};
+    return WriteWorldCameraCaptureVectors(fd, &iov, 1, offset);
+  }
+
+  auto IndexKey(uint32_t id, uint32_t frame_type, MLTime timestamp) {
+    return std::make_tuple(id, frame_type, timestamp);
+  }
+
+  bool IndexLess(const WorldCameraCaptureIndexEntry &a, const WorldCameraCaptureIndexEntry &b) {
+    return IndexKey(a.id, a.frame_type, a.timestamp) < IndexKey(b.id, b.frame_type, b.timestamp);
+  }
+}
+
+bool WriteWorldCameraCaptureVectors(int fd, iovec *iov, int count, uint64_t offset) {
+  while (count > 0) {
+    const ssize_t written = pwritev(fd, iov, count, static_cast<off_t>(offset));
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    offset += static_cast<uint64_t>(written);
+    size_t remaining = static_cast<size_t>(written);
+    while (count > 0 && remaining >= iov->iov_len) {
+      remaining -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<uint8_t *>(iov->iov_base) + remaining;
+      iov->iov_len -= remaining;
+    }
+  }
+  return true;
+}
+
+WorldCameraCaptureIndexEntry MakeWorldCameraCaptureIndexEntry(const MLWorldCameraFrame &frame, uint64_t data_offset) {
+  WorldCameraCaptureIndexEntry entry = {};
+  entry.id = frame.id;
+  entry.frame_type = frame.frame_type;
+  entry.frame_number = frame.frame_number;
+  entry.timestamp = frame.timestamp;
+  entry.data_offset = data_offset;
+  entry.width = frame.frame_buffer.width;
+  entry.height = frame.frame_buffer.height;
+  entry.stride = frame.frame_buffer.stride;
+  entry.bytes_per_pixel = frame.frame_buffer.bytes_per_pixel;
+  entry.size = frame.frame_buffer.size;
+  entry.intrinsics = frame.intrinsics;
+  entry.camera_pose = frame.camera_pose;
+  return entry;
+}
+
+bool WriteWorldCameraCaptureFooter(int fd, uint64_t offset, std::vector<WorldCameraCaptureIndexEntry> &index) {
+  std::stable_sort(index.begin(), index.end(), IndexLess);
+  WorldCameraCaptureTrailer trailer = {};
+  trailer.index_offset = offset;
+  trailer.index_count = index.size();
+  trailer.magic = kWorldCameraCaptureMagic;
+  trailer.version = kWorldCameraCaptureVersion;
+  const size_t index_size = index.size() * sizeof(WorldCameraCaptureIndexEntry);
+  return WriteAll(fd, index.data(), index_size, offset) &&
+         WriteAll(fd, &trailer, sizeof(trailer), offset + index_size);
+}
+
+WorldCameraCaptureWriter::~WorldCameraCaptureWriter() {
+  Close();
+}
+
+bool WorldCameraCaptureWriter::Open(const char *path, size_t expected_frames) {
+  if (fd_ >= 0 || !path) {
+    return false;
+  }
+  fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  index_.clear();
+  index_.reserve(expected_frames);
+
+  WorldCameraCaptureHeader header = {};
+  header.magic = kWorldCameraCaptureMagic;
+  header.version = kWorldCameraCaptureVersion;
+  header.alignment = kWorldCameraCaptureAlignment;
+  uint8_t first_page[kWorldCameraCaptureAlignment] = {};
+  memcpy(first_page, &header, sizeof(header));
+  if (!WriteAll(fd_, first_page, sizeof(first_page), 0)) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  offset_ = sizeof(first_page);
+  return true;
+}
+
+bool WorldCameraCaptureWriter::Append(const MLWorldCameraFrame &frame) {
+  if (fd_ < 0 || !frame.frame_buffer.data) {
+    return false;
+  }
+  const uint64_t size = frame.frame_buffer.size;
+  const uint64_t padding = WorldCameraCaptureAlignedSize(size) - size;
+  iovec iov[2] = {
+          {frame.frame_buffer.data, static_cast<size_t>(size)},
+          {const_cast<uint8_t *>(kZeroPadding), static_cast<size_t>(padding)},
+  };
+  if (!WriteWorldCameraCaptureVectors(fd_, iov, padding > 0 ? 2 : 1, offset_)) {
+    return false;
+  }
+  index_.push_back(MakeWorldCameraCaptureIndexEntry(frame, offset_));
+  offset_ += size + padding;
+  return true;
+}
+
+bool WorldCameraCaptureWriter::Close() {
+  if (fd_ < 0) {
+    return false;
+  }
+  const bool footer_ok = WriteWorldCameraCaptureFooter(fd_, offset_, index_);
+  const bool close_ok = close(fd_) == 0;
+  fd_ = -1;
+  index_.clear();
+  return footer_ok && close_ok;
+}
+
+WorldCameraCaptureReader::~WorldCameraCaptureReader() {
+  Close();
+}
+
+bool WorldCameraCaptureReader::Open(const char *path) {
+  if (mapping_ || !path) {
+    return false;
+  }
+  const int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat file_stat = {};
+  if (fstat(fd, &file_stat) != 0 ||
+      file_stat.st_size < static_cast<off_t>(kWorldCameraCaptureAlignment + sizeof(WorldCameraCaptureTrailer))) {
+    close(fd);
+    return false;
+  }
+  const size_t size = static_cast<size_t>(file_stat.st_size);
+  void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  // The mapping stays valid after the descriptor is closed
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  mapping_ = static_cast<uint8_t *>(mapping);
+  mapping_size_ = size;
+
+  WorldCameraCaptureHeader header;
+  WorldCameraCaptureTrailer trailer;
+  memcpy(&header, mapping_, sizeof(header));
+  memcpy(&trailer, mapping_ + size - sizeof(trailer), sizeof(trailer));
+  const uint64_t index_end = size - sizeof(trailer);
+  if (header.magic != kWorldCameraCaptureMagic || header.version != kWorldCameraCaptureVersion ||
+      trailer.magic != kWorldCameraCaptureMagic || trailer.version != kWorldCameraCaptureVersion ||
+      trailer.index_offset % kWorldCameraCaptureAlignment != 0 || trailer.index_offset > index_end ||
+      trailer.index_count != (index_end - trailer.index_offset) / sizeof(WorldCameraCaptureIndexEntry)) {
+    Close();
+    return false;
+  }
+  index_ = reinterpret_cast<const WorldCameraCaptureIndexEntry *>(mapping_ + trailer.index_offset);
+  index_count_ = static_cast<size_t>(trailer.index_count);
+  for (size_t i = 0; i < index_count_; ++i) {
+    const WorldCameraCaptureIndexEntry &entry = index_[i];
+    // Written so that a corrupt data_offset cannot wrap around
+    if (entry.size > trailer.index_offset || entry.data_offset > trailer.index_offset - entry.size) {
+      Close();
+      return false;
+    }
+    // The plane must hold every row it describes, or readers of the last rows run past it
+    const uint64_t row_bytes = static_cast<uint64_t>(entry.width) * entry.bytes_per_pixel;
+    if (entry.height > 0 &&
+        (row_bytes > entry.stride ||
+         entry.size < static_cast<uint64_t>(entry.stride) * (entry.height - 1) + row_bytes)) {
+      Close();
+      return false;
+    }
+  }
+  return true;
+}
+
+void WorldCameraCaptureReader::Close() {
+  if (mapping_) {
+    munmap(mapping_, mapping_size_);
+  }
+  mapping_ = nullptr;
+  mapping_size_ = 0;
+  index_ = nullptr;
+  index_count_ = 0;
+}
+
+MLWorldCameraFrame WorldCameraCaptureReader::Frame(size_t index) const {
+  const WorldCameraCaptureIndexEntry &entry = index_[index];
+  MLWorldCameraFrame frame = {};
+  frame.id = static_cast<MLWorldCameraIdentifier>(entry.id);
+  frame.frame_number = entry.frame_number;
+  frame.timestamp = entry.timestamp;
+  frame.intrinsics = entry.intrinsics;
+  frame.camera_pose = entry.camera_pose;
+  frame.frame_buffer.width = entry.width;
+  frame.frame_buffer.height = entry.height;
+  frame.frame_buffer.stride = entry.stride;
+  frame.frame_buffer.bytes_per_pixel = entry.bytes_per_pixel;
+  frame.frame_buffer.size = entry.size;
+  frame.frame_buffer.data = mapping_ + entry.data_offset;
+  frame.frame_type = static_cast<MLWorldCameraFrameType>(entry.frame_type);
+  return frame;
+}
+
+std::pair<size_t, size_t> WorldCameraCaptureReader::Range(MLWorldCameraIdentifier camera,
+                                                          MLWorldCameraFrameType frame_type) const {
+  const auto first = std::lower_bound(index_, index_ + index_count_, IndexKey(camera, frame_type, INT64_MIN),
+                                      [](const WorldCameraCaptureIndexEntry &entry, const auto &key) {
+                                        return IndexKey(entry.id, entry.frame_type, entry.timestamp) < key;
+                                      });
+  const auto last = std::upper_bound(first, index_ + index_count_, IndexKey(camera, frame_type, INT64_MAX),
+                                     [](const auto &key, const WorldCameraCaptureIndexEntry &entry) {
+                                       return key < IndexKey(entry.id, entry.frame_type, entry.timestamp);
+                                     });
+  return {static_cast<size_t>(first - index_), static_cast<size_t>(last - index_)};
+}
+
+size_t WorldCameraCaptureReader::Seek(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type,
+                                      MLTime timestamp) const {
+  const auto range = Range(camera, frame_type);
+  const auto it = std::lower_bound(index_ + range.first, index_ + range.second, timestamp,
+                                   [](const WorldCameraCaptureIndexEntry &entry, MLTime value) {
+                                     return entry.timestamp < value;
+                                   });
+  return static_cast<size_t>(it - index_);
+}
@@ -0,0 +1,153 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+struct iovec;
+
+/*
+  World camera capture container.
+
+  A capture file is laid out as:
+    - a WorldCameraCaptureHeader, padded to kWorldCameraCaptureAlignment
+    - the frame_buffer.data plane of every frame, each starting on a
+      kWorldCameraCaptureAlignment boundary, in the order they were appended
+    - the index: one WorldCameraCaptureIndexEntry per frame, sorted by
+      (camera, frame type, timestamp), starting on an alignment boundary
+    - a WorldCameraCaptureTrailer at the very end of the file
+
+  Planes are page aligned so the reader can mmap the file and hand out frame
+  buffers that point straight into the mapping, and so the file can be written
+  with direct I/O.
+*/
+
+constexpr uint32_t kWorldCameraCaptureMagic = 0x50414357;  // "WCAP"
+constexpr uint32_t kWorldCameraCaptureVersion = 1;
+constexpr size_t kWorldCameraCaptureAlignment = 4096;
+
+struct WorldCameraCaptureHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t alignment;
+  uint32_t reserved;
+};
+
+struct WorldCameraCaptureIndexEntry {
+  uint32_t id;
+  uint32_t frame_type;
+  int64_t frame_number;
+  MLTime timestamp;
+  uint64_t data_offset;
+  uint32_t width;
+  uint32_t height;
+  uint32_t stride;
+  uint32_t bytes_per_pixel;
+  uint32_t size;
+  uint32_t reserved;
+  MLWorldCameraIntrinsics intrinsics;
+  MLTransform camera_pose;
+};
+
+struct WorldCameraCaptureTrailer {
+  uint64_t index_offset;
+  uint64_t index_count;
+  uint32_t magic;
+  uint32_t version;
+};
+
+// Size of a frame plane once padded to the container alignment.
+inline uint64_t WorldCameraCaptureAlignedSize(uint64_t size) {
+  return (size + kWorldCameraCaptureAlignment - 1) & ~uint64_t(kWorldCameraCaptureAlignment - 1);
+}
+
+// Builds the index entry of a frame whose plane is stored at data_offset.
+WorldCameraCaptureIndexEntry MakeWorldCameraCaptureIndexEntry(const MLWorldCameraFrame &frame, uint64_t data_offset);
+
+// Writes the iovecs completely at offset, retrying interrupted and short writes. The iovecs are
+// advanced in place as data is written. Returns false if writing failed.
+bool WriteWorldCameraCaptureVectors(int fd, iovec *iov, int count, uint64_t offset);
+
+// Sorts index entries by (camera, frame type, timestamp) and appends the index and trailer
+// at offset, which must be aligned. Returns false if writing failed.
+bool WriteWorldCameraCaptureFooter(int fd, uint64_t offset, std::vector<WorldCameraCaptureIndexEntry> &index);
+
+/*!
+  \brief Writes world camera frames to a capture file.
+
+  Appending issues a single vectored write per frame for the plane and its
+  padding, continued until the frame is complete; the index is kept in memory
+  and written on Close. The writer is not thread safe.
+*/
+class WorldCameraCaptureWriter {
+public:
+  WorldCameraCaptureWriter() = default;
+  WorldCameraCaptureWriter(const WorldCameraCaptureWriter &) = delete;
+  WorldCameraCaptureWriter &operator=(const WorldCameraCaptureWriter &) = delete;
+  ~WorldCameraCaptureWriter();
+
+  // expected_frames is only used to size the in-memory index up front.
+  bool Open(const char *path, size_t expected_frames = 0);
+  bool Append(const MLWorldCameraFrame &frame);
+  // Writes the index and trailer. The capture is unreadable until this succeeds.
+  bool Close();
+
+  bool IsOpen() const { return fd_ >= 0; }
+  uint64_t BytesWritten() const { return offset_; }
+
+private:
+  int fd_ = -1;
+  uint64_t offset_ = 0;
+  std::vector<WorldCameraCaptureIndexEntry> index_;
+};
+
+/*!
+  \brief Memory maps a capture file for reading.
+
+  Frames returned by the reader point into the read only mapping; no image data
+  is copied, and writing through MLWorldCameraFrameBuffer.data is not allowed.
+  Frames stay valid until Close. Open rejects captures whose index places a plane
+  outside the frame data or describes more rows than its plane holds, so every
+  pixel of a returned frame can be read without further checks.
+*/
+class WorldCameraCaptureReader {
+public:
+  WorldCameraCaptureReader() = default;
+  WorldCameraCaptureReader(const WorldCameraCaptureReader &) = delete;
+  WorldCameraCaptureReader &operator=(const WorldCameraCaptureReader &) = delete;
+  ~WorldCameraCaptureReader();
+
+  bool Open(const char *path);
+  void Close();
+
+  bool IsOpen() const { return mapping_ != nullptr; }
+  // Number of frames, indexed in (camera, frame type, timestamp) order.
+  size_t FrameCount() const { return index_count_; }
+  MLWorldCameraFrame Frame(size_t index) const;
+  // Range [first, last) of the frames of a camera and frame type.
+  std::pair<size_t, size_t> Range(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const;
+  // Index of the first frame of a camera and frame type at or after timestamp, or the end of its Range.
+  size_t Seek(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type, MLTime timestamp) const;
+
+private:
+  uint8_t *mapping_ = nullptr;
+  size_t mapping_size_ = 0;
+  const WorldCameraCaptureIndexEntry *index_ = nullptr;
+  size_t index_count_ = 0;
+};
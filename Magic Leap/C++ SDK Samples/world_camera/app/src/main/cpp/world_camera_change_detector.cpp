@@ -0,0 +1,157 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_change_detector.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORLD_CAMERA_CHANGE_AVX2 1
+#endif
+
+namespace {
+
+  constexpr uint32_t kTileSize = WorldCameraDirtyTiles::kTileSize;
+
+  // Sum of absolute differences of two width x height blocks. Returns as soon as the sum exceeds limit.
+  uint32_t BlockSad(const uint8_t *a, size_t a_stride, const uint8_t *b, size_t b_stride, uint32_t width,
+                    uint32_t height, uint32_t limit) {
+    uint32_t sad = 0;
+    for (uint32_t y = 0; y < height; ++y, a += a_stride, b += b_stride) {
+      for (uint32_t x = 0; x < width; ++x) {
+        sad += std::abs(a[x] - b[x]);
+      }
+      if (sad > limit) {
+        break;
+      }
+    }
+    return sad;
+  }
+
+#if WORLD_CAMERA_CHANGE_AVX2
+  // BlockSad for a full tile width: one row of 32 pixels per _mm256_sad_epu8
+  __attribute__((target("avx2")))
+  uint32_t TileSadAvx2(const uint8_t *a, size_t a_stride, const uint8_t *b, size_t b_stride, uint32_t height,
+                       uint32_t limit) {
+    __m256i sums = _mm256_setzero_si256();
+    uint32_t sad = 0;
+    for (uint32_t y = 0; y < height; ++y, a += a_stride, b += b_stride) {
+      const __m256i row_a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+      const __m256i row_b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+      sums = _mm256_add_epi64(sums, _mm256_sad_epu8(row_a, row_b));
+      if ((y & 7) == 7 || y + 1 == height) {
+        const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        sad = static_cast<uint32_t>(_mm_cvtsi128_si64(half) + _mm_extract_epi64(half, 1));
+        if (sad > limit) {
+          break;
+        }
+      }
+    }
+    return sad;
+  }
+
+  bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+  }
+#endif
+}
+
+const WorldCameraDirtyTiles *WorldCameraChangeDetector::Update(const MLWorldCameraFrame &frame) {
+  const size_t index = WorldCameraStreamIndex(frame);
+  const MLWorldCameraFrameBuffer &buffer = frame.frame_buffer;
+  if (index == kWorldCameraStreamCount || buffer.bytes_per_pixel != 1 || !buffer.data || buffer.width == 0 ||
+      buffer.height == 0 || buffer.stride < buffer.width) {
+    return nullptr;
+  }
+  Stream &stream = streams_[index];
+  WorldCameraDirtyTiles &tiles = stream.tiles;
+  const bool all_dirty = !stream.valid || tiles.width != buffer.width || tiles.height != buffer.height;
+  if (all_dirty) {
+    tiles.width = buffer.width;
+    tiles.height = buffer.height;
+    tiles.columns = (buffer.width + kTileSize - 1) / kTileSize;
+    tiles.rows = (buffer.height + kTileSize - 1) / kTileSize;
+    tiles.bits.resize((static_cast<size_t>(tiles.columns) * tiles.rows + 63) / 64);
+    stream.reference.resize(static_cast<size_t>(buffer.width) * buffer.height);
+  }
+  std::fill(tiles.bits.begin(), tiles.bits.end(), 0);
+  tiles.dirty_count = 0;
+
+#if WORLD_CAMERA_CHANGE_AVX2
+  const bool use_avx2 = HasAvx2();
+#endif
+  for (uint32_t row = 0; row < tiles.rows; ++row) {
+    const uint32_t y = row * kTileSize;
+    const uint32_t tile_height = std::min(kTileSize, buffer.height - y);
+    for (uint32_t column = 0; column < tiles.columns; ++column) {
+      const uint32_t x = column * kTileSize;
+      const uint32_t tile_width = std::min(kTileSize, buffer.width - x);
+      const uint8_t *source = buffer.data + static_cast<size_t>(y) * buffer.stride + x;
+      uint8_t *reference = stream.reference.data() + static_cast<size_t>(y) * buffer.width + x;
+
+      bool dirty = all_dirty;
+      if (!dirty) {
+        const uint32_t limit = threshold_ * tile_width * tile_height;
+        uint32_t sad;
+#if WORLD_CAMERA_CHANGE_AVX2
+        if (use_avx2 && tile_width == kTileSize) {
+          sad = TileSadAvx2(source, buffer.stride, reference, buffer.width, tile_height, limit);
+        } else
+#endif
+        {
+          sad = BlockSad(source, buffer.stride, reference, buffer.width, tile_width, tile_height, limit);
+        }
+        dirty = sad > limit;
+      }
+      if (!dirty) {
+        continue;
+      }
+      const size_t tile = static_cast<size_t>(row) * tiles.columns + column;
+      tiles.bits[tile / 64] |= uint64_t{1} << (tile % 64);
+      ++tiles.dirty_count;
+      for (uint32_t i = 0; i < tile_height; ++i) {
+        memcpy(reference + static_cast<size_t>(i) * buffer.width, source + static_cast<size_t>(i) * buffer.stride,
+               tile_width);
+      }
+    }
+  }
+  stream.valid = true;
+  ++stream.counters.frames;
+  stream.counters.tiles += static_cast<uint64_t>(tiles.columns) * tiles.rows;
+  stream.counters.dirty_tiles += tiles.dirty_count;
+  return &tiles;
+}
+
+void WorldCameraChangeDetector::Invalidate(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) {
+  const size_t index = WorldCameraStreamIndex(camera, frame_type);
+  if (index < kWorldCameraStreamCount) {
+    streams_[index].valid = false;
+  }
+}
+
+void WorldCameraChangeDetector::InvalidateAll() {
+  for (auto &stream : streams_) {
+    stream.valid = false;
+  }
+}
+
+const WorldCameraChangeDetector::Counters &WorldCameraChangeDetector::GetCounters(
+        MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const {
+  static const Counters kEmpty = {};
+  const size_t index = WorldCameraStreamIndex(camera, frame_type);
+  return index < kWorldCameraStreamCount ? streams_[index].counters : kEmpty;
+}
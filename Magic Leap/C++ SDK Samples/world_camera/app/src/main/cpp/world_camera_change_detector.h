@@ -0,0 +1,88 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_stream.h"
+
+/*!
+  \brief Bitmap of the tiles of a frame that changed.
+
+  The frame is divided into kTileSize x kTileSize tiles, row by row; tiles in the
+  last column and row may be smaller.
+*/
+struct WorldCameraDirtyTiles {
+  static constexpr uint32_t kTileSize = 32;
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t columns = 0;
+  uint32_t rows = 0;
+  uint32_t dirty_count = 0;
+  // Bit column % 64 of word (row * columns + column) / 64 is set for a dirty tile
+  std::vector<uint64_t> bits;
+
+  bool IsDirty(uint32_t column, uint32_t row) const {
+    const size_t tile = static_cast<size_t>(row) * columns + column;
+    return (bits[tile / 64] >> (tile % 64)) & 1;
+  }
+};
+
+/*!
+  \brief Finds the tiles of world camera frames that changed since the previous frame.
+
+  Every tile is compared with a reference copy of its stream by the sum of absolute
+  differences, computed with AVX2 when the CPU supports it. A tile whose mean
+  difference exceeds the threshold is marked dirty and copied into the reference,
+  so the reference always holds what consumers processing only dirty tiles have
+  seen, and slow changes accumulate until they are reported. The first frame of a
+  stream, after Invalidate or a change of size, is entirely dirty. Not thread safe.
+*/
+class WorldCameraChangeDetector {
+public:
+  struct Counters {
+    uint64_t frames;
+    uint64_t tiles;
+    uint64_t dirty_tiles;
+  };
+
+  // threshold is the mean absolute difference per pixel above which a tile is dirty.
+  explicit WorldCameraChangeDetector(uint32_t threshold = 4) : threshold_(threshold) {}
+
+  // Returns the dirty tiles of frame, or NULL if it is not an 8-bit frame of a known stream.
+  // The result is valid until the next call for the same stream.
+  const WorldCameraDirtyTiles *Update(const MLWorldCameraFrame &frame);
+  // Makes the next frame of a stream entirely dirty, e.g. when consumers lost their state.
+  void Invalidate(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type);
+  void InvalidateAll();
+
+  const Counters &GetCounters(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const;
+
+private:
+  struct Stream {
+    bool valid = false;
+    std::vector<uint8_t> reference;
+    WorldCameraDirtyTiles tiles;
+    Counters counters = {};
+  };
+
+  uint32_t threshold_;
+  std::array<Stream, kWorldCameraStreamCount> streams_;
+};
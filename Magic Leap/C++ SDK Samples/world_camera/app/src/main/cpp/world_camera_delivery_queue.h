@@ -0,0 +1,111 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*!
+  \brief Bounded lock free queue of indices, for handing pooled data between threads.
+
+  A multi producer, multi consumer ring after Dmitry Vyukov's bounded queue: each
+  cell carries a sequence number telling producers and consumers whether it is free
+  or full for their lap, so TryPush and TryPop are a single compare and swap of a
+  shared position when they do not contend. Any thread may pop, which lets a
+  producer discard the oldest entry of a full queue. The capacity is chosen by Reset
+  up to kMaxCapacity and enforced by a separate count, since the ring needs at least
+  two cells to tell a full cell from a free one. The queue never allocates.
+*/
+template <size_t kMaxCapacity>
+class WorldCameraDeliveryQueue {
+public:
+  WorldCameraDeliveryQueue() { Reset(kMaxCapacity); }
+
+  // Empties the queue and sets its capacity, which must be between 1 and kMaxCapacity.
+  // Must not race with TryPush or TryPop.
+  void Reset(size_t capacity) {
+    capacity_ = capacity;
+    for (size_t i = 0; i < cells_.size(); ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    push_position_.store(0, std::memory_order_relaxed);
+    pop_position_.store(0, std::memory_order_relaxed);
+  }
+
+  // Returns false if the queue is full.
+  bool TryPush(size_t value) {
+    // Entries are only counted out once popped, so the ring itself never fills up
+    if (count_.fetch_add(1, std::memory_order_acquire) >= capacity_) {
+      count_.fetch_sub(1, std::memory_order_relaxed);
+      return false;
+    }
+    size_t position = push_position_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells_[position % cells_.size()];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t lap = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (lap == 0) {
+        if (push_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          cell.value = value;
+          cell.sequence.store(position + 1, std::memory_order_release);
+          return true;
+        }
+      } else {
+        // Another producer took the position first
+        position = push_position_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns false if the queue is empty.
+  bool TryPop(size_t *out_value) {
+    size_t position = pop_position_.load(std::memory_order_relaxed);
+    while (true) {
+      Cell &cell = cells_[position % cells_.size()];
+      const size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      const intptr_t lap = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+      if (lap == 0) {
+        if (pop_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+          *out_value = cell.value;
+          cell.sequence.store(position + cells_.size(), std::memory_order_release);
+          count_.fetch_sub(1, std::memory_order_release);
+          return true;
+        }
+      } else if (lap < 0) {
+        // The cell has not been filled for this lap yet
+        return false;
+      } else {
+        position = pop_position_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  size_t Capacity() const { return capacity_; }
+
+private:
+  struct alignas(64) Cell {
+    std::atomic<size_t> sequence{0};
+    size_t value = 0;
+  };
+
+  std::array<Cell, kMaxCapacity + 1> cells_;
+  size_t capacity_ = 0;
+  std::atomic<size_t> count_{0};
+  // Producers and consumers advance separate cache lines
+  alignas(64) std::atomic<size_t> push_position_{0};
+  alignas(64) std::atomic<size_t> pop_position_{0};
+};
@@ -0,0 +1,157 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_downscale.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORLD_CAMERA_DOWNSCALE_AVX2 1
+#endif
+
+namespace {
+
+  // Averages factor x factor blocks of output columns [first, width) of one output row
+  void DownscaleRowScalar(const uint8_t *src, size_t stride, uint32_t factor, uint32_t first, uint32_t width,
+                          uint8_t *dst) {
+    const uint32_t area = factor * factor;
+    for (uint32_t x = first; x < width; ++x) {
+      uint32_t sum = 0;
+      for (uint32_t row = 0; row < factor; ++row) {
+        const uint8_t *p = src + row * stride + x * factor;
+        for (uint32_t column = 0; column < factor; ++column) {
+          sum += p[column];
+        }
+      }
+      dst[x] = static_cast<uint8_t>((sum + area / 2) / area);
+    }
+  }
+
+#if WORLD_CAMERA_DOWNSCALE_AVX2
+  // 16 output pixels per iteration: horizontal pairs are summed with maddubs, then the two rows added
+  __attribute__((target("avx2")))
+  uint32_t DownscaleRow2Avx2(const uint8_t *src, size_t stride, uint32_t width, uint8_t *dst) {
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i round = _mm256_set1_epi16(2);
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+      const __m256i top = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x * 2));
+      const __m256i bottom = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + stride + x * 2));
+      __m256i sum = _mm256_add_epi16(_mm256_maddubs_epi16(top, ones), _mm256_maddubs_epi16(bottom, ones));
+      sum = _mm256_srli_epi16(_mm256_add_epi16(sum, round), 2);
+      const __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x), bytes);
+    }
+    return x;
+  }
+
+  // 8 output pixels per iteration: pair sums of four rows, then adjacent pairs added with madd
+  __attribute__((target("avx2")))
+  uint32_t DownscaleRow4Avx2(const uint8_t *src, size_t stride, uint32_t width, uint8_t *dst) {
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i ones16 = _mm256_set1_epi16(1);
+    const __m256i round = _mm256_set1_epi32(8);
+    uint32_t x = 0;
+    for (; x + 8 <= width; x += 8) {
+      __m256i pairs = _mm256_setzero_si256();
+      for (uint32_t row = 0; row < 4; ++row) {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + row * stride + x * 4));
+        pairs = _mm256_add_epi16(pairs, _mm256_maddubs_epi16(pixels, ones));
+      }
+      __m256i sum = _mm256_madd_epi16(pairs, ones16);
+      sum = _mm256_srli_epi32(_mm256_add_epi32(sum, round), 4);
+      const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(words, words));
+    }
+    return x;
+  }
+
+  bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+  }
+#endif
+}
+
+WorldCameraRegion ClipWorldCameraRegion(const WorldCameraRegion &region, uint32_t width, uint32_t height) {
+  if (region.width == 0 || region.height == 0) {
+    return WorldCameraRegion{0, 0, width, height};
+  }
+  WorldCameraRegion clipped;
+  clipped.x = std::min(region.x, width);
+  clipped.y = std::min(region.y, height);
+  clipped.width = std::min(region.width, width - clipped.x);
+  clipped.height = std::min(region.height, height - clipped.y);
+  return clipped;
+}
+
+MLWorldCameraFrame CropWorldCameraFrame(const MLWorldCameraFrame &frame, const WorldCameraRegion &region) {
+  const MLWorldCameraFrameBuffer &buffer = frame.frame_buffer;
+  const WorldCameraRegion clipped = ClipWorldCameraRegion(region, buffer.width, buffer.height);
+  MLWorldCameraFrame cropped = frame;
+  cropped.frame_buffer.data = buffer.data + static_cast<size_t>(clipped.y) * buffer.stride + clipped.x;
+  cropped.frame_buffer.width = clipped.width;
+  cropped.frame_buffer.height = clipped.height;
+  cropped.frame_buffer.size = clipped.height > 0 ? buffer.stride * (clipped.height - 1) + clipped.width : 0;
+  cropped.intrinsics.width = clipped.width;
+  cropped.intrinsics.height = clipped.height;
+  cropped.intrinsics.principal_point.x -= clipped.x;
+  cropped.intrinsics.principal_point.y -= clipped.y;
+  return cropped;
+}
+
+size_t WorldCameraDownscaledSize(const MLWorldCameraFrame &frame, uint32_t factor) {
+  return static_cast<size_t>(frame.frame_buffer.width / factor) * (frame.frame_buffer.height / factor);
+}
+
+MLWorldCameraFrame DownscaleWorldCameraFrame(const MLWorldCameraFrame &frame, uint32_t factor, uint8_t *dst) {
+  const MLWorldCameraFrameBuffer &buffer = frame.frame_buffer;
+  const uint32_t width = buffer.width / factor;
+  const uint32_t height = buffer.height / factor;
+#if WORLD_CAMERA_DOWNSCALE_AVX2
+  const bool use_avx2 = HasAvx2();
+#endif
+  for (uint32_t y = 0; y < height; ++y) {
+    const uint8_t *src = buffer.data + static_cast<size_t>(y) * factor * buffer.stride;
+    uint8_t *out = dst + static_cast<size_t>(y) * width;
+    uint32_t x = 0;
+    if (factor == 1) {
+      memcpy(out, src, width);
+      continue;
+    }
+#if WORLD_CAMERA_DOWNSCALE_AVX2
+    if (use_avx2) {
+      x = factor == 2 ? DownscaleRow2Avx2(src, buffer.stride, width, out)
+                      : DownscaleRow4Avx2(src, buffer.stride, width, out);
+    }
+#endif
+    DownscaleRowScalar(src, buffer.stride, factor, x, width, out);
+  }
+
+  MLWorldCameraFrame downscaled = frame;
+  downscaled.frame_buffer.data = dst;
+  downscaled.frame_buffer.width = width;
+  downscaled.frame_buffer.height = height;
+  downscaled.frame_buffer.stride = width;
+  downscaled.frame_buffer.size = width * height;
+  // Pixel centers of the output grid lie at (u + 0.5) * factor - 0.5 in the input grid
+  downscaled.intrinsics.width = width;
+  downscaled.intrinsics.height = height;
+  downscaled.intrinsics.focal_length.x /= factor;
+  downscaled.intrinsics.focal_length.y /= factor;
+  downscaled.intrinsics.principal_point.x = (frame.intrinsics.principal_point.x + 0.5f) / factor - 0.5f;
+  downscaled.intrinsics.principal_point.y = (frame.intrinsics.principal_point.y + 0.5f) / factor - 0.5f;
+  return downscaled;
+}
@@ -0,0 +1,47 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ml_world_camera.h>
+
+// A rectangular region of a frame, in pixels. A width or height of 0 selects the full frame.
+struct WorldCameraRegion {
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+// Clips region to a width x height frame. A region with a width or height of 0 selects the full frame.
+WorldCameraRegion ClipWorldCameraRegion(const WorldCameraRegion &region, uint32_t width, uint32_t height);
+
+// Returns a view of region of an 8-bit frame. The frame buffer points into the source
+// buffer, so nothing is copied, and the principal point is shifted to match.
+MLWorldCameraFrame CropWorldCameraFrame(const MLWorldCameraFrame &frame, const WorldCameraRegion &region);
+
+// Size in bytes of an 8-bit frame downscaled by factor.
+size_t WorldCameraDownscaledSize(const MLWorldCameraFrame &frame, uint32_t factor);
+
+/*!
+  \brief Downscales an 8-bit frame by averaging every factor x factor block of pixels.
+
+  factor must be 1, 2 or 4; width and height are rounded down to a multiple of it.
+  dst receives WorldCameraDownscaledSize bytes with a stride of the output width.
+  The returned frame describes dst, with focal length and principal point scaled to
+  the output pixel grid. Uses AVX2 when the CPU supports it.
+*/
+MLWorldCameraFrame DownscaleWorldCameraFrame(const MLWorldCameraFrame &frame, uint32_t factor, uint8_t *dst);
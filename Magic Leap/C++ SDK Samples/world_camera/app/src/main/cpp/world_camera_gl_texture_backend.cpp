@@ -0,0 +1,93 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_gl_texture_backend.h"
+
+namespace {
+
+  // Upper bound for waiting on a pixel buffer that is still being read by the GPU
+  constexpr GLuint64 kFenceTimeoutNs = 100000000;
+}
+
+WorldCameraGLTextureBackend::WorldCameraGLTextureBackend(GLuint texture, size_t buffer_count)
+    : texture_(texture), buffers_(buffer_count > 0 ? buffer_count : 1) {
+  for (auto &buffer : buffers_) {
+    glGenBuffers(1, &buffer.name);
+    buffer.capacity = 0;
+    buffer.fence = nullptr;
+  }
+}
+
+WorldCameraGLTextureBackend::~WorldCameraGLTextureBackend() {
+  for (auto &buffer : buffers_) {
+    if (buffer.fence) {
+      glDeleteSync(buffer.fence);
+    }
+    glDeleteBuffers(1, &buffer.name);
+  }
+}
+
+bool WorldCameraGLTextureBackend::Allocate(uint32_t width, uint32_t height) {
+  glBindTexture(GL_TEXTURE_2D, texture_);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, width, height);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return glGetError() == GL_NO_ERROR;
+}
+
+uint8_t *WorldCameraGLTextureBackend::BeginUpload(size_t size, bool *stalled) {
+  PixelBuffer &buffer = buffers_[current_];
+  if (buffer.fence) {
+    if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+      *stalled = true;
+      glClientWaitSync(buffer.fence, GL_SYNC_FLUSH_COMMANDS_BIT, kFenceTimeoutNs);
+    }
+    glDeleteSync(buffer.fence);
+    buffer.fence = nullptr;
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.name);
+  if (size > buffer.capacity) {
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    buffer.capacity = size;
+  }
+  // The fence guarantees the GPU is done with this buffer, so no implicit synchronization is needed
+  void *data = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+                                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+  if (!data) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+  return static_cast<uint8_t *>(data);
+}
+
+void WorldCameraGLTextureBackend::EndUpload(const WorldCameraTextureRect *rects, size_t rect_count,
+                                            uint32_t row_length) {
+  PixelBuffer &buffer = buffers_[current_];
+  if (glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER) == GL_TRUE) {
+    glBindTexture(GL_TEXTURE_2D, texture_);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, row_length);
+    for (size_t i = 0; i < rect_count; ++i) {
+      const WorldCameraTextureRect &rect = rects[i];
+      // Sources from the bound pixel unpack buffer, returns without waiting for the copy
+      const size_t offset = static_cast<size_t>(rect.y) * row_length + rect.x;
+      glTexSubImage2D(GL_TEXTURE_2D, 0, rect.x, rect.y, rect.width, rect.height, GL_RED, GL_UNSIGNED_BYTE,
+                      reinterpret_cast<const void *>(offset));
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  current_ = (current_ + 1) % buffers_.size();
+}
@@ -0,0 +1,53 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <app_framework/application.h>
+
+#include "world_camera_texture_streamer.h"
+
+/*!
+  \brief Backend that streams uploads through a ring of OpenGL pixel buffer objects.
+
+  The texture gets immutable GL_R8 storage once. Every upload is written into the
+  next pixel unpack buffer and transferred with glTexSubImage2D from that buffer,
+  so the copy into the texture runs asynchronously on the GPU. A fence per buffer
+  tells when it may be written again; waiting on it is reported as a stall.
+  Must be used on the thread owning the GL context.
+*/
+class WorldCameraGLTextureBackend : public WorldCameraTextureBackend {
+public:
+  // texture is a texture name without storage; the backend does not take ownership.
+  explicit WorldCameraGLTextureBackend(GLuint texture, size_t buffer_count = 3);
+  ~WorldCameraGLTextureBackend() override;
+
+  bool Allocate(uint32_t width, uint32_t height) override;
+  uint8_t *BeginUpload(size_t size, bool *stalled) override;
+  void EndUpload(const WorldCameraTextureRect *rects, size_t rect_count, uint32_t row_length) override;
+
+private:
+  struct PixelBuffer {
+    GLuint name;
+    size_t capacity;
+    GLsync fence;
+  };
+
+  GLuint texture_;
+  std::vector<PixelBuffer> buffers_;
+  size_t current_ = 0;
+};
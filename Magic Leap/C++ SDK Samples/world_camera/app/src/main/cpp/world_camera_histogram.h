@@ -0,0 +1,95 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+#include <ml_world_camera.h>
+
+constexpr size_t kWorldCameraHistogramBinCount = 32;
+
+// Snapshot of a histogram of durations in nanoseconds. Bin i counts samples in
+// [first_bin_start + i * bin_width, first_bin_start + (i + 1) * bin_width); samples below
+// the first bin are counted in it and samples beyond the last bin in the last one.
+struct WorldCameraHistogram {
+  MLTime first_bin_start = 0;
+  MLTime bin_width = 0;
+  std::array<uint64_t, kWorldCameraHistogramBinCount> bins = {};
+  uint64_t count = 0;
+  MLTime sum = 0;
+  // Exact extremes, 0 while count is 0
+  MLTime min = 0;
+  MLTime max = 0;
+};
+
+/*!
+  \brief Histogram of durations that any number of threads can record into without a lock.
+
+  Bins, count, sum and the extremes are separate relaxed atomics, so Record is a few
+  fetch_adds and Read may see a sample in some fields and not yet in others. Bins
+  start at 0 and are bin_width wide; samples beyond the last bin are counted in it
+  and negative samples in the first one, as WorldCameraHistogram defines.
+*/
+class WorldCameraAtomicHistogram {
+public:
+  explicit WorldCameraAtomicHistogram(MLTime bin_width) : bin_width_(bin_width > 0 ? bin_width : 1) { Reset(); }
+
+  void Record(MLTime sample) {
+    const MLTime bin = std::min<MLTime>(std::max<MLTime>(sample, 0) / bin_width_, kWorldCameraHistogramBinCount - 1);
+    bins_[static_cast<size_t>(bin)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(sample, std::memory_order_relaxed);
+    MLTime current = min_.load(std::memory_order_relaxed);
+    while (sample < current && !min_.compare_exchange_weak(current, sample, std::memory_order_relaxed)) {
+    }
+    current = max_.load(std::memory_order_relaxed);
+    while (sample > current && !max_.compare_exchange_weak(current, sample, std::memory_order_relaxed)) {
+    }
+  }
+
+  void Read(WorldCameraHistogram *out_histogram) const {
+    out_histogram->first_bin_start = 0;
+    out_histogram->bin_width = bin_width_;
+    for (size_t i = 0; i < bins_.size(); ++i) {
+      out_histogram->bins[i] = bins_[i].load(std::memory_order_relaxed);
+    }
+    out_histogram->count = count_.load(std::memory_order_relaxed);
+    out_histogram->sum = sum_.load(std::memory_order_relaxed);
+    out_histogram->min = out_histogram->count ? min_.load(std::memory_order_relaxed) : 0;
+    out_histogram->max = out_histogram->count ? max_.load(std::memory_order_relaxed) : 0;
+  }
+
+  void Reset() {
+    for (std::atomic<uint64_t> &bin : bins_) {
+      bin.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(std::numeric_limits<MLTime>::max(), std::memory_order_relaxed);
+    max_.store(std::numeric_limits<MLTime>::min(), std::memory_order_relaxed);
+  }
+
+private:
+  MLTime bin_width_;
+  std::array<std::atomic<uint64_t>, kWorldCameraHistogramBinCount> bins_;
+  std::atomic<uint64_t> count_;
+  std::atomic<MLTime> sum_;
+  std::atomic<MLTime> min_;
+  std::atomic<MLTime> max_;
+};
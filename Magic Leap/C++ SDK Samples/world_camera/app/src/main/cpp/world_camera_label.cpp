@@ -0,0 +1,44 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_label.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+void WorldCameraLabel::SetText(std::initializer_list<const char *> parts) {
+  size_t size = 0;
+  for (const char *part : parts) {
+    const size_t length = std::min(strlen(part), kCapacity - 1 - size);
+    memcpy(text_ + size, part, length);
+    size += length;
+  }
+  text_[size] = '\0';
+  prefix_size_ = size;
+  size_ = size;
+  has_number_ = false;
+}
+
+bool WorldCameraLabel::SetNumber(int64_t value) {
+  if (has_number_ && value == number_) {
+    return false;
+  }
+  // Leaves room for the terminator; a number that does not fit leaves the fixed text alone
+  const auto [end, error] = std::to_chars(text_ + prefix_size_, text_ + kCapacity - 1, value);
+  size_ = error == std::errc() ? static_cast<size_t>(end - text_) : prefix_size_;
+  text_[size_] = '\0';
+  has_number_ = true;
+  number_ = value;
+  return true;
+}
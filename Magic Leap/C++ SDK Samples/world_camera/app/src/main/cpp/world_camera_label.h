@@ -0,0 +1,52 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+/*!
+  \brief Text label formatted into a fixed buffer without allocating.
+
+  A label is a fixed text, set once from a list of parts, optionally followed by
+  a number that changes every frame, e.g. "Left Camera\nLow Exposure\nFrame
+  Number: 1234". Setting the number only rewrites the digits after the fixed
+  text, and reports whether the label changed, so callers push it to the renderer
+  only when needed. Text that does not fit in kCapacity is truncated.
+*/
+class WorldCameraLabel {
+public:
+  static constexpr size_t kCapacity = 128;
+
+  WorldCameraLabel() = default;
+  explicit WorldCameraLabel(std::initializer_list<const char *> parts) { SetText(parts); }
+
+  // Replaces the fixed text with the concatenation of parts and clears the number.
+  void SetText(std::initializer_list<const char *> parts);
+
+  // Appends value to the fixed text. Returns false if the label already showed value.
+  bool SetNumber(int64_t value);
+
+  const char *c_str() const { return text_; }
+  size_t size() const { return size_; }
+
+private:
+  char text_[kCapacity] = {};
+  // Length of the fixed text and of the whole label
+  size_t prefix_size_ = 0;
+  size_t size_ = 0;
+  bool has_number_ = false;
+  int64_t number_ = 0;
+};
@@ -0,0 +1,55 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_memory_texture_backend.h"
+
+#include <cstring>
+
+WorldCameraMemoryTextureBackend::WorldCameraMemoryTextureBackend(size_t buffer_count)
+    : buffers_(buffer_count > 0 ? buffer_count : 1) {}
+
+bool WorldCameraMemoryTextureBackend::Allocate(uint32_t width, uint32_t height) {
+  // Storage is immutable, like glTexStorage2D
+  if (width_ != 0 || width == 0 || height == 0) {
+    return false;
+  }
+  width_ = width;
+  height_ = height;
+  texture_.assign(static_cast<size_t>(width) * height, 0);
+  return true;
+}
+
+uint8_t *WorldCameraMemoryTextureBackend::BeginUpload(size_t size, bool *) {
+  std::vector<uint8_t> &buffer = buffers_[current_];
+  if (buffer.size() < size) {
+    buffer.resize(size);
+  }
+  return buffer.data();
+}
+
+void WorldCameraMemoryTextureBackend::EndUpload(const WorldCameraTextureRect *rects, size_t rect_count,
+                                                uint32_t row_length) {
+  const uint8_t *staging = buffers_[current_].data();
+  for (size_t i = 0; i < rect_count; ++i) {
+    const WorldCameraTextureRect &rect = rects[i];
+    if (rect.x + rect.width > width_ || rect.y + rect.height > height_) {
+      continue;
+    }
+    for (uint32_t y = rect.y; y < rect.y + rect.height; ++y) {
+      memcpy(texture_.data() + static_cast<size_t>(y) * width_ + rect.x,
+             staging + static_cast<size_t>(y) * row_length + rect.x, rect.width);
+    }
+    bytes_transferred_ += static_cast<uint64_t>(rect.width) * rect.height;
+  }
+  current_ = (current_ + 1) % buffers_.size();
+}
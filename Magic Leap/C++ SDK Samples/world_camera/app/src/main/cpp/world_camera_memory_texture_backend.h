@@ -0,0 +1,53 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "world_camera_texture_streamer.h"
+
+/*!
+  \brief Backend that keeps the texture in system memory.
+
+  Mirrors WorldCameraGLTextureBackend without a graphics API: storage is fixed on
+  the first Allocate, uploads are staged in a ring of buffers whose contents are
+  not preserved between uploads, like invalidated pixel buffers, and EndUpload
+  copies only the given rects into the texture. It never stalls. Used to test and
+  benchmark the streamer and atlas on a host.
+*/
+class WorldCameraMemoryTextureBackend : public WorldCameraTextureBackend {
+public:
+  explicit WorldCameraMemoryTextureBackend(size_t buffer_count = 3);
+
+  bool Allocate(uint32_t width, uint32_t height) override;
+  uint8_t *BeginUpload(size_t size, bool *stalled) override;
+  void EndUpload(const WorldCameraTextureRect *rects, size_t rect_count, uint32_t row_length) override;
+
+  uint32_t Width() const { return width_; }
+  uint32_t Height() const { return height_; }
+  // Texture contents, rows Width() bytes apart.
+  const uint8_t *Texture() const { return texture_.data(); }
+  // Bytes copied into the texture by all uploads.
+  uint64_t BytesTransferred() const { return bytes_transferred_; }
+
+private:
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  std::vector<uint8_t> texture_;
+  std::vector<std::vector<uint8_t>> buffers_;
+  size_t current_ = 0;
+  uint64_t bytes_transferred_ = 0;
+};
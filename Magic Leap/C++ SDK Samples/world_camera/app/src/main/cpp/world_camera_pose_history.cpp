@@ -0,0 +1,141 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_pose_history.h"
+
+#include <cmath>
+
+namespace {
+
+  // Above this cosine of half the angle between two rotations, slerp is replaced by a
+  // normalized lerp, which is as accurate there and avoids dividing by a tiny sine
+  constexpr double kSlerpThreshold = 0.9995;
+}
+
+MLTransform InterpolateWorldCameraPose(const MLTransform &a, const MLTransform &b, double t) {
+  MLTransform pose;
+  pose.position.x = static_cast<float>(a.position.x + (b.position.x - a.position.x) * t);
+  pose.position.y = static_cast<float>(a.position.y + (b.position.y - a.position.y) * t);
+  pose.position.z = static_cast<float>(a.position.z + (b.position.z - a.position.z) * t);
+
+  // q and -q are the same rotation; flipping b keeps to the shorter arc
+  double bx = b.rotation.x, by = b.rotation.y, bz = b.rotation.z, bw = b.rotation.w;
+  double cosine = a.rotation.x * bx + a.rotation.y * by + a.rotation.z * bz + a.rotation.w * bw;
+  if (cosine < 0.0) {
+    bx = -bx;
+    by = -by;
+    bz = -bz;
+    bw = -bw;
+    cosine = -cosine;
+  }
+  double wa = 1.0 - t;
+  double wb = t;
+  if (cosine < kSlerpThreshold) {
+    const double angle = std::acos(cosine);
+    const double sine = std::sin(angle);
+    wa = std::sin(wa * angle) / sine;
+    wb = std::sin(wb * angle) / sine;
+  }
+  double x = wa * a.rotation.x + wb * bx;
+  double y = wa * a.rotation.y + wb * by;
+  double z = wa * a.rotation.z + wb * bz;
+  double w = wa * a.rotation.w + wb * bw;
+  const double norm = std::sqrt(x * x + y * y + z * z + w * w);
+  pose.rotation.x = static_cast<float>(x / norm);
+  pose.rotation.y = static_cast<float>(y / norm);
+  pose.rotation.z = static_cast<float>(z / norm);
+  pose.rotation.w = static_cast<float>(w / norm);
+  return pose;
+}
+
+bool WorldCameraPoseHistory::Add(MLWorldCameraIdentifier camera, MLTime timestamp, const MLTransform &pose) {
+  const size_t camera_index = WorldCameraIndex(camera);
+  if (camera_index == kWorldCameraCount) {
+    return false;
+  }
+  Ring &ring = rings_[camera_index];
+  if (ring.count > 0 && timestamp <= ring.timestamps[ring.Slot(ring.count - 1)]) {
+    return false;
+  }
+  if (ring.count == kCapacity) {
+    ring.begin = ring.Slot(1);
+    --ring.count;
+  }
+  const size_t slot = ring.Slot(ring.count);
+  ring.timestamps[slot] = timestamp;
+  ring.poses[slot] = pose;
+  ++ring.count;
+  return true;
+}
+
+bool WorldCameraPoseHistory::PoseAt(MLWorldCameraIdentifier camera, MLTime time, MLTransform *out_pose) const {
+  const Ring *ring = FindRing(camera);
+  if (!ring || ring->count == 0 || !out_pose) {
+    return false;
+  }
+  // Index of the first sample at or after time
+  size_t first = 0;
+  size_t count = ring->count;
+  while (count > 0) {
+    const size_t half = count / 2;
+    if (ring->timestamps[ring->Slot(first + half)] < time) {
+      first += half + 1;
+      count -= half + 1;
+    } else {
+      count = half;
+    }
+  }
+  if (first == ring->count) {
+    return false;
+  }
+  const size_t after = ring->Slot(first);
+  if (ring->timestamps[after] == time) {
+    *out_pose = ring->poses[after];
+    return true;
+  }
+  if (first == 0) {
+    return false;
+  }
+  const size_t before = ring->Slot(first - 1);
+  const MLTime start = ring->timestamps[before];
+  const double t = static_cast<double>(time - start) / static_cast<double>(ring->timestamps[after] - start);
+  *out_pose = InterpolateWorldCameraPose(ring->poses[before], ring->poses[after], t);
+  return true;
+}
+
+size_t WorldCameraPoseHistory::Size(MLWorldCameraIdentifier camera) const {
+  const Ring *ring = FindRing(camera);
+  return ring ? ring->count : 0;
+}
+
+MLTime WorldCameraPoseHistory::Oldest(MLWorldCameraIdentifier camera) const {
+  const Ring *ring = FindRing(camera);
+  return ring && ring->count > 0 ? ring->timestamps[ring->Slot(0)] : 0;
+}
+
+MLTime WorldCameraPoseHistory::Newest(MLWorldCameraIdentifier camera) const {
+  const Ring *ring = FindRing(camera);
+  return ring && ring->count > 0 ? ring->timestamps[ring->Slot(ring->count - 1)] : 0;
+}
+
+void WorldCameraPoseHistory::Reset() {
+  for (Ring &ring : rings_) {
+    ring.begin = 0;
+    ring.count = 0;
+  }
+}
+
+const WorldCameraPoseHistory::Ring *WorldCameraPoseHistory::FindRing(MLWorldCameraIdentifier camera) const {
+  const size_t camera_index = WorldCameraIndex(camera);
+  return camera_index < kWorldCameraCount ? &rings_[camera_index] : nullptr;
+}
@@ -0,0 +1,75 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_stream.h"
+
+/*!
+  \brief History of world camera poses with lookup at arbitrary times.
+
+  Keeps the camera_pose of the last kCapacity frames of every camera in a ring, as
+  the world camera API only reports the pose of each delivered frame. Timestamps
+  and transforms are stored in separate arrays, so the binary search for the
+  samples around a query time only touches the timestamps. The pose between two samples
+  is interpolated linearly for the position and spherically for the rotation.
+
+  Both exposure modes of a camera feed the same history, as they share the camera
+  pose. Not thread safe.
+*/
+class WorldCameraPoseHistory {
+public:
+  static constexpr size_t kCapacity = 64;
+
+  // Adds the pose of frame. Returns false for unknown cameras and for frames not newer
+  // than the newest sample of their camera.
+  bool Add(const MLWorldCameraFrame &frame) { return Add(frame.id, frame.timestamp, frame.camera_pose); }
+  bool Add(MLWorldCameraIdentifier camera, MLTime timestamp, const MLTransform &pose);
+
+  // Pose of camera at time, interpolated between the samples around it. Returns false if
+  // time lies outside the history of the camera.
+  bool PoseAt(MLWorldCameraIdentifier camera, MLTime time, MLTransform *out_pose) const;
+
+  // Number of samples of camera and their time span.
+  size_t Size(MLWorldCameraIdentifier camera) const;
+  MLTime Oldest(MLWorldCameraIdentifier camera) const;
+  MLTime Newest(MLWorldCameraIdentifier camera) const;
+
+  void Reset();
+
+private:
+  static_assert((kCapacity & (kCapacity - 1)) == 0, "Capacity must be a power of two");
+
+  struct Ring {
+    // Slot of the oldest sample; samples are in time order from there.
+    size_t begin = 0;
+    size_t count = 0;
+    std::array<MLTime, kCapacity> timestamps = {};
+    std::array<MLTransform, kCapacity> poses = {};
+
+    size_t Slot(size_t index) const { return (begin + index) & (kCapacity - 1); }
+  };
+
+  const Ring *FindRing(MLWorldCameraIdentifier camera) const;
+
+  std::array<Ring, kWorldCameraCount> rings_;
+};
+
+// Interpolates between two poses, t = 0 giving a and t = 1 giving b. The rotation takes the
+// shorter of the two arcs between the quaternions.
+MLTransform InterpolateWorldCameraPose(const MLTransform &a, const MLTransform &b, double t);
@@ -0,0 +1,222 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_pyramid.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORLD_CAMERA_PYRAMID_AVX2 1
+#endif
+
+namespace {
+
+  // Smallest width and height that can be halved with reflected borders
+  constexpr uint32_t kMinLevelSize = 3;
+
+  size_t AlignedStride(size_t bytes) {
+    const size_t alignment = WorldCameraPyramidBuilder::kRowAlignment;
+    return (bytes + alignment - 1) / alignment * alignment;
+  }
+
+  // Reflects an index around the edge pixels: -2, -1, n, n + 1 map to 2, 1, n - 2, n - 3
+  int32_t Reflect(int32_t index, int32_t size) {
+    if (index < 0) {
+      return -index;
+    }
+    return index < size ? index : 2 * size - 2 - index;
+  }
+
+  // Vertical pass, columns [first, width): t[x] = r0 + 4 r1 + 6 r2 + 4 r3 + r4
+  void VerticalScalar(const uint8_t *const rows[5], uint32_t first, uint32_t width, int16_t *t) {
+    for (uint32_t x = first; x < width; ++x) {
+      t[x] = static_cast<int16_t>(rows[0][x] + rows[4][x] + 4 * (rows[1][x] + rows[3][x]) + 6 * rows[2][x]);
+    }
+  }
+
+  // Horizontal pass and subsampling, outputs [first, width): the same taps around t[2x], rounded and divided by 256
+  void HorizontalScalar(const int16_t *t, uint32_t first, uint32_t width, uint8_t *dst) {
+    for (uint32_t x = first; x < width; ++x) {
+      const int16_t *p = t + 2 * x;
+      dst[x] = static_cast<uint8_t>((p[-2] + p[2] + 4 * (p[-1] + p[1]) + 6 * p[0] + 128) >> 8);
+    }
+  }
+
+#if WORLD_CAMERA_PYRAMID_AVX2
+  __attribute__((target("avx2")))
+  uint32_t VerticalAvx2(const uint8_t *const rows[5], uint32_t width, int16_t *t) {
+    uint32_t x = 0;
+    for (; x + 16 <= width; x += 16) {
+      __m256i r[5];
+      for (int i = 0; i < 5; ++i) {
+        r[i] = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[i] + x)));
+      }
+      const __m256i outer = _mm256_add_epi16(r[0], r[4]);
+      const __m256i inner = _mm256_slli_epi16(_mm256_add_epi16(r[1], r[3]), 2);
+      const __m256i center = _mm256_add_epi16(_mm256_slli_epi16(r[2], 2), _mm256_slli_epi16(r[2], 1));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(t + x),
+                          _mm256_add_epi16(_mm256_add_epi16(outer, inner), center));
+    }
+    return x;
+  }
+
+  // Eight outputs per iteration. Each output x needs taps t[2x - 2] .. t[2x + 2]; multiplying
+  // pairs of neighbours with madd yields (t[2x-2] + 4 t[2x-1]), (6 t[2x] + 4 t[2x+1]) and t[2x+2].
+  __attribute__((target("avx2")))
+  uint32_t HorizontalAvx2(const int16_t *t, uint32_t t_width, uint32_t width, uint8_t *dst) {
+    const __m256i weights_left = _mm256_set1_epi32((4 << 16) | 1);
+    const __m256i weights_center = _mm256_set1_epi32((4 << 16) | 6);
+    const __m256i weights_right = _mm256_set1_epi32(1);
+    const __m256i round = _mm256_set1_epi32(128);
+    uint32_t x = 0;
+    // The last load reads t[2x + 2] .. t[2x + 17], and t is padded up to t[t_width + 1]
+    for (; x + 8 <= width && 2 * x + 16 <= t_width; x += 8) {
+      const int16_t *p = t + 2 * x;
+      const __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p - 2));
+      const __m256i center = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+      const __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 2));
+      __m256i sum = _mm256_add_epi32(_mm256_madd_epi16(left, weights_left), _mm256_madd_epi16(center, weights_center));
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(right, weights_right));
+      sum = _mm256_srli_epi32(_mm256_add_epi32(sum, round), 8);
+      const __m128i words = _mm_packs_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+      _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + x), _mm_packus_epi16(words, words));
+    }
+    return x;
+  }
+
+  bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+  }
+#endif
+
+  void Downsample(const uint8_t *src, uint32_t width, uint32_t height, uint32_t src_stride, uint8_t *dst,
+                  uint32_t dst_stride, int16_t *scratch, bool use_avx2) {
+    const uint32_t dst_width = (width + 1) / 2;
+    const uint32_t dst_height = (height + 1) / 2;
+    // Two reflected columns on either side of the filtered row
+    int16_t *t = scratch + 2;
+#if !WORLD_CAMERA_PYRAMID_AVX2
+    (void)use_avx2;
+#endif
+    for (uint32_t y = 0; y < dst_height; ++y) {
+      const uint8_t *rows[5];
+      for (int i = 0; i < 5; ++i) {
+        rows[i] = src + static_cast<size_t>(Reflect(2 * static_cast<int32_t>(y) - 2 + i, height)) * src_stride;
+      }
+      uint32_t x = 0;
+#if WORLD_CAMERA_PYRAMID_AVX2
+      if (use_avx2) {
+        x = VerticalAvx2(rows, width, t);
+      }
+#endif
+      VerticalScalar(rows, x, width, t);
+      t[-2] = t[2];
+      t[-1] = t[1];
+      t[width] = t[width - 2];
+      t[width + 1] = t[width - 3];
+
+      uint8_t *out = dst + static_cast<size_t>(y) * dst_stride;
+      x = 0;
+#if WORLD_CAMERA_PYRAMID_AVX2
+      if (use_avx2) {
+        x = HorizontalAvx2(t, width, dst_width, out);
+      }
+#endif
+      HorizontalScalar(t, x, dst_width, out);
+    }
+  }
+}
+
+void DownsampleWorldCameraImage(const uint8_t *src, uint32_t width, uint32_t height, uint32_t src_stride,
+                                uint8_t *dst, uint32_t dst_stride, int16_t *scratch) {
+#if WORLD_CAMERA_PYRAMID_AVX2
+  Downsample(src, width, height, src_stride, dst, dst_stride, scratch, HasAvx2());
+#else
+  Downsample(src, width, height, src_stride, dst, dst_stride, scratch, false);
+#endif
+}
+
+void DownsampleWorldCameraImageScalar(const uint8_t *src, uint32_t width, uint32_t height, uint32_t src_stride,
+                                      uint8_t *dst, uint32_t dst_stride, int16_t *scratch) {
+  Downsample(src, width, height, src_stride, dst, dst_stride, scratch, false);
+}
+
+WorldCameraPyramidBuilder::WorldCameraPyramidBuilder(uint32_t level_count)
+    : level_count_(std::min(std::max(level_count, 1u), WorldCameraPyramidFrame::kMaxLevels)) {}
+
+WorldCameraPyramidBuilder::~WorldCameraPyramidBuilder() {
+  free(arena_);
+}
+
+const WorldCameraPyramidFrame *WorldCameraPyramidBuilder::Build(const MLWorldCameraFrame &frame) {
+  const MLWorldCameraFrameBuffer &source = frame.frame_buffer;
+  if (source.bytes_per_pixel != 1 || !source.data || source.width == 0 || source.height == 0 ||
+      source.stride < source.width) {
+    return nullptr;
+  }
+  pyramid_.frame = frame;
+  pyramid_.levels[0] = source;
+
+  // Lay out the levels, followed by the filter scratch row
+  size_t offsets[WorldCameraPyramidFrame::kMaxLevels] = {};
+  size_t size = 0;
+  uint32_t count = 1;
+  for (; count < level_count_; ++count) {
+    const MLWorldCameraFrameBuffer &above = pyramid_.levels[count - 1];
+    if (above.width < kMinLevelSize || above.height < kMinLevelSize) {
+      break;
+    }
+    MLWorldCameraFrameBuffer &level = pyramid_.levels[count];
+    level = MLWorldCameraFrameBuffer{};
+    level.width = (above.width + 1) / 2;
+    level.height = (above.height + 1) / 2;
+    level.stride = static_cast<uint32_t>(AlignedStride(level.width));
+    level.bytes_per_pixel = 1;
+    level.size = level.stride * level.height;
+    offsets[count] = size;
+    size += level.size;
+  }
+  const size_t scratch_offset = size;
+  size += AlignedStride((source.width + 4) * sizeof(int16_t));
+  if (!Reserve(size)) {
+    return nullptr;
+  }
+
+  int16_t *scratch = reinterpret_cast<int16_t *>(arena_ + scratch_offset);
+  for (uint32_t i = 1; i < count; ++i) {
+    const MLWorldCameraFrameBuffer &above = pyramid_.levels[i - 1];
+    MLWorldCameraFrameBuffer &level = pyramid_.levels[i];
+    level.data = arena_ + offsets[i];
+    DownsampleWorldCameraImage(above.data, above.width, above.height, above.stride, level.data, level.stride,
+                               scratch);
+  }
+  pyramid_.level_count = count;
+  return &pyramid_;
+}
+
+bool WorldCameraPyramidBuilder::Reserve(size_t size) {
+  if (size <= arena_size_) {
+    return true;
+  }
+  void *memory = nullptr;
+  if (posix_memalign(&memory, kRowAlignment, size) != 0) {
+    return false;
+  }
+  free(arena_);
+  arena_ = static_cast<uint8_t *>(memory);
+  arena_size_ = size;
+  return true;
+}
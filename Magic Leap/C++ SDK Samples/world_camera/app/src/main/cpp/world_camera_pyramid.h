@@ -0,0 +1,75 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <ml_world_camera.h>
+
+// A world camera frame with its Gaussian pyramid. levels[0] is the frame buffer itself.
+struct WorldCameraPyramidFrame {
+  static constexpr uint32_t kMaxLevels = 8;
+
+  MLWorldCameraFrame frame;
+  uint32_t level_count;
+  MLWorldCameraFrameBuffer levels[kMaxLevels];
+};
+
+/*!
+  \brief Builds Gaussian pyramids of 8-bit world camera frames.
+
+  Each level is the previous one blurred with the separable 5-tap kernel
+  [1 4 6 4 1] / 16 in both directions and subsampled by two, with borders
+  reflected around the edge pixel, the same as OpenCV pyrDown. Level sizes are
+  ((width + 1) / 2, (height + 1) / 2) of the level above. Both filter passes use
+  AVX2 when the CPU supports it, with a bit exact scalar fallback.
+
+  All levels live in one arena with rows aligned to 64 bytes. The arena is reused
+  across frames and only grows when a frame needs more room, so building pyramids
+  of a stream does not allocate. Not thread safe.
+*/
+class WorldCameraPyramidBuilder {
+public:
+  static constexpr size_t kRowAlignment = 64;
+
+  // level_count includes the full resolution level and is clamped to kMaxLevels.
+  explicit WorldCameraPyramidBuilder(uint32_t level_count = 4);
+  WorldCameraPyramidBuilder(const WorldCameraPyramidBuilder &) = delete;
+  WorldCameraPyramidBuilder &operator=(const WorldCameraPyramidBuilder &) = delete;
+  ~WorldCameraPyramidBuilder();
+
+  // Returns the pyramid of an 8-bit frame, or NULL if the frame cannot be processed.
+  // Levels stay valid until the next call. Fewer levels are built for frames too
+  // small to be halved level_count - 1 times.
+  const WorldCameraPyramidFrame *Build(const MLWorldCameraFrame &frame);
+
+private:
+  bool Reserve(size_t size);
+
+  uint32_t level_count_;
+  uint8_t *arena_ = nullptr;
+  size_t arena_size_ = 0;
+  WorldCameraPyramidFrame pyramid_ = {};
+};
+
+// Halves an 8-bit image with the pyramid filter, writing ((width + 1) / 2) x ((height + 1) / 2)
+// pixels to dst, using AVX2 when available. scratch must hold width + 4 int16_t values. width and
+// height must be at least 3.
+void DownsampleWorldCameraImage(const uint8_t *src, uint32_t width, uint32_t height, uint32_t src_stride,
+                                uint8_t *dst, uint32_t dst_stride, int16_t *scratch);
+
+// Portable implementation of DownsampleWorldCameraImage, bit exact with the vectorized one.
+void DownsampleWorldCameraImageScalar(const uint8_t *src, uint32_t width, uint32_t height, uint32_t src_stride,
+                                      uint8_t *dst, uint32_t dst_stride, int16_t *scratch);
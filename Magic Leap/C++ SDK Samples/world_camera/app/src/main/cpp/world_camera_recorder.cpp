@@ -0,0 +1,227 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_recorder.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace {
+
+  // Maximum number of slots persisted by a single vectored write
+  constexpr size_t kMaxBatch = 8;
+}
+
+WorldCameraRecorder::~WorldCameraRecorder() {
+  Stop();
+}
+
+bool WorldCameraRecorder::Start(const char *path, size_t slot_count, size_t max_frame_size) {
+  if (IsRecording() || !path || slot_count == 0 || max_frame_size == 0) {
+    return false;
+  }
+  fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+  direct_io_ = fd_ >= 0;
+  if (fd_ < 0 && errno == EINVAL) {
+    // File system does not support direct I/O
+    fd_ = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  }
+  if (fd_ < 0) {
+    return false;
+  }
+
+  // One extra aligned slot holds the file header page
+  slot_size_ = WorldCameraCaptureAlignedSize(max_frame_size);
+  void *memory = nullptr;
+  if (posix_memalign(&memory, kWorldCameraCaptureAlignment, slot_size_ * (slot_count + 1)) != 0) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  slot_memory_ = static_cast<uint8_t *>(memory);
+
+  uint8_t *header_page = slot_memory_ + slot_size_ * slot_count;
+  memset(header_page, 0, kWorldCameraCaptureAlignment);
+  WorldCameraCaptureHeader header = {};
+  header.magic = kWorldCameraCaptureMagic;
+  header.version = kWorldCameraCaptureVersion;
+  header.alignment = kWorldCameraCaptureAlignment;
+  memcpy(header_page, &header, sizeof(header));
+  iovec header_iov = {header_page, kWorldCameraCaptureAlignment};
+  if (!WriteWorldCameraCaptureVectors(fd_, &header_iov, 1, 0)) {
+    close(fd_);
+    fd_ = -1;
+    FreeSlots();
+    return false;
+  }
+  offset_ = kWorldCameraCaptureAlignment;
+
+  path_ = path;
+  slots_.resize(slot_count);
+  free_slots_.clear();
+  for (size_t i = 0; i < slot_count; ++i) {
+    slots_[i].data = slot_memory_ + slot_size_ * i;
+    free_slots_.push_back(slot_count - 1 - i);
+  }
+  ready_slots_.assign(slot_count, 0);
+  ready_head_ = 0;
+  ready_count_ = 0;
+  index_.clear();
+  // Roughly 10 minutes of all cameras in both modes before the index has to grow
+  index_.reserve(kWorldCameraStreamCount * 30 * 60 * 10);
+  for (size_t i = 0; i < kWorldCameraStreamCount; ++i) {
+    frames_written_[i] = 0;
+    bytes_written_[i] = 0;
+    frames_dropped_[i] = 0;
+  }
+  queue_depth_ = 0;
+  write_failed_ = false;
+  stopping_ = false;
+  writer_ = std::thread(&WorldCameraRecorder::WriterLoop, this);
+  return true;
+}
+
+bool WorldCameraRecorder::Submit(const MLWorldCameraFrame &frame) {
+  const size_t stream = WorldCameraStreamIndex(frame);
+  if (!IsRecording() || stream >= kWorldCameraStreamCount || !frame.frame_buffer.data) {
+    return false;
+  }
+  const size_t size = frame.frame_buffer.size;
+  size_t slot_index;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_slots_.empty() || size > slot_size_ || write_failed_) {
+      frames_dropped_[stream].fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    slot_index = free_slots_.back();
+    free_slots_.pop_back();
+  }
+
+  // Copy outside the lock so the writer thread is never held up by it
+  Slot &slot = slots_[slot_index];
+  memcpy(slot.data, frame.frame_buffer.data, size);
+  memset(slot.data + size, 0, WorldCameraCaptureAlignedSize(size) - size);
+  slot.frame = frame;
+  slot.frame.frame_buffer.data = slot.data;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ready_slots_[(ready_head_ + ready_count_) % ready_slots_.size()] = slot_index;
+    ++ready_count_;
+    queue_depth_.store(ready_count_, std::memory_order_relaxed);
+  }
+  ready_cv_.notify_one();
+  return true;
+}
+
+bool WorldCameraRecorder::Stop() {
+  if (!IsRecording()) {
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  ready_cv_.notify_one();
+  writer_.join();
+
+  bool ok = close(fd_) == 0 && !write_failed_;
+  fd_ = -1;
+  // The index is not a whole number of blocks, so it is written without O_DIRECT
+  if (ok) {
+    const int footer_fd = open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+    ok = footer_fd >= 0 && WriteWorldCameraCaptureFooter(footer_fd, offset_, index_);
+    if (footer_fd >= 0) {
+      ok = close(footer_fd) == 0 && ok;
+    }
+  }
+  index_.clear();
+  FreeSlots();
+  return ok;
+}
+
+WorldCameraRecorder::StreamCounters WorldCameraRecorder::GetCounters(MLWorldCameraIdentifier camera,
+                                                                     MLWorldCameraFrameType frame_type) const {
+  const size_t stream = WorldCameraStreamIndex(camera, frame_type);
+  if (stream >= kWorldCameraStreamCount) {
+    return {};
+  }
+  return {frames_written_[stream].load(std::memory_order_relaxed),
+          bytes_written_[stream].load(std::memory_order_relaxed),
+          frames_dropped_[stream].load(std::memory_order_relaxed)};
+}
+
+void WorldCameraRecorder::WriterLoop() {
+  size_t batch[kMaxBatch];
+  while (true) {
+    size_t count = 0;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_cv_.wait(lock, [this] { return ready_count_ > 0 || stopping_; });
+      if (ready_count_ == 0) {
+        return;
+      }
+      while (count < kMaxBatch && ready_count_ > 0) {
+        batch[count++] = ready_slots_[ready_head_];
+        ready_head_ = (ready_head_ + 1) % ready_slots_.size();
+        --ready_count_;
+      }
+    }
+
+    if (!write_failed_.load(std::memory_order_relaxed) && !WriteBatch(batch, count)) {
+      write_failed_.store(true, std::memory_order_relaxed);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < count; ++i) {
+      free_slots_.push_back(batch[i]);
+    }
+    queue_depth_.store(ready_count_, std::memory_order_relaxed);
+  }
+}
+
+bool WorldCameraRecorder::WriteBatch(const size_t *slot_indices, size_t count) {
+  iovec iov[kMaxBatch];
+  for (size_t i = 0; i < count; ++i) {
+    const Slot &slot = slots_[slot_indices[i]];
+    iov[i].iov_base = slot.data;
+    iov[i].iov_len = WorldCameraCaptureAlignedSize(slot.frame.frame_buffer.size);
+  }
+  if (!WriteWorldCameraCaptureVectors(fd_, iov, static_cast<int>(count), offset_)) {
+    return false;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const MLWorldCameraFrame &frame = slots_[slot_indices[i]].frame;
+    const size_t stream = WorldCameraStreamIndex(frame);
+    index_.push_back(MakeWorldCameraCaptureIndexEntry(frame, offset_));
+    offset_ += WorldCameraCaptureAlignedSize(frame.frame_buffer.size);
+    frames_written_[stream].fetch_add(1, std::memory_order_relaxed);
+    bytes_written_[stream].fetch_add(frame.frame_buffer.size, std::memory_order_relaxed);
+  }
+  return true;
+}
+
+void WorldCameraRecorder::FreeSlots() {
+  free(slot_memory_);
+  slot_memory_ = nullptr;
+  slots_.clear();
+  free_slots_.clear();
+  ready_slots_.clear();
+}
@@ -0,0 +1,101 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_capture.h"
+#include "world_camera_stream.h"
+
+/*!
+  \brief Records world camera frames to a capture file from a background thread.
+
+  Submit copies the frame into one of a fixed set of preallocated, page aligned
+  slots and returns; it never waits on disk I/O. A writer thread persists queued
+  slots in batches with a single vectored write per batch, using O_DIRECT when the
+  file system supports it so recording does not churn the page cache. When every
+  slot is queued, new frames are dropped and counted instead of blocking the caller.
+
+  Submit must be called from a single thread. Counters may be read from any thread.
+*/
+class WorldCameraRecorder {
+public:
+  struct StreamCounters {
+    uint64_t frames_written;
+    uint64_t bytes_written;
+    uint64_t frames_dropped;
+  };
+
+  WorldCameraRecorder() = default;
+  WorldCameraRecorder(const WorldCameraRecorder &) = delete;
+  WorldCameraRecorder &operator=(const WorldCameraRecorder &) = delete;
+  ~WorldCameraRecorder();
+
+  // Preallocates slot_count slots of max_frame_size bytes and starts the writer thread.
+  bool Start(const char *path, size_t slot_count = 24, size_t max_frame_size = 1016 * 1016);
+  // Returns false if the frame was dropped.
+  bool Submit(const MLWorldCameraFrame &frame);
+  // Writes all queued frames and the capture index, then stops the writer thread.
+  bool Stop();
+
+  bool IsRecording() const { return writer_.joinable(); }
+  bool IsDirectIO() const { return direct_io_; }
+  size_t QueueDepth() const { return queue_depth_.load(std::memory_order_relaxed); }
+  StreamCounters GetCounters(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const;
+
+private:
+  struct Slot {
+    uint8_t *data;
+    MLWorldCameraFrame frame;
+  };
+
+  void WriterLoop();
+  bool WriteBatch(const size_t *slot_indices, size_t count);
+  void FreeSlots();
+
+  std::string path_;
+  int fd_ = -1;
+  bool direct_io_ = false;
+  std::atomic<bool> write_failed_{false};
+  uint64_t offset_ = 0;
+  size_t slot_size_ = 0;
+  uint8_t *slot_memory_ = nullptr;
+  std::vector<Slot> slots_;
+  std::vector<WorldCameraCaptureIndexEntry> index_;
+
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  // Free slots are used as a stack, queued slots as a ring in submission order
+  std::vector<size_t> free_slots_;
+  std::vector<size_t> ready_slots_;
+  size_t ready_head_ = 0;
+  size_t ready_count_ = 0;
+  bool stopping_ = false;
+  std::thread writer_;
+
+  std::atomic<size_t> queue_depth_{0};
+  std::array<std::atomic<uint64_t>, kWorldCameraStreamCount> frames_written_{};
+  std::array<std::atomic<uint64_t>, kWorldCameraStreamCount> bytes_written_{};
+  std::array<std::atomic<uint64_t>, kWorldCameraStreamCount> frames_dropped_{};
+};
@@ -0,0 +1,877 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_replay.h"
+
+#include <algorithm>
+#include <array>
+#include <thread>
+
+#include "world_camera_downscale.h"
+#include "world_camera_pose_history.h"
+#include "world_camera_scheduler.h"
+
+namespace {
+
+  // Longest a producer poll sleeps, which bounds how long unregistering callbacks waits for it
+  constexpr uint64_t kProducerPollMs = 10;
+  // Longest the callback threads sleep before checking their queue again
+  constexpr auto kWakeInterval = std::chrono::milliseconds(1);
+
+  constexpr double kNanosecondsPerSecond = 1e9;
+
+  // Inverse of WorldCameraStreamIndex
+  MLWorldCameraIdentifier CameraForStream(size_t stream) {
+    return static_cast<MLWorldCameraIdentifier>(MLWorldCameraIdentifier_Left << (stream / 2));
+  }
+
+  MLWorldCameraFrameType FrameTypeForStream(size_t stream) {
+    return (stream % 2) ? MLWorldCameraFrameType_NormalExposure : MLWorldCameraFrameType_LowExposure;
+  }
+
+  uint32_t ModeForFrameType(MLWorldCameraFrameType frame_type) {
+    switch (frame_type) {
+      case MLWorldCameraFrameType_LowExposure: return MLWorldCameraMode_LowExposure;
+      case MLWorldCameraFrameType_NormalExposure: return MLWorldCameraMode_NormalExposure;
+      default: return MLWorldCameraMode_Unknown;
+    }
+  }
+
+  template <typename T>
+  void UpdatePeak(std::atomic<T> &peak, T value) {
+    T current = peak.load(std::memory_order_relaxed);
+    while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  bool IsValidOutputSettings(const WorldCameraReplay::OutputSettings &settings) {
+    for (uint32_t factor : settings.downscale) {
+      if (factor != 1 && factor != 2 && factor != 4) {
+        return false;
+      }
+    }
+    for (uint32_t depth : settings.queue_depth) {
+      if (depth < 1 || depth > WorldCameraReplay::kMaxQueueDepth) {
+        return false;
+      }
+    }
+    return true;
+  }
+}
+
+WorldCameraReplay::~WorldCameraReplay() {
+  Disconnect();
+}
+
+MLResult WorldCameraReplay::Connect(const char *capture_path, const MLWorldCameraSettings *settings,
+                                    Timing timing, bool loop) {
+  if (connected_ || !capture_path || !settings) {
+    return MLResult_InvalidParam;
+  }
+  if (!LoadCapture(capture_path)) {
+    capture_.Close();
+    return MLResult_UnspecifiedFailure;
+  }
+  settings_ = *settings;
+  output_settings_ = OutputSettings();
+  settings_generation_.fetch_add(1, std::memory_order_release);
+  has_schedule_ = false;
+  collected_.store(0, std::memory_order_relaxed);
+  timing_ = timing;
+  loop_ = loop;
+  cursor_ = Cursor();
+  ResetPools();
+  start_time_ = std::chrono::steady_clock::now();
+  connected_ = true;
+  ResetMetrics();
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::UpdateSettings(const MLWorldCameraSettings *settings) {
+  if (!connected_ || !settings) {
+    return MLResult_InvalidParam;
+  }
+  std::unique_lock<std::shared_mutex> lock(settings_mutex_);
+  settings_ = *settings;
+  settings_generation_.fetch_add(1, std::memory_order_release);
+  // Rates of 0 share the slots of the enabled modes, which may have changed
+  if (has_schedule_) {
+    ApplySchedule(schedule_, settings_.mode);
+  }
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::SetOutputSettings(const OutputSettings *settings) {
+  if (!connected_ || !settings || !IsValidOutputSettings(*settings)) {
+    return MLResult_InvalidParam;
+  }
+  std::unique_lock<std::shared_mutex> lock(settings_mutex_);
+  output_settings_ = *settings;
+  settings_generation_.fetch_add(1, std::memory_order_release);
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::SetSchedule(const WorldCameraSchedule *schedule) {
+  if (!connected_ || !schedule) {
+    return MLResult_InvalidParam;
+  }
+  std::unique_lock<std::shared_mutex> lock(settings_mutex_);
+  if (!ApplySchedule(*schedule, settings_.mode)) {
+    return MLResult_InvalidParam;
+  }
+  schedule_ = *schedule;
+  has_schedule_ = true;
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::GetLatestWorldCameraData(uint64_t timeout_ms, MLWorldCameraData **out_data) {
+  if (!connected_ || !out_data) {
+    return MLResult_InvalidParam;
+  }
+  if (callbacks_registered_) {
+    return MLResult_IllegalState;
+  }
+  DataSlot *slot = nullptr;
+  const MLResult result = Poll(cursor_, data_slots_.data(), data_slots_.size(), timeout_ms, false, &slot);
+  if (slot) {
+    RecordDelivery(cursor_, *slot);
+  }
+  *out_data = slot ? &slot->data : nullptr;
+  return result;
+}
+
+MLResult WorldCameraReplay::GetBufferedWorldCameraData(uint64_t timeout_ms, MLWorldCameraData **out_data) {
+  if (!connected_ || !out_data) {
+    return MLResult_InvalidParam;
+  }
+  if (callbacks_registered_) {
+    return MLResult_IllegalState;
+  }
+  DataSlot *slot = nullptr;
+  const MLResult result = Poll(cursor_, data_slots_.data(), data_slots_.size(), timeout_ms, true, &slot);
+  if (slot) {
+    RecordDelivery(cursor_, *slot);
+  }
+  *out_data = slot ? &slot->data : nullptr;
+  return result;
+}
+
+MLResult WorldCameraReplay::Poll(Cursor &cursor, DataSlot *slots, size_t slot_count, uint64_t timeout_ms,
+                                 bool buffered, DataSlot **out_slot) {
+  *out_slot = nullptr;
+  DataSlot *slot = ClaimDataSlot(slots, slot_count);
+  if (!slot) {
+    exhausted_polls_.fetch_add(1, std::memory_order_relaxed);
+    return MLResult_AllocFailed;
+  }
+  RefreshSettings(cursor);
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+  while (true) {
+    const size_t frame_count = (timing_ == Timing::Recorded) ? CollectRecorded(cursor, buffered, *slot)
+                                                             : CollectAsFastAsPossible(cursor, buffered, *slot);
+    if (frame_count > 0 && ApplyOutputSettings(cursor, *slot) > 0) {
+      break;
+    }
+    if (timing_ == Timing::AsFastAsPossible || IsExhausted(cursor) || std::chrono::steady_clock::now() >= deadline) {
+      ReleaseDataSlot(*slot);
+      return MLResult_Timeout;
+    }
+    // Sleep until the next frame is due or the timeout expires, whichever comes first
+    std::this_thread::sleep_until(std::min(DueTime(cursor.position), deadline));
+  }
+
+  MLWorldCameraDataInit(&slot->data);
+  slot->data.frame_count = static_cast<uint8_t>(slot->count);
+  slot->data.frames = slot->frames.data();
+  *out_slot = slot;
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::ReleaseCameraData(MLWorldCameraData *world_camera_data) {
+  if (!connected_ || !world_camera_data) {
+    return MLResult_InvalidParam;
+  }
+  const size_t index = SlotIndex(world_camera_data);
+  if (index == data_slots_.size() || !data_slots_[index].in_use.load(std::memory_order_relaxed)) {
+    return MLResult_InvalidParam;
+  }
+  ReleaseDataSlot(data_slots_[index]);
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::GetPoseAtTime(MLWorldCameraIdentifier camera, MLTime time, MLTransform *out_pose) const {
+  const size_t camera_index = WorldCameraIndex(camera);
+  if (!connected_ || camera_index == kWorldCameraCount || !out_pose) {
+    return MLResult_InvalidParam;
+  }
+  const uint64_t end = timing_ == Timing::Recorded ? DueCount(std::chrono::steady_clock::now())
+                                                  : collected_.load(std::memory_order_relaxed);
+  if (end == 0) {
+    return MLResult_Timeout;
+  }
+  // Only the frames of the current loop share a time base
+  const size_t loop_end = end % frames_.size() == 0 ? frames_.size() : end % frames_.size();
+  const std::vector<size_t> &positions = camera_frames_[camera_index];
+  const auto history_end = std::lower_bound(positions.begin(), positions.end(), loop_end);
+  const auto history_begin = history_end - std::min<ptrdiff_t>(history_end - positions.begin(),
+                                                                WorldCameraPoseHistory::kCapacity);
+  // First sample at or after time
+  const auto after = std::lower_bound(history_begin, history_end, time, [this](size_t position, MLTime t) {
+    return frames_[position].timestamp < t;
+  });
+  if (after == history_end) {
+    return MLResult_Timeout;
+  }
+  const MLWorldCameraFrame &next = frames_[*after];
+  if (next.timestamp == time) {
+    *out_pose = next.camera_pose;
+    return MLResult_Ok;
+  }
+  if (after == history_begin) {
+    return MLResult_Timeout;
+  }
+  const MLWorldCameraFrame &previous = frames_[*(after - 1)];
+  const double t = static_cast<double>(time - previous.timestamp) /
+                   static_cast<double>(next.timestamp - previous.timestamp);
+  *out_pose = InterpolateWorldCameraPose(previous.camera_pose, next.camera_pose, t);
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::SetCallbacks(const Callbacks *cb, void *user_data) {
+  if (!connected_) {
+    return MLResult_InvalidParam;
+  }
+  if (cb && (!cb->on_data_available || cb->queue_depth < 1 || cb->queue_depth > kMaxCallbackQueueDepth ||
+             cb->queue_policy < QueuePolicy::DropOldest || cb->queue_policy > QueuePolicy::Block)) {
+    return MLResult_InvalidParam;
+  }
+  StopCallbacks();
+  if (!cb) {
+    return MLResult_Ok;
+  }
+  callbacks_ = *cb;
+  callbacks_user_data_ = user_data;
+  delivery_queue_.Reset(cb->queue_depth);
+  stopping_ = false;
+  callbacks_registered_ = true;
+  delivery_ = std::thread(&WorldCameraReplay::DeliveryLoop, this);
+  producer_ = std::thread(&WorldCameraReplay::ProducerLoop, this);
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::CreateSubscription(const SubscriptionSettings *settings, MLHandle *out_subscription) {
+  if (!connected_ || !settings || !out_subscription || (settings->cameras & MLWorldCameraIdentifier_All) == 0 ||
+      (settings->mode & (MLWorldCameraMode_LowExposure | MLWorldCameraMode_NormalExposure)) == 0) {
+    return MLResult_InvalidParam;
+  }
+  for (size_t i = 0; i < subscriptions_.size(); ++i) {
+    Subscription &subscription = subscriptions_[i];
+    bool expected = false;
+    if (!subscription.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      continue;
+    }
+    Cursor &cursor = subscription.cursor;
+    cursor = Cursor();
+    cursor.cameras = settings->cameras;
+    cursor.mode = settings->mode;
+    cursor.next_buffer = (i + 1) * buffers_.size() / (subscriptions_.size() + 1);
+    if (timing_ == Timing::Recorded) {
+      cursor.position = DueCount(std::chrono::steady_clock::now());
+    }
+    *out_subscription = i + 1;
+    return MLResult_Ok;
+  }
+  // Every subscription is in use
+  return MLResult_UnspecifiedFailure;
+}
+
+MLResult WorldCameraReplay::GetSubscriptionData(MLHandle subscription, uint64_t timeout_ms,
+                                                MLWorldCameraData **out_data) {
+  Subscription *found = FindSubscription(subscription);
+  if (!found || !out_data) {
+    return MLResult_InvalidParam;
+  }
+  DataSlot *slot = nullptr;
+  const MLResult result =
+          Poll(found->cursor, found->data_slots.data(), found->data_slots.size(), timeout_ms, false, &slot);
+  if (slot) {
+    RecordDelivery(found->cursor, *slot);
+  }
+  *out_data = slot ? &slot->data : nullptr;
+  return result;
+}
+
+MLResult WorldCameraReplay::ReleaseSubscriptionData(MLHandle subscription, MLWorldCameraData *world_camera_data) {
+  Subscription *found = FindSubscription(subscription);
+  if (!found || !world_camera_data) {
+    return MLResult_InvalidParam;
+  }
+  for (DataSlot &slot : found->data_slots) {
+    if (&slot.data == world_camera_data && slot.in_use.load(std::memory_order_relaxed)) {
+      ReleaseDataSlot(slot);
+      return MLResult_Ok;
+    }
+  }
+  return MLResult_InvalidParam;
+}
+
+MLResult WorldCameraReplay::DestroySubscription(MLHandle subscription) {
+  Subscription *found = FindSubscription(subscription);
+  if (!found) {
+    return MLResult_InvalidParam;
+  }
+  for (DataSlot &slot : found->data_slots) {
+    if (slot.in_use.load(std::memory_order_relaxed)) {
+      ReleaseDataSlot(slot);
+    }
+  }
+  found->in_use.store(false, std::memory_order_release);
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::AcquireFrameLease(const MLWorldCameraFrame *frame, FrameLease *out_lease) {
+  if (!connected_ || !frame || !out_lease) {
+    return MLResult_InvalidParam;
+  }
+  // Only frames of unreleased data can be leased. Slots are matched by address so the
+  // frames of slots other threads are filling are not read.
+  size_t buffer = kBufferCapacity;
+  const uintptr_t address = reinterpret_cast<uintptr_t>(frame);
+  const auto find = [&](const DataSlot &slot) {
+    const uintptr_t first = reinterpret_cast<uintptr_t>(slot.frames.data());
+    if (address < first || address >= first + sizeof(slot.frames) || !slot.in_use.load(std::memory_order_acquire)) {
+      return false;
+    }
+    const size_t index = (address - first) / sizeof(MLWorldCameraFrame);
+    if (index < slot.count && &slot.frames[index] == frame) {
+      buffer = slot.buffers[index];
+    }
+    return true;
+  };
+  bool found = std::any_of(data_slots_.begin(), data_slots_.end(), find);
+  for (size_t i = 0; i < subscriptions_.size() && !found; ++i) {
+    found = std::any_of(subscriptions_[i].data_slots.begin(), subscriptions_[i].data_slots.end(), find);
+  }
+  if (buffer == kBufferCapacity) {
+    return MLResult_InvalidParam;
+  }
+  // Take the references before publishing the lease, so a concurrent release of it cannot free the buffer
+  buffers_[buffer].refs.fetch_add(1, std::memory_order_relaxed);
+  buffers_[buffer].leases.fetch_add(1, std::memory_order_relaxed);
+  for (size_t i = 0; i < leases_.size(); ++i) {
+    size_t expected = 0;
+    if (!leases_[i].compare_exchange_strong(expected, buffer + 1, std::memory_order_acq_rel)) {
+      continue;
+    }
+    *out_lease = FrameLease();
+    out_lease->lease_handle = i + 1;
+    out_lease->id = frame->id;
+    out_lease->frame_number = frame->frame_number;
+    out_lease->frame_type = frame->frame_type;
+    out_lease->frame_buffer = frame->frame_buffer;
+    return MLResult_Ok;
+  }
+  // Every lease is held
+  buffers_[buffer].leases.fetch_sub(1, std::memory_order_relaxed);
+  ReleaseBuffer(buffer);
+  return MLResult_UnspecifiedFailure;
+}
+
+MLResult WorldCameraReplay::ReleaseFrameLease(FrameLease *lease) {
+  if (!connected_ || !lease || lease->lease_handle == 0 || lease->lease_handle > leases_.size()) {
+    return MLResult_InvalidParam;
+  }
+  const size_t entry = leases_[lease->lease_handle - 1].exchange(0, std::memory_order_acq_rel);
+  if (entry == 0) {
+    return MLResult_InvalidParam;
+  }
+  buffers_[entry - 1].leases.fetch_sub(1, std::memory_order_relaxed);
+  ReleaseBuffer(entry - 1);
+  lease->lease_handle = ML_INVALID_HANDLE;
+  lease->frame_buffer.data = nullptr;
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::GetPoolStatus(PoolStatus *out_status) const {
+  if (!connected_ || !out_status) {
+    return MLResult_InvalidParam;
+  }
+  *out_status = PoolStatus();
+  out_status->data_capacity = static_cast<uint32_t>(data_slots_.size() + subscriptions_.size() * kSubscriptionDataCapacity);
+  out_status->data_in_use = data_in_use_.load(std::memory_order_relaxed);
+  out_status->data_peak = data_peak_.load(std::memory_order_relaxed);
+  out_status->buffer_capacity = static_cast<uint32_t>(buffers_.size());
+  out_status->buffers_in_use = buffers_in_use_.load(std::memory_order_relaxed);
+  for (const FrameBuffer &buffer : buffers_) {
+    const uint32_t leases = buffer.leases.load(std::memory_order_relaxed);
+    if (leases > 0 && buffer.refs.load(std::memory_order_relaxed) == leases) {
+      ++out_status->buffers_leased;
+    }
+  }
+  out_status->buffers_peak = buffers_peak_.load(std::memory_order_relaxed);
+  // Full resolution pixels stay in the memory mapped capture; only downscaled frames need pixel storage
+  out_status->reserved_bytes = sizeof(data_slots_) + sizeof(subscriptions_) + sizeof(buffers_) + sizeof(leases_) +
+                               pixel_bytes_.load(std::memory_order_relaxed);
+  out_status->exhausted_polls = exhausted_polls_.load(std::memory_order_relaxed);
+  out_status->exhausted_frames = exhausted_frames_.load(std::memory_order_relaxed);
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::GetMetrics(Metrics *out_metrics) const {
+  if (!connected_ || !out_metrics) {
+    return MLResult_InvalidParam;
+  }
+  *out_metrics = Metrics();
+  for (size_t stream = 0; stream < metrics_.size(); ++stream) {
+    const StreamCounters &metrics = metrics_[stream];
+    const uint64_t delivered = metrics.delivered.load(std::memory_order_relaxed);
+    if (delivered == 0) {
+      continue;
+    }
+    StreamMetrics &out = out_metrics->streams[out_metrics->stream_count++];
+    out.id = CameraForStream(stream);
+    out.frame_type = FrameTypeForStream(stream);
+    out.frames_delivered = delivered;
+    out.frames_dropped = metrics.dropped.load(std::memory_order_relaxed);
+    out.frames_duplicated = metrics.duplicated.load(std::memory_order_relaxed);
+    metrics.latency.Read(&out.latency);
+    metrics.interval.Read(&out.interval);
+  }
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::ResetMetrics() {
+  if (!connected_) {
+    return MLResult_InvalidParam;
+  }
+  for (StreamCounters &metrics : metrics_) {
+    metrics.delivered.store(0, std::memory_order_relaxed);
+    metrics.dropped.store(0, std::memory_order_relaxed);
+    metrics.duplicated.store(0, std::memory_order_relaxed);
+    metrics.latency.Reset();
+    metrics.interval.Reset();
+  }
+  metrics_generation_.fetch_add(1, std::memory_order_release);
+  return MLResult_Ok;
+}
+
+MLResult WorldCameraReplay::Disconnect() {
+  if (!connected_) {
+    return MLResult_InvalidParam;
+  }
+  StopCallbacks();
+  connected_ = false;
+  frames_.clear();
+  scheduled_.clear();
+  ResetPools();
+  capture_.Close();
+  return MLResult_Ok;
+}
+
+bool WorldCameraReplay::LoadCapture(const char *capture_path) {
+  if (!capture_.Open(capture_path)) {
+    return false;
+  }
+  frames_.clear();
+  frames_.reserve(capture_.FrameCount());
+  for (size_t i = 0; i < capture_.FrameCount(); ++i) {
+    frames_.push_back(capture_.Frame(i));
+  }
+  // The capture index is ordered by camera first; replay needs a single timeline
+  std::stable_sort(frames_.begin(), frames_.end(), [](const MLWorldCameraFrame &a, const MLWorldCameraFrame &b) {
+    return a.timestamp < b.timestamp;
+  });
+  if (frames_.empty()) {
+    return false;
+  }
+  for (auto &positions : camera_frames_) {
+    positions.clear();
+  }
+  for (size_t position = 0; position < frames_.size(); ++position) {
+    const size_t camera_index = WorldCameraIndex(frames_[position].id);
+    if (camera_index < camera_frames_.size()) {
+      camera_frames_[camera_index].push_back(position);
+    }
+  }
+  scheduled_ = std::vector<std::atomic<bool>>(frames_.size());
+  for (auto &scheduled : scheduled_) {
+    scheduled.store(true, std::memory_order_relaxed);
+  }
+  // A loop lasts from the first frame until one frame interval after the last one
+  MLTime interval = 1;
+  const size_t first_stream = WorldCameraStreamIndex(frames_.front());
+  for (size_t i = 1; i < frames_.size(); ++i) {
+    if (WorldCameraStreamIndex(frames_[i]) == first_stream) {
+      interval = std::max<MLTime>(1, frames_[i].timestamp - frames_.front().timestamp);
+      break;
+    }
+  }
+  loop_duration_ = frames_.back().timestamp - frames_.front().timestamp + interval;
+  return true;
+}
+
+WorldCameraReplay::DataSlot *WorldCameraReplay::ClaimDataSlot(DataSlot *slots, size_t slot_count) {
+  for (size_t i = 0; i < slot_count; ++i) {
+    bool expected = false;
+    if (slots[i].in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+      slots[i].count = 0;
+      UpdatePeak(data_peak_, data_in_use_.fetch_add(1, std::memory_order_relaxed) + 1);
+      return &slots[i];
+    }
+  }
+  return nullptr;
+}
+
+void WorldCameraReplay::ReleaseDataSlot(DataSlot &slot) {
+  for (size_t i = 0; i < slot.count; ++i) {
+    ReleaseBuffer(slot.buffers[i]);
+  }
+  slot.count = 0;
+  slot.in_use.store(false, std::memory_order_release);
+  data_in_use_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+size_t WorldCameraReplay::SlotIndex(const MLWorldCameraData *data) const {
+  for (size_t i = 0; i < data_slots_.size(); ++i) {
+    if (&data_slots_[i].data == data) {
+      return i;
+    }
+  }
+  return data_slots_.size();
+}
+
+WorldCameraReplay::Subscription *WorldCameraReplay::FindSubscription(MLHandle subscription) {
+  if (!connected_ || subscription == 0 || subscription > subscriptions_.size()) {
+    return nullptr;
+  }
+  Subscription &found = subscriptions_[subscription - 1];
+  return found.in_use.load(std::memory_order_acquire) ? &found : nullptr;
+}
+
+size_t WorldCameraReplay::ClaimBuffer(size_t &next_buffer) {
+  for (size_t i = 0; i < buffers_.size(); ++i) {
+    const size_t buffer = (next_buffer + i) % buffers_.size();
+    uint32_t expected = 0;
+    if (buffers_[buffer].refs.compare_exchange_strong(expected, 1, std::memory_order_acquire)) {
+      next_buffer = (buffer + 1) % buffers_.size();
+      UpdatePeak(buffers_peak_, buffers_in_use_.fetch_add(1, std::memory_order_relaxed) + 1);
+      return buffer;
+    }
+  }
+  return buffers_.size();
+}
+
+void WorldCameraReplay::ReleaseBuffer(size_t buffer) {
+  if (buffers_[buffer].refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    buffers_in_use_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void WorldCameraReplay::RefreshSettings(Cursor &cursor) {
+  // Only UpdateSettings takes the lock exclusively, so steady state polls do not touch it
+  if (settings_generation_.load(std::memory_order_acquire) == cursor.settings_generation) {
+    return;
+  }
+  std::shared_lock<std::shared_mutex> lock(settings_mutex_);
+  cursor.settings = settings_;
+  cursor.output = output_settings_;
+  cursor.settings_generation = settings_generation_.load(std::memory_order_relaxed);
+}
+
+bool WorldCameraReplay::ApplySchedule(const WorldCameraSchedule &schedule, uint32_t modes) {
+  for (size_t camera_index = 0; camera_index < kWorldCameraCount; ++camera_index) {
+    const MLWorldCameraIdentifier camera = CameraForStream(camera_index * 2);
+    const auto slot_count = std::count_if(frames_.begin(), frames_.end(), [camera](const MLWorldCameraFrame &frame) {
+      return frame.id == camera;
+    });
+    if (slot_count == 0) {
+      continue;
+    }
+    // Every recorded frame of the camera is one of its slots; validity does not depend on
+    // the slot rate, so an invalid schedule is rejected before the first camera is changed
+    WorldCameraExposureScheduler scheduler(slot_count * kNanosecondsPerSecond / loop_duration_);
+    if (!scheduler.SetSchedule(schedule, modes)) {
+      return false;
+    }
+    // A slot assigned to a mode delivers the next recorded frame of that mode; slots
+    // assigned while one is still pending do not add up, so frames are not delivered in bursts
+    std::array<bool, kWorldCameraStreamCount> pending = {};
+    for (size_t position = 0; position < frames_.size(); ++position) {
+      const MLWorldCameraFrame &frame = frames_[position];
+      if (frame.id != camera) {
+        continue;
+      }
+      const size_t slot_stream = WorldCameraStreamIndex(camera, scheduler.NextSlot(camera));
+      if (slot_stream < pending.size()) {
+        pending[slot_stream] = true;
+      }
+      const size_t stream = WorldCameraStreamIndex(frame);
+      const bool scheduled = stream < pending.size() && pending[stream];
+      if (scheduled) {
+        pending[stream] = false;
+      }
+      scheduled_[position].store(scheduled, std::memory_order_relaxed);
+    }
+  }
+  return true;
+}
+
+bool WorldCameraReplay::IsRequested(const Cursor &cursor, uint64_t position) const {
+  const MLWorldCameraFrame &frame = FrameAt(position);
+  return (cursor.settings.cameras & cursor.cameras & frame.id) != 0 &&
+         (cursor.settings.mode & cursor.mode & ModeForFrameType(frame.frame_type)) != 0 &&
+         scheduled_[position % frames_.size()].load(std::memory_order_relaxed);
+}
+
+size_t WorldCameraReplay::QueueDepth(const Cursor &cursor, const MLWorldCameraFrame &frame, bool buffered) const {
+  return buffered ? cursor.output.queue_depth[WorldCameraIndex(frame.id)] : 1;
+}
+
+uint64_t WorldCameraReplay::DueCount(std::chrono::steady_clock::time_point time) const {
+  const MLTime elapsed = std::max<MLTime>(
+          0, std::chrono::duration_cast<std::chrono::nanoseconds>(time - start_time_).count());
+  const uint64_t loops = loop_ ? static_cast<uint64_t>(elapsed / loop_duration_) : 0;
+  const MLTime replay_time = frames_.front().timestamp + (loop_ ? elapsed % loop_duration_ : elapsed);
+  const auto due_end = std::upper_bound(frames_.begin(), frames_.end(), replay_time,
+                                        [](MLTime time, const MLWorldCameraFrame &frame) {
+                                          return time < frame.timestamp;
+                                        });
+  return loops * frames_.size() + static_cast<uint64_t>(due_end - frames_.begin());
+}
+
+std::chrono::steady_clock::time_point WorldCameraReplay::DueTime(uint64_t position) const {
+  const uint64_t loops = position / frames_.size();
+  return start_time_ + std::chrono::nanoseconds(static_cast<MLTime>(loops) * loop_duration_ +
+                                                FrameAt(position).timestamp - frames_.front().timestamp);
+}
+
+bool WorldCameraReplay::IsExhausted(const Cursor &cursor) const {
+  return !loop_ && cursor.position >= frames_.size();
+}
+
+size_t WorldCameraReplay::CollectAsFastAsPossible(Cursor &cursor, bool buffered, DataSlot &slot) {
+  std::array<size_t, kWorldCameraStreamCount> used = {};
+  const auto now = std::chrono::steady_clock::now();
+  slot.count = 0;
+  // At most one pass through the capture, in case no frame is requested
+  for (size_t scanned = 0; scanned < frames_.size() && !IsExhausted(cursor); ++scanned, ++cursor.position) {
+    const MLWorldCameraFrame &frame = FrameAt(cursor.position);
+    const size_t stream = WorldCameraStreamIndex(frame);
+    if (stream >= used.size() || !IsRequested(cursor, cursor.position)) {
+      continue;
+    }
+    if (used[stream] == QueueDepth(cursor, frame, buffered)) {
+      break;
+    }
+    ++used[stream];
+    slot.positions[slot.count] = cursor.position;
+    slot.due[slot.count] = now;
+    slot.frames[slot.count++] = frame;
+  }
+  UpdatePeak(collected_, cursor.position);
+  return slot.count;
+}
+
+size_t WorldCameraReplay::CollectRecorded(Cursor &cursor, bool buffered, DataSlot &slot) {
+  const uint64_t end = DueCount(std::chrono::steady_clock::now());
+  // Frames more than a loop behind have been overwritten by newer frames of their stream
+  const uint64_t first = std::max(cursor.position, end > frames_.size() ? end - frames_.size() : 0);
+
+  // Like the device, only the newest queue depth frames of each camera/frame type that
+  // became due since the last poll are delivered; older ones were overwritten
+  std::array<size_t, kWorldCameraStreamCount> due = {};
+  for (uint64_t position = first; position < end; ++position) {
+    const MLWorldCameraFrame &frame = FrameAt(position);
+    const size_t stream = WorldCameraStreamIndex(frame);
+    if (stream < due.size() && IsRequested(cursor, position)) {
+      ++due[stream];
+    }
+  }
+  slot.count = 0;
+  for (uint64_t position = first; position < end; ++position) {
+    const MLWorldCameraFrame &frame = FrameAt(position);
+    const size_t stream = WorldCameraStreamIndex(frame);
+    if (stream < due.size() && IsRequested(cursor, position) && due[stream]-- <= QueueDepth(cursor, frame, buffered)) {
+      slot.positions[slot.count] = position;
+      slot.due[slot.count] = DueTime(position);
+      slot.frames[slot.count++] = frame;
+    }
+  }
+  cursor.position = std::max(cursor.position, end);
+  return slot.count;
+}
+
+size_t WorldCameraReplay::ApplyOutputSettings(Cursor &cursor, DataSlot &slot) {
+  const OutputSettings &settings = cursor.output;
+  size_t kept = 0;
+  for (size_t i = 0; i < slot.count; ++i) {
+    const size_t buffer = ClaimBuffer(cursor.next_buffer);
+    if (buffer == buffers_.size()) {
+      // Every buffer is referenced by unreleased data or leases
+      exhausted_frames_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+    const size_t camera_index = WorldCameraIndex(slot.frames[i].id);
+    MLWorldCameraFrame frame = CropWorldCameraFrame(slot.frames[i], settings.roi[camera_index]);
+    const uint32_t factor = settings.downscale[camera_index];
+    if (factor > 1) {
+      std::vector<uint8_t> &pixels = buffers_[buffer].pixels;
+      const size_t capacity = pixels.capacity();
+      pixels.resize(WorldCameraDownscaledSize(frame, factor));
+      pixel_bytes_.fetch_add(pixels.capacity() - capacity, std::memory_order_relaxed);
+      frame = DownscaleWorldCameraFrame(frame, factor, pixels.data());
+    }
+    slot.frames[kept] = frame;
+    slot.buffers[kept] = buffer;
+    slot.positions[kept] = slot.positions[i];
+    slot.due[kept] = slot.due[i];
+    ++kept;
+  }
+  slot.count = kept;
+  return kept;
+}
+
+void WorldCameraReplay::RecordDelivery(Cursor &cursor, const DataSlot &slot) {
+  const uint64_t generation = metrics_generation_.load(std::memory_order_acquire);
+  if (cursor.metrics_generation != generation) {
+    cursor.sequence.ResetAll();
+    cursor.metrics_generation = generation;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < slot.count; ++i) {
+    const MLWorldCameraFrame &frame = slot.frames[i];
+    const size_t stream = WorldCameraStreamIndex(frame);
+    if (stream >= metrics_.size()) {
+      continue;
+    }
+    StreamCounters &metrics = metrics_[stream];
+    // Frame numbers and timestamps start over with every loop through the capture
+    const uint64_t last_position = cursor.last_position[stream];
+    if (slot.positions[i] / frames_.size() != last_position / frames_.size()) {
+      cursor.sequence.Reset(frame.id, frame.frame_type);
+    }
+    cursor.last_position[stream] = slot.positions[i];
+    const WorldCameraSequenceTracker::StreamState &state = cursor.sequence.Stream(frame.id, frame.frame_type);
+    const uint64_t dropped = state.dropped;
+    switch (cursor.sequence.Update(frame.id, frame.frame_type, frame.frame_number)) {
+      case WorldCameraSequenceTracker::Result::Gap:
+        metrics.dropped.fetch_add(state.dropped - dropped, std::memory_order_relaxed);
+        metrics.interval.Record(frame.timestamp - FrameAt(last_position).timestamp);
+        break;
+      case WorldCameraSequenceTracker::Result::InOrder:
+        metrics.interval.Record(frame.timestamp - FrameAt(last_position).timestamp);
+        break;
+      case WorldCameraSequenceTracker::Result::Duplicate:
+        metrics.duplicated.fetch_add(1, std::memory_order_relaxed);
+        break;
+      default:
+        break;
+    }
+    metrics.delivered.fetch_add(1, std::memory_order_relaxed);
+    metrics.latency.Record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - slot.due[i]).count());
+  }
+}
+
+void WorldCameraReplay::ResetPools() {
+  const auto reset = [](DataSlot &slot) {
+    slot.in_use.store(false, std::memory_order_relaxed);
+    slot.count = 0;
+  };
+  std::for_each(data_slots_.begin(), data_slots_.end(), reset);
+  for (Subscription &subscription : subscriptions_) {
+    subscription.in_use.store(false, std::memory_order_relaxed);
+    std::for_each(subscription.data_slots.begin(), subscription.data_slots.end(), reset);
+  }
+  for (FrameBuffer &buffer : buffers_) {
+    buffer.refs.store(0, std::memory_order_relaxed);
+    buffer.leases.store(0, std::memory_order_relaxed);
+  }
+  for (std::atomic<size_t> &lease : leases_) {
+    lease.store(0, std::memory_order_relaxed);
+  }
+  data_in_use_.store(0, std::memory_order_relaxed);
+  data_peak_.store(0, std::memory_order_relaxed);
+  buffers_in_use_.store(0, std::memory_order_relaxed);
+  buffers_peak_.store(0, std::memory_order_relaxed);
+  exhausted_polls_.store(0, std::memory_order_relaxed);
+  exhausted_frames_.store(0, std::memory_order_relaxed);
+}
+
+void WorldCameraReplay::StopCallbacks() {
+  if (!callbacks_registered_) {
+    return;
+  }
+  stopping_ = true;
+  wake_.notify_all();
+  producer_.join();
+  delivery_.join();
+  // Data pushed after the delivery thread saw the queue empty is released undelivered
+  size_t slot = 0;
+  while (delivery_queue_.TryPop(&slot)) {
+    ReleaseDataSlot(data_slots_[slot]);
+  }
+  callbacks_registered_ = false;
+}
+
+void WorldCameraReplay::ProducerLoop() {
+  while (!stopping_.load(std::memory_order_acquire)) {
+    DataSlot *data = nullptr;
+    if (Poll(cursor_, data_slots_.data(), data_slots_.size(), kProducerPollMs, false, &data) != MLResult_Ok) {
+      // Pool exhausted, or nothing left to replay
+      WaitForWake();
+      continue;
+    }
+    const size_t slot = static_cast<size_t>(data - data_slots_.data());
+    while (!delivery_queue_.TryPush(slot)) {
+      if (callbacks_.queue_policy == QueuePolicy::DropNewest || stopping_.load(std::memory_order_acquire)) {
+        ReleaseDataSlot(data_slots_[slot]);
+        break;
+      }
+      if (callbacks_.queue_policy == QueuePolicy::DropOldest) {
+        size_t oldest = 0;
+        if (delivery_queue_.TryPop(&oldest)) {
+          ReleaseDataSlot(data_slots_[oldest]);
+        }
+        continue;
+      }
+      // Block until the callback has taken an entry
+      WaitForWake();
+    }
+    wake_.notify_all();
+  }
+}
+
+void WorldCameraReplay::DeliveryLoop() {
+  size_t slot = 0;
+  while (true) {
+    if (!delivery_queue_.TryPop(&slot)) {
+      if (stopping_.load(std::memory_order_acquire)) {
+        return;
+      }
+      WaitForWake();
+      continue;
+    }
+    if (!stopping_.load(std::memory_order_acquire)) {
+      RecordDelivery(cursor_, data_slots_[slot]);
+      callbacks_.on_data_available(&data_slots_[slot].data, callbacks_user_data_);
+    }
+    ReleaseDataSlot(data_slots_[slot]);
+    // Room for a blocked producer
+    wake_.notify_all();
+  }
+}
+
+void WorldCameraReplay::WaitForWake() {
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  wake_.wait_for(lock, kWakeInterval);
+}
@@ -0,0 +1,402 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_capture.h"
+#include "world_camera_delivery_queue.h"
+#include "world_camera_downscale.h"
+#include "world_camera_histogram.h"
+#include "world_camera_scheduler.h"
+#include "world_camera_sequence_tracker.h"
+#include "world_camera_stream.h"
+
+/*!
+  \brief Replays a world camera recording through the same calls as the world camera API.
+
+  WorldCameraReplay mirrors MLWorldCameraConnect, MLWorldCameraUpdateSettings,
+  MLWorldCameraGetLatestWorldCameraData,
+  MLWorldCameraReleaseCameraData and MLWorldCameraDisconnect so
+  code consuming world camera data can be driven from a capture file (see
+  world_camera_capture.h) on a host without a device. It only depends on the world camera header.
+
+  Frames are filtered by MLWorldCameraSettings.cameras and .mode exactly like the
+  device. Latest polls return at most one frame per camera and frame type.
+  Buffered polls, which the device API does not offer, return every frame queued
+  since the previous poll up to the queue depth of the output settings, in capture
+  order per camera and frame type; both kinds of poll consume the same queues. Frame buffers point into the
+  memory mapped capture, so no image data is copied.
+
+  Output settings, which the device API does not offer, are set with
+  SetOutputSettings and select a region of interest, a downscale factor and a
+  queue depth per camera. Regions are delivered as views into the capture, and
+  downscaled frames are written to pooled buffers; the intrinsics of either are
+  adjusted to describe the delivered image. Settings passed to Connect and
+  UpdateSettings stay at the version devices accept.
+
+  Schedules, which the device API does not offer, are set with SetSchedule and
+  thin the capture with WorldCameraExposureScheduler: each recorded frame of a
+  camera is one of its sensor slots, and a slot the scheduler assigns to a mode
+  delivers the next recorded frame of that mode. Modes
+  so arrive at their target rate, or at the recorded rate if that is lower. Frames
+  left out keep their recorded frame numbers, so they count as dropped in the
+  metrics. Without a schedule every recorded frame is delivered.
+
+  GetPoseAtTime, which the device API does not offer, interpolates between the
+  camera poses of the last WorldCameraPoseHistory::kCapacity frames of the camera
+  that have been replayed: frames that are due with Recorded timing, or that any
+  consumer has collected with AsFastAsPossible timing, whether or not they were
+  delivered. Timestamps start over with every loop, so the history only spans the
+  current loop. The lookup is a binary search over the capture and takes no lock.
+
+  Data objects and frame buffers come from fixed capacity pools whose occupancy
+  GetPoolStatus reports; the device API has no equivalent. Polling while every data
+  object is unreleased fails with MLResult_AllocFailed, and frames are dropped while
+  every frame buffer is referenced by unreleased data or leases. Polling does not
+  allocate once the downscale buffers have grown to the frame size.
+
+  As an alternative to polling, which the device API does not offer, callbacks can
+  be registered with SetCallbacks; polling then fails with MLResult_IllegalState.
+  Registered callbacks are fed by a producer thread that polls like
+  GetLatestWorldCameraData and pushes data into a lock free queue of the
+  requested depth, from which a delivery thread invokes the callback. The queue
+  policy applies when the callback falls behind; with Block, the producer waits
+  and frames that become due meanwhile are skipped like with a late poll.
+
+  Subscriptions, which the device API does not offer, are independent consumers of
+  a subset of the cameras and modes of the replay that see every new frame exactly
+  once regardless of what other subscriptions consumed. Every subscription has its own cursor into the replay and its own data objects,
+  so subscriptions can be polled from different threads concurrently. They share
+  nothing but the frame buffer pool, claimed with atomics, and the settings, which
+  a poll only copies after UpdateSettings changed them. With Recorded timing a new
+  subscription starts with the frames that become due after it was created; with
+  AsFastAsPossible it starts at the beginning of the capture.
+
+  Delivery metrics, which the device API does not report, are recorded when a poll
+  returns or a callback is invoked, and read with GetMetrics from any thread without
+  a lock; values of one snapshot may stem from consecutive frames.
+  A frame's capture time is the moment it became due in the replay, or the start
+  of the poll collecting it with AsFastAsPossible timing, so latency measures
+  how late consumers picked frames up. Drops and duplicates are detected per
+  cursor, so the handle and every subscription count the frames they missed.
+
+  A frame lease, which the device API has no equivalent of, keeps the buffer of a
+  frame of unreleased data valid after the data is released, without copying it.
+  Each lease takes a reference on the buffer, so a frame may be leased any number
+  of times and every lease is released on its own. A leased buffer is not recycled,
+  and while every buffer is leased new frames are dropped, so leases should only be
+  held while the frame is in flight. Release every lease before Disconnect.
+
+  Leases may be acquired and released from any thread, including the callback,
+  and the pool status and metrics may be read from any thread. A single subscription is not
+  thread safe, and neither is anything else, like the device API.
+*/
+class WorldCameraReplay {
+public:
+  enum class Timing {
+    // Frames become available when their MLTime, relative to the first frame, has
+    // elapsed since Connect. Frames due since the previous poll beyond the queue depth
+    // are dropped, so latest polls return only the latest frame of each camera/mode.
+    Recorded,
+    // Every poll returns the next group of frames immediately, up to the queue depth of
+    // each camera/mode.
+    AsFastAsPossible,
+  };
+
+  // Occupancy of the data and frame buffer pools. The pools are sized on construction and
+  // never grow, so a persistently full pool means data or leases are held for too long.
+  struct PoolStatus {
+    uint32_t data_capacity = 0;
+    // Data objects delivered and not yet released, and the most since Connect
+    uint32_t data_in_use = 0;
+    uint32_t data_peak = 0;
+    // Frame buffers over all cameras and frame types
+    uint32_t buffer_capacity = 0;
+    // Frame buffers referenced by unreleased data or by leases, those referenced only by
+    // leases, and the most in use since Connect
+    uint32_t buffers_in_use = 0;
+    uint32_t buffers_leased = 0;
+    uint32_t buffers_peak = 0;
+    // Bytes reserved for frame metadata and downscaled pixels
+    uint64_t reserved_bytes = 0;
+    // Polls that failed with MLResult_AllocFailed, and frames dropped for want of a buffer
+    uint64_t exhausted_polls = 0;
+    uint64_t exhausted_frames = 0;
+  };
+
+  // Lease on the buffer of one frame, from AcquireFrameLease
+  struct FrameLease {
+    // Used to release the lease; ML_INVALID_HANDLE once released
+    MLHandle lease_handle = ML_INVALID_HANDLE;
+    MLWorldCameraIdentifier id = MLWorldCameraIdentifier_Left;
+    int64_t frame_number = 0;
+    MLWorldCameraFrameType frame_type = MLWorldCameraFrameType_Unknown;
+    // Read only, and valid until the lease is released
+    MLWorldCameraFrameBuffer frame_buffer = {};
+  };
+
+  // What happens when callbacks fall behind and their delivery queue is full
+  enum class QueuePolicy {
+    // Discard the oldest queued data to make room for the new data
+    DropOldest,
+    // Discard the new data and keep the queued data
+    DropNewest,
+    // Stop producing until the callback has taken queued data; frames due meanwhile are skipped
+    Block,
+  };
+
+  struct Callbacks {
+    // Data queued for delivery, between 1 and kMaxCallbackQueueDepth
+    uint32_t queue_depth = 2;
+    QueuePolicy queue_policy = QueuePolicy::DropOldest;
+    // Invoked on a thread of the replay, never concurrently with itself. The data is only
+    // valid during the call; lease frames to keep their buffers.
+    void (*on_data_available)(const MLWorldCameraData *data, void *user_data) = nullptr;
+  };
+
+  struct SubscriptionSettings {
+    // Modes and cameras delivered to the subscription, of those enabled in the settings
+    uint32_t mode = MLWorldCameraMode_NormalExposure;
+    uint32_t cameras = MLWorldCameraIdentifier_All;
+  };
+
+  // Entry i of every array applies to the camera with identifier (1 << i)
+  struct OutputSettings {
+    // Region of interest, clipped to the frame
+    std::array<WorldCameraRegion, kWorldCameraCount> roi = {};
+    // 1, 2 or 4; every factor x factor block of the region is averaged into one pixel
+    std::array<uint32_t, kWorldCameraCount> downscale = {1, 1, 1};
+    // Frames of each frame type kept for buffered polls, between 1 and kMaxQueueDepth
+    std::array<uint32_t, kWorldCameraCount> queue_depth = {1, 1, 1};
+  };
+
+  // Delivery metrics of one camera and frame type
+  struct StreamMetrics {
+    MLWorldCameraIdentifier id = MLWorldCameraIdentifier_Left;
+    MLWorldCameraFrameType frame_type = MLWorldCameraFrameType_Unknown;
+    uint64_t frames_delivered = 0;
+    // Frame numbers skipped between consecutive deliveries, including roll over
+    uint64_t frames_dropped = 0;
+    // Deliveries repeating the frame number of the previous one
+    uint64_t frames_duplicated = 0;
+    // From the moment the frame was captured until it was delivered
+    WorldCameraHistogram latency;
+    // Between the timestamps of consecutively delivered frames; its spread is the jitter
+    WorldCameraHistogram interval;
+  };
+
+  struct Metrics {
+    // Camera and frame types with deliveries since the metrics were last reset
+    uint32_t stream_count = 0;
+    std::array<StreamMetrics, kWorldCameraStreamCount> streams = {};
+  };
+
+  static constexpr size_t kMaxQueueDepth = 8;
+  static constexpr size_t kDataCapacity = 8;
+  // One data object is being produced and one is in the callback while the queue is full
+  static constexpr size_t kMaxCallbackQueueDepth = kDataCapacity - 2;
+  static constexpr size_t kMaxSubscriptions = 16;
+  // Data objects of each subscription
+  static constexpr size_t kSubscriptionDataCapacity = 2;
+  static constexpr size_t kBufferCapacity = 4 * kWorldCameraStreamCount * kMaxQueueDepth;
+  static constexpr size_t kMaxLeases = 64;
+  static constexpr MLTime kLatencyBinWidth = 1'000'000;
+  static constexpr MLTime kIntervalBinWidth = 2'000'000;
+
+  WorldCameraReplay() = default;
+  WorldCameraReplay(const WorldCameraReplay &) = delete;
+  WorldCameraReplay &operator=(const WorldCameraReplay &) = delete;
+  ~WorldCameraReplay();
+
+  MLResult Connect(const char *capture_path, const MLWorldCameraSettings *settings,
+                   Timing timing = Timing::Recorded, bool loop = false);
+  MLResult UpdateSettings(const MLWorldCameraSettings *settings);
+  // Applies from the next poll; Connect restores the defaults.
+  MLResult SetOutputSettings(const OutputSettings *settings);
+  MLResult SetSchedule(const WorldCameraSchedule *schedule);
+  MLResult GetLatestWorldCameraData(uint64_t timeout_ms, MLWorldCameraData **out_data);
+  // Data comes from the same pool as latest polls and is released with ReleaseCameraData.
+  MLResult GetBufferedWorldCameraData(uint64_t timeout_ms, MLWorldCameraData **out_data);
+  MLResult ReleaseCameraData(MLWorldCameraData *world_camera_data);
+  MLResult GetPoseAtTime(MLWorldCameraIdentifier camera, MLTime time, MLTransform *out_pose) const;
+  // Passing nullptr unregisters the callbacks, waiting for an ongoing callback to return.
+  MLResult SetCallbacks(const Callbacks *cb, void *user_data);
+  // Subscriptions are polled and released like the replay itself, and must be destroyed before Disconnect.
+  MLResult CreateSubscription(const SubscriptionSettings *settings, MLHandle *out_subscription);
+  MLResult GetSubscriptionData(MLHandle subscription, uint64_t timeout_ms, MLWorldCameraData **out_data);
+  MLResult ReleaseSubscriptionData(MLHandle subscription, MLWorldCameraData *world_camera_data);
+  MLResult DestroySubscription(MLHandle subscription);
+  // Fails with MLResult_InvalidParam unless frame belongs to data of this replay that has not
+  // been released, and with MLResult_UnspecifiedFailure while kMaxLeases leases are held.
+  MLResult AcquireFrameLease(const MLWorldCameraFrame *frame, FrameLease *out_lease);
+  // Releases the reference of lease and clears its handle and frame buffer data.
+  MLResult ReleaseFrameLease(FrameLease *lease);
+  // Values are read without blocking delivery and may be one frame apart from each other.
+  MLResult GetPoolStatus(PoolStatus *out_status) const;
+  MLResult GetMetrics(Metrics *out_metrics) const;
+  // Clears the metrics. Drop detection restarts with the next delivery of each stream.
+  MLResult ResetMetrics();
+  MLResult Disconnect();
+
+  bool IsConnected() const { return connected_; }
+
+private:
+  static constexpr size_t kMaxDeliveredFrames = kWorldCameraStreamCount * kMaxQueueDepth;
+
+  struct DataSlot {
+    std::atomic<bool> in_use{false};
+    MLWorldCameraData data = {};
+    std::array<MLWorldCameraFrame, kMaxDeliveredFrames> frames = {};
+    // Index into buffers_ of every frame
+    std::array<size_t, kMaxDeliveredFrames> buffers = {};
+    // Position in the replay of every frame and when it became due, for the metrics
+    std::array<uint64_t, kMaxDeliveredFrames> positions = {};
+    std::array<std::chrono::steady_clock::time_point, kMaxDeliveredFrames> due = {};
+    size_t count = 0;
+  };
+
+  struct FrameBuffer {
+    // One reference for the data delivering the frame plus one per lease; free at 0
+    std::atomic<uint32_t> refs{0};
+    std::atomic<uint32_t> leases{0};
+    // Only used by downscaled frames; full resolution frames point into the capture
+    std::vector<uint8_t> pixels;
+  };
+
+  // Position of one consumer in the replay, owned by the thread polling with it.
+  struct Cursor {
+    // Frames consumed, counting every frame of each earlier loop through the capture
+    uint64_t position = 0;
+    // Cameras and modes selected in addition to the settings
+    uint32_t cameras = MLWorldCameraIdentifier_All;
+    uint32_t mode = MLWorldCameraMode_LowExposure | MLWorldCameraMode_NormalExposure;
+    // Copy of settings_ and output_settings_ as of settings_generation
+    MLWorldCameraSettings settings = {};
+    OutputSettings output;
+    uint64_t settings_generation = 0;
+    // Where to start looking for a free buffer, so consumers do not contend on the same ones
+    size_t next_buffer = 0;
+    // Frames delivered with this cursor as of metrics_generation, for drops and intervals
+    WorldCameraSequenceTracker sequence;
+    std::array<uint64_t, kWorldCameraStreamCount> last_position = {};
+    uint64_t metrics_generation = 0;
+  };
+
+  struct StreamCounters {
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> duplicated{0};
+    WorldCameraAtomicHistogram latency{kLatencyBinWidth};
+    WorldCameraAtomicHistogram interval{kIntervalBinWidth};
+  };
+
+  struct Subscription {
+    std::atomic<bool> in_use{false};
+    Cursor cursor;
+    std::array<DataSlot, kSubscriptionDataCapacity> data_slots;
+  };
+
+  bool LoadCapture(const char *capture_path);
+  MLResult Poll(Cursor &cursor, DataSlot *slots, size_t slot_count, uint64_t timeout_ms, bool buffered,
+                DataSlot **out_slot);
+  DataSlot *ClaimDataSlot(DataSlot *slots, size_t slot_count);
+  void ReleaseDataSlot(DataSlot &slot);
+  // Index of the slot holding data, or kDataCapacity
+  size_t SlotIndex(const MLWorldCameraData *data) const;
+  Subscription *FindSubscription(MLHandle subscription);
+  size_t ClaimBuffer(size_t &next_buffer);
+  void ReleaseBuffer(size_t buffer);
+  void RefreshSettings(Cursor &cursor);
+  // Marks the frames delivered under schedule for the modes enabled in modes. Returns
+  // false, keeping the current schedule, if the schedule is invalid.
+  bool ApplySchedule(const WorldCameraSchedule &schedule, uint32_t modes);
+  bool IsRequested(const Cursor &cursor, uint64_t position) const;
+  size_t QueueDepth(const Cursor &cursor, const MLWorldCameraFrame &frame, bool buffered) const;
+  // Number of frames due at time, counting every frame of each earlier loop
+  uint64_t DueCount(std::chrono::steady_clock::time_point time) const;
+  std::chrono::steady_clock::time_point DueTime(uint64_t position) const;
+  bool IsExhausted(const Cursor &cursor) const;
+  const MLWorldCameraFrame &FrameAt(uint64_t position) const { return frames_[position % frames_.size()]; }
+  size_t CollectAsFastAsPossible(Cursor &cursor, bool buffered, DataSlot &slot);
+  size_t CollectRecorded(Cursor &cursor, bool buffered, DataSlot &slot);
+  size_t ApplyOutputSettings(Cursor &cursor, DataSlot &slot);
+  // Adds the frames of slot, delivered now with cursor, to the metrics
+  void RecordDelivery(Cursor &cursor, const DataSlot &slot);
+  void ResetPools();
+  void StopCallbacks();
+  void ProducerLoop();
+  void DeliveryLoop();
+  void WaitForWake();
+
+  WorldCameraCaptureReader capture_;
+  std::vector<MLWorldCameraFrame> frames_;
+  // Positions in frames_ of the frames of each camera, in time order
+  std::array<std::vector<size_t>, kWorldCameraCount> camera_frames_;
+  // Furthest position collected by any cursor, where the pose history ends with AsFastAsPossible timing
+  std::atomic<uint64_t> collected_{0};
+  std::array<DataSlot, kDataCapacity> data_slots_;
+  std::array<Subscription, kMaxSubscriptions> subscriptions_;
+  std::array<FrameBuffer, kBufferCapacity> buffers_;
+  // Index into buffers_ plus one of the buffer held by each lease, 0 if the lease is free
+  std::array<std::atomic<size_t>, kMaxLeases> leases_ = {};
+  // Written only by UpdateSettings; cursors copy it when settings_generation_ changed
+  std::shared_mutex settings_mutex_;
+  MLWorldCameraSettings settings_ = {};
+  OutputSettings output_settings_;
+  std::atomic<uint64_t> settings_generation_{0};
+  WorldCameraSchedule schedule_;
+  bool has_schedule_ = false;
+  // Whether the schedule delivers each frame of frames_; polls read it without the lock
+  std::vector<std::atomic<bool>> scheduled_;
+  Timing timing_ = Timing::Recorded;
+  std::chrono::steady_clock::time_point start_time_;
+  // Duration of one loop through the capture
+  MLTime loop_duration_ = 0;
+  Cursor cursor_;
+  bool loop_ = false;
+  bool connected_ = false;
+
+  Callbacks callbacks_;
+  void *callbacks_user_data_ = nullptr;
+  bool callbacks_registered_ = false;
+  std::atomic<bool> stopping_{false};
+  WorldCameraDeliveryQueue<kMaxCallbackQueueDepth> delivery_queue_;
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::thread producer_;
+  std::thread delivery_;
+
+  std::atomic<uint32_t> data_in_use_{0};
+  std::atomic<uint32_t> data_peak_{0};
+  std::atomic<uint32_t> buffers_in_use_{0};
+  std::atomic<uint32_t> buffers_peak_{0};
+  std::atomic<uint64_t> pixel_bytes_{0};
+  std::atomic<uint64_t> exhausted_polls_{0};
+  std::atomic<uint64_t> exhausted_frames_{0};
+
+  std::array<StreamCounters, kWorldCameraStreamCount> metrics_;
+  // Incremented by ResetMetrics, so cursors restart drop detection
+  std::atomic<uint64_t> metrics_generation_{0};
+};
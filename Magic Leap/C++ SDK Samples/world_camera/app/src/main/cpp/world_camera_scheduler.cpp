@@ -0,0 +1,179 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+  // Credits are sums of fractions, so comparisons allow for rounding
+  constexpr double kCreditEpsilon = 1e-9;
+
+  constexpr MLTime kNanosecondsPerSecond = 1000000000;
+
+  constexpr MLWorldCameraIdentifier kCameras[kWorldCameraCount] = {
+          MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right, MLWorldCameraIdentifier_Center};
+
+  size_t ModeIndex(MLWorldCameraFrameType frame_type) {
+    switch (frame_type) {
+      case MLWorldCameraFrameType_LowExposure: return 0;
+      case MLWorldCameraFrameType_NormalExposure: return 1;
+      default: return WorldCameraExposureScheduler::kModeCount;
+    }
+  }
+
+  MLWorldCameraFrameType FrameTypeForModeIndex(size_t mode) {
+    return mode == 0 ? MLWorldCameraFrameType_LowExposure : MLWorldCameraFrameType_NormalExposure;
+  }
+}
+
+WorldCameraExposureScheduler::WorldCameraExposureScheduler(double slot_rate) : slot_rate_(slot_rate) {
+  SetSchedule(WorldCameraSchedule(), MLWorldCameraMode_LowExposure | MLWorldCameraMode_NormalExposure);
+}
+
+bool WorldCameraExposureScheduler::SetSchedule(const WorldCameraSchedule &schedule, uint32_t modes) {
+  size_t priority = kModeCount;
+  switch (schedule.priority_mode) {
+    case MLWorldCameraMode_Unknown: break;
+    case MLWorldCameraMode_LowExposure: priority = 0; break;
+    case MLWorldCameraMode_NormalExposure: priority = 1; break;
+    default: return false;
+  }
+  for (const auto &camera_rates : schedule.target_rate) {
+    for (float rate : camera_rates) {
+      if (!(rate >= 0.0f)) {
+        return false;
+      }
+    }
+  }
+
+  for (size_t camera = 0; camera < kWorldCameraCount; ++camera) {
+    ModeValues &shares = shares_[camera];
+    double claimed = 0.0;
+    size_t unclaimed_modes = 0;
+    for (size_t mode = 0; mode < kModeCount; ++mode) {
+      shares[mode] = (modes & (1u << mode)) ? schedule.target_rate[camera][mode] : 0.0;
+      claimed += shares[mode];
+      if ((modes & (1u << mode)) && shares[mode] == 0.0) {
+        ++unclaimed_modes;
+      }
+    }
+    const double scale = claimed > slot_rate_ ? slot_rate_ / claimed : 1.0;
+    const double leftover = slot_rate_ - claimed * scale;
+    double total = 0.0;
+    for (size_t mode = 0; mode < kModeCount; ++mode) {
+      if (shares[mode] > 0.0) {
+        shares[mode] *= scale / slot_rate_;
+      } else if (modes & (1u << mode)) {
+        shares[mode] = leftover / unclaimed_modes / slot_rate_;
+      }
+      total += shares[mode];
+    }
+    shares[kModeCount] = std::max(0.0, 1.0 - total);
+    credits_[camera] = {};
+  }
+  priority_ = priority;
+  return true;
+}
+
+MLWorldCameraFrameType WorldCameraExposureScheduler::NextSlot(MLWorldCameraIdentifier camera) {
+  const size_t camera_index = WorldCameraIndex(camera);
+  if (camera_index == kWorldCameraCount) {
+    return MLWorldCameraFrameType_Unknown;
+  }
+  const ModeValues &shares = shares_[camera_index];
+  ModeValues &credits = credits_[camera_index];
+  for (size_t mode = 0; mode <= kModeCount; ++mode) {
+    credits[mode] += shares[mode];
+  }
+
+  // Ties go to the priority mode, then to the lower mode, and idle slots come last
+  std::array<size_t, kModeCount + 1> order;
+  size_t count = 0;
+  if (priority_ < kModeCount) {
+    order[count++] = priority_;
+  }
+  for (size_t mode = 0; mode < kModeCount; ++mode) {
+    if (mode != priority_) {
+      order[count++] = mode;
+    }
+  }
+  order[count++] = kModeCount;
+
+  size_t best = kModeCount + 1;
+  for (size_t i = 0; i < count; ++i) {
+    const size_t mode = order[i];
+    if (shares[mode] > 0.0 && (best > kModeCount || credits[mode] > credits[best] + kCreditEpsilon)) {
+      best = mode;
+    }
+  }
+  if (best > kModeCount) {
+    return MLWorldCameraFrameType_Unknown;
+  }
+  credits[best] -= 1.0;
+  return best == kModeCount ? MLWorldCameraFrameType_Unknown : FrameTypeForModeIndex(best);
+}
+
+double WorldCameraExposureScheduler::Rate(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const {
+  const size_t camera_index = WorldCameraIndex(camera);
+  const size_t mode = ModeIndex(frame_type);
+  if (camera_index == kWorldCameraCount || mode == kModeCount) {
+    return 0.0;
+  }
+  return shares_[camera_index][mode] * slot_rate_;
+}
+
+WorldCameraScheduleReport SimulateWorldCameraSchedule(const WorldCameraSchedule &schedule, uint32_t modes,
+                                                      const WorldCameraSensorModel &sensor, MLTime duration) {
+  constexpr size_t kModeCount = WorldCameraExposureScheduler::kModeCount;
+  WorldCameraScheduleReport report = {};
+  WorldCameraExposureScheduler scheduler(sensor.slot_rate);
+  if (!scheduler.SetSchedule(schedule, modes) || sensor.slot_rate <= 0.0 || duration <= 0) {
+    return report;
+  }
+
+  const double seconds = static_cast<double>(duration) / kNanosecondsPerSecond;
+  const uint64_t slot_count = static_cast<uint64_t>(seconds * sensor.slot_rate);
+  for (size_t camera_index = 0; camera_index < kWorldCameraCount; ++camera_index) {
+    const MLWorldCameraIdentifier camera = kCameras[camera_index];
+    MLTime total_latency[kModeCount] = {};
+    for (uint64_t slot = 0; slot < slot_count; ++slot) {
+      const MLWorldCameraFrameType frame_type = scheduler.NextSlot(camera);
+      const size_t mode = ModeIndex(frame_type);
+      if (mode == kModeCount) {
+        continue;
+      }
+      WorldCameraScheduleReport::Mode &result = report.modes[camera_index][mode];
+      // Frame k of a mode is due at k / rate; slots that come early do not wait. Leftover
+      // shares request no rate of their own, so they are due by the rate they were given
+      const double requested = schedule.target_rate[camera_index][mode];
+      const double due_rate = requested > 0.0 ? requested : scheduler.Rate(camera, frame_type);
+      const MLTime slot_start = static_cast<MLTime>(std::llround(slot * kNanosecondsPerSecond / sensor.slot_rate));
+      const MLTime due = static_cast<MLTime>(std::llround(result.frames * kNanosecondsPerSecond / due_rate));
+      const MLTime latency = std::max<MLTime>(0, slot_start - due) + sensor.exposure[mode] + sensor.readout;
+      total_latency[mode] += latency;
+      result.max_latency = std::max(result.max_latency, latency);
+      ++result.frames;
+    }
+    for (size_t mode = 0; mode < kModeCount; ++mode) {
+      WorldCameraScheduleReport::Mode &result = report.modes[camera_index][mode];
+      result.target_rate = schedule.target_rate[camera_index][mode];
+      result.resolved_rate = scheduler.Rate(camera, FrameTypeForModeIndex(mode));
+      result.achieved_rate = result.frames / seconds;
+      result.mean_latency = result.frames > 0 ? total_latency[mode] / static_cast<MLTime>(result.frames) : 0;
+    }
+  }
+  return report;
+}
@@ -0,0 +1,127 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_stream.h"
+
+// Number of exposure modes a schedule shares the slots of a camera between: low and
+// normal exposure.
+constexpr size_t kWorldCameraScheduleModeCount = 2;
+
+/*!
+  \brief Target frame rates of the exposure modes of each camera.
+
+  Each camera captures one frame per sensor slot and picks the exposure mode of every
+  slot. The schedule sets how the slots of a camera are shared between the enabled
+  modes. The device API has no schedule: this sample type drives
+  WorldCameraReplay::SetSchedule and SimulateWorldCameraSchedule. A default schedule
+  shares the slots of every camera equally between the enabled modes.
+*/
+struct WorldCameraSchedule {
+  // Target frame rate in Hz of each camera, indexed as by WorldCameraIndex, and mode,
+  // 0 for low and 1 for normal exposure. A rate of 0 requests an equal share of the
+  // slots not claimed by the other modes of the camera. If the rates of a camera add
+  // up to more than its slot rate, they are scaled down proportionally.
+  std::array<std::array<float, kWorldCameraScheduleModeCount>, kWorldCameraCount> target_rate = {};
+  // When frames of both modes of a camera are equally overdue, the slot goes to this
+  // mode. MLWorldCameraMode_Unknown favours neither mode.
+  MLWorldCameraMode priority_mode = MLWorldCameraMode_Unknown;
+};
+
+/*!
+  \brief Assigns the sensor slots of each world camera to exposure modes.
+
+  This is the slot assignment policy of WorldCameraSchedule. Target rates are
+  first resolved per camera: modes that are not enabled get no slots, rates of 0
+  share the slots left by the other modes, and rates exceeding the slot rate are
+  scaled down. Slots are then handed out by smooth weighted round robin with an
+  idle pseudo mode for the unclaimed slots: every slot each mode earns its rate
+  divided by the slot rate in credit, and the mode with the most credit takes the
+  slot and pays one slot. Each mode so receives its rate with frames spread evenly,
+  and ties go to the priority mode.
+*/
+class WorldCameraExposureScheduler {
+public:
+  static constexpr size_t kModeCount = kWorldCameraScheduleModeCount;
+
+  // slot_rate is the number of frames per second each camera can capture.
+  explicit WorldCameraExposureScheduler(double slot_rate);
+
+  // Resolves the target rates of schedule for the modes enabled in modes, a combination
+  // of MLWorldCameraMode values. Returns false, keeping the current schedule, if the
+  // schedule is invalid.
+  bool SetSchedule(const WorldCameraSchedule &schedule, uint32_t modes);
+
+  // Frame type to capture in the next slot of camera, or MLWorldCameraFrameType_Unknown if
+  // the slot stays idle.
+  MLWorldCameraFrameType NextSlot(MLWorldCameraIdentifier camera);
+
+  // Resolved rate in Hz of a camera and frame type.
+  double Rate(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const;
+  double SlotRate() const { return slot_rate_; }
+
+private:
+  // Index kModeCount is the idle pseudo mode.
+  using ModeValues = std::array<double, kModeCount + 1>;
+
+  double slot_rate_;
+  size_t priority_ = kModeCount;
+  std::array<ModeValues, kWorldCameraCount> shares_ = {};
+  std::array<ModeValues, kWorldCameraCount> credits_ = {};
+};
+
+// Sensor timing of one camera, used by SimulateWorldCameraSchedule.
+struct WorldCameraSensorModel {
+  double slot_rate = 60.0;
+  // Exposure time of each mode, indexed like WorldCameraSchedule::target_rate, in nanoseconds.
+  MLTime exposure[WorldCameraExposureScheduler::kModeCount] = {1000000, 8000000};
+  // Time from the end of an exposure until the frame is delivered, in nanoseconds.
+  MLTime readout = 6000000;
+};
+
+struct WorldCameraScheduleReport {
+  struct Mode {
+    // Rate requested by the schedule, 0 for a share of the leftover slots
+    double target_rate;
+    // Rate the scheduler assigned after sharing the leftover slots and scaling down
+    // oversubscribed cameras
+    double resolved_rate;
+    double achieved_rate;
+    uint64_t frames;
+    // Time from when a frame was due by the target rate, or by the resolved rate for
+    // leftover shares, until it was delivered: the wait for a slot plus exposure and
+    // readout, in nanoseconds. Grows over the run when the target cannot be met.
+    MLTime mean_latency;
+    MLTime max_latency;
+  };
+
+  Mode modes[kWorldCameraCount][WorldCameraExposureScheduler::kModeCount];
+};
+
+/*!
+  \brief Runs schedule against a sensor model for duration nanoseconds.
+
+  Every camera captures in slots of 1 / sensor.slot_rate seconds, with the mode of
+  each slot picked by WorldCameraExposureScheduler for the modes enabled in modes.
+  Reports the requested, resolved and achieved rates and the latency of every
+  camera and mode, so schedules can be evaluated on a host.
+*/
+WorldCameraScheduleReport SimulateWorldCameraSchedule(const WorldCameraSchedule &schedule, uint32_t modes,
+                                                      const WorldCameraSensorModel &sensor, MLTime duration);
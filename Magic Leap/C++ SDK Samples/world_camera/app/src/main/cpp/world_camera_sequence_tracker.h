@@ -0,0 +1,141 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_stream.h"
+
+// Range of consecutive missing frame numbers, inclusive. last is smaller than first
+// if the range spans the frame number roll over from INT64_MAX to 0.
+struct WorldCameraFrameGap {
+  int64_t first;
+  int64_t last;
+};
+
+/*!
+  \brief Detects dropped and repeated world camera frames from their frame numbers.
+
+  State is kept per camera and frame type in a plain array, so Update is a few
+  comparisons without any lookup or allocation. Frame numbers count up from 0 and
+  roll over from INT64_MAX back to 0. A stream that has been reset, e.g. after a
+  pause or a settings change, accepts its next frame number without counting a
+  gap. The most recent gaps of every stream are kept for reporting. Not thread safe.
+*/
+class WorldCameraSequenceTracker {
+public:
+  static constexpr size_t kGapHistory = 8;
+
+  enum class Result {
+    // First frame after construction or a reset
+    First,
+    // Directly follows the previous frame
+    InOrder,
+    // Follows a gap of missing frames
+    Gap,
+    // Repeats the previous frame number
+    Duplicate,
+    // Negative frame number, ignored
+    Invalid,
+  };
+
+  struct StreamState {
+    // -1 until a frame has been seen since the last reset
+    int64_t last_frame_number = -1;
+    uint64_t frames = 0;
+    uint64_t dropped = 0;
+    uint64_t duplicates = 0;
+    uint64_t invalid = 0;
+    // Total number of gaps; the latest min(gap_count, kGapHistory) are in gaps
+    uint64_t gap_count = 0;
+    std::array<WorldCameraFrameGap, kGapHistory> gaps = {};
+  };
+
+  // Records frame_number of a camera and frame type. If the result is Gap and gap is not
+  // NULL, the missing frame numbers are stored in it.
+  Result Update(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type, int64_t frame_number,
+                WorldCameraFrameGap *gap = nullptr) {
+    const size_t index = WorldCameraStreamIndex(camera, frame_type);
+    if (index == kWorldCameraStreamCount) {
+      return Result::Invalid;
+    }
+    StreamState &stream = streams_[index];
+    if (frame_number < 0) {
+      ++stream.invalid;
+      return Result::Invalid;
+    }
+    const int64_t last = stream.last_frame_number;
+    if (last < 0) {
+      stream.last_frame_number = frame_number;
+      ++stream.frames;
+      return Result::First;
+    }
+    if (frame_number == last) {
+      ++stream.duplicates;
+      return Result::Duplicate;
+    }
+
+    // A smaller frame number means the counter rolled over to 0
+    const uint64_t distance = frame_number > last
+                              ? static_cast<uint64_t>(frame_number - last)
+                              : static_cast<uint64_t>(INT64_MAX - last) + static_cast<uint64_t>(frame_number) + 1;
+    stream.last_frame_number = frame_number;
+    ++stream.frames;
+    if (distance == 1) {
+      return Result::InOrder;
+    }
+    const WorldCameraFrameGap missing = {last == INT64_MAX ? 0 : last + 1,
+                                         frame_number == 0 ? INT64_MAX : frame_number - 1};
+    stream.dropped += distance - 1;
+    stream.gaps[stream.gap_count % kGapHistory] = missing;
+    ++stream.gap_count;
+    if (gap) {
+      *gap = missing;
+    }
+    return Result::Gap;
+  }
+
+  // Forgets the last frame number of a stream, so its next frame is not checked for a gap.
+  void Reset(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) {
+    const size_t index = WorldCameraStreamIndex(camera, frame_type);
+    if (index < kWorldCameraStreamCount) {
+      streams_[index].last_frame_number = -1;
+    }
+  }
+
+  void ResetAll() {
+    for (auto &stream : streams_) {
+      stream.last_frame_number = -1;
+    }
+  }
+
+  const StreamState &Stream(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const {
+    static const StreamState kEmpty;
+    const size_t index = WorldCameraStreamIndex(camera, frame_type);
+    return index < kWorldCameraStreamCount ? streams_[index] : kEmpty;
+  }
+
+  // Latest gap of a stream, or NULL if it has none.
+  const WorldCameraFrameGap *LastGap(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) const {
+    const StreamState &stream = Stream(camera, frame_type);
+    return stream.gap_count ? &stream.gaps[(stream.gap_count - 1) % kGapHistory] : nullptr;
+  }
+
+private:
+  std::array<StreamState, kWorldCameraStreamCount> streams_;
+};
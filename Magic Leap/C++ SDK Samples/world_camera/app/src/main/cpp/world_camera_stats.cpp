@@ -0,0 +1,193 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_stats.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORLD_CAMERA_STATS_AVX2 1
+#endif
+
+namespace {
+
+  struct Moments {
+    uint64_t sum = 0;
+    uint64_t squares = 0;
+    int64_t laplacian_sum = 0;
+    uint64_t laplacian_squares = 0;
+  };
+
+  // Four interleaved tables, so runs of equal pixels do not serialize on a single counter
+  using HistogramTables = uint32_t[4][WorldCameraFrameStats::kBinCount];
+
+  void CountRow(const uint8_t *row, uint32_t width, HistogramTables &tables) {
+    uint32_t x = 0;
+    for (; x + 4 <= width; x += 4) {
+      ++tables[0][row[x]];
+      ++tables[1][row[x + 1]];
+      ++tables[2][row[x + 2]];
+      ++tables[3][row[x + 3]];
+    }
+    for (; x < width; ++x) {
+      ++tables[0][row[x]];
+    }
+  }
+
+  void SumRowScalar(const uint8_t *row, uint32_t first, uint32_t width, Moments *moments) {
+    for (uint32_t x = first; x < width; ++x) {
+      moments->sum += row[x];
+      moments->squares += row[x] * row[x];
+    }
+  }
+
+  // Laplacian moments of columns [first, last)
+  void LaplacianRowScalar(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint32_t first, uint32_t last,
+                          Moments *moments) {
+    for (uint32_t x = first; x < last; ++x) {
+      const int32_t laplacian = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+      moments->laplacian_sum += laplacian;
+      moments->laplacian_squares += laplacian * laplacian;
+    }
+  }
+
+#if WORLD_CAMERA_STATS_AVX2
+  // 32-bit lane accumulators are flushed to 64 bits before this many iterations can overflow them
+  constexpr uint32_t kFlushInterval = 512;
+
+  __attribute__((target("avx2")))
+  int64_t SumLanes32(__m256i lanes) {
+    const __m256i low = _mm256_cvtepi32_epi64(_mm256_castsi256_si128(lanes));
+    const __m256i high = _mm256_cvtepi32_epi64(_mm256_extracti128_si256(lanes, 1));
+    const __m256i sum = _mm256_add_epi64(low, high);
+    return _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) + _mm256_extract_epi64(sum, 2) +
+           _mm256_extract_epi64(sum, 3);
+  }
+
+  __attribute__((target("avx2")))
+  uint32_t SumRowAvx2(const uint8_t *row, uint32_t width, Moments *moments) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i sum = zero;
+    uint32_t x = 0;
+    while (x + 32 <= width) {
+      __m256i squares = zero;
+      for (uint32_t i = 0; i < kFlushInterval && x + 32 <= width; ++i, x += 32) {
+        const __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + x));
+        sum = _mm256_add_epi64(sum, _mm256_sad_epu8(pixels, zero));
+        const __m256i low = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(pixels));
+        const __m256i high = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(pixels, 1));
+        squares = _mm256_add_epi32(squares, _mm256_add_epi32(_mm256_madd_epi16(low, low),
+                                                             _mm256_madd_epi16(high, high)));
+      }
+      moments->squares += SumLanes32(squares);
+    }
+    moments->sum += _mm256_extract_epi64(sum, 0) + _mm256_extract_epi64(sum, 1) + _mm256_extract_epi64(sum, 2) +
+                    _mm256_extract_epi64(sum, 3);
+    return x;
+  }
+
+  // Returns the first column not processed, starting from column 1
+  __attribute__((target("avx2")))
+  uint32_t LaplacianRowAvx2(const uint8_t *up, const uint8_t *row, const uint8_t *down, uint32_t last,
+                            Moments *moments) {
+    const __m256i ones = _mm256_set1_epi16(1);
+    uint32_t x = 1;
+    while (x + 16 <= last) {
+      __m256i sum = _mm256_setzero_si256();
+      __m256i squares = _mm256_setzero_si256();
+      for (uint32_t i = 0; i < kFlushInterval && x + 16 <= last; ++i, x += 16) {
+        const __m256i center = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x)));
+        const __m256i left = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x - 1)));
+        const __m256i right = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x + 1)));
+        const __m256i above = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(up + x)));
+        const __m256i below = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(down + x)));
+        const __m256i neighbours = _mm256_add_epi16(_mm256_add_epi16(left, right), _mm256_add_epi16(above, below));
+        const __m256i laplacian = _mm256_sub_epi16(_mm256_slli_epi16(center, 2), neighbours);
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(laplacian, ones));
+        squares = _mm256_add_epi32(squares, _mm256_madd_epi16(laplacian, laplacian));
+      }
+      moments->laplacian_sum += SumLanes32(sum);
+      moments->laplacian_squares += SumLanes32(squares);
+    }
+    return x;
+  }
+
+  bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+  }
+#endif
+}
+
+bool ComputeWorldCameraFrameStats(const MLWorldCameraFrameBuffer &buffer, uint32_t row_step,
+                                  WorldCameraFrameStats *out_stats) {
+  const uint32_t width = buffer.width;
+  const uint32_t height = buffer.height;
+  if (buffer.bytes_per_pixel != 1 || !buffer.data || width == 0 || height == 0 || !out_stats) {
+    return false;
+  }
+  row_step = std::max(row_step, 1u);
+#if WORLD_CAMERA_STATS_AVX2
+  const bool use_avx2 = HasAvx2();
+#endif
+
+  HistogramTables tables = {};
+  Moments moments;
+  uint64_t pixel_count = 0;
+  uint64_t laplacian_count = 0;
+  for (uint32_t y = 0; y < height; y += row_step) {
+    const uint8_t *row = buffer.data + static_cast<size_t>(y) * buffer.stride;
+    CountRow(row, width, tables);
+    uint32_t x = 0;
+#if WORLD_CAMERA_STATS_AVX2
+    if (use_avx2) {
+      x = SumRowAvx2(row, width, &moments);
+    }
+#endif
+    SumRowScalar(row, x, width, &moments);
+    pixel_count += width;
+
+    // Only pixels with all four neighbours have a Laplacian
+    if (y == 0 || y + 1 >= height || width < 3) {
+      continue;
+    }
+    const uint8_t *up = row - buffer.stride;
+    const uint8_t *down = row + buffer.stride;
+    x = 1;
+#if WORLD_CAMERA_STATS_AVX2
+    if (use_avx2) {
+      x = LaplacianRowAvx2(up, row, down, width - 1, &moments);
+    }
+#endif
+    LaplacianRowScalar(up, row, down, x, width - 1, &moments);
+    laplacian_count += width - 2;
+  }
+
+  for (uint32_t bin = 0; bin < WorldCameraFrameStats::kBinCount; ++bin) {
+    out_stats->histogram[bin] = tables[0][bin] + tables[1][bin] + tables[2][bin] + tables[3][bin];
+  }
+  out_stats->pixel_count = pixel_count;
+  out_stats->mean = static_cast<double>(moments.sum) / pixel_count;
+  out_stats->variance = std::max(0.0, static_cast<double>(moments.squares) / pixel_count -
+                                      out_stats->mean * out_stats->mean);
+  out_stats->sharpness_count = laplacian_count;
+  if (laplacian_count > 0) {
+    const double laplacian_mean = static_cast<double>(moments.laplacian_sum) / laplacian_count;
+    out_stats->sharpness = std::max(0.0, static_cast<double>(moments.laplacian_squares) / laplacian_count -
+                                         laplacian_mean * laplacian_mean);
+  } else {
+    out_stats->sharpness = 0.0;
+  }
+  return true;
+}
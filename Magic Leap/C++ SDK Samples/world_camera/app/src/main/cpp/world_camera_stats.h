@@ -0,0 +1,48 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstdint>
+
+#include <ml_world_camera.h>
+
+// Image quality statistics of an 8-bit world camera frame.
+struct WorldCameraFrameStats {
+  static constexpr uint32_t kBinCount = 256;
+
+  // Number of sampled pixels of each value.
+  uint32_t histogram[kBinCount];
+  uint64_t pixel_count;
+  double mean;
+  double variance;
+  // Variance of the Laplacian 4 c - l - r - u - d over sampled pixels with all four
+  // neighbours. Blur suppresses high frequencies, so lower values mean a blurrier image.
+  double sharpness;
+  uint64_t sharpness_count;
+};
+
+/*!
+  \brief Computes the statistics of an 8-bit frame buffer in a single pass.
+
+  Every row_step-th row is sampled, starting with the first, and every pixel of a
+  sampled row contributes; the Laplacian uses the true neighbouring rows, so row
+  subsampling trades accuracy of the estimates for speed without changing what
+  they measure. Each sampled row is read once while it is in cache: sums, sums of
+  squares and the Laplacian moments use AVX2 when the CPU supports it, and the
+  histogram is counted alongside. Sums are accumulated exactly in integers, so both
+  paths give the same results. Returns false for buffers that are not 8-bit or have
+  no pixels.
+*/
+bool ComputeWorldCameraFrameStats(const MLWorldCameraFrameBuffer &buffer, uint32_t row_step,
+                                  WorldCameraFrameStats *out_stats);
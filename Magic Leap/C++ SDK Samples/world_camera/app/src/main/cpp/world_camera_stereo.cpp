@@ -0,0 +1,224 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_stereo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+  // Row major 3x3 helpers
+  void Multiply(const double a[9], const double b[9], double out[9]) {
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) {
+        out[r * 3 + c] = a[r * 3] * b[c] + a[r * 3 + 1] * b[3 + c] + a[r * 3 + 2] * b[6 + c];
+      }
+    }
+  }
+
+  void Transpose(const double a[9], double out[9]) {
+    for (int r = 0; r < 3; ++r) {
+      for (int c = 0; c < 3; ++c) {
+        out[c * 3 + r] = a[r * 3 + c];
+      }
+    }
+  }
+
+  void Normalize(double v[3]) {
+    const double length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0) {
+      v[0] /= length;
+      v[1] /= length;
+      v[2] /= length;
+    }
+  }
+
+  // Camera to world rotation in the image convention (x right, y down, z forward).
+  void CameraToWorld(const MLTransform &pose, double out[9]) {
+    const double x = pose.rotation.x, y = pose.rotation.y, z = pose.rotation.z, w = pose.rotation.w;
+    const double rotation[9] = {
+            1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w),
+            2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w),
+            2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y),
+    };
+    // Flip y and z to go from the graphics convention of camera_pose to the image convention
+    const double flip[9] = {1, 0, 0, 0, -1, 0, 0, 0, -1};
+    Multiply(rotation, flip, out);
+  }
+
+  bool SameIntrinsics(const MLWorldCameraIntrinsics &a, const MLWorldCameraIntrinsics &b) {
+    return memcmp(&a, &b, sizeof(a)) == 0;
+  }
+}
+
+bool WorldCameraStereoRectifier::Submit(const MLWorldCameraFrame &frame) {
+  if (frame.frame_type != settings_.frame_type || frame.frame_buffer.bytes_per_pixel != 1 ||
+      !frame.frame_buffer.data) {
+    return false;
+  }
+  PendingFrame *own;
+  PendingFrame *other;
+  if (frame.id == MLWorldCameraIdentifier_Left) {
+    own = &pending_left_;
+    other = &pending_right_;
+  } else if (frame.id == MLWorldCameraIdentifier_Right) {
+    own = &pending_right_;
+    other = &pending_left_;
+  } else {
+    return false;
+  }
+
+  if (other->valid) {
+    const MLTime difference = frame.timestamp - other->frame.timestamp;
+    if (std::abs(difference) <= settings_.max_time_difference) {
+      if (frame.id == MLWorldCameraIdentifier_Left) {
+        Rectify(frame, other->frame);
+      } else {
+        Rectify(other->frame, frame);
+      }
+      own->valid = false;
+      other->valid = false;
+      return true;
+    }
+    // Timestamps increase, so an older unmatched frame can no longer be paired
+    if (difference > 0) {
+      other->valid = false;
+    }
+  }
+  Stage(frame, own);
+  return false;
+}
+
+void WorldCameraStereoRectifier::Stage(const MLWorldCameraFrame &frame, PendingFrame *pending) {
+  // The caller releases the frame after Submit, so the image is kept until its partner arrives
+  pending->pixels.assign(frame.frame_buffer.data, frame.frame_buffer.data + frame.frame_buffer.size);
+  pending->frame = frame;
+  pending->frame.frame_buffer.data = pending->pixels.data();
+  pending->valid = true;
+}
+
+void WorldCameraStereoRectifier::Rectify(const MLWorldCameraFrame &left, const MLWorldCameraFrame &right) {
+  // Both poses at the left timestamp, so head motion between the captures does not
+  // show up as a change of the relative pose
+  MLTransform right_pose = right.camera_pose;
+  pair_pose_interpolated_ = pose_history_ &&
+                            pose_history_->PoseAt(MLWorldCameraIdentifier_Right, left.timestamp, &right_pose);
+  if (pose_history_ && !pair_pose_interpolated_) {
+    // PoseAt leaves right_pose untouched when it fails
+    ++pose_fallback_count_;
+  }
+  double left_to_world[9], right_to_world[9], world_to_left[9];
+  CameraToWorld(left.camera_pose, left_to_world);
+  CameraToWorld(right_pose, right_to_world);
+  Transpose(left_to_world, world_to_left);
+
+  // Pose of the right camera in the left camera frame
+  double relative_rotation[9];
+  Multiply(world_to_left, right_to_world, relative_rotation);
+  const double offset[3] = {right_pose.position.x - left.camera_pose.position.x,
+                            right_pose.position.y - left.camera_pose.position.y,
+                            right_pose.position.z - left.camera_pose.position.z};
+  double relative_translation[3];
+  for (int r = 0; r < 3; ++r) {
+    relative_translation[r] = world_to_left[r * 3] * offset[0] + world_to_left[r * 3 + 1] * offset[1] +
+                              world_to_left[r * 3 + 2] * offset[2];
+  }
+
+  if (NeedsRebuild(left, right, relative_rotation, relative_translation)) {
+    // Rectified frame in left camera coordinates: x along the baseline, z the mean
+    // viewing direction made orthogonal to it, y completing a right handed frame
+    double x_axis[3] = {relative_translation[0], relative_translation[1], relative_translation[2]};
+    Normalize(x_axis);
+    double forward[3] = {relative_rotation[2], relative_rotation[5], 1.0 + relative_rotation[8]};
+    Normalize(forward);
+    const double along = forward[0] * x_axis[0] + forward[1] * x_axis[1] + forward[2] * x_axis[2];
+    double z_axis[3] = {forward[0] - along * x_axis[0], forward[1] - along * x_axis[1], forward[2] - along * x_axis[2]};
+    Normalize(z_axis);
+    const double y_axis[3] = {z_axis[1] * x_axis[2] - z_axis[2] * x_axis[1],
+                              z_axis[2] * x_axis[0] - z_axis[0] * x_axis[2],
+                              z_axis[0] * x_axis[1] - z_axis[1] * x_axis[0]};
+    // Rows are the rectified axes, so this maps left camera coordinates to rectified ones
+    const double left_to_rectified[9] = {x_axis[0], x_axis[1], x_axis[2],
+                                         y_axis[0], y_axis[1], y_axis[2],
+                                         z_axis[0], z_axis[1], z_axis[2]};
+    double right_to_rectified[9];
+    Multiply(left_to_rectified, relative_rotation, right_to_rectified);
+
+    // Keep the resolution of the sharper camera and center the principal point
+    const float focal = std::min({left.intrinsics.focal_length.x, left.intrinsics.focal_length.y,
+                                  right.intrinsics.focal_length.x, right.intrinsics.focal_length.y});
+    memset(&rectified_intrinsics_, 0, sizeof(rectified_intrinsics_));
+    rectified_intrinsics_.width = left.intrinsics.width;
+    rectified_intrinsics_.height = left.intrinsics.height;
+    rectified_intrinsics_.focal_length = {focal, focal};
+    rectified_intrinsics_.principal_point = {(left.intrinsics.width - 1) * 0.5f, (left.intrinsics.height - 1) * 0.5f};
+    rectified_intrinsics_.fov = left.intrinsics.fov;
+
+    left_table_ = BuildWorldCameraRemapTable(left.intrinsics, left.frame_buffer.stride, rectified_intrinsics_,
+                                             left_to_rectified);
+    right_table_ = BuildWorldCameraRemapTable(right.intrinsics, right.frame_buffer.stride, rectified_intrinsics_,
+                                              right_to_rectified);
+    left_intrinsics_ = left.intrinsics;
+    right_intrinsics_ = right.intrinsics;
+    memcpy(table_rotation_, relative_rotation, sizeof(table_rotation_));
+    memcpy(table_translation_, relative_translation, sizeof(table_translation_));
+    ++table_build_count_;
+  }
+
+  const size_t size = static_cast<size_t>(rectified_intrinsics_.width) * rectified_intrinsics_.height;
+  rectified_left_.resize(size);
+  rectified_right_.resize(size);
+  RemapWorldCameraFrameBuffer(left_table_, left.frame_buffer, rectified_left_.data(), rectified_intrinsics_.width);
+  RemapWorldCameraFrameBuffer(right_table_, right.frame_buffer, rectified_right_.data(), rectified_intrinsics_.width);
+  baseline_ = std::sqrt(relative_translation[0] * relative_translation[0] +
+                        relative_translation[1] * relative_translation[1] +
+                        relative_translation[2] * relative_translation[2]);
+  pair_timestamp_ = left.timestamp;
+  ++pair_count_;
+}
+
+bool WorldCameraStereoRectifier::NeedsRebuild(const MLWorldCameraFrame &left, const MLWorldCameraFrame &right,
+                                              const double relative_rotation[9],
+                                              const double relative_translation[3]) const {
+  if (table_build_count_ == 0 || !SameIntrinsics(left.intrinsics, left_intrinsics_) ||
+      !SameIntrinsics(right.intrinsics, right_intrinsics_) ||
+      left.frame_buffer.stride != left_table_.source_stride || right.frame_buffer.stride != right_table_.source_stride) {
+    return true;
+  }
+  const double dx = relative_translation[0] - table_translation_[0];
+  const double dy = relative_translation[1] - table_translation_[1];
+  const double dz = relative_translation[2] - table_translation_[2];
+  if (std::sqrt(dx * dx + dy * dy + dz * dz) > settings_.max_translation_change) {
+    return true;
+  }
+  // Angle of the rotation between the cached and current relative rotations
+  double trace = 0.0;
+  for (int i = 0; i < 9; ++i) {
+    trace += table_rotation_[i] * relative_rotation[i];
+  }
+  const double angle = std::acos(std::max(-1.0, std::min(1.0, (trace - 1.0) * 0.5)));
+  return angle > settings_.max_rotation_change;
+}
+
+MLWorldCameraFrameBuffer WorldCameraStereoRectifier::MakeView(std::vector<uint8_t> &pixels) {
+  MLWorldCameraFrameBuffer view = {};
+  view.width = rectified_intrinsics_.width;
+  view.height = rectified_intrinsics_.height;
+  view.stride = rectified_intrinsics_.width;
+  view.bytes_per_pixel = 1;
+  view.size = static_cast<uint32_t>(pixels.size());
+  view.data = pixels.data();
+  return view;
+}
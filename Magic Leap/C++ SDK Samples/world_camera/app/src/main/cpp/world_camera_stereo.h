@@ -0,0 +1,118 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_pose_history.h"
+#include "world_camera_undistort.h"
+
+/*!
+  \brief Pairs left and right world camera frames and rectifies them.
+
+  Frames of the configured frame type are matched by timestamp. For every pair
+  the stage computes rectifying rotations from the two camera poses, so that
+  epipolar lines become image rows, and remaps both images with the vectorized
+  kernel from world_camera_undistort.h. The remap tables only depend on the pose
+  of the right camera relative to the left one and are rebuilt when that relative
+  pose, or the intrinsics, change by more than the configured thresholds.
+
+  camera_pose is taken to follow the usual graphics convention (x right, y up,
+  z backward); the rectified images use the image convention (x right, y down,
+  z forward).
+
+  The left and right frames of a pair are captured a little apart, so their poses
+  include head motion between the two timestamps. With a pose history set, the
+  right camera pose is instead interpolated at the left timestamp, which keeps the
+  relative pose, and with it the cached tables, steady while the head moves. If the
+  history does not cover the left timestamp, e.g. because the newest right sample
+  is older, the pair is rectified with the right frame's own pose and flagged: see
+  PairPoseInterpolated and PoseFallbackCount.
+
+  Frame buffers passed to Submit need only stay valid for the duration of the
+  call. Not thread safe.
+*/
+class WorldCameraStereoRectifier {
+public:
+  struct Settings {
+    MLWorldCameraFrameType frame_type = MLWorldCameraFrameType_NormalExposure;
+    // Maximum difference between the timestamps of a left and right frame, in nanoseconds.
+    MLTime max_time_difference = 1000000;
+    // Relative pose changes below these thresholds reuse the cached remap tables.
+    double max_translation_change = 0.0005;
+    double max_rotation_change = 0.0005;
+  };
+
+  WorldCameraStereoRectifier() = default;
+  explicit WorldCameraStereoRectifier(const Settings &settings) : settings_(settings) {}
+
+  // Returns true when frame completed a pair and a new rectified pair is available.
+  bool Submit(const MLWorldCameraFrame &frame);
+  // Poses of the right camera are looked up in history when it covers the left timestamp.
+  // history must outlive the rectifier; nullptr uses the frame poses.
+  void SetPoseHistory(const WorldCameraPoseHistory *history) { pose_history_ = history; }
+
+  // Rectified images of the latest pair, width x height with a stride of width.
+  MLWorldCameraFrameBuffer RectifiedLeft() { return MakeView(rectified_left_); }
+  MLWorldCameraFrameBuffer RectifiedRight() { return MakeView(rectified_right_); }
+  // Pinhole intrinsics shared by both rectified images.
+  const MLWorldCameraIntrinsics &RectifiedIntrinsics() const { return rectified_intrinsics_; }
+  // Distance between the two cameras of the latest pair, in meters.
+  double Baseline() const { return baseline_; }
+  MLTime PairTimestamp() const { return pair_timestamp_; }
+  uint64_t PairCount() const { return pair_count_; }
+  // False if the latest pair used the right frame's own pose although a history is set.
+  bool PairPoseInterpolated() const { return pair_pose_interpolated_; }
+  // Pairs rectified with the right frame's own pose because the history missed the left timestamp.
+  uint64_t PoseFallbackCount() const { return pose_fallback_count_; }
+  uint64_t TableBuildCount() const { return table_build_count_; }
+
+private:
+  struct PendingFrame {
+    bool valid = false;
+    MLWorldCameraFrame frame = {};
+    std::vector<uint8_t> pixels;
+  };
+
+  void Stage(const MLWorldCameraFrame &frame, PendingFrame *pending);
+  void Rectify(const MLWorldCameraFrame &left, const MLWorldCameraFrame &right);
+  bool NeedsRebuild(const MLWorldCameraFrame &left, const MLWorldCameraFrame &right,
+                    const double relative_rotation[9], const double relative_translation[3]) const;
+  MLWorldCameraFrameBuffer MakeView(std::vector<uint8_t> &pixels);
+
+  Settings settings_;
+  const WorldCameraPoseHistory *pose_history_ = nullptr;
+  PendingFrame pending_left_;
+  PendingFrame pending_right_;
+
+  WorldCameraRemapTable left_table_;
+  WorldCameraRemapTable right_table_;
+  MLWorldCameraIntrinsics left_intrinsics_ = {};
+  MLWorldCameraIntrinsics right_intrinsics_ = {};
+  double table_rotation_[9] = {};
+  double table_translation_[3] = {};
+  MLWorldCameraIntrinsics rectified_intrinsics_ = {};
+
+  std::vector<uint8_t> rectified_left_;
+  std::vector<uint8_t> rectified_right_;
+  double baseline_ = 0.0;
+  MLTime pair_timestamp_ = 0;
+  uint64_t pair_count_ = 0;
+  bool pair_pose_interpolated_ = false;
+  uint64_t pose_fallback_count_ = 0;
+  uint64_t table_build_count_ = 0;
+};
@@ -0,0 +1,53 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+
+#include <ml_world_camera.h>
+
+// Cameras are numbered densely in the order left, right, center.
+constexpr size_t kWorldCameraCount = 3;
+
+// Index of a single camera, or kWorldCameraCount if camera is not a single known camera.
+inline size_t WorldCameraIndex(MLWorldCameraIdentifier camera) {
+  switch (camera) {
+    case MLWorldCameraIdentifier_Left: return 0;
+    case MLWorldCameraIdentifier_Right: return 1;
+    case MLWorldCameraIdentifier_Center: return 2;
+    default: return kWorldCameraCount;
+  }
+}
+
+// A stream is a single camera and frame type combination, e.g. left camera low exposure.
+// Streams are numbered densely so per stream state can live in plain arrays.
+constexpr size_t kWorldCameraStreamCount = kWorldCameraCount * 2;
+
+// Index of the stream of a camera and frame type, or kWorldCameraStreamCount if either
+// is not a single known value.
+inline size_t WorldCameraStreamIndex(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type) {
+  const size_t camera_index = WorldCameraIndex(camera);
+  if (camera_index == kWorldCameraCount) {
+    return kWorldCameraStreamCount;
+  }
+  switch (frame_type) {
+    case MLWorldCameraFrameType_LowExposure: return camera_index * 2;
+    case MLWorldCameraFrameType_NormalExposure: return camera_index * 2 + 1;
+    default: return kWorldCameraStreamCount;
+  }
+}
+
+inline size_t WorldCameraStreamIndex(const MLWorldCameraFrame &frame) {
+  return WorldCameraStreamIndex(frame.id, frame.frame_type);
+}
@@ -0,0 +1,189 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_texture_atlas.h"
+
+#include <cstring>
+#include <utility>
+
+WorldCameraTextureRect WorldCameraAtlasLayout::Cell(size_t cell) const {
+  return {static_cast<uint32_t>(cell % columns) * cell_width, static_cast<uint32_t>(cell / columns) * cell_height,
+          cell_width, cell_height};
+}
+
+WorldCameraTextureUv WorldCameraAtlasLayout::Uv(size_t cell) const {
+  const WorldCameraTextureRect rect = Cell(cell);
+  const float width = static_cast<float>(Width());
+  const float height = static_cast<float>(Height());
+  return {rect.x / width, rect.y / height, (rect.x + rect.width) / width, (rect.y + rect.height) / height};
+}
+
+WorldCameraTextureAtlas::WorldCameraTextureAtlas(std::unique_ptr<WorldCameraTextureBackend> backend,
+                                                 const WorldCameraAtlasLayout &layout)
+    : backend_(std::move(backend)),
+      layout_(layout),
+      filled_(layout.CellCount(), false),
+      pending_clears_(layout.CellCount(), false) {}
+
+WorldCameraTextureAtlas::~WorldCameraTextureAtlas() {
+  // A mapped pixel buffer must be unmapped before the backend releases it
+  if (staging_) {
+    Flush();
+  }
+}
+
+bool WorldCameraTextureAtlas::Upload(size_t cell, const MLWorldCameraFrameBuffer &buffer) {
+  if (buffer.bytes_per_pixel != 1 || !buffer.data || buffer.stride < buffer.width) {
+    ++counters_.rejected;
+    return false;
+  }
+  uint32_t stride = 0;
+  uint8_t *staging = BeginCell(cell, buffer.width, buffer.height, &stride);
+  if (!staging) {
+    return false;
+  }
+  for (uint32_t y = 0; y < buffer.height; ++y) {
+    memcpy(staging + static_cast<size_t>(y) * stride, buffer.data + static_cast<size_t>(y) * buffer.stride,
+           buffer.width);
+  }
+  return true;
+}
+
+bool WorldCameraTextureAtlas::Upload(size_t cell, const MLWorldCameraFrameBuffer &buffer,
+                                     const WorldCameraDirtyTiles &tiles) {
+  if (buffer.bytes_per_pixel != 1 || !buffer.data || buffer.stride < buffer.width || tiles.width != buffer.width ||
+      tiles.height != buffer.height || cell >= filled_.size() || buffer.width > layout_.cell_width ||
+      buffer.height > layout_.cell_height) {
+    ++counters_.rejected;
+    return false;
+  }
+  // Until a full frame has been staged the cell holds nothing to keep
+  if (!filled_[cell]) {
+    return Upload(cell, buffer);
+  }
+  if (tiles.dirty_count == 0) {
+    ++counters_.skipped;
+    return true;
+  }
+  uint8_t *staging = Staging();
+  if (!staging) {
+    return false;
+  }
+  cell_rects_.clear();
+  AppendWorldCameraDirtyRects(tiles, &cell_rects_);
+  const WorldCameraTextureRect origin = layout_.Cell(cell);
+  const uint32_t row_length = layout_.Width();
+  for (const auto &rect : cell_rects_) {
+    for (uint32_t y = rect.y; y < rect.y + rect.height; ++y) {
+      memcpy(staging + static_cast<size_t>(origin.y + y) * row_length + origin.x + rect.x,
+             buffer.data + static_cast<size_t>(y) * buffer.stride + rect.x, rect.width);
+    }
+    AddRect(cell, rect);
+  }
+  return true;
+}
+
+uint8_t *WorldCameraTextureAtlas::BeginCell(size_t cell, uint32_t width, uint32_t height, uint32_t *out_stride) {
+  if (cell >= filled_.size() || width == 0 || height == 0 || width > layout_.cell_width ||
+      height > layout_.cell_height) {
+    ++counters_.rejected;
+    return nullptr;
+  }
+  uint8_t *staging = Staging();
+  if (!staging) {
+    return nullptr;
+  }
+  const WorldCameraTextureRect origin = layout_.Cell(cell);
+  AddRect(cell, {0, 0, width, height});
+  // A frame smaller than the cell leaves the rest of it as it was
+  filled_[cell] = width == layout_.cell_width && height == layout_.cell_height;
+  *out_stride = layout_.Width();
+  return staging + static_cast<size_t>(origin.y) * layout_.Width() + origin.x;
+}
+
+bool WorldCameraTextureAtlas::Clear(size_t cell) {
+  if (cell >= filled_.size()) {
+    ++counters_.rejected;
+    return false;
+  }
+  // Black is not a frame that dirty tiles could be applied to
+  filled_[cell] = false;
+  if (staging_) {
+    StageClear(cell);
+  } else {
+    pending_clears_[cell] = true;
+    has_pending_clears_ = true;
+  }
+  return true;
+}
+
+void WorldCameraTextureAtlas::Flush() {
+  // Cells cleared since the last upload are transferred even when no frame was staged
+  if (!staging_ && !(has_pending_clears_ && Staging())) {
+    return;
+  }
+  backend_->EndUpload(rects_.data(), rects_.size(), layout_.Width());
+  staging_ = nullptr;
+  counters_.rects += rects_.size();
+  rects_.clear();
+  ++counters_.uploads;
+}
+
+uint8_t *WorldCameraTextureAtlas::Staging() {
+  if (staging_) {
+    return staging_;
+  }
+  if (!allocated_) {
+    if (layout_.CellCount() == 0 || layout_.cell_width == 0 || layout_.cell_height == 0 ||
+        !backend_->Allocate(layout_.Width(), layout_.Height())) {
+      ++counters_.rejected;
+      return nullptr;
+    }
+    allocated_ = true;
+  }
+  bool stalled = false;
+  staging_ = backend_->BeginUpload(static_cast<size_t>(layout_.Width()) * layout_.Height(), &stalled);
+  if (stalled) {
+    ++counters_.stalls;
+  }
+  if (!staging_) {
+    ++counters_.rejected;
+    return nullptr;
+  }
+  // Pending clears go first, so frames staged into the same cells replace them
+  if (has_pending_clears_) {
+    for (size_t cell = 0; cell < pending_clears_.size(); ++cell) {
+      if (pending_clears_[cell]) {
+        StageClear(cell);
+        pending_clears_[cell] = false;
+      }
+    }
+    has_pending_clears_ = false;
+  }
+  return staging_;
+}
+
+void WorldCameraTextureAtlas::AddRect(size_t cell, const WorldCameraTextureRect &rect) {
+  const WorldCameraTextureRect origin = layout_.Cell(cell);
+  rects_.push_back({origin.x + rect.x, origin.y + rect.y, rect.width, rect.height});
+  counters_.bytes_copied += static_cast<uint64_t>(rect.width) * rect.height;
+}
+
+void WorldCameraTextureAtlas::StageClear(size_t cell) {
+  const WorldCameraTextureRect origin = layout_.Cell(cell);
+  const uint32_t row_length = layout_.Width();
+  for (uint32_t y = 0; y < layout_.cell_height; ++y) {
+    memset(staging_ + static_cast<size_t>(origin.y + y) * row_length + origin.x, 0, layout_.cell_width);
+  }
+  AddRect(cell, {0, 0, layout_.cell_width, layout_.cell_height});
+}
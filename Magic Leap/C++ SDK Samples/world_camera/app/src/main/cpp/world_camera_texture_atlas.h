@@ -0,0 +1,115 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_change_detector.h"
+#include "world_camera_texture_streamer.h"
+
+// Region of a texture in normalized coordinates, u to the right and v down from row 0.
+struct WorldCameraTextureUv {
+  float u0;
+  float v0;
+  float u1;
+  float v1;
+};
+
+// Grid of equally sized cells in an atlas texture, numbered in rows from the top left.
+struct WorldCameraAtlasLayout {
+  uint32_t cell_width = 0;
+  uint32_t cell_height = 0;
+  uint32_t columns = 0;
+  uint32_t rows = 0;
+
+  uint32_t Width() const { return cell_width * columns; }
+  uint32_t Height() const { return cell_height * rows; }
+  size_t CellCount() const { return static_cast<size_t>(columns) * rows; }
+  WorldCameraTextureRect Cell(size_t cell) const;
+  WorldCameraTextureUv Uv(size_t cell) const;
+};
+
+/*!
+  \brief Streams several world camera previews into the cells of one texture.
+
+  Frames for any number of cells are staged into a single upload of the backend and
+  transferred together by Flush, one sub-rectangle per dirty span of each cell, so
+  all previews cost one upload per frame and can be drawn with one quad. Frames
+  must fit their cell and are placed at its top left. Like the streamer, a cell
+  takes only the dirty tiles of a frame once it holds a full frame. Clearing a cell
+  outside an upload does not begin one; the cell is blanked in the next upload, or by
+  the next Flush. Not thread safe.
+*/
+class WorldCameraTextureAtlas {
+public:
+  struct Counters {
+    // Flushes that transferred anything
+    uint64_t uploads;
+    uint64_t rects;
+    uint64_t bytes_copied;
+    // Frames without any dirty tile, for which nothing was staged
+    uint64_t skipped;
+    uint64_t stalls;
+    uint64_t rejected;
+  };
+
+  WorldCameraTextureAtlas(std::unique_ptr<WorldCameraTextureBackend> backend, const WorldCameraAtlasLayout &layout);
+  // Ends an upload that was begun and not flushed, so the backend is not left staging.
+  ~WorldCameraTextureAtlas();
+  WorldCameraTextureAtlas(const WorldCameraTextureAtlas &) = delete;
+  WorldCameraTextureAtlas &operator=(const WorldCameraTextureAtlas &) = delete;
+
+  // Stages an 8-bit single channel frame buffer into cell.
+  bool Upload(size_t cell, const MLWorldCameraFrameBuffer &buffer);
+  // Stages only the dirty tiles of an 8-bit single channel frame buffer. The cell must hold
+  // the previous frame, as the change detector's reference does.
+  bool Upload(size_t cell, const MLWorldCameraFrameBuffer &buffer, const WorldCameraDirtyTiles &tiles);
+  // Returns staging memory for a width x height image in cell, with rows *out_stride bytes
+  // apart, so a frame can be produced in place. The whole image is transferred on Flush.
+  uint8_t *BeginCell(size_t cell, uint32_t width, uint32_t height, uint32_t *out_stride);
+  // Blanks cell, e.g. when its stream is disabled. Applied in the current upload if one is
+  // begun, otherwise when the next one begins; frames staged afterwards replace it.
+  bool Clear(size_t cell);
+  // Transfers everything staged since the last flush, and any pending clears, in a single upload.
+  void Flush();
+
+  const WorldCameraAtlasLayout &Layout() const { return layout_; }
+  const Counters &GetCounters() const { return counters_; }
+
+private:
+  // Staging memory of the whole atlas for the current upload, begun on first use
+  uint8_t *Staging();
+  // Adds rect of cell, in cell coordinates, to the current upload
+  void AddRect(size_t cell, const WorldCameraTextureRect &rect);
+  // Stages black into the whole of cell
+  void StageClear(size_t cell);
+
+  std::unique_ptr<WorldCameraTextureBackend> backend_;
+  WorldCameraAtlasLayout layout_;
+  bool allocated_ = false;
+  uint8_t *staging_ = nullptr;
+  std::vector<WorldCameraTextureRect> rects_;
+  std::vector<WorldCameraTextureRect> cell_rects_;
+  // Cells holding a full frame, which dirty tiles may be applied to
+  std::vector<bool> filled_;
+  // Cells cleared while no upload was begun
+  std::vector<bool> pending_clears_;
+  bool has_pending_clears_ = false;
+  Counters counters_ = {};
+};
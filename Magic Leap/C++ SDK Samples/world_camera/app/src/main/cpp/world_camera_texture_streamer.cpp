@@ -0,0 +1,153 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_texture_streamer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+namespace {
+
+  // Bytes spanned by height rows of width pixels that are stride bytes apart
+  size_t UploadSize(uint32_t width, uint32_t height, uint32_t stride) {
+    return static_cast<size_t>(stride) * (height - 1) + width;
+  }
+}
+
+void AppendWorldCameraDirtyRects(const WorldCameraDirtyTiles &tiles, std::vector<WorldCameraTextureRect> *rects) {
+  constexpr uint32_t kTileSize = WorldCameraDirtyTiles::kTileSize;
+  const size_t first_rect = rects->size();
+  for (uint32_t row = 0; row < tiles.rows; ++row) {
+    uint32_t first = tiles.columns;
+    uint32_t last = 0;
+    for (uint32_t column = 0; column < tiles.columns; ++column) {
+      if (tiles.IsDirty(column, row)) {
+        first = std::min(first, column);
+        last = column;
+      }
+    }
+    if (first == tiles.columns) {
+      continue;
+    }
+    const uint32_t x = first * kTileSize;
+    const uint32_t y = row * kTileSize;
+    const WorldCameraTextureRect rect = {x, y, std::min(tiles.width, (last + 1) * kTileSize) - x,
+                                         std::min(kTileSize, tiles.height - y)};
+    if (rects->size() > first_rect && rects->back().x == rect.x && rects->back().width == rect.width &&
+        rects->back().y + rects->back().height == rect.y) {
+      rects->back().height += rect.height;
+    } else {
+      rects->push_back(rect);
+    }
+  }
+}
+
+WorldCameraTextureStreamer::WorldCameraTextureStreamer(std::unique_ptr<WorldCameraTextureBackend> backend)
+    : backend_(std::move(backend)) {}
+
+bool WorldCameraTextureStreamer::Upload(const MLWorldCameraFrameBuffer &buffer) {
+  if (buffer.bytes_per_pixel != 1 || !buffer.data) {
+    ++counters_.rejected;
+    return false;
+  }
+  uint8_t *staging = BeginUpload(buffer.width, buffer.height, buffer.stride);
+  if (!staging) {
+    return false;
+  }
+  memcpy(staging, buffer.data, UploadSize(buffer.width, buffer.height, buffer.stride));
+  EndUpload();
+  return true;
+}
+
+bool WorldCameraTextureStreamer::Upload(const MLWorldCameraFrameBuffer &buffer, const WorldCameraDirtyTiles &tiles) {
+  if (buffer.bytes_per_pixel != 1 || !buffer.data || tiles.width != buffer.width || tiles.height != buffer.height) {
+    ++counters_.rejected;
+    return false;
+  }
+  // Until a first full frame has been uploaded the texture holds nothing to keep
+  if (counters_.uploads == 0) {
+    return Upload(buffer);
+  }
+  if (tiles.dirty_count == 0) {
+    ++counters_.skipped;
+    return true;
+  }
+
+  rects_.clear();
+  AppendWorldCameraDirtyRects(tiles, &rects_);
+
+  uint8_t *staging = Stage(buffer.width, buffer.height, buffer.stride);
+  if (!staging) {
+    return false;
+  }
+  for (const auto &rect : rects_) {
+    for (uint32_t y = rect.y; y < rect.y + rect.height; ++y) {
+      const size_t offset = static_cast<size_t>(y) * buffer.stride + rect.x;
+      memcpy(staging + offset, buffer.data + offset, rect.width);
+    }
+    counters_.bytes_copied += static_cast<uint64_t>(rect.width) * rect.height;
+  }
+  backend_->EndUpload(rects_.data(), rects_.size(), pending_stride_);
+  pending_stride_ = 0;
+  ++counters_.uploads;
+  return true;
+}
+
+uint8_t *WorldCameraTextureStreamer::BeginUpload(uint32_t width, uint32_t height, uint32_t stride) {
+  uint8_t *staging = Stage(width, height, stride);
+  if (staging) {
+    counters_.bytes_copied += UploadSize(width, height, stride);
+  }
+  return staging;
+}
+
+void WorldCameraTextureStreamer::EndUpload() {
+  if (pending_stride_ == 0) {
+    return;
+  }
+  const WorldCameraTextureRect rect = {0, 0, width_, height_};
+  backend_->EndUpload(&rect, 1, pending_stride_);
+  pending_stride_ = 0;
+  ++counters_.uploads;
+}
+
+uint8_t *WorldCameraTextureStreamer::Stage(uint32_t width, uint32_t height, uint32_t stride) {
+  if (pending_stride_ != 0 || width == 0 || height == 0 || stride < width) {
+    ++counters_.rejected;
+    return nullptr;
+  }
+  if (width_ == 0) {
+    if (!backend_->Allocate(width, height)) {
+      ++counters_.rejected;
+      return nullptr;
+    }
+    width_ = width;
+    height_ = height;
+  } else if (width != width_ || height != height_) {
+    ++counters_.rejected;
+    return nullptr;
+  }
+
+  bool stalled = false;
+  uint8_t *staging = backend_->BeginUpload(UploadSize(width, height, stride), &stalled);
+  if (stalled) {
+    ++counters_.stalls;
+  }
+  if (!staging) {
+    ++counters_.rejected;
+    return nullptr;
+  }
+  pending_stride_ = stride;
+  return staging;
+}
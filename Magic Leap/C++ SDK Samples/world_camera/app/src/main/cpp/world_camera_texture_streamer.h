@@ -0,0 +1,103 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_change_detector.h"
+
+// Region of a texture, in pixels.
+struct WorldCameraTextureRect {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+};
+
+// Appends the rects covering the dirty tiles of an image: one per row of tiles from its first
+// to its last dirty tile, merged with the rect above when both span the same columns.
+void AppendWorldCameraDirtyRects(const WorldCameraDirtyTiles &tiles, std::vector<WorldCameraTextureRect> *rects);
+
+/*!
+  \brief Destination of world camera texture uploads.
+
+  A backend owns an 8-bit single channel texture with storage fixed on first use
+  and stages each upload in memory it provides, so the streamer itself has no
+  dependency on a graphics API.
+*/
+class WorldCameraTextureBackend {
+public:
+  virtual ~WorldCameraTextureBackend() = default;
+  // Allocates storage for a width x height texture. Called once, before the first upload.
+  virtual bool Allocate(uint32_t width, uint32_t height) = 0;
+  // Returns at least size writable bytes for the next upload, or nullptr on failure.
+  // Sets *stalled if the backend had to wait for a previous upload to complete.
+  virtual uint8_t *BeginUpload(size_t size, bool *stalled) = 0;
+  // Transfers rects of the staged image, whose rows are row_length pixels apart, to the
+  // same rects of the texture. Pixel (x, y) is staged at byte y * row_length + x.
+  virtual void EndUpload(const WorldCameraTextureRect *rects, size_t rect_count, uint32_t row_length) = 0;
+};
+
+/*!
+  \brief Streams world camera frames into a texture.
+
+  Uploads follow the real width, height and stride of each frame buffer: rows are
+  copied as they are laid out in memory and the stride is passed on as the row
+  length instead of repacking them. Given the dirty tiles of a frame, only the
+  span of dirty tiles in each row of tiles is copied and transferred. Storage is sized by the
+  first frame; frames of another size are rejected and counted. Not thread safe.
+*/
+class WorldCameraTextureStreamer {
+public:
+  struct Counters {
+    uint64_t uploads;
+    // Frames without any dirty tile, for which nothing was uploaded
+    uint64_t skipped;
+    uint64_t bytes_copied;
+    uint64_t stalls;
+    uint64_t rejected;
+  };
+
+  explicit WorldCameraTextureStreamer(std::unique_ptr<WorldCameraTextureBackend> backend);
+
+  // Uploads an 8-bit single channel frame buffer.
+  bool Upload(const MLWorldCameraFrameBuffer &buffer);
+  // Uploads only the dirty tiles of an 8-bit single channel frame buffer. The texture
+  // must hold the previous frame, as the change detector's reference does.
+  bool Upload(const MLWorldCameraFrameBuffer &buffer, const WorldCameraDirtyTiles &tiles);
+  // Returns staging memory for a width x height image with rows stride bytes apart, so
+  // a frame can be produced in place, e.g. by undistortion. Finish with EndUpload.
+  uint8_t *BeginUpload(uint32_t width, uint32_t height, uint32_t stride);
+  void EndUpload();
+
+  uint32_t Width() const { return width_; }
+  uint32_t Height() const { return height_; }
+  const Counters &GetCounters() const { return counters_; }
+
+private:
+  uint8_t *Stage(uint32_t width, uint32_t height, uint32_t stride);
+
+  std::unique_ptr<WorldCameraTextureBackend> backend_;
+  uint32_t width_ = 0;
+  uint32_t height_ = 0;
+  // Row length of the upload in progress, 0 if none
+  uint32_t pending_stride_ = 0;
+  std::vector<WorldCameraTextureRect> rects_;
+  Counters counters_ = {};
+};
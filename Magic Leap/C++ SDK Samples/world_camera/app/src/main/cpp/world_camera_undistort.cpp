@@ -0,0 +1,232 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include "world_camera_undistort.h"
+
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define WORLD_CAMERA_REMAP_AVX2 1
+#endif
+
+namespace {
+
+  constexpr int kWeightBits = 7;
+  constexpr int kWeightScale = 1 << kWeightBits;
+  constexpr uint32_t kInsideFlag = 0xFFFF0000u;
+
+  // Splits a source coordinate into an integer tap in [0, size - 2] and a weight in 1/128ths.
+  void SplitCoordinate(double coordinate, uint32_t size, int32_t *tap, int32_t *weight) {
+    int32_t integer = static_cast<int32_t>(std::floor(coordinate));
+    int32_t fraction = static_cast<int32_t>(std::lround((coordinate - integer) * kWeightScale));
+    if (fraction == kWeightScale) {
+      ++integer;
+      fraction = 0;
+    }
+    if (integer >= static_cast<int32_t>(size) - 1) {
+      integer = static_cast<int32_t>(size) - 2;
+      fraction = kWeightScale;
+    }
+    *tap = integer;
+    *weight = fraction;
+  }
+
+  inline uint8_t Interpolate(const uint8_t *src, uint32_t stride, int32_t offset, uint32_t weight) {
+    if ((weight & kInsideFlag) == 0) {
+      return 0;
+    }
+    const int32_t fx = weight & 0xFF;
+    const int32_t fy = (weight >> 8) & 0xFF;
+    const uint8_t *p = src + offset;
+    const int32_t top = p[0] * kWeightScale + (p[1] - p[0]) * fx;
+    const int32_t bottom = p[stride] * kWeightScale + (p[stride + 1] - p[stride]) * fx;
+    return static_cast<uint8_t>((top * kWeightScale + (bottom - top) * fy + (1 << (2 * kWeightBits - 1))) >>
+                                (2 * kWeightBits));
+  }
+
+  void RemapRowScalar(const WorldCameraRemapTable &table, const uint8_t *src, size_t first, size_t count, uint8_t *dst) {
+    for (size_t i = 0; i < count; ++i) {
+      dst[i] = Interpolate(src, table.source_stride, table.offsets[first + i], table.weights[first + i]);
+    }
+  }
+
+#if WORLD_CAMERA_REMAP_AVX2
+  // Eight output pixels per iteration: the four taps of each pixel are fetched with two
+  // gathers and interpolated in 32-bit lanes with the same arithmetic as Interpolate.
+  __attribute__((target("avx2")))
+  void RemapAvx2(const WorldCameraRemapTable &table, const uint8_t *src, uint8_t *dst, uint32_t dst_stride) {
+    const int stride = static_cast<int>(table.source_stride);
+    const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+    const __m256i scale = _mm256_set1_epi32(kWeightScale);
+    const __m256i round = _mm256_set1_epi32(1 << (2 * kWeightBits - 1));
+    // The bottom taps are gathered from two bytes before them, so the 4-byte load never
+    // reads past the last pixel of the buffer.
+    const int *bottom_base = reinterpret_cast<const int *>(src + stride - 2);
+    const int *top_base = reinterpret_cast<const int *>(src);
+
+    for (uint32_t y = 0; y < table.height; ++y) {
+      const size_t row = static_cast<size_t>(y) * table.width;
+      uint8_t *out = dst + static_cast<size_t>(y) * dst_stride;
+      uint32_t x = 0;
+      for (; x + 8 <= table.width; x += 8) {
+        const __m256i offsets = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&table.offsets[row + x]));
+        const __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&table.weights[row + x]));
+        const __m256i top_taps = _mm256_i32gather_epi32(top_base, offsets, 1);
+        const __m256i bottom_taps = _mm256_i32gather_epi32(bottom_base, offsets, 1);
+
+        const __m256i p00 = _mm256_and_si256(top_taps, byte_mask);
+        const __m256i p01 = _mm256_and_si256(_mm256_srli_epi32(top_taps, 8), byte_mask);
+        const __m256i p10 = _mm256_and_si256(_mm256_srli_epi32(bottom_taps, 16), byte_mask);
+        const __m256i p11 = _mm256_srli_epi32(bottom_taps, 24);
+        const __m256i fx = _mm256_and_si256(weights, byte_mask);
+        const __m256i fy = _mm256_and_si256(_mm256_srli_epi32(weights, 8), byte_mask);
+        const __m256i inside = _mm256_srai_epi32(weights, 16);
+
+        const __m256i top = _mm256_add_epi32(_mm256_mullo_epi32(p00, scale),
+                                             _mm256_mullo_epi32(_mm256_sub_epi32(p01, p00), fx));
+        const __m256i bottom = _mm256_add_epi32(_mm256_mullo_epi32(p10, scale),
+                                                _mm256_mullo_epi32(_mm256_sub_epi32(p11, p10), fx));
+        __m256i value = _mm256_add_epi32(_mm256_mullo_epi32(top, scale),
+                                         _mm256_mullo_epi32(_mm256_sub_epi32(bottom, top), fy));
+        value = _mm256_srli_epi32(_mm256_add_epi32(value, round), 2 * kWeightBits);
+        value = _mm256_and_si256(value, inside);
+
+        const __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(out + x), _mm_packus_epi16(words, words));
+      }
+      RemapRowScalar(table, src, row + x, table.width - x, out + x);
+    }
+  }
+
+  bool HasAvx2() {
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+  }
+#endif
+
+  bool MatchesTable(const WorldCameraRemapTable &table, const MLWorldCameraFrameBuffer &source) {
+    return source.data && source.bytes_per_pixel == 1 && source.width == table.source_width &&
+           source.height == table.source_height && source.stride == table.source_stride;
+  }
+}
+
+WorldCameraRemapTable BuildWorldCameraRemapTable(const MLWorldCameraIntrinsics &intrinsics, uint32_t source_stride,
+                                                 const MLWorldCameraIntrinsics &output, const double *rotation) {
+  WorldCameraRemapTable table;
+  if (intrinsics.width < 2 || intrinsics.height < 2 || source_stride < intrinsics.width) {
+    return table;
+  }
+  table.width = output.width;
+  table.height = output.height;
+  table.source_width = intrinsics.width;
+  table.source_height = intrinsics.height;
+  table.source_stride = source_stride;
+  table.offsets.resize(static_cast<size_t>(output.width) * output.height);
+  table.weights.resize(table.offsets.size());
+
+  const double identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  const double *r = rotation ? rotation : identity;
+  const double k1 = intrinsics.radial_distortion[0], k2 = intrinsics.radial_distortion[1];
+  const double k3 = intrinsics.radial_distortion[2], k4 = intrinsics.radial_distortion[3];
+  const double p1 = intrinsics.tangential_distortion[0], p2 = intrinsics.tangential_distortion[1];
+  const double max_u = intrinsics.width - 1.0, max_v = intrinsics.height - 1.0;
+
+  for (uint32_t v = 0; v < output.height; ++v) {
+    for (uint32_t u = 0; u < output.width; ++u) {
+      const size_t index = static_cast<size_t>(v) * output.width + u;
+      table.offsets[index] = 0;
+      table.weights[index] = 0;
+
+      // Ray in the output camera, rotated back into the source camera
+      const double xo = (u - output.principal_point.x) / output.focal_length.x;
+      const double yo = (v - output.principal_point.y) / output.focal_length.y;
+      const double xs = r[0] * xo + r[3] * yo + r[6];
+      const double ys = r[1] * xo + r[4] * yo + r[7];
+      const double zs = r[2] * xo + r[5] * yo + r[8];
+      if (zs <= 0.0) {
+        continue;
+      }
+      const double a = xs / zs, b = ys / zs;
+
+      const double radius = std::sqrt(a * a + b * b);
+      const double theta = std::atan(radius);
+      const double theta2 = theta * theta;
+      const double theta_d = theta * (1.0 + theta2 * (k1 + theta2 * (k2 + theta2 * (k3 + theta2 * k4))));
+      const double radial_scale = radius > 1e-12 ? theta_d / radius : 1.0;
+      const double x = a * radial_scale, y = b * radial_scale;
+      const double rd2 = x * x + y * y;
+      const double xd = x + 2.0 * p1 * x * y + p2 * (rd2 + 2.0 * x * x);
+      const double yd = y + p1 * (rd2 + 2.0 * y * y) + 2.0 * p2 * x * y;
+
+      const double su = intrinsics.focal_length.x * xd + intrinsics.principal_point.x;
+      const double sv = intrinsics.focal_length.y * yd + intrinsics.principal_point.y;
+      if (!(su >= 0.0 && su <= max_u && sv >= 0.0 && sv <= max_v)) {
+        continue;
+      }
+      int32_t x0, y0, fx, fy;
+      SplitCoordinate(su, intrinsics.width, &x0, &fx);
+      SplitCoordinate(sv, intrinsics.height, &y0, &fy);
+      table.offsets[index] = y0 * static_cast<int32_t>(source_stride) + x0;
+      table.weights[index] = kInsideFlag | static_cast<uint32_t>(fy << 8) | static_cast<uint32_t>(fx);
+    }
+  }
+  return table;
+}
+
+void RemapWorldCameraFrameBufferScalar(const WorldCameraRemapTable &table, const MLWorldCameraFrameBuffer &source,
+                                       uint8_t *dst, uint32_t dst_stride) {
+  if (!MatchesTable(table, source)) {
+    return;
+  }
+  for (uint32_t y = 0; y < table.height; ++y) {
+    RemapRowScalar(table, source.data, static_cast<size_t>(y) * table.width, table.width,
+                   dst + static_cast<size_t>(y) * dst_stride);
+  }
+}
+
+void RemapWorldCameraFrameBuffer(const WorldCameraRemapTable &table, const MLWorldCameraFrameBuffer &source,
+                                 uint8_t *dst, uint32_t dst_stride) {
+#if WORLD_CAMERA_REMAP_AVX2
+  if (HasAvx2() && MatchesTable(table, source)) {
+    RemapAvx2(table, source.data, dst, dst_stride);
+    return;
+  }
+#endif
+  RemapWorldCameraFrameBufferScalar(table, source, dst, dst_stride);
+}
+
+bool WorldCameraUndistorter::Undistort(const MLWorldCameraFrame &frame, uint8_t *dst, uint32_t dst_stride) {
+  const WorldCameraRemapTable &table = GetTable(frame.intrinsics, frame.frame_buffer.stride);
+  if (table.offsets.empty() || !MatchesTable(table, frame.frame_buffer)) {
+    return false;
+  }
+  RemapWorldCameraFrameBuffer(table, frame.frame_buffer, dst, dst_stride);
+  return true;
+}
+
+const WorldCameraRemapTable &WorldCameraUndistorter::GetTable(const MLWorldCameraIntrinsics &intrinsics,
+                                                              uint32_t source_stride) {
+  const TableKey key{intrinsics.width, intrinsics.height, source_stride,
+                     {intrinsics.focal_length.x, intrinsics.focal_length.y,
+                      intrinsics.principal_point.x, intrinsics.principal_point.y,
+                      intrinsics.radial_distortion[0], intrinsics.radial_distortion[1],
+                      intrinsics.radial_distortion[2], intrinsics.radial_distortion[3],
+                      intrinsics.tangential_distortion[0], intrinsics.tangential_distortion[1]}};
+  auto it = tables_.find(key);
+  if (it == tables_.end()) {
+    // Undistort into a pinhole camera with the same size, focal length and principal point
+    it = tables_.emplace(key, BuildWorldCameraRemapTable(intrinsics, source_stride, intrinsics)).first;
+  }
+  return it->second;
+}
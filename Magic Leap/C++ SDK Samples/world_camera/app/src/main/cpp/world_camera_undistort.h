@@ -0,0 +1,90 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+/*!
+  \brief Precomputed source locations for remapping an 8-bit single channel image.
+
+  For every output pixel the table holds the byte offset of the top left source
+  tap and the bilinear weights packed as fx | fy << 8, both in 1/128ths, with the
+  top 16 bits set when the source location lies inside the image. Offsets bake in
+  the source stride, so a table is only valid for buffers with that stride.
+*/
+struct WorldCameraRemapTable {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t source_width = 0;
+  uint32_t source_height = 0;
+  uint32_t source_stride = 0;
+  std::vector<int32_t> offsets;
+  std::vector<uint32_t> weights;
+};
+
+/*!
+  \brief Builds a table that undistorts a world camera image.
+
+  The world cameras use a fisheye model: for a normalized undistorted point (a, b)
+  with r = sqrt(a^2 + b^2) and theta = atan(r),
+
+    theta_d = theta * (1 + k1 theta^2 + k2 theta^4 + k3 theta^6 + k4 theta^8)
+    x = a * theta_d / r,  y = b * theta_d / r
+
+  followed by the tangential terms
+
+    x_d = x + 2 p1 x y + p2 (r_d^2 + 2 x^2)
+    y_d = y + p1 (r_d^2 + 2 y^2) + 2 p2 x y,  with r_d^2 = x^2 + y^2
+
+  and projected with the focal length and principal point of intrinsics.
+
+  The output is an ideal pinhole camera described by the focal length, principal
+  point and size of output. rotation, if not NULL, is a row major 3x3 rotation
+  from the source camera to the output camera, e.g. a stereo rectifying rotation.
+*/
+WorldCameraRemapTable BuildWorldCameraRemapTable(const MLWorldCameraIntrinsics &intrinsics, uint32_t source_stride,
+                                                 const MLWorldCameraIntrinsics &output, const double *rotation = nullptr);
+
+// Remaps an 8-bit single channel frame buffer matching the table into dst, using AVX2 when available.
+// Output pixels whose source lies outside the image are set to 0.
+void RemapWorldCameraFrameBuffer(const WorldCameraRemapTable &table, const MLWorldCameraFrameBuffer &source,
+                                 uint8_t *dst, uint32_t dst_stride);
+
+// Portable implementation of RemapWorldCameraFrameBuffer, bit exact with the vectorized one.
+void RemapWorldCameraFrameBufferScalar(const WorldCameraRemapTable &table, const MLWorldCameraFrameBuffer &source,
+                                       uint8_t *dst, uint32_t dst_stride);
+
+/*!
+  \brief Undistorts world camera frames, building a remap table once per unique set of intrinsics.
+
+  Tables are cached by the intrinsics values and the source stride, so frames of
+  all cameras can share one undistorter. Not thread safe.
+*/
+class WorldCameraUndistorter {
+public:
+  // Returns false if the frame is not an 8-bit single channel image.
+  bool Undistort(const MLWorldCameraFrame &frame, uint8_t *dst, uint32_t dst_stride);
+  const WorldCameraRemapTable &GetTable(const MLWorldCameraIntrinsics &intrinsics, uint32_t source_stride);
+  size_t CachedTableCount() const { return tables_.size(); }
+
+private:
+  typedef std::tuple<uint32_t, uint32_t, uint32_t, std::array<double, 10>> TableKey;
+  std::map<TableKey, WorldCameraRemapTable> tables_;
+};
@@ -0,0 +1,52 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+// Minimal stand-in for the SDK's ml_api.h, with just what ml_world_camera.h and the
+// sample sources need, so they can be built and tested on a host without the SDK.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+#define ML_EXTERN_C_BEGIN extern "C" {
+#define ML_EXTERN_C_END }
+#else
+#define ML_EXTERN_C_BEGIN
+#define ML_EXTERN_C_END
+#endif
+
+#define ML_API
+#define ML_CALL
+#define ML_STATIC_INLINE static inline
+
+typedef int32_t MLResult;
+
+enum {
+  MLResult_Ok = 0,
+  MLResult_InvalidParam,
+  MLResult_Timeout,
+  MLResult_UnspecifiedFailure,
+  MLResult_PermissionDenied,
+  MLResult_IllegalState,
+  MLResult_AllocFailed,
+};
+
+typedef uint64_t MLHandle;
+
+#define ML_INVALID_HANDLE 0xFFFFFFFFFFFFFFFF
+
+ML_STATIC_INLINE bool MLHandleIsValid(MLHandle handle) {
+  return handle != ML_INVALID_HANDLE;
+}
@@ -0,0 +1,37 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+// Minimal stand-in for the SDK's ml_types.h, see ml_api.h.
+
+#include "ml_api.h"
+
+typedef int64_t MLTime;
+
+typedef struct MLVec2f {
+  float x, y;
+} MLVec2f;
+
+typedef struct MLVec3f {
+  float x, y, z;
+} MLVec3f;
+
+typedef struct MLQuaternionf {
+  float x, y, z, w;
+} MLQuaternionf;
+
+typedef struct MLTransform {
+  MLQuaternionf rotation;
+  MLVec3f position;
+} MLTransform;
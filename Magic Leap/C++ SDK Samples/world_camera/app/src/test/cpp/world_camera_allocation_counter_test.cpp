@@ -0,0 +1,175 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "world_camera_allocation_counter.h"
+#include "world_camera_test.h"
+
+/*
+  Allocation counter: every form of operator new, aligned ones included, is counted
+  on the calling thread only, and a failing allocation calls the new handler, then
+  throws std::bad_alloc or, for the nothrow forms, returns nullptr, like the library
+  operators.
+*/
+
+namespace {
+
+  // More than malloc can ever return, so every allocation of it fails
+  volatile std::size_t huge_size = static_cast<std::size_t>(-1) / 2;
+
+  // Allocations stored here escape, so the compiler cannot elide them
+  void *volatile sink = nullptr;
+
+  template <typename T>
+  T *Keep(T *pointer) {
+    sink = pointer;
+    return pointer;
+  }
+
+  // Over-aligned, so new and delete of it take the std::align_val_t forms
+  struct alignas(64) Line {
+    unsigned char bytes[64];
+  };
+
+  constexpr std::align_val_t kLineAlignment = std::align_val_t(alignof(Line));
+
+  bool IsAligned(const void *pointer) {
+    return reinterpret_cast<std::uintptr_t>(pointer) % alignof(Line) == 0;
+  }
+
+  int handler_calls = 0;
+
+  void GiveUpHandler() {
+    ++handler_calls;
+    std::set_new_handler(nullptr);
+  }
+
+  struct HandlerError {};
+
+  void ThrowingHandler() {
+    ++handler_calls;
+    throw HandlerError();
+  }
+
+  void TestCounting() {
+    CHECK(WorldCameraCountsAllocations());
+    uint64_t before = WorldCameraAllocationCount();
+    int *single = Keep(new int(1));
+    int *array = Keep(new int[4]);
+    int *nothrow_single = Keep(new (std::nothrow) int(2));
+    int *nothrow_array = Keep(new (std::nothrow) int[4]);
+    CHECK(WorldCameraAllocationCount() - before == 4);
+    before = WorldCameraAllocationCount();
+    delete single;
+    delete[] array;
+    operator delete(nothrow_single, std::nothrow);
+    operator delete[](nothrow_array, std::nothrow);
+    CHECK(WorldCameraAllocationCount() == before);
+
+    Line *line = Keep(new Line());
+    Line *lines = Keep(new Line[3]);
+    Line *nothrow_line = Keep(new (std::nothrow) Line());
+    Line *nothrow_lines = Keep(new (std::nothrow) Line[3]);
+    CHECK(WorldCameraAllocationCount() - before == 4);
+    CHECK(IsAligned(line) && IsAligned(lines) && IsAligned(nothrow_line) && IsAligned(nothrow_lines));
+    before = WorldCameraAllocationCount();
+    delete line;
+    delete[] lines;
+    operator delete(nothrow_line, kLineAlignment, std::nothrow);
+    operator delete[](nothrow_lines, kLineAlignment, std::nothrow);
+    CHECK(WorldCameraAllocationCount() == before);
+
+    std::vector<int> values;
+    values.reserve(16);
+    CHECK(WorldCameraAllocationCount() - before == 1);
+    values.assign(16, 3);
+    CHECK(WorldCameraAllocationCount() - before == 1);
+  }
+
+  void TestPerThread() {
+    uint64_t other_count = 0;
+    std::thread thread([&other_count] {
+      const uint64_t before = WorldCameraAllocationCount();
+      for (int i = 0; i < 100; ++i) {
+        delete Keep(new int(i));
+      }
+      other_count = WorldCameraAllocationCount() - before;
+    });
+    // Starting the thread allocates here, joining does not
+    const uint64_t before = WorldCameraAllocationCount();
+    thread.join();
+    CHECK(other_count == 100);
+    CHECK(WorldCameraAllocationCount() == before);
+  }
+
+  void TestFailure() {
+    std::set_new_handler(nullptr);
+    bool thrown = false;
+    try {
+      operator delete(operator new(huge_size));
+    } catch (const std::bad_alloc &) {
+      thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(operator new(huge_size, std::nothrow) == nullptr);
+    CHECK(operator new[](huge_size, std::nothrow) == nullptr);
+    thrown = false;
+    try {
+      operator delete(operator new(huge_size, kLineAlignment), kLineAlignment);
+    } catch (const std::bad_alloc &) {
+      thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(operator new(huge_size, kLineAlignment, std::nothrow) == nullptr);
+    CHECK(operator new[](huge_size, kLineAlignment, std::nothrow) == nullptr);
+
+    // The handler is called until it gives up by removing itself
+    handler_calls = 0;
+    std::set_new_handler(GiveUpHandler);
+    thrown = false;
+    try {
+      operator delete[](operator new[](huge_size));
+    } catch (const std::bad_alloc &) {
+      thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(handler_calls == 1);
+
+    // Exceptions of the handler propagate, except from the nothrow forms
+    handler_calls = 0;
+    std::set_new_handler(ThrowingHandler);
+    thrown = false;
+    try {
+      operator delete(operator new(huge_size));
+    } catch (const HandlerError &) {
+      thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(operator new(huge_size, std::nothrow) == nullptr);
+    CHECK(operator new(huge_size, kLineAlignment, std::nothrow) == nullptr);
+    CHECK(handler_calls == 3);
+    std::set_new_handler(nullptr);
+  }
+}
+
+int main() {
+  TestCounting();
+  TestPerThread();
+  TestFailure();
+  return 0;
+}
@@ -0,0 +1,259 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "world_camera_allocation_counter.h"
+#include "world_camera_bundler.h"
+#include "world_camera_test.h"
+
+/*
+  Bundling: frames within the tolerance form complete bundles in camera order, a
+  camera that stops delivering yields partial bundles after max_wait, a camera
+  running ahead overwrites its ring while the others are skewed behind, and the
+  statistics count every outcome. Submitting does not allocate once warmed up,
+  whether pixels are copied or not.
+*/
+
+namespace {
+
+  constexpr MLTime kInterval = 33'333'333;
+  constexpr uint32_t kWidth = 32;
+  constexpr uint32_t kHeight = 24;
+
+  const MLWorldCameraIdentifier kCameras[kWorldCameraCount] = {
+          MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right, MLWorldCameraIdentifier_Center};
+
+  // Pixels of one frame per camera, refilled on every submit
+  struct Source {
+    std::array<std::vector<uint8_t>, kWorldCameraCount> pixels;
+
+    Source() {
+      for (auto &camera_pixels : pixels) {
+        camera_pixels.resize(kWidth * kHeight);
+      }
+    }
+
+    MLWorldCameraFrame Frame(MLWorldCameraIdentifier camera, int64_t frame_number, MLTime timestamp) {
+      std::vector<uint8_t> &camera_pixels = pixels[WorldCameraIndex(camera)];
+      camera_pixels.assign(camera_pixels.size(), SyntheticPixel(camera, frame_number));
+      MLWorldCameraFrame frame = {};
+      frame.id = camera;
+      frame.frame_number = frame_number;
+      frame.timestamp = timestamp;
+      frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+      frame.frame_buffer.width = kWidth;
+      frame.frame_buffer.height = kHeight;
+      frame.frame_buffer.stride = kWidth;
+      frame.frame_buffer.bytes_per_pixel = 1;
+      frame.frame_buffer.size = kWidth * kHeight;
+      frame.frame_buffer.data = camera_pixels.data();
+      return frame;
+    }
+  };
+
+  WorldCameraBundler::Settings Settings(bool copy_pixels) {
+    WorldCameraBundler::Settings settings;
+    settings.copy_pixels = copy_pixels;
+    settings.max_frame_size = kWidth * kHeight;
+    return settings;
+  }
+
+  // Frame n of every camera lies within 1.5 ms of n * kInterval
+  MLTime Timestamp(size_t camera_index, int64_t frame_number) {
+    return frame_number * kInterval + static_cast<MLTime>(camera_index) * 750'000;
+  }
+
+  void TestCompleteBundles() {
+    WorldCameraBundler bundler(Settings(true));
+    Source source;
+    size_t bundles = 0;
+    for (int64_t n = 0; n < 20; ++n) {
+      // Submitted in reverse camera order; bundles list frames left to right regardless
+      for (size_t i = kWorldCameraCount; i-- > 0;) {
+        CHECK(bundler.Submit(source.Frame(kCameras[i], n, Timestamp(i, n)), [&](const WorldCameraBundler::Bundle &bundle) {
+          CHECK(bundle.frame_count == kWorldCameraCount);
+          CHECK(bundle.cameras == MLWorldCameraIdentifier_All);
+          CHECK(bundle.timestamp == Timestamp(0, n));
+          CHECK(bundle.skew == 1'500'000);
+          for (size_t j = 0; j < kWorldCameraCount; ++j) {
+            const MLWorldCameraFrame &frame = bundle.frames[j];
+            CHECK(frame.id == kCameras[j] && frame.frame_number == n);
+            // Copies survive the source buffers being refilled
+            CHECK(frame.frame_buffer.data != source.pixels[j].data());
+            CHECK(IsUniform(frame.frame_buffer, SyntheticPixel(frame.id, n)));
+          }
+          ++bundles;
+        }));
+      }
+    }
+    CHECK(bundles == 20);
+    const WorldCameraBundler::Statistics &statistics = bundler.GetStatistics();
+    CHECK(statistics.frames_submitted == 60);
+    CHECK(statistics.bundles_complete == 20 && statistics.bundles_partial == 0);
+    CHECK(statistics.frames_rejected == 0 && statistics.frames_overwritten == 0 && statistics.frames_unmatched == 0);
+    CHECK(statistics.last_skew == 1'500'000 && statistics.max_skew == 1'500'000);
+    CHECK(statistics.total_skew == 20 * 1'500'000);
+    for (MLWorldCameraIdentifier camera : kCameras) {
+      CHECK(bundler.QueuedFrames(camera) == 0);
+    }
+  }
+
+  void TestPartialBundles() {
+    WorldCameraBundler::Settings settings = Settings(false);
+    settings.max_wait = 3 * kInterval;
+    WorldCameraBundler bundler(settings);
+    Source source;
+    std::vector<int64_t> partial;
+    // The center camera stops after frame 4
+    for (int64_t n = 0; n < 12; ++n) {
+      for (size_t i = 0; i < kWorldCameraCount; ++i) {
+        if (kCameras[i] == MLWorldCameraIdentifier_Center && n > 4) {
+          continue;
+        }
+        bundler.Submit(source.Frame(kCameras[i], n, Timestamp(i, n)), [&](const WorldCameraBundler::Bundle &bundle) {
+          if (bundle.frame_count == kWorldCameraCount) {
+            CHECK(bundle.frames[0].frame_number <= 4);
+            return;
+          }
+          CHECK(bundle.frame_count == 2);
+          CHECK(bundle.cameras == (MLWorldCameraIdentifier_Left | MLWorldCameraIdentifier_Right));
+          // Partial bundles point at the caller's buffers
+          CHECK(bundle.frames[0].frame_buffer.data == source.pixels[0].data());
+          partial.push_back(bundle.frames[0].frame_number);
+        });
+      }
+    }
+    // Frame 5 waits until a frame more than max_wait newer arrives, which is frame 8 of
+    // the right camera; every later frame releases the next one
+    const WorldCameraBundler::Statistics &statistics = bundler.GetStatistics();
+    CHECK(statistics.bundles_complete == 5);
+    CHECK(partial.size() == 4);
+    for (size_t k = 0; k < partial.size(); ++k) {
+      CHECK(partial[k] == static_cast<int64_t>(5 + k));
+    }
+    CHECK(statistics.bundles_partial == partial.size());
+    CHECK(bundler.QueuedFrames(MLWorldCameraIdentifier_Left) == 3);
+
+    // Resetting drops the waiting frames
+    bundler.Reset();
+    CHECK(bundler.QueuedFrames(MLWorldCameraIdentifier_Left) == 0);
+  }
+
+  void TestOverwriteUnderSkew() {
+    WorldCameraBundler::Settings settings = Settings(true);
+    settings.ring_depth = 4;
+    settings.max_wait = 30 * kInterval;
+    WorldCameraBundler bundler(settings);
+    Source source;
+    size_t bundles = 0;
+    auto on_bundle = [&](const WorldCameraBundler::Bundle &bundle) {
+      CHECK(bundle.frame_count == kWorldCameraCount);
+      for (size_t j = 0; j < kWorldCameraCount; ++j) {
+        CHECK(bundle.frames[j].frame_number == bundle.frames[0].frame_number);
+        CHECK(IsUniform(bundle.frames[j].frame_buffer, SyntheticPixel(kCameras[j], bundle.frames[0].frame_number)));
+      }
+      ++bundles;
+    };
+    // The left camera runs 10 frames ahead and overwrites its oldest 6
+    for (int64_t n = 0; n < 10; ++n) {
+      CHECK(bundler.Submit(source.Frame(MLWorldCameraIdentifier_Left, n, Timestamp(0, n)), on_bundle));
+    }
+    CHECK(bundler.QueuedFrames(MLWorldCameraIdentifier_Left) == settings.ring_depth);
+    CHECK(bundler.GetStatistics().frames_overwritten == 6);
+    // The lagging frames of the other cameras have no partner left and are discarded
+    for (int64_t n = 0; n < 10; ++n) {
+      for (size_t i = 1; i < kWorldCameraCount; ++i) {
+        CHECK(bundler.Submit(source.Frame(kCameras[i], n, Timestamp(i, n)), on_bundle));
+      }
+    }
+    const WorldCameraBundler::Statistics &statistics = bundler.GetStatistics();
+    CHECK(bundles == 4);
+    CHECK(statistics.bundles_complete == 4);
+    CHECK(statistics.frames_unmatched == 2 * 6);
+    CHECK(statistics.frames_overwritten == 6);
+    CHECK(statistics.frames_submitted == 30);
+  }
+
+  void TestRejected() {
+    WorldCameraBundler::Settings settings = Settings(true);
+    settings.cameras = MLWorldCameraIdentifier_Left | MLWorldCameraIdentifier_Right;
+    WorldCameraBundler bundler(settings);
+    Source source;
+    auto on_bundle = [](const WorldCameraBundler::Bundle &) {};
+    CHECK(!bundler.Submit(source.Frame(MLWorldCameraIdentifier_Center, 0, 0), on_bundle));
+    MLWorldCameraFrame low = source.Frame(MLWorldCameraIdentifier_Left, 0, 0);
+    low.frame_type = MLWorldCameraFrameType_LowExposure;
+    CHECK(!bundler.Submit(low, on_bundle));
+    MLWorldCameraFrame large = source.Frame(MLWorldCameraIdentifier_Left, 0, 0);
+    large.frame_buffer.size = kWidth * kHeight + 1;
+    CHECK(!bundler.Submit(large, on_bundle));
+    CHECK(bundler.Submit(source.Frame(MLWorldCameraIdentifier_Left, 0, 0), on_bundle));
+    const WorldCameraBundler::Statistics &statistics = bundler.GetStatistics();
+    CHECK(statistics.frames_submitted == 4 && statistics.frames_rejected == 3);
+
+    // Changing the cameras discards queued frames
+    bundler.SetCameras(MLWorldCameraIdentifier_All);
+    CHECK(bundler.QueuedFrames(MLWorldCameraIdentifier_Left) == 0);
+    CHECK(bundler.Submit(source.Frame(MLWorldCameraIdentifier_Center, 1, kInterval), on_bundle));
+  }
+
+  void TestSteadyStateAllocation(bool copy_pixels) {
+    WorldCameraBundler::Settings settings = Settings(copy_pixels);
+    settings.max_wait = 2 * kInterval;
+    WorldCameraBundler bundler(settings);
+    Source source;
+    size_t bundles = 0;
+    auto on_bundle = [&bundles](const WorldCameraBundler::Bundle &) { ++bundles; };
+    // Complete bundles, then partial ones while the center camera pauses
+    auto submit = [&](int64_t n) {
+      for (size_t i = 0; i < kWorldCameraCount; ++i) {
+        if (kCameras[i] != MLWorldCameraIdentifier_Center || n % 20 < 10) {
+          bundler.Submit(source.Frame(kCameras[i], n, Timestamp(i, n)), on_bundle);
+        }
+      }
+    };
+    int64_t n = 0;
+    for (; n < 40; ++n) {
+      submit(n);
+    }
+
+    const uint64_t before = WorldCameraAllocationCount();
+    for (; n < 1040; ++n) {
+      submit(n);
+    }
+    const uint64_t allocations = WorldCameraAllocationCount() - before;
+    if (allocations != 0) {
+      std::fprintf(stderr, "copy_pixels %d: %lu allocations\n", copy_pixels, static_cast<unsigned long>(allocations));
+    }
+    CHECK(allocations == 0);
+    const WorldCameraBundler::Statistics &statistics = bundler.GetStatistics();
+    CHECK(statistics.bundles_complete > 0 && statistics.bundles_partial > 0);
+    CHECK(bundles == statistics.bundles_complete + statistics.bundles_partial);
+  }
+}
+
+int main() {
+  CHECK(WorldCameraCountsAllocations());
+  TestCompleteBundles();
+  TestPartialBundles();
+  TestOverwriteUnderSkew();
+  TestRejected();
+  TestSteadyStateAllocation(true);
+  TestSteadyStateAllocation(false);
+  return 0;
+}
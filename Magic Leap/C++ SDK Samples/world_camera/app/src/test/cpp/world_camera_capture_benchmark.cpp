@@ -0,0 +1,90 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "world_camera_capture.h"
+#include "world_camera_test.h"
+
+/*
+  Measures the throughput of WorldCameraCaptureWriter appending 1016x1016 frames of
+  every camera in both modes, with planes that fill their pages exactly and with
+  planes that need padding, and the time Close takes to sort and write the index.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  const char *kCapturePath = "world_camera_capture_benchmark.wcap";
+  constexpr uint32_t kSize = 1016;
+  constexpr size_t kFramesPerStream = 150;
+
+  const MLWorldCameraIdentifier kCameras[kWorldCameraCount] = {
+          MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right, MLWorldCameraIdentifier_Center};
+  const MLWorldCameraFrameType kFrameTypes[] = {MLWorldCameraFrameType_LowExposure,
+                                                MLWorldCameraFrameType_NormalExposure};
+
+  void Run(const char *name, uint32_t width, uint32_t height) {
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height, 0x5A);
+    MLWorldCameraFrame frame = {};
+    frame.frame_buffer.width = width;
+    frame.frame_buffer.height = height;
+    frame.frame_buffer.stride = width;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = static_cast<uint32_t>(pixels.size());
+    frame.frame_buffer.data = pixels.data();
+
+    WorldCameraCaptureWriter writer;
+    CHECK(writer.Open(kCapturePath, kFramesPerStream * kWorldCameraStreamCount));
+    std::vector<double> append_us;
+    append_us.reserve(kFramesPerStream * kWorldCameraStreamCount);
+    const Clock::time_point start = Clock::now();
+    for (size_t k = 0; k < kFramesPerStream; ++k) {
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        for (MLWorldCameraIdentifier camera : kCameras) {
+          frame.id = camera;
+          frame.frame_type = frame_type;
+          frame.frame_number = static_cast<int64_t>(k);
+          frame.timestamp = static_cast<MLTime>(k) * 33'333'333;
+          const Clock::time_point before = Clock::now();
+          CHECK(writer.Append(frame));
+          append_us.push_back(std::chrono::duration<double, std::micro>(Clock::now() - before).count());
+        }
+      }
+    }
+    const Clock::time_point appended = Clock::now();
+    const uint64_t bytes = writer.BytesWritten();
+    CHECK(writer.Close());
+    const Clock::time_point closed = Clock::now();
+
+    std::sort(append_us.begin(), append_us.end());
+    const double seconds = std::chrono::duration<double>(appended - start).count();
+    std::printf("%-16s %4ux%-4u  %7.1f MB/s  %7.0f frames/s  append p50 %6.1f us  p99 %7.1f us  close %6.2f ms\n",
+                name, width, height, bytes / seconds / 1e6, append_us.size() / seconds,
+                append_us[append_us.size() / 2], append_us[append_us.size() * 99 / 100],
+                std::chrono::duration<double, std::milli>(closed - appended).count());
+  }
+}
+
+int main() {
+  Run("padded planes", kSize, kSize);
+  Run("page multiples", 1024, 1024);
+  std::remove(kCapturePath);
+  return 0;
+}
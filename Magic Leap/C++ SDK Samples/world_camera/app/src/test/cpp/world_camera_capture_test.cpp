@@ -0,0 +1,151 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "world_camera_capture.h"
+#include "world_camera_test.h"
+
+/*
+  Capture container: Range finds the frames of every camera and frame type, Seek
+  the first frame at or after a timestamp, and Open rejects captures whose index
+  entries describe planes smaller than their rows or outside the frame data.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_capture_test.wcap";
+
+  const MLWorldCameraIdentifier kCameras[kWorldCameraCount] = {
+          MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right, MLWorldCameraIdentifier_Center};
+  const MLWorldCameraFrameType kFrameTypes[] = {MLWorldCameraFrameType_LowExposure,
+                                                MLWorldCameraFrameType_NormalExposure};
+
+  void TestRangeAndSeek() {
+    SyntheticCapture capture;
+    capture.cameras = MLWorldCameraIdentifier_Left | MLWorldCameraIdentifier_Center;
+    capture.jitter = 2'000'000;
+    const std::vector<MLWorldCameraFrame> written = WriteSyntheticCapture(kCapturePath, capture);
+    WorldCameraCaptureReader reader;
+    CHECK(reader.Open(kCapturePath));
+    CHECK(reader.FrameCount() == written.size());
+
+    size_t covered = 0;
+    for (MLWorldCameraIdentifier camera : kCameras) {
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        const auto range = reader.Range(camera, frame_type);
+        CHECK(range.first <= range.second && range.second <= reader.FrameCount());
+        if ((capture.cameras & camera) == 0) {
+          CHECK(range.first == range.second);
+          CHECK(reader.Seek(camera, frame_type, capture.first_timestamp) == range.second);
+          continue;
+        }
+        CHECK(range.second - range.first == capture.frames_per_stream);
+        covered += range.second - range.first;
+        for (size_t i = range.first; i < range.second; ++i) {
+          const MLWorldCameraFrame frame = reader.Frame(i);
+          CHECK(frame.id == camera && frame.frame_type == frame_type);
+          CHECK(i == range.first || reader.Frame(i - 1).timestamp < frame.timestamp);
+          CHECK(IsUniform(frame.frame_buffer, SyntheticPixel(camera, frame.frame_number)));
+
+          // Exact timestamps find their frame, timestamps just after it the next one
+          CHECK(reader.Seek(camera, frame_type, frame.timestamp) == i);
+          CHECK(reader.Seek(camera, frame_type, frame.timestamp + 1) == i + 1);
+          CHECK(reader.Seek(camera, frame_type, frame.timestamp - 1) == i);
+        }
+        CHECK(reader.Seek(camera, frame_type, INT64_MIN) == range.first);
+        CHECK(reader.Seek(camera, frame_type, reader.Frame(range.second - 1).timestamp + 1) == range.second);
+        CHECK(reader.Seek(camera, frame_type, INT64_MAX) == range.second);
+      }
+    }
+    CHECK(covered == reader.FrameCount());
+    reader.Close();
+    CHECK(!reader.IsOpen());
+  }
+
+  // Writes one frame of width x height with the given stride and plane size
+  void WriteFrame(uint32_t width, uint32_t height, uint32_t stride, uint32_t size) {
+    std::vector<uint8_t> pixels(size, 7);
+    MLWorldCameraFrame frame = {};
+    frame.id = MLWorldCameraIdentifier_Left;
+    frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+    frame.frame_buffer.width = width;
+    frame.frame_buffer.height = height;
+    frame.frame_buffer.stride = stride;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = size;
+    frame.frame_buffer.data = pixels.data();
+    WorldCameraCaptureWriter writer;
+    CHECK(writer.Open(kCapturePath, 1));
+    CHECK(writer.Append(frame));
+    CHECK(writer.Close());
+  }
+
+  bool Opens() {
+    WorldCameraCaptureReader reader;
+    return reader.Open(kCapturePath);
+  }
+
+  void TestPlaneSizeValidation() {
+    // The last row of a plane needs no padding
+    WriteFrame(64, 48, 80, 80 * 47 + 64);
+    CHECK(Opens());
+    WriteFrame(64, 48, 64, 64 * 48);
+    CHECK(Opens());
+    // One byte short of the last row
+    WriteFrame(64, 48, 80, 80 * 47 + 63);
+    CHECK(!Opens());
+    // A stride narrower than the row
+    WriteFrame(64, 48, 60, 64 * 48);
+    CHECK(!Opens());
+    // Sizes whose row count would overflow 32 bits
+    WriteFrame(64, 0x10000, 0x10000, 4096);
+    CHECK(!Opens());
+    // Empty frames describe no rows
+    WriteFrame(0, 0, 0, 1);
+    CHECK(Opens());
+
+    // A plane reaching into the index is rejected as well
+    std::vector<uint8_t> file;
+    WriteFrame(64, 48, 64, 64 * 48);
+    std::FILE *stream = std::fopen(kCapturePath, "rb");
+    CHECK(stream);
+    CHECK(std::fseek(stream, 0, SEEK_END) == 0);
+    file.resize(static_cast<size_t>(std::ftell(stream)));
+    std::rewind(stream);
+    CHECK(std::fread(file.data(), 1, file.size(), stream) == file.size());
+    std::fclose(stream);
+    WorldCameraCaptureTrailer trailer;
+    std::memcpy(&trailer, file.data() + file.size() - sizeof(trailer), sizeof(trailer));
+    WorldCameraCaptureIndexEntry entry;
+    std::memcpy(&entry, file.data() + trailer.index_offset, sizeof(entry));
+    entry.data_offset = trailer.index_offset - entry.size + 1;
+    std::memcpy(file.data() + trailer.index_offset, &entry, sizeof(entry));
+    stream = std::fopen(kCapturePath, "wb");
+    CHECK(stream);
+    CHECK(std::fwrite(file.data(), 1, file.size(), stream) == file.size());
+    std::fclose(stream);
+    CHECK(!Opens());
+  }
+}
+
+int main() {
+  TestRangeAndSeek();
+  TestPlaneSizeValidation();
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,120 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Measures the bytes moved per frame with each output setting of the replay on
+  1016x1016 frames: the bytes read from the capture and written by downscaling, and
+  the bytes a consumer reading every delivered pixel touches, with the frames per
+  second of polling and summing every delivered frame on one thread.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  const char *kCapturePath = "world_camera_downscale_benchmark.wcap";
+  constexpr uint32_t kSize = 1016;
+  constexpr auto kDuration = std::chrono::milliseconds(500);
+
+  struct Config {
+    const char *name;
+    WorldCameraRegion roi;
+    uint32_t downscale;
+  };
+
+  uint64_t Sum(const MLWorldCameraFrameBuffer &buffer) {
+    uint64_t sum = 0;
+    for (uint32_t y = 0; y < buffer.height; ++y) {
+      const uint8_t *row = buffer.data + static_cast<size_t>(y) * buffer.stride;
+      for (uint32_t x = 0; x < buffer.width; ++x) {
+        sum += row[x];
+      }
+    }
+    return sum;
+  }
+
+  void Run(const Config &config) {
+    WorldCameraReplay replay;
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) ==
+          MLResult_Ok);
+    WorldCameraReplay::OutputSettings output;
+    output.roi.fill(config.roi);
+    output.downscale.fill(config.downscale);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+
+    size_t frames = 0;
+    uint64_t read_bytes = 0;
+    uint64_t written_bytes = 0;
+    uint64_t delivered_bytes = 0;
+    uint64_t checksum = 0;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + kDuration;
+    Clock::time_point now = start;
+    for (; now < end; now = Clock::now()) {
+      MLWorldCameraData *data = nullptr;
+      CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+      for (uint32_t i = 0; i < data->frame_count; ++i) {
+        const MLWorldCameraFrameBuffer &buffer = data->frames[i].frame_buffer;
+        const uint64_t delivered = static_cast<uint64_t>(buffer.width) * buffer.height;
+        // Downscaling reads every source pixel of the region once and writes the output;
+        // full resolution regions are views into the capture
+        if (config.downscale > 1) {
+          read_bytes += delivered * config.downscale * config.downscale;
+          written_bytes += delivered;
+        }
+        delivered_bytes += delivered;
+        checksum += Sum(buffer);
+      }
+      frames += data->frame_count;
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    CHECK(frames > 0);
+    const double seconds = std::chrono::duration<double>(now - start).count();
+    std::printf("%-22s  %8.0f read  %8.0f written  %8.0f delivered bytes/frame  %8.0f frames/s  (%llu)\n",
+                config.name, static_cast<double>(read_bytes) / frames, static_cast<double>(written_bytes) / frames,
+                static_cast<double>(delivered_bytes) / frames, frames / seconds,
+                static_cast<unsigned long long>(checksum % 1000));
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.width = kSize;
+  capture.height = kSize;
+  WriteSyntheticCapture(kCapturePath, capture);
+  const Config configs[] = {
+          {"full frame", WorldCameraRegion{}, 1},
+          {"center half roi", WorldCameraRegion{kSize / 4, kSize / 4, kSize / 2, kSize / 2}, 1},
+          {"downscale 2", WorldCameraRegion{}, 2},
+          {"downscale 4", WorldCameraRegion{}, 4},
+          {"half roi, downscale 2", WorldCameraRegion{kSize / 4, kSize / 4, kSize / 2, kSize / 2}, 2},
+  };
+  for (const Config &config : configs) {
+    Run(config);
+  }
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,267 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "world_camera_downscale.h"
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Region of interest and downscaling: regions are clipped to the frame, downscaling
+  matches a scalar block average for every width tail and stride, the intrinsics
+  follow the delivered pixel grid, and the replay applies the output settings per
+  camera while device settings stay at version 1.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_downscale_test.wcap";
+
+  MLWorldCameraFrame Frame(std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, uint32_t stride) {
+    pixels.resize(static_cast<size_t>(stride) * height);
+    MLWorldCameraFrame frame = {};
+    frame.id = MLWorldCameraIdentifier_Left;
+    frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+    frame.intrinsics.width = width;
+    frame.intrinsics.height = height;
+    frame.intrinsics.focal_length = {200.0f, 210.0f};
+    frame.intrinsics.principal_point = {width / 2.0f + 1.25f, height / 2.0f - 0.75f};
+    frame.frame_buffer.width = width;
+    frame.frame_buffer.height = height;
+    frame.frame_buffer.stride = stride;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = static_cast<uint32_t>(pixels.size());
+    frame.frame_buffer.data = pixels.data();
+    return frame;
+  }
+
+  bool IsNear(float a, float b) {
+    return std::fabs(a - b) < 1e-4f;
+  }
+
+  void TestClip() {
+    WorldCameraRegion full = ClipWorldCameraRegion(WorldCameraRegion{}, 64, 48);
+    CHECK(full.x == 0 && full.y == 0 && full.width == 64 && full.height == 48);
+    full = ClipWorldCameraRegion(WorldCameraRegion{10, 10, 0, 5}, 64, 48);
+    CHECK(full.x == 0 && full.y == 0 && full.width == 64 && full.height == 48);
+
+    WorldCameraRegion inside = ClipWorldCameraRegion(WorldCameraRegion{8, 4, 16, 12}, 64, 48);
+    CHECK(inside.x == 8 && inside.y == 4 && inside.width == 16 && inside.height == 12);
+
+    // Regions reaching beyond the frame are cut at its edges
+    WorldCameraRegion beyond = ClipWorldCameraRegion(WorldCameraRegion{50, 40, 30, 30}, 64, 48);
+    CHECK(beyond.x == 50 && beyond.y == 40 && beyond.width == 14 && beyond.height == 8);
+
+    // Regions starting outside the frame are empty
+    WorldCameraRegion outside = ClipWorldCameraRegion(WorldCameraRegion{70, 10, 8, 8}, 64, 48);
+    CHECK(outside.x == 64 && outside.width == 0);
+    outside = ClipWorldCameraRegion(WorldCameraRegion{10, 48, 8, 8}, 64, 48);
+    CHECK(outside.y == 48 && outside.height == 0);
+  }
+
+  void TestCrop() {
+    std::vector<uint8_t> pixels;
+    const MLWorldCameraFrame frame = Frame(pixels, 64, 48, 80);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      pixels[i] = static_cast<uint8_t>(i * 13);
+    }
+    const MLWorldCameraFrame cropped = CropWorldCameraFrame(frame, WorldCameraRegion{10, 6, 100, 20});
+    const MLWorldCameraFrameBuffer &buffer = cropped.frame_buffer;
+    // A view into the frame: the stride is kept and nothing is copied
+    CHECK(buffer.data == pixels.data() + 6 * 80 + 10);
+    CHECK(buffer.width == 54 && buffer.height == 20 && buffer.stride == 80);
+    CHECK(buffer.size == 80 * 19 + 54);
+    CHECK(cropped.intrinsics.width == 54 && cropped.intrinsics.height == 20);
+    // The principal point moves with the origin, the focal length is unchanged
+    CHECK(IsNear(cropped.intrinsics.principal_point.x, frame.intrinsics.principal_point.x - 10.0f));
+    CHECK(IsNear(cropped.intrinsics.principal_point.y, frame.intrinsics.principal_point.y - 6.0f));
+    CHECK(IsNear(cropped.intrinsics.focal_length.x, frame.intrinsics.focal_length.x));
+    CHECK(IsNear(cropped.intrinsics.focal_length.y, frame.intrinsics.focal_length.y));
+  }
+
+  uint8_t BlockAverage(const MLWorldCameraFrameBuffer &buffer, uint32_t factor, uint32_t x, uint32_t y) {
+    uint32_t sum = 0;
+    for (uint32_t row = 0; row < factor; ++row) {
+      for (uint32_t column = 0; column < factor; ++column) {
+        sum += buffer.data[static_cast<size_t>(y * factor + row) * buffer.stride + x * factor + column];
+      }
+    }
+    return static_cast<uint8_t>((sum + factor * factor / 2) / (factor * factor));
+  }
+
+  void TestDownscale() {
+    std::mt19937 random(3);
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> dst;
+    for (uint32_t factor : {1u, 2u, 4u}) {
+      // Widths around the vector widths of 16 and 8 output pixels exercise the scalar tails
+      for (uint32_t width = factor; width <= 80 * factor; width += factor + width % 3) {
+        for (uint32_t height : {factor, 3 * factor + 1, 9 * factor + 3}) {
+          const MLWorldCameraFrame frame = Frame(pixels, width, height, width + 7);
+          for (uint8_t &pixel : pixels) {
+            pixel = static_cast<uint8_t>(random());
+          }
+          dst.assign(WorldCameraDownscaledSize(frame, factor) + 1, 0xAA);
+          const MLWorldCameraFrame downscaled = DownscaleWorldCameraFrame(frame, factor, dst.data());
+          const MLWorldCameraFrameBuffer &buffer = downscaled.frame_buffer;
+          CHECK(buffer.data == dst.data());
+          CHECK(buffer.width == width / factor && buffer.height == height / factor);
+          CHECK(buffer.stride == buffer.width && buffer.size == buffer.width * buffer.height);
+          CHECK(dst.size() == buffer.size + 1);
+          for (uint32_t y = 0; y < buffer.height; ++y) {
+            for (uint32_t x = 0; x < buffer.width; ++x) {
+              CHECK(dst[y * buffer.stride + x] == BlockAverage(frame.frame_buffer, factor, x, y));
+            }
+          }
+          // Nothing is written past the downscaled size
+          CHECK(dst.back() == 0xAA);
+        }
+      }
+    }
+    // Saturated blocks do not overflow the sums
+    for (uint8_t value : {uint8_t(0), uint8_t(255)}) {
+      const MLWorldCameraFrame frame = Frame(pixels, 256, 8, 256);
+      pixels.assign(pixels.size(), value);
+      for (uint32_t factor : {2u, 4u}) {
+        dst.resize(WorldCameraDownscaledSize(frame, factor));
+        DownscaleWorldCameraFrame(frame, factor, dst.data());
+        for (uint8_t pixel : dst) {
+          CHECK(pixel == value);
+        }
+      }
+    }
+  }
+
+  void TestIntrinsics() {
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> dst;
+    const MLWorldCameraFrame frame = Frame(pixels, 99, 50, 99);
+    for (uint32_t factor : {1u, 2u, 4u}) {
+      dst.resize(WorldCameraDownscaledSize(frame, factor));
+      const MLWorldCameraIntrinsics &intrinsics = DownscaleWorldCameraFrame(frame, factor, dst.data()).intrinsics;
+      CHECK(intrinsics.width == 99 / factor && intrinsics.height == 50 / factor);
+      CHECK(IsNear(intrinsics.focal_length.x, frame.intrinsics.focal_length.x / factor));
+      CHECK(IsNear(intrinsics.focal_length.y, frame.intrinsics.focal_length.y / factor));
+      // The principal point is the same ray: pixel centers u of the output lie at
+      // (u + 0.5) * factor - 0.5 in the input
+      CHECK(IsNear((intrinsics.principal_point.x + 0.5f) * factor - 0.5f, frame.intrinsics.principal_point.x));
+      CHECK(IsNear((intrinsics.principal_point.y + 0.5f) * factor - 0.5f, frame.intrinsics.principal_point.y));
+    }
+    // Factor 1 leaves the intrinsics alone
+    dst.resize(WorldCameraDownscaledSize(frame, 1));
+    const MLWorldCameraIntrinsics &same = DownscaleWorldCameraFrame(frame, 1, dst.data()).intrinsics;
+    CHECK(same.principal_point.x == frame.intrinsics.principal_point.x);
+    CHECK(same.principal_point.y == frame.intrinsics.principal_point.y);
+
+    // Cropping then downscaling: a 3D point projecting to (u, v) in the frame projects to
+    // the matching position of the delivered image
+    const MLWorldCameraFrame cropped = CropWorldCameraFrame(frame, WorldCameraRegion{17, 9, 64, 32});
+    dst.resize(WorldCameraDownscaledSize(cropped, 4));
+    const MLWorldCameraIntrinsics &both = DownscaleWorldCameraFrame(cropped, 4, dst.data()).intrinsics;
+    const float x = 0.1f;
+    const float y = -0.05f;
+    const float u = frame.intrinsics.focal_length.x * x + frame.intrinsics.principal_point.x;
+    const float v = frame.intrinsics.focal_length.y * y + frame.intrinsics.principal_point.y;
+    CHECK(IsNear(both.focal_length.x * x + both.principal_point.x, (u - 17.0f + 0.5f) / 4.0f - 0.5f));
+    CHECK(IsNear(both.focal_length.y * y + both.principal_point.y, (v - 9.0f + 0.5f) / 4.0f - 0.5f));
+  }
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  const MLWorldCameraFrame *FindFrame(const MLWorldCameraData *data, MLWorldCameraIdentifier camera) {
+    for (uint32_t i = 0; i < data->frame_count; ++i) {
+      if (data->frames[i].id == camera) {
+        return &data->frames[i];
+      }
+    }
+    return nullptr;
+  }
+
+  void TestReplayOutputSettings(const SyntheticCapture &capture) {
+    // Device settings keep the version devices accept
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(settings.version == 1);
+
+    WorldCameraReplay replay;
+    WorldCameraReplay::OutputSettings output;
+    CHECK(replay.SetOutputSettings(&output) == MLResult_InvalidParam);
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) == MLResult_Ok);
+    CHECK(replay.SetOutputSettings(nullptr) == MLResult_InvalidParam);
+    for (uint32_t factor : {0u, 3u, 8u}) {
+      output.downscale[1] = factor;
+      CHECK(replay.SetOutputSettings(&output) == MLResult_InvalidParam);
+    }
+    output.downscale[1] = 1;
+    for (uint32_t depth : {0u, static_cast<uint32_t>(WorldCameraReplay::kMaxQueueDepth + 1)}) {
+      output.queue_depth[2] = depth;
+      CHECK(replay.SetOutputSettings(&output) == MLResult_InvalidParam);
+    }
+    output.queue_depth[2] = 1;
+
+    // Left is cropped, right is cropped and downscaled, center is delivered unchanged
+    output.roi[0] = WorldCameraRegion{8, 4, 32, 16};
+    output.roi[1] = WorldCameraRegion{40, 30, 100, 100};
+    output.downscale[1] = 2;
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+    MLWorldCameraData *data = nullptr;
+    CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+    const MLWorldCameraFrame *left = FindFrame(data, MLWorldCameraIdentifier_Left);
+    const MLWorldCameraFrame *right = FindFrame(data, MLWorldCameraIdentifier_Right);
+    const MLWorldCameraFrame *center = FindFrame(data, MLWorldCameraIdentifier_Center);
+    CHECK(left && right && center);
+    CHECK(left->frame_buffer.width == 32 && left->frame_buffer.height == 16);
+    CHECK(left->frame_buffer.stride == capture.width);
+    CHECK(IsNear(left->intrinsics.principal_point.x, capture.width / 2.0f - 8.0f));
+    CHECK(IsUniform(left->frame_buffer, SyntheticPixel(left->id, left->frame_number)));
+    CHECK(right->frame_buffer.width == (capture.width - 40) / 2 && right->frame_buffer.height == (capture.height - 30) / 2);
+    CHECK(IsNear(right->intrinsics.focal_length.x, 50.0f));
+    CHECK(IsUniform(right->frame_buffer, SyntheticPixel(right->id, right->frame_number)));
+    CHECK(center->frame_buffer.width == capture.width && center->frame_buffer.height == capture.height);
+    CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+
+    // Connect restores full frames
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) == MLResult_Ok);
+    CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+    for (uint32_t i = 0; i < data->frame_count; ++i) {
+      CHECK(data->frames[i].frame_buffer.width == capture.width);
+      CHECK(data->frames[i].frame_buffer.height == capture.height);
+    }
+    CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  WriteSyntheticCapture(kCapturePath, capture);
+  TestClip();
+  TestCrop();
+  TestDownscale();
+  TestIntrinsics();
+  TestReplayOutputSettings(capture);
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,133 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include "world_camera_allocation_counter.h"
+#include "world_camera_label.h"
+#include "world_camera_test.h"
+
+/*
+  Compares the two ways the sample labels its previews every frame: concatenating a
+  std::string from the camera and mode names and std::to_string of the frame number,
+  pushed to the TextComponent every frame, and a WorldCameraLabel that only rewrites
+  the digits and is pushed only when the number changed. The cameras run at half the
+  render rate, so every other frame brings no new frame number. Reports the time and
+  the allocations of the render thread per frame for all 6 streams.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  constexpr size_t kFrames = 200'000;
+  constexpr size_t kStreams = 6;
+
+  const std::array<const char *, 3> kCameraNames = {"Left Camera", "Center Camera", "Right Camera"};
+  const std::array<const char *, 2> kModeNames = {"Low Exposure", "Normal Exposure"};
+
+  // Stand-in for the app framework TextComponent, which keeps its own copy of the text
+  class TextComponent {
+  public:
+    void SetText(const char *text) {
+      text_.assign(text);
+      ++updates_;
+    }
+    size_t size() const { return text_.size(); }
+    size_t updates() const { return updates_; }
+
+  private:
+    std::string text_;
+    size_t updates_ = 0;
+  };
+
+  struct Result {
+    double ns_per_frame = 0.0;
+    double allocations_per_frame = 0.0;
+    double updates_per_frame = 0.0;
+  };
+
+  // Every number has 7 digits, so the TextComponent copies never outgrow the warm up frame
+  int64_t FrameNumber(size_t frame, size_t stream) {
+    return static_cast<int64_t>(frame / 2 + (stream + 1) * 1'000'000);
+  }
+
+  template <typename UpdateFrame>
+  Result Measure(std::array<TextComponent, kStreams> &texts, UpdateFrame update_frame) {
+    // One frame to warm up, so the TextComponent copies have their capacity
+    update_frame(0);
+    const uint64_t allocations = WorldCameraAllocationCount();
+    const Clock::time_point start = Clock::now();
+    for (size_t frame = 1; frame <= kFrames; ++frame) {
+      update_frame(frame);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    Result result;
+    result.ns_per_frame = ns / kFrames;
+    result.allocations_per_frame = static_cast<double>(WorldCameraAllocationCount() - allocations) / kFrames;
+    size_t updates = 0;
+    for (const TextComponent &text : texts) {
+      updates += text.updates();
+    }
+    result.updates_per_frame = static_cast<double>(updates - kStreams) / kFrames;
+    return result;
+  }
+
+  Result RunString() {
+    std::array<TextComponent, kStreams> texts;
+    return Measure(texts, [&texts](size_t frame) {
+      for (size_t stream = 0; stream < kStreams; ++stream) {
+        const std::string label = std::string(kCameraNames[stream / 2]) + "\n" +
+                                  std::string(kModeNames[stream % 2]) +
+                                  "\nFrame Number: " + std::to_string(FrameNumber(frame, stream));
+        texts[stream].SetText(label.c_str());
+      }
+    });
+  }
+
+  Result RunLabel() {
+    std::array<TextComponent, kStreams> texts;
+    std::array<WorldCameraLabel, kStreams> labels;
+    for (size_t stream = 0; stream < kStreams; ++stream) {
+      labels[stream].SetText({kCameraNames[stream / 2], "\n", kModeNames[stream % 2], "\nFrame Number: "});
+    }
+    return Measure(texts, [&texts, &labels](size_t frame) {
+      for (size_t stream = 0; stream < kStreams; ++stream) {
+        if (labels[stream].SetNumber(FrameNumber(frame, stream))) {
+          texts[stream].SetText(labels[stream].c_str());
+        }
+      }
+    });
+  }
+
+  void Print(const char *name, const Result &result) {
+    std::printf("%-18s %8.1f ns/frame  %6.2f allocations/frame  %5.2f text updates/frame\n", name,
+                result.ns_per_frame, result.allocations_per_frame, result.updates_per_frame);
+  }
+}
+
+int main() {
+  CHECK(WorldCameraCountsAllocations());
+  std::printf("%zu frames, %zu streams, a new frame number every other frame\n", kFrames, kStreams);
+  const Result string = RunString();
+  const Result label = RunLabel();
+  Print("std::string", string);
+  Print("WorldCameraLabel", label);
+  CHECK(label.allocations_per_frame == 0.0);
+  std::printf("speedup %.1fx\n", string.ns_per_frame / label.ns_per_frame);
+  return 0;
+}
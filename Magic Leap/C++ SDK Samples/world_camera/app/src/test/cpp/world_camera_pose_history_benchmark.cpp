@@ -0,0 +1,162 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "world_camera_pose_history.h"
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Measures interpolated pose queries per second: WorldCameraPoseHistory::PoseAt at
+  random and at increasing times over a full history of 30 Hz poses, against a linear
+  scan of the same samples, and WorldCameraReplay::GetPoseAtTime over the replayed
+  frames of a capture.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  const char *kCapturePath = "world_camera_pose_history_benchmark.wcap";
+  constexpr size_t kQueries = 2'000'000;
+  constexpr MLTime kInterval = 33'333'333;
+  constexpr MLTime kFirstTime = 1'000'000'000;
+  constexpr MLWorldCameraIdentifier kCameras[] = {MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right,
+                                                  MLWorldCameraIdentifier_Center};
+
+  struct Query {
+    MLWorldCameraIdentifier camera;
+    MLTime time;
+  };
+
+  std::vector<Query> RandomQueries(MLTime oldest, MLTime newest) {
+    std::mt19937_64 random(13);
+    std::uniform_int_distribution<MLTime> time(oldest, newest);
+    std::vector<Query> queries(kQueries);
+    for (size_t i = 0; i < queries.size(); ++i) {
+      queries[i] = {kCameras[i % 3], time(random)};
+    }
+    return queries;
+  }
+
+  template <typename Lookup>
+  void Measure(const char *name, const std::vector<Query> &queries, Lookup lookup) {
+    size_t found = 0;
+    double sum = 0.0;
+    const Clock::time_point start = Clock::now();
+    for (const Query &query : queries) {
+      MLTransform pose;
+      if (lookup(query, &pose)) {
+        ++found;
+        sum += pose.position.x;
+      }
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    CHECK(found == queries.size());
+    std::printf("%-34s %8.2f M queries/s %7.1f ns/query (%g)\n", name, queries.size() / seconds / 1e6,
+                seconds * 1e9 / queries.size(), sum);
+  }
+
+  // Interpolation around time by scanning the samples, as a history without the binary search would
+  bool LinearPoseAt(const std::vector<MLTime> &timestamps, const std::vector<MLTransform> &poses, MLTime time,
+                    MLTransform *out_pose) {
+    for (size_t i = 1; i < timestamps.size(); ++i) {
+      if (timestamps[i] >= time) {
+        if (timestamps[i - 1] > time) {
+          return false;
+        }
+        const double t = static_cast<double>(time - timestamps[i - 1]) / (timestamps[i] - timestamps[i - 1]);
+        *out_pose = InterpolateWorldCameraPose(poses[i - 1], poses[i], t);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void BenchmarkHistory() {
+    WorldCameraPoseHistory history;
+    std::vector<MLTime> timestamps;
+    std::vector<MLTransform> poses;
+    // Twice the capacity, so the rings have wrapped
+    for (size_t i = 0; i < 2 * WorldCameraPoseHistory::kCapacity; ++i) {
+      const MLTime time = kFirstTime + static_cast<MLTime>(i) * kInterval;
+      for (MLWorldCameraIdentifier camera : kCameras) {
+        CHECK(history.Add(camera, time, SyntheticPose(camera, time)));
+      }
+      if (i >= WorldCameraPoseHistory::kCapacity) {
+        timestamps.push_back(time);
+        poses.push_back(SyntheticPose(MLWorldCameraIdentifier_Left, time));
+      }
+    }
+    const MLTime oldest = history.Oldest(MLWorldCameraIdentifier_Left);
+    const MLTime newest = history.Newest(MLWorldCameraIdentifier_Left);
+    const std::vector<Query> random = RandomQueries(oldest, newest);
+    std::vector<Query> increasing(kQueries);
+    for (size_t i = 0; i < increasing.size(); ++i) {
+      increasing[i] = {kCameras[i % 3], oldest + static_cast<MLTime>((newest - oldest) * (i / 3) / (kQueries / 3))};
+    }
+
+    std::printf("%zu samples per camera\n", history.Size(MLWorldCameraIdentifier_Left));
+    Measure("history, random times", random, [&](const Query &query, MLTransform *pose) {
+      return history.PoseAt(query.camera, query.time, pose);
+    });
+    Measure("history, increasing times", increasing, [&](const Query &query, MLTransform *pose) {
+      return history.PoseAt(query.camera, query.time, pose);
+    });
+    Measure("linear scan, random times", random, [&](const Query &query, MLTransform *pose) {
+      return LinearPoseAt(timestamps, poses, query.time, pose);
+    });
+  }
+
+  void BenchmarkReplay() {
+    WorldCameraReplay replay;
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    MLTime newest = 0;
+    for (size_t i = 0; i < 2 * WorldCameraPoseHistory::kCapacity; ++i) {
+      MLWorldCameraData *data = nullptr;
+      CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+      for (uint8_t frame = 0; frame < data->frame_count; ++frame) {
+        newest = std::max(newest, data->frames[frame].timestamp);
+      }
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+    // Well inside the replayed frames of every camera
+    const std::vector<Query> queries = RandomQueries(newest - 16 * kInterval, newest - kInterval);
+    Measure("replay GetPoseAtTime, random times", queries, [&](const Query &query, MLTransform *pose) {
+      return replay.GetPoseAtTime(query.camera, query.time, pose) == MLResult_Ok;
+    });
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.frames_per_stream = 4 * WorldCameraPoseHistory::kCapacity;
+  capture.first_timestamp = kFirstTime;
+  capture.interval = kInterval;
+  WriteSyntheticCapture(kCapturePath, capture);
+  BenchmarkHistory();
+  BenchmarkReplay();
+  std::remove(kCapturePath);
+  return 0;
+}
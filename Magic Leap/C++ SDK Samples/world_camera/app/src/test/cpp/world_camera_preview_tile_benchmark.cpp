@@ -0,0 +1,219 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "world_camera_label.h"
+#include "world_camera_test.h"
+
+/*
+  Compares the two ways the sample updates its previews every frame, on a mocked scene
+  graph shaped like the one SetupPreview builds: walking the children of each preview
+  two levels deep and looking components up by type, as SetNodeText and
+  SetPreviewVisibility did, and the direct handles of a PreviewTile resolved once. The
+  number of previews scales from the 6 streams of the device to dozens.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  constexpr size_t kFrames = 20'000;
+
+  // Minimal stand-ins for the app framework scene graph: nodes own their children and
+  // components, and GetComponent returns the first component of a type by dynamic cast
+  class Component {
+  public:
+    virtual ~Component() = default;
+  };
+
+  class TransformComponent : public Component {};
+
+  class RenderableComponent : public Component {
+  public:
+    void SetVisible(bool visible) { visible_ = visible; }
+    bool IsVisible() const { return visible_; }
+
+  private:
+    bool visible_ = true;
+  };
+
+  class TextComponent : public RenderableComponent {
+  public:
+    TextComponent() { text_.reserve(WorldCameraLabel::kCapacity); }
+    void SetText(const char *text) { text_.assign(text); }
+    size_t size() const { return text_.size(); }
+
+  private:
+    std::string text_;
+  };
+
+  class Node {
+  public:
+    void AddChild(std::shared_ptr<Node> child) { children_.push_back(std::move(child)); }
+    void AddComponent(std::shared_ptr<Component> component) { components_.push_back(std::move(component)); }
+    const std::vector<std::shared_ptr<Node>> &GetChildren() const { return children_; }
+
+    template <typename T>
+    std::shared_ptr<T> GetComponent() const {
+      for (const auto &component : components_) {
+        if (auto typed = std::dynamic_pointer_cast<T>(component)) {
+          return typed;
+        }
+      }
+      return nullptr;
+    }
+
+  private:
+    std::vector<std::shared_ptr<Node>> children_;
+    std::vector<std::shared_ptr<Component>> components_;
+  };
+
+  using TileKey = std::pair<size_t, size_t>;
+
+  // PreviewTile of the sample, without the texture and streamer
+  struct PreviewTile {
+    std::shared_ptr<Node> node;
+    TextComponent *text = nullptr;
+    std::array<RenderableComponent *, 2> renderables = {};
+    WorldCameraLabel label;
+  };
+
+  struct Scene {
+    std::map<TileKey, std::shared_ptr<Node>> display_nodes;
+    std::vector<WorldCameraLabel> labels;
+    std::vector<PreviewTile> tiles;
+  };
+
+  TileKey Key(size_t tile) {
+    return {tile / 2, tile % 2};
+  }
+
+  // Builds the preview of every tile as SetupPreview does: a root holding a combined node
+  // with the image and the label nodes
+  Scene BuildScene(size_t tile_count) {
+    Scene scene;
+    scene.labels.resize(tile_count);
+    scene.tiles.resize(tile_count);
+    for (size_t i = 0; i < tile_count; ++i) {
+      auto image = std::make_shared<Node>();
+      image->AddComponent(std::make_shared<TransformComponent>());
+      auto image_renderable = std::make_shared<RenderableComponent>();
+      image->AddComponent(image_renderable);
+      auto text = std::make_shared<Node>();
+      text->AddComponent(std::make_shared<TransformComponent>());
+      auto text_component = std::make_shared<TextComponent>();
+      text->AddComponent(text_component);
+      auto combined = std::make_shared<Node>();
+      combined->AddChild(image);
+      combined->AddChild(text);
+      auto root = std::make_shared<Node>();
+      root->AddChild(combined);
+
+      scene.display_nodes[Key(i)] = root;
+      scene.labels[i].SetText({"Camera ", "\n", "Mode", "\nFrame Number: "});
+      PreviewTile &tile = scene.tiles[i];
+      tile.node = root;
+      tile.text = text_component.get();
+      tile.renderables = {image_renderable.get(), text_component.get()};
+      tile.label = scene.labels[i];
+    }
+    return scene;
+  }
+
+  // SetNodeText and SetPreviewVisibility as they were before PreviewTile
+  void WalkFrame(Scene &scene, int64_t frame) {
+    for (size_t i = 0; i < scene.labels.size(); ++i) {
+      if (!scene.labels[i].SetNumber(frame)) {
+        continue;
+      }
+      for (const auto &first_child : scene.display_nodes[Key(i)]->GetChildren()) {
+        for (const auto &second_child : first_child->GetChildren()) {
+          auto component = second_child->GetComponent<TextComponent>();
+          if (component) {
+            component->SetText(scene.labels[i].c_str());
+          }
+        }
+      }
+    }
+  }
+
+  void WalkVisibility(Scene &scene, bool state) {
+    for (size_t i = 0; i < scene.labels.size(); ++i) {
+      for (auto first_child : scene.display_nodes[Key(i)]->GetChildren()) {
+        for (auto second_child : first_child->GetChildren()) {
+          auto component = second_child->GetComponent<RenderableComponent>();
+          if (component) {
+            component->SetVisible(state);
+          }
+        }
+      }
+    }
+  }
+
+  // The same updates through the handles of each tile
+  void DirectFrame(Scene &scene, int64_t frame) {
+    for (PreviewTile &tile : scene.tiles) {
+      if (tile.label.SetNumber(frame) && tile.text) {
+        tile.text->SetText(tile.label.c_str());
+      }
+    }
+  }
+
+  void DirectVisibility(Scene &scene, bool state) {
+    for (const PreviewTile &tile : scene.tiles) {
+      for (auto renderable : tile.renderables) {
+        if (renderable) {
+          renderable->SetVisible(state);
+        }
+      }
+    }
+  }
+
+  template <typename Update>
+  double MicrosecondsPerFrame(Scene &scene, Update update) {
+    const Clock::time_point start = Clock::now();
+    for (size_t frame = 0; frame < kFrames; ++frame) {
+      update(scene, static_cast<int64_t>(frame));
+    }
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kFrames;
+  }
+
+  void Run(size_t tile_count) {
+    Scene scene = BuildScene(tile_count);
+    const double walk_text = MicrosecondsPerFrame(scene, WalkFrame);
+    const double direct_text = MicrosecondsPerFrame(scene, DirectFrame);
+    const double walk_visibility =
+        MicrosecondsPerFrame(scene, [](Scene &s, int64_t frame) { WalkVisibility(s, frame & 1); });
+    const double direct_visibility =
+        MicrosecondsPerFrame(scene, [](Scene &s, int64_t frame) { DirectVisibility(s, frame & 1); });
+    // Every label was updated every frame, on both paths
+    CHECK(scene.tiles.front().text->size() == scene.tiles.front().label.size());
+    std::printf("%3zu tiles  labels: walk %7.3f us, direct %7.3f us  visibility: walk %7.3f us, direct %7.3f us\n",
+                tile_count, walk_text, direct_text, walk_visibility, direct_visibility);
+  }
+}
+
+int main() {
+  for (size_t tiles : {6, 12, 24, 48, 96}) {
+    Run(tiles);
+  }
+  return 0;
+}
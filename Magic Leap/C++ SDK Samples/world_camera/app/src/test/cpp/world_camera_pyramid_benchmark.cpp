@@ -0,0 +1,120 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "world_camera_pyramid.h"
+#include "world_camera_test.h"
+
+/*
+  Compares halving a 1016x1016 frame with DownsampleWorldCameraImage, which uses AVX2
+  when the CPU supports it, with its scalar implementation and with a direct 5x5
+  evaluation of the pyrDown filter, and measures building a four level pyramid.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  constexpr uint32_t kSize = 1016;
+  constexpr uint32_t kHalf = (kSize + 1) / 2;
+  constexpr int kIterations = 200;
+
+  int32_t Reflect(int32_t index, int32_t size) {
+    if (index < 0) {
+      return -index;
+    }
+    return index < size ? index : 2 * size - 2 - index;
+  }
+
+  // pyrDown evaluated straight from its definition, 25 taps per output pixel
+  void DirectPyrDown(const std::vector<uint8_t> &src, std::vector<uint8_t> &dst) {
+    static const int32_t kKernel[5] = {1, 4, 6, 4, 1};
+    for (uint32_t y = 0; y < kHalf; ++y) {
+      for (uint32_t x = 0; x < kHalf; ++x) {
+        int32_t sum = 0;
+        for (int32_t i = 0; i < 5; ++i) {
+          const int32_t row = Reflect(2 * static_cast<int32_t>(y) - 2 + i, kSize);
+          for (int32_t j = 0; j < 5; ++j) {
+            const int32_t column = Reflect(2 * static_cast<int32_t>(x) - 2 + j, kSize);
+            sum += kKernel[i] * kKernel[j] * src[static_cast<size_t>(row) * kSize + column];
+          }
+        }
+        dst[static_cast<size_t>(y) * kHalf + x] = static_cast<uint8_t>((sum + 128) >> 8);
+      }
+    }
+  }
+
+  template <typename Run>
+  double MillisecondsPerCall(Run run) {
+    run();
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+      run();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kIterations;
+  }
+
+  void Print(const char *name, double ms, double reference_ms) {
+    std::printf("%-30s %8.3f ms %8.1f Mpixel/s  %6.2fx\n", name, ms,
+                static_cast<double>(kSize) * kSize / ms / 1e3, reference_ms / ms);
+  }
+}
+
+int main() {
+  std::vector<uint8_t> src(static_cast<size_t>(kSize) * kSize);
+  std::mt19937 random(11);
+  for (uint8_t &pixel : src) {
+    pixel = static_cast<uint8_t>(random());
+  }
+  std::vector<uint8_t> direct(static_cast<size_t>(kHalf) * kHalf);
+  std::vector<uint8_t> scalar(direct.size()), vectorized(direct.size());
+  std::vector<int16_t> scratch(kSize + 4);
+
+  const double direct_ms = MillisecondsPerCall([&] { DirectPyrDown(src, direct); });
+  const double scalar_ms = MillisecondsPerCall([&] {
+    DownsampleWorldCameraImageScalar(src.data(), kSize, kSize, kSize, scalar.data(), kHalf, scratch.data());
+  });
+  const double vectorized_ms = MillisecondsPerCall([&] {
+    DownsampleWorldCameraImage(src.data(), kSize, kSize, kSize, vectorized.data(), kHalf, scratch.data());
+  });
+  CHECK(scalar == direct);
+  CHECK(vectorized == direct);
+
+  MLWorldCameraFrame frame = {};
+  frame.frame_buffer.width = kSize;
+  frame.frame_buffer.height = kSize;
+  frame.frame_buffer.stride = kSize;
+  frame.frame_buffer.bytes_per_pixel = 1;
+  frame.frame_buffer.size = static_cast<uint32_t>(src.size());
+  frame.frame_buffer.data = src.data();
+  WorldCameraPyramidBuilder builder(4);
+  const double pyramid_ms = MillisecondsPerCall([&] { CHECK(builder.Build(frame)); });
+
+#if defined(__x86_64__) || defined(__i386__)
+  const bool avx2 = __builtin_cpu_supports("avx2");
+#else
+  const bool avx2 = false;
+#endif
+  std::printf("%ux%u to %ux%u, AVX2 %s, speedups against the direct filter\n", kSize, kSize, kHalf, kHalf,
+              avx2 ? "available" : "not available");
+  Print("direct 5x5 pyrDown", direct_ms, direct_ms);
+  Print("separable scalar", scalar_ms, direct_ms);
+  Print(avx2 ? "separable AVX2" : "separable dispatch (scalar)", vectorized_ms, direct_ms);
+  Print("four level pyramid", pyramid_ms, direct_ms);
+  return 0;
+}
@@ -0,0 +1,160 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "world_camera_pyramid.h"
+#include "world_camera_test.h"
+
+/*
+  Gaussian pyramids: downsampling, vectorized and scalar, matches a direct evaluation
+  of the pyrDown filter with reflected borders for every size and row tail, and the
+  builder lays out aligned levels, stops at small levels and reuses its arena.
+*/
+
+namespace {
+
+  int32_t Reflect(int32_t index, int32_t size) {
+    if (index < 0) {
+      return -index;
+    }
+    return index < size ? index : 2 * size - 2 - index;
+  }
+
+  // The [1 4 6 4 1] / 16 kernel in both directions around source pixel (2x, 2y), rounded.
+  uint8_t Reference(const std::vector<uint8_t> &src, uint32_t width, uint32_t height, uint32_t stride, uint32_t x,
+                    uint32_t y) {
+    static const int32_t kKernel[5] = {1, 4, 6, 4, 1};
+    int32_t sum = 0;
+    for (int32_t i = 0; i < 5; ++i) {
+      const int32_t row = Reflect(2 * static_cast<int32_t>(y) - 2 + i, height);
+      for (int32_t j = 0; j < 5; ++j) {
+        const int32_t column = Reflect(2 * static_cast<int32_t>(x) - 2 + j, width);
+        sum += kKernel[i] * kKernel[j] * src[static_cast<size_t>(row) * stride + column];
+      }
+    }
+    return static_cast<uint8_t>((sum + 128) >> 8);
+  }
+
+  void TestDownsample() {
+    std::mt19937 random(5);
+    for (uint32_t width = 3; width <= 80; ++width) {
+      for (uint32_t height : {3u, 4u, 7u}) {
+        const uint32_t stride = width + width % 5;
+        std::vector<uint8_t> src(static_cast<size_t>(stride) * height);
+        for (uint8_t &pixel : src) {
+          pixel = static_cast<uint8_t>(random());
+        }
+        const uint32_t dst_width = (width + 1) / 2;
+        const uint32_t dst_height = (height + 1) / 2;
+        const uint32_t dst_stride = dst_width + 1;
+        std::vector<uint8_t> dst(static_cast<size_t>(dst_stride) * dst_height, 0xAA);
+        std::vector<int16_t> scratch(width + 4);
+        std::vector<uint8_t> scalar(dst);
+        DownsampleWorldCameraImage(src.data(), width, height, stride, dst.data(), dst_stride, scratch.data());
+        DownsampleWorldCameraImageScalar(src.data(), width, height, stride, scalar.data(), dst_stride, scratch.data());
+        CHECK(scalar == dst);
+        for (uint32_t y = 0; y < dst_height; ++y) {
+          for (uint32_t x = 0; x < dst_width; ++x) {
+            CHECK(dst[y * dst_stride + x] == Reference(src, width, height, stride, x, y));
+          }
+          // Padding is left alone
+          CHECK(dst[y * dst_stride + dst_width] == 0xAA);
+        }
+      }
+    }
+    // Extreme values do not overflow the intermediate sums
+    for (uint8_t value : {uint8_t(0), uint8_t(255)}) {
+      std::vector<uint8_t> src(64 * 9, value);
+      std::vector<uint8_t> dst(32 * 5);
+      std::vector<int16_t> scratch(64 + 4);
+      DownsampleWorldCameraImage(src.data(), 64, 9, 64, dst.data(), 32, scratch.data());
+      for (uint8_t pixel : dst) {
+        CHECK(pixel == value);
+      }
+    }
+  }
+
+  MLWorldCameraFrame Frame(std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, uint32_t stride) {
+    pixels.resize(static_cast<size_t>(stride) * height);
+    MLWorldCameraFrame frame = {};
+    frame.id = MLWorldCameraIdentifier_Left;
+    frame.frame_number = 42;
+    frame.frame_buffer.width = width;
+    frame.frame_buffer.height = height;
+    frame.frame_buffer.stride = stride;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = static_cast<uint32_t>(pixels.size());
+    frame.frame_buffer.data = pixels.data();
+    return frame;
+  }
+
+  void TestBuilder() {
+    std::mt19937 random(9);
+    std::vector<uint8_t> pixels;
+    const MLWorldCameraFrame frame = Frame(pixels, 101, 75, 112);
+    for (uint8_t &pixel : pixels) {
+      pixel = static_cast<uint8_t>(random());
+    }
+    WorldCameraPyramidBuilder builder(4);
+    const WorldCameraPyramidFrame *pyramid = builder.Build(frame);
+    CHECK(pyramid);
+    CHECK(pyramid->frame.frame_number == 42);
+    CHECK(pyramid->level_count == 4);
+    CHECK(pyramid->levels[0].data == pixels.data());
+    const uint32_t widths[] = {101, 51, 26, 13};
+    const uint32_t heights[] = {75, 38, 19, 10};
+    for (uint32_t i = 0; i < pyramid->level_count; ++i) {
+      const MLWorldCameraFrameBuffer &level = pyramid->levels[i];
+      CHECK(level.width == widths[i] && level.height == heights[i]);
+      if (i == 0) {
+        continue;
+      }
+      CHECK(level.stride % WorldCameraPyramidBuilder::kRowAlignment == 0);
+      CHECK(reinterpret_cast<uintptr_t>(level.data) % WorldCameraPyramidBuilder::kRowAlignment == 0);
+      // Every level is the downsampled level above
+      const MLWorldCameraFrameBuffer &above = pyramid->levels[i - 1];
+      std::vector<uint8_t> source(above.data, above.data + static_cast<size_t>(above.stride) * above.height);
+      for (uint32_t y = 0; y < level.height; ++y) {
+        for (uint32_t x = 0; x < level.width; ++x) {
+          CHECK(level.data[y * level.stride + x] == Reference(source, above.width, above.height, above.stride, x, y));
+        }
+      }
+    }
+
+    // The arena is reused for frames of the same size
+    const uint8_t *level_data = pyramid->levels[1].data;
+    pyramid = builder.Build(frame);
+    CHECK(pyramid && pyramid->levels[1].data == level_data);
+
+    // Small frames get fewer levels, levels are clamped and other formats are rejected
+    std::vector<uint8_t> small_pixels;
+    pyramid = builder.Build(Frame(small_pixels, 10, 5, 10));
+    CHECK(pyramid && pyramid->level_count == 3);
+    CHECK(pyramid->levels[2].width == 3 && pyramid->levels[2].height == 2);
+    WorldCameraPyramidBuilder many(100);
+    pyramid = many.Build(Frame(small_pixels, 1024, 1024, 1024));
+    CHECK(pyramid && pyramid->level_count == WorldCameraPyramidFrame::kMaxLevels);
+    MLWorldCameraFrame wide = frame;
+    wide.frame_buffer.bytes_per_pixel = 2;
+    CHECK(!builder.Build(wide));
+  }
+}
+
+int main() {
+  TestDownsample();
+  TestBuilder();
+  return 0;
+}
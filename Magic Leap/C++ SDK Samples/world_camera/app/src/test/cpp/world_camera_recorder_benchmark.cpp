@@ -0,0 +1,115 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "world_camera_recorder.h"
+#include "world_camera_test.h"
+
+/*
+  Feeds WorldCameraRecorder with 1016x1016 frames of all three cameras in both
+  modes, first paced at the full sensor rate of 30 Hz per camera and mode, then as
+  fast as Submit accepts them, and reports the submit latency seen by the caller,
+  the deepest queue, the write throughput and the frames dropped per stream.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  const char *kCapturePath = "world_camera_recorder_benchmark.wcap";
+  constexpr uint32_t kSize = 1016;
+  constexpr MLTime kInterval = 33'333'333;
+
+  const MLWorldCameraIdentifier kCameras[kWorldCameraCount] = {
+          MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right, MLWorldCameraIdentifier_Center};
+  const MLWorldCameraFrameType kFrameTypes[] = {MLWorldCameraFrameType_LowExposure,
+                                                MLWorldCameraFrameType_NormalExposure};
+
+  void Run(const char *name, bool paced, std::chrono::milliseconds duration) {
+    std::vector<uint8_t> pixels(kSize * kSize);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+      pixels[i] = static_cast<uint8_t>(i * 13);
+    }
+    MLWorldCameraFrame frame = {};
+    frame.intrinsics.width = kSize;
+    frame.intrinsics.height = kSize;
+    frame.frame_buffer.width = kSize;
+    frame.frame_buffer.height = kSize;
+    frame.frame_buffer.stride = kSize;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = kSize * kSize;
+    frame.frame_buffer.data = pixels.data();
+
+    WorldCameraRecorder recorder;
+    CHECK(recorder.Start(kCapturePath));
+    std::vector<double> submit_us;
+    submit_us.reserve(1 << 16);
+    size_t max_queue_depth = 0;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + duration;
+    int64_t frame_number = 0;
+    for (Clock::time_point now = start; now < end; ++frame_number) {
+      // The sensors capture every camera and mode once per interval
+      if (paced) {
+        std::this_thread::sleep_until(start + std::chrono::nanoseconds(frame_number * kInterval));
+      }
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        for (MLWorldCameraIdentifier camera : kCameras) {
+          frame.id = camera;
+          frame.frame_type = frame_type;
+          frame.frame_number = frame_number;
+          frame.timestamp = frame_number * kInterval;
+          const Clock::time_point before = Clock::now();
+          recorder.Submit(frame);
+          now = Clock::now();
+          submit_us.push_back(std::chrono::duration<double, std::micro>(now - before).count());
+          max_queue_depth = std::max(max_queue_depth, recorder.QueueDepth());
+        }
+      }
+    }
+    CHECK(recorder.Stop());
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t written = 0;
+    uint64_t bytes = 0;
+    uint64_t dropped = 0;
+    for (MLWorldCameraIdentifier camera : kCameras) {
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        const WorldCameraRecorder::StreamCounters counters = recorder.GetCounters(camera, frame_type);
+        written += counters.frames_written;
+        bytes += counters.bytes_written;
+        dropped += counters.frames_dropped;
+      }
+    }
+    std::sort(submit_us.begin(), submit_us.end());
+    std::printf("%-8s %s  %7.0f frames/s offered  %7.1f MB/s written  %5.2f%% dropped  queue max %2zu  "
+                "submit p50 %6.1f us  p99 %6.1f us  max %7.1f us\n",
+                name, recorder.IsDirectIO() ? "direct" : "cached", submit_us.size() / seconds, bytes / seconds / 1e6,
+                100.0 * dropped / std::max<uint64_t>(written + dropped, 1), max_queue_depth,
+                submit_us[submit_us.size() / 2], submit_us[submit_us.size() * 99 / 100], submit_us.back());
+  }
+}
+
+int main() {
+  Run("30 Hz", true, std::chrono::milliseconds(3000));
+  Run("flat out", false, std::chrono::milliseconds(1000));
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,186 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "world_camera_capture.h"
+#include "world_camera_recorder.h"
+#include "world_camera_test.h"
+
+/*
+  Recording round trip: frames of every camera in both modes submitted to
+  WorldCameraRecorder are read back by WorldCameraCaptureReader with the same
+  metadata and pixels, in timestamp order per camera and frame type, and the
+  counters account for every written and dropped frame.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_recorder_test.wcap";
+  constexpr uint32_t kWidth = 100;
+  constexpr uint32_t kHeight = 30;
+  // Rows are padded, so planes are not a multiple of the width
+  constexpr uint32_t kStride = 112;
+  constexpr uint32_t kSize = kStride * (kHeight - 1) + kWidth;
+  constexpr size_t kFramesPerStream = 40;
+  constexpr MLTime kInterval = 33'333'333;
+
+  const MLWorldCameraIdentifier kCameras[kWorldCameraCount] = {
+          MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right, MLWorldCameraIdentifier_Center};
+  const MLWorldCameraFrameType kFrameTypes[] = {MLWorldCameraFrameType_LowExposure,
+                                                MLWorldCameraFrameType_NormalExposure};
+
+  uint8_t Pixel(size_t stream, int64_t frame_number, size_t offset) {
+    return static_cast<uint8_t>(offset * 31 + frame_number * 7 + stream * 50);
+  }
+
+  MLWorldCameraFrame Frame(MLWorldCameraIdentifier camera, MLWorldCameraFrameType frame_type, int64_t frame_number,
+                           std::vector<uint8_t> &pixels) {
+    const size_t stream = WorldCameraStreamIndex(camera, frame_type);
+    pixels.resize(kSize);
+    for (size_t i = 0; i < kSize; ++i) {
+      pixels[i] = Pixel(stream, frame_number, i);
+    }
+    MLWorldCameraFrame frame = {};
+    frame.id = camera;
+    frame.frame_type = frame_type;
+    frame.frame_number = frame_number;
+    frame.timestamp = 1'000'000'000 + frame_number * kInterval +
+                      (frame_type == MLWorldCameraFrameType_LowExposure ? kInterval / 4 : 0);
+    frame.camera_pose = SyntheticPose(camera, frame.timestamp);
+    frame.intrinsics.width = kWidth;
+    frame.intrinsics.height = kHeight;
+    frame.intrinsics.focal_length = {150.0f, 151.0f};
+    frame.intrinsics.principal_point = {kWidth / 2.0f, kHeight / 2.0f + static_cast<float>(stream)};
+    frame.intrinsics.radial_distortion[0] = -0.25;
+    frame.frame_buffer.width = kWidth;
+    frame.frame_buffer.height = kHeight;
+    frame.frame_buffer.stride = kStride;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = kSize;
+    frame.frame_buffer.data = pixels.data();
+    return frame;
+  }
+
+  bool IsRecorded(const MLWorldCameraFrame &frame) {
+    const size_t stream = WorldCameraStreamIndex(frame);
+    for (size_t i = 0; i < frame.frame_buffer.size; ++i) {
+      if (frame.frame_buffer.data[i] != Pixel(stream, frame.frame_number, i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void TestRoundTrip() {
+    WorldCameraRecorder recorder;
+    // Enough slots for every frame, so none is dropped however slow the disk
+    CHECK(recorder.Start(kCapturePath, kFramesPerStream * kWorldCameraStreamCount, kSize));
+    CHECK(recorder.IsRecording());
+    std::vector<uint8_t> pixels;
+    for (size_t k = 0; k < kFramesPerStream; ++k) {
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        for (MLWorldCameraIdentifier camera : kCameras) {
+          CHECK(recorder.Submit(Frame(camera, frame_type, static_cast<int64_t>(k), pixels)));
+        }
+      }
+    }
+    // Frames without pixels, of unknown cameras or larger than a slot are not recorded
+    std::vector<uint8_t> other_pixels;
+    MLWorldCameraFrame empty = Frame(MLWorldCameraIdentifier_Left, MLWorldCameraFrameType_NormalExposure, 99, other_pixels);
+    empty.frame_buffer.data = nullptr;
+    CHECK(!recorder.Submit(empty));
+    MLWorldCameraFrame unknown = Frame(MLWorldCameraIdentifier_All, MLWorldCameraFrameType_NormalExposure, 99, other_pixels);
+    CHECK(!recorder.Submit(unknown));
+    MLWorldCameraFrame large = Frame(MLWorldCameraIdentifier_Right, MLWorldCameraFrameType_LowExposure, 99, other_pixels);
+    large.frame_buffer.size = static_cast<uint32_t>(WorldCameraCaptureAlignedSize(kSize) + 1);
+    other_pixels.resize(large.frame_buffer.size);
+    large.frame_buffer.data = other_pixels.data();
+    CHECK(!recorder.Submit(large));
+    CHECK(recorder.Stop());
+    CHECK(!recorder.IsRecording());
+    CHECK(recorder.QueueDepth() == 0);
+
+    for (MLWorldCameraIdentifier camera : kCameras) {
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        const WorldCameraRecorder::StreamCounters counters = recorder.GetCounters(camera, frame_type);
+        CHECK(counters.frames_written == kFramesPerStream);
+        CHECK(counters.bytes_written == kFramesPerStream * kSize);
+        const bool oversized = camera == MLWorldCameraIdentifier_Right && frame_type == MLWorldCameraFrameType_LowExposure;
+        CHECK(counters.frames_dropped == (oversized ? 1u : 0u));
+      }
+    }
+
+    WorldCameraCaptureReader reader;
+    CHECK(reader.Open(kCapturePath));
+    CHECK(reader.FrameCount() == kFramesPerStream * kWorldCameraStreamCount);
+    std::vector<uint8_t> expected_pixels;
+    for (MLWorldCameraIdentifier camera : kCameras) {
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        const auto range = reader.Range(camera, frame_type);
+        CHECK(range.second - range.first == kFramesPerStream);
+        for (size_t i = range.first; i < range.second; ++i) {
+          const MLWorldCameraFrame frame = reader.Frame(i);
+          const int64_t frame_number = static_cast<int64_t>(i - range.first);
+          const MLWorldCameraFrame expected = Frame(camera, frame_type, frame_number, expected_pixels);
+          CHECK(frame.id == camera && frame.frame_type == frame_type);
+          CHECK(frame.frame_number == frame_number && frame.timestamp == expected.timestamp);
+          CHECK(frame.camera_pose.position.x == expected.camera_pose.position.x);
+          CHECK(frame.camera_pose.rotation.w == expected.camera_pose.rotation.w);
+          CHECK(frame.intrinsics.principal_point.y == expected.intrinsics.principal_point.y);
+          CHECK(frame.intrinsics.radial_distortion[0] == -0.25);
+          CHECK(frame.frame_buffer.width == kWidth && frame.frame_buffer.height == kHeight);
+          CHECK(frame.frame_buffer.stride == kStride && frame.frame_buffer.size == kSize);
+          CHECK(reinterpret_cast<uintptr_t>(frame.frame_buffer.data) % kWorldCameraCaptureAlignment == 0);
+          CHECK(IsRecorded(frame));
+        }
+      }
+    }
+    reader.Close();
+  }
+
+  void TestDroppedWhenFull() {
+    WorldCameraRecorder recorder;
+    CHECK(recorder.Start(kCapturePath, 2, kSize));
+    std::vector<uint8_t> pixels;
+    size_t submitted = 0;
+    for (size_t k = 0; k < 200; ++k) {
+      submitted += recorder.Submit(Frame(MLWorldCameraIdentifier_Left, MLWorldCameraFrameType_NormalExposure,
+                                         static_cast<int64_t>(k), pixels));
+    }
+    CHECK(recorder.Stop());
+    const WorldCameraRecorder::StreamCounters counters =
+            recorder.GetCounters(MLWorldCameraIdentifier_Left, MLWorldCameraFrameType_NormalExposure);
+    CHECK(counters.frames_written == submitted);
+    CHECK(counters.frames_written + counters.frames_dropped == 200);
+
+    // Whatever was written reads back in order
+    WorldCameraCaptureReader reader;
+    CHECK(reader.Open(kCapturePath));
+    CHECK(reader.FrameCount() == submitted);
+    for (size_t i = 1; i < reader.FrameCount(); ++i) {
+      CHECK(reader.Frame(i).frame_number > reader.Frame(i - 1).frame_number);
+      CHECK(IsRecorded(reader.Frame(i)));
+    }
+  }
+}
+
+int main() {
+  TestRoundTrip();
+  TestDroppedWhenFull();
+  std::remove(kCapturePath);
+  return 0;
+}
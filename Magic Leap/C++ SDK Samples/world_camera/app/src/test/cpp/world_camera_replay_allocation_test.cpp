@@ -0,0 +1,96 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <cstdio>
+
+#include "world_camera_allocation_counter.h"
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Steady state polling of WorldCameraReplay must not allocate: once every pooled frame
+  buffer has been used, poll and release cycles leave the allocation count unchanged,
+  with full resolution frames pointing into the capture and with downscaled frames
+  written to the pooled buffers.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_replay_allocation_test.wcap";
+  constexpr size_t kCycles = 1000;
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  WorldCameraReplay::OutputSettings Output(uint32_t downscale) {
+    WorldCameraReplay::OutputSettings output;
+    output.downscale.fill(downscale);
+    output.queue_depth.fill(2);
+    return output;
+  }
+
+  size_t Cycle(WorldCameraReplay &replay, bool buffered) {
+    MLWorldCameraData *data = nullptr;
+    const MLResult result = buffered ? replay.GetBufferedWorldCameraData(0, &data) :
+                                       replay.GetLatestWorldCameraData(0, &data);
+    CHECK(result == MLResult_Ok);
+    const size_t frames = data->frame_count;
+    CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    return frames;
+  }
+
+  void TestSteadyStatePolling(uint32_t downscale, bool buffered) {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    const WorldCameraReplay::OutputSettings output = Output(downscale);
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) == MLResult_Ok);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+    // Buffers are claimed in turn, so this many polls use every one of them and grow their pixels
+    for (size_t i = 0; i < WorldCameraReplay::kBufferCapacity; ++i) {
+      Cycle(replay, buffered);
+    }
+
+    const uint64_t before = WorldCameraAllocationCount();
+    size_t frames = 0;
+    for (size_t i = 0; i < kCycles; ++i) {
+      frames += Cycle(replay, buffered);
+    }
+    const uint64_t allocations = WorldCameraAllocationCount() - before;
+    if (allocations != 0) {
+      std::fprintf(stderr, "downscale %u, %s polls: %lu allocations\n", downscale, buffered ? "buffered" : "latest",
+                   static_cast<unsigned long>(allocations));
+    }
+    CHECK(allocations == 0);
+    CHECK(frames >= kCycles * kWorldCameraStreamCount);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+}
+
+int main() {
+  CHECK(WorldCameraCountsAllocations());
+  SyntheticCapture capture;
+  capture.frames_per_stream = 40;
+  WriteSyntheticCapture(kCapturePath, capture);
+  TestSteadyStatePolling(1, false);
+  TestSteadyStatePolling(2, false);
+  TestSteadyStatePolling(4, false);
+  TestSteadyStatePolling(1, true);
+  TestSteadyStatePolling(2, true);
+  std::remove(kCapturePath);
+  return 0;
+}
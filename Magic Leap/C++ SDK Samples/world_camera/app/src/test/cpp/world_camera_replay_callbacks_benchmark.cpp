@@ -0,0 +1,131 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Compares the capture to processing latency of polling once per rendered frame with
+  callback delivery, replaying a 30 fps capture of all cameras and modes at its
+  recorded pace. Latency is measured from the moment a frame became due in the replay.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  const char *kCapturePath = "world_camera_replay_callbacks_benchmark.wcap";
+  constexpr size_t kFramesPerStream = 150;
+  constexpr MLTime kFirstTimestamp = 1'000'000'000;
+
+  struct Run {
+    Clock::time_point start;
+    std::mutex mutex;
+    std::vector<double> latencies_ms;
+    size_t polls = 0;
+    size_t empty_polls = 0;
+
+    void Record(const MLWorldCameraData &data) {
+      const Clock::time_point now = Clock::now();
+      std::lock_guard<std::mutex> lock(mutex);
+      for (uint8_t i = 0; i < data.frame_count; ++i) {
+        const Clock::time_point due = start + std::chrono::nanoseconds(data.frames[i].timestamp - kFirstTimestamp);
+        latencies_ms.push_back(std::chrono::duration<double, std::milli>(now - due).count());
+      }
+    }
+
+    void Print(const char *name) {
+      std::sort(latencies_ms.begin(), latencies_ms.end());
+      double sum = 0.0;
+      for (double latency : latencies_ms) {
+        sum += latency;
+      }
+      const size_t count = latencies_ms.size();
+      std::printf("%-28s %6zu frames %6zu polls %6zu empty  latency mean %6.2f ms  p99 %6.2f ms\n", name, count, polls,
+                  empty_polls, count ? sum / count : 0.0, count ? latencies_ms[count * 99 / 100] : 0.0);
+    }
+  };
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  const auto kDuration = std::chrono::nanoseconds(kFramesPerStream * SyntheticCapture().interval);
+
+  // Polls with a timeout of 0 once every 60 Hz render frame, like WorldCameraApp::OnPreRender.
+  void RenderLoopPolling() {
+    WorldCameraReplay replay;
+    Run run;
+    const MLWorldCameraSettings settings = Settings();
+    run.start = Clock::now();
+    CHECK(replay.Connect(kCapturePath, &settings) == MLResult_Ok);
+    const auto frame_time = std::chrono::microseconds(16667);
+    for (auto next = run.start; next < run.start + kDuration; next += frame_time) {
+      std::this_thread::sleep_until(next);
+      MLWorldCameraData *data = nullptr;
+      ++run.polls;
+      if (replay.GetLatestWorldCameraData(0, &data) != MLResult_Ok) {
+        ++run.empty_polls;
+        continue;
+      }
+      run.Record(*data);
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    run.Print("render loop poll (60 Hz)");
+  }
+
+  void Callbacks(WorldCameraReplay::QueuePolicy policy, const char *name) {
+    WorldCameraReplay replay;
+    Run run;
+    const MLWorldCameraSettings settings = Settings();
+    run.start = Clock::now();
+    CHECK(replay.Connect(kCapturePath, &settings) == MLResult_Ok);
+    WorldCameraReplay::Callbacks callbacks;
+    callbacks.queue_policy = policy;
+    callbacks.on_data_available = [](const MLWorldCameraData *data, void *user_data) {
+      static_cast<Run *>(user_data)->Record(*data);
+    };
+    CHECK(replay.SetCallbacks(&callbacks, &run) == MLResult_Ok);
+    std::this_thread::sleep_until(run.start + kDuration);
+    CHECK(replay.SetCallbacks(nullptr, nullptr) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    run.Print(name);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.frames_per_stream = kFramesPerStream;
+  capture.first_timestamp = kFirstTimestamp;
+  capture.width = 640;
+  capture.height = 480;
+  WriteSyntheticCapture(kCapturePath, capture);
+  RenderLoopPolling();
+  Callbacks(WorldCameraReplay::QueuePolicy::DropOldest, "callbacks (drop oldest)");
+  Callbacks(WorldCameraReplay::QueuePolicy::DropNewest, "callbacks (drop newest)");
+  Callbacks(WorldCameraReplay::QueuePolicy::Block, "callbacks (block)");
+  std::remove(kCapturePath);
+  return 0;
+}
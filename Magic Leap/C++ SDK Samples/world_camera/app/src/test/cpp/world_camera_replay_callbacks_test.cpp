@@ -0,0 +1,283 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Callback delivery of WorldCameraReplay: the delivery queue, registration checks,
+  the three queue policies and unregistering while a callback runs.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_replay_callbacks_test.wcap";
+  constexpr size_t kFramesPerStream = 200;
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  // Records the frame numbers delivered per stream and checks callbacks never overlap.
+  struct Recorder {
+    std::mutex mutex;
+    std::array<std::vector<int64_t>, kWorldCameraStreamCount> frame_numbers;
+    std::atomic<bool> in_callback{false};
+    std::atomic<size_t> overlaps{0};
+    std::atomic<size_t> callbacks{0};
+    std::chrono::microseconds delay{0};
+
+    static void OnData(const MLWorldCameraData *data, void *user_data) {
+      Recorder *recorder = static_cast<Recorder *>(user_data);
+      if (recorder->in_callback.exchange(true)) {
+        ++recorder->overlaps;
+      }
+      {
+        std::lock_guard<std::mutex> lock(recorder->mutex);
+        for (uint8_t i = 0; i < data->frame_count; ++i) {
+          const MLWorldCameraFrame &frame = data->frames[i];
+          CHECK(IsUniform(frame.frame_buffer, SyntheticPixel(frame.id, frame.frame_number)));
+          recorder->frame_numbers[WorldCameraStreamIndex(frame)].push_back(frame.frame_number);
+        }
+      }
+      std::this_thread::sleep_for(recorder->delay);
+      ++recorder->callbacks;
+      recorder->in_callback = false;
+    }
+
+    size_t Delivered(size_t stream) {
+      std::lock_guard<std::mutex> lock(mutex);
+      return frame_numbers[stream].size();
+    }
+
+    // Waits until the last frame of every stream has been delivered or timeout expired.
+    bool WaitForLastFrame(std::chrono::seconds timeout) {
+      const auto deadline = std::chrono::steady_clock::now() + timeout;
+      while (std::chrono::steady_clock::now() < deadline) {
+        bool complete = true;
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          for (const auto &numbers : frame_numbers) {
+            complete = complete && !numbers.empty() && numbers.back() == int64_t(kFramesPerStream - 1);
+          }
+        }
+        if (complete) {
+          return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      return false;
+    }
+  };
+
+  WorldCameraReplay::Callbacks Callbacks(uint32_t queue_depth, WorldCameraReplay::QueuePolicy policy) {
+    WorldCameraReplay::Callbacks callbacks;
+    callbacks.queue_depth = queue_depth;
+    callbacks.queue_policy = policy;
+    callbacks.on_data_available = &Recorder::OnData;
+    return callbacks;
+  }
+
+  void TestDeliveryQueue() {
+    WorldCameraDeliveryQueue<WorldCameraReplay::kMaxCallbackQueueDepth> queue;
+    for (size_t capacity = 1; capacity <= WorldCameraReplay::kMaxCallbackQueueDepth; ++capacity) {
+      queue.Reset(capacity);
+      size_t value = 0;
+      CHECK(!queue.TryPop(&value));
+      // Wrap around the ring several times at every fill level
+      for (size_t round = 0; round < 3 * capacity; ++round) {
+        for (size_t i = 0; i < capacity; ++i) {
+          CHECK(queue.TryPush(round * 100 + i));
+        }
+        CHECK(!queue.TryPush(0));
+        for (size_t i = 0; i < capacity; ++i) {
+          CHECK(queue.TryPop(&value));
+          CHECK(value == round * 100 + i);
+        }
+        CHECK(!queue.TryPop(&value));
+      }
+    }
+  }
+
+  void TestRegistration() {
+    WorldCameraReplay replay;
+    Recorder recorder;
+    WorldCameraReplay::Callbacks callbacks = Callbacks(2, WorldCameraReplay::QueuePolicy::DropOldest);
+    CHECK(replay.SetCallbacks(&callbacks, &recorder) == MLResult_InvalidParam);
+
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    callbacks.queue_depth = 0;
+    CHECK(replay.SetCallbacks(&callbacks, &recorder) == MLResult_InvalidParam);
+    callbacks.queue_depth = WorldCameraReplay::kMaxCallbackQueueDepth + 1;
+    CHECK(replay.SetCallbacks(&callbacks, &recorder) == MLResult_InvalidParam);
+    callbacks = Callbacks(2, WorldCameraReplay::QueuePolicy::DropOldest);
+    callbacks.on_data_available = nullptr;
+    CHECK(replay.SetCallbacks(&callbacks, &recorder) == MLResult_InvalidParam);
+    // Unregistering without callbacks is allowed
+    CHECK(replay.SetCallbacks(nullptr, nullptr) == MLResult_Ok);
+
+    callbacks = Callbacks(2, WorldCameraReplay::QueuePolicy::Block);
+    CHECK(replay.SetCallbacks(&callbacks, &recorder) == MLResult_Ok);
+    MLWorldCameraData *data = nullptr;
+    CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_IllegalState);
+    CHECK(replay.GetBufferedWorldCameraData(0, &data) == MLResult_IllegalState);
+    CHECK(recorder.WaitForLastFrame(std::chrono::seconds(10)));
+    CHECK(replay.SetCallbacks(nullptr, nullptr) == MLResult_Ok);
+    // Polling works again once unregistered; the capture has been consumed
+    CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Timeout);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // Block never discards data, so every frame arrives in order even with a slow callback.
+  void TestBlock() {
+    WorldCameraReplay replay;
+    Recorder recorder;
+    recorder.delay = std::chrono::microseconds(200);
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    const WorldCameraReplay::Callbacks callbacks = Callbacks(1, WorldCameraReplay::QueuePolicy::Block);
+    CHECK(replay.SetCallbacks(&callbacks, &recorder) == MLResult_Ok);
+    CHECK(recorder.WaitForLastFrame(std::chrono::seconds(10)));
+    CHECK(replay.SetCallbacks(nullptr, nullptr) == MLResult_Ok);
+    CHECK(recorder.overlaps == 0);
+    for (const auto &numbers : recorder.frame_numbers) {
+      CHECK(numbers.size() == kFramesPerStream);
+      for (size_t i = 0; i < numbers.size(); ++i) {
+        CHECK(numbers[i] == int64_t(i));
+      }
+    }
+    WorldCameraReplay::PoolStatus status;
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.data_in_use == 0);
+    CHECK(status.buffers_in_use == 0);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // With a callback slower than the producer, DropNewest keeps the first frames and
+  // DropOldest keeps the last ones.
+  void TestDropPolicy(WorldCameraReplay::QueuePolicy policy) {
+    WorldCameraReplay replay;
+    Recorder recorder;
+    recorder.delay = std::chrono::milliseconds(2);
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    const WorldCameraReplay::Callbacks callbacks = Callbacks(2, policy);
+    CHECK(replay.SetCallbacks(&callbacks, &recorder) == MLResult_Ok);
+    if (policy == WorldCameraReplay::QueuePolicy::DropOldest) {
+      CHECK(recorder.WaitForLastFrame(std::chrono::seconds(10)));
+    } else {
+      // Let the producer run through the capture
+      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+    CHECK(replay.SetCallbacks(nullptr, nullptr) == MLResult_Ok);
+    CHECK(recorder.overlaps == 0);
+    const std::vector<int64_t> &numbers = recorder.frame_numbers[0];
+    CHECK(!numbers.empty());
+    CHECK(numbers.size() < kFramesPerStream);
+    for (size_t i = 1; i < numbers.size(); ++i) {
+      CHECK(numbers[i] > numbers[i - 1]);
+    }
+    if (policy == WorldCameraReplay::QueuePolicy::DropNewest) {
+      CHECK(numbers.front() == 0);
+    } else {
+      CHECK(numbers.back() == int64_t(kFramesPerStream - 1));
+    }
+    WorldCameraReplay::PoolStatus status;
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.data_in_use == 0);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // Unregistering waits for the running callback, releases queued data undelivered, and
+  // leases taken in the callback stay valid.
+  struct Blocker {
+    WorldCameraReplay *replay = nullptr;
+    std::atomic<bool> entered{false};
+    std::atomic<bool> release{false};
+    std::atomic<bool> returned{false};
+    std::atomic<size_t> callbacks{0};
+    WorldCameraReplay::FrameLease lease = {};
+
+    static void OnData(const MLWorldCameraData *data, void *user_data) {
+      Blocker *blocker = static_cast<Blocker *>(user_data);
+      if (blocker->callbacks++ > 0) {
+        return;
+      }
+      CHECK(blocker->replay->AcquireFrameLease(&data->frames[0], &blocker->lease) == MLResult_Ok);
+      blocker->entered = true;
+      while (!blocker->release) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      blocker->returned = true;
+    }
+  };
+
+  void TestUnregisterDuringCallback() {
+    WorldCameraReplay replay;
+    Blocker blocker;
+    blocker.replay = &replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    WorldCameraReplay::Callbacks callbacks =
+        Callbacks(WorldCameraReplay::kMaxCallbackQueueDepth, WorldCameraReplay::QueuePolicy::Block);
+    callbacks.on_data_available = &Blocker::OnData;
+    CHECK(replay.SetCallbacks(&callbacks, &blocker) == MLResult_Ok);
+    while (!blocker.entered) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    // Let the producer fill the queue behind the blocked callback
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    WorldCameraReplay::PoolStatus status;
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.data_in_use >= WorldCameraReplay::kMaxCallbackQueueDepth + 1);
+    blocker.release = true;
+    CHECK(replay.SetCallbacks(nullptr, nullptr) == MLResult_Ok);
+    CHECK(blocker.returned);
+    CHECK(blocker.callbacks == 1);
+
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.data_in_use == 0);
+    CHECK(status.buffers_in_use == 1);
+    CHECK(IsUniform(blocker.lease.frame_buffer, SyntheticPixel(blocker.lease.id, blocker.lease.frame_number)));
+    CHECK(replay.ReleaseFrameLease(&blocker.lease) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.frames_per_stream = kFramesPerStream;
+  WriteSyntheticCapture(kCapturePath, capture);
+  TestDeliveryQueue();
+  TestRegistration();
+  TestBlock();
+  TestDropPolicy(WorldCameraReplay::QueuePolicy::DropNewest);
+  TestDropPolicy(WorldCameraReplay::QueuePolicy::DropOldest);
+  TestUnregisterDuringCallback();
+  std::remove(kCapturePath);
+  return 0;
+}
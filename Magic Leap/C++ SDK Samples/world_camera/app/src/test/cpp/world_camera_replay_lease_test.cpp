@@ -0,0 +1,276 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <atomic>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Frame leases of WorldCameraReplay: leased buffers must keep their content after the
+  data is released and while later polls recycle the pool, and leases must be safe to
+  release from other threads than the polling one.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_replay_lease_test.wcap";
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  WorldCameraReplay::OutputSettings Output(uint32_t downscale, uint32_t queue_depth) {
+    WorldCameraReplay::OutputSettings output;
+    output.downscale.fill(downscale);
+    output.queue_depth.fill(queue_depth);
+    return output;
+  }
+
+  bool HoldsFrame(const WorldCameraReplay::FrameLease &lease) {
+    return IsUniform(lease.frame_buffer, SyntheticPixel(lease.id, lease.frame_number));
+  }
+
+  void TestLeaseOutlivesData() {
+    for (uint32_t downscale : {1u, 2u}) {
+      WorldCameraReplay replay;
+      const MLWorldCameraSettings settings = Settings();
+      const WorldCameraReplay::OutputSettings output = Output(downscale, 1);
+      CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) == MLResult_Ok);
+      CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+
+      MLWorldCameraData *data = nullptr;
+      CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+      CHECK(data->frame_count == kWorldCameraStreamCount);
+      std::vector<WorldCameraReplay::FrameLease> leases(data->frame_count);
+      for (uint8_t i = 0; i < data->frame_count; ++i) {
+        CHECK(replay.AcquireFrameLease(&data->frames[i], &leases[i]) == MLResult_Ok);
+        CHECK(leases[i].frame_buffer.data == data->frames[i].frame_buffer.data);
+      }
+      // A frame can be leased more than once
+      WorldCameraReplay::FrameLease second;
+      CHECK(replay.AcquireFrameLease(&data->frames[0], &second) == MLResult_Ok);
+      const MLWorldCameraFrame released_frame = data->frames[0];
+      const MLWorldCameraFrame *released_pointer = &data->frames[0];
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+
+      // Frames of released data cannot be leased
+      WorldCameraReplay::FrameLease stale;
+      CHECK(replay.AcquireFrameLease(released_pointer, &stale) == MLResult_InvalidParam);
+      CHECK(replay.AcquireFrameLease(&released_frame, &stale) == MLResult_InvalidParam);
+
+      // Recycle the pool many times over while the leases are held
+      for (size_t poll = 0; poll < 4 * WorldCameraReplay::kBufferCapacity; ++poll) {
+        CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+        CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+      }
+      WorldCameraReplay::PoolStatus status;
+      CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+      CHECK(status.data_in_use == 0);
+      CHECK(status.buffers_in_use == leases.size());
+      CHECK(status.buffers_leased == leases.size());
+      CHECK(status.exhausted_frames == 0);
+      for (const WorldCameraReplay::FrameLease &lease : leases) {
+        CHECK(HoldsFrame(lease));
+      }
+
+      for (WorldCameraReplay::FrameLease &lease : leases) {
+        CHECK(replay.ReleaseFrameLease(&lease) == MLResult_Ok);
+        CHECK(lease.lease_handle == ML_INVALID_HANDLE);
+        CHECK(lease.frame_buffer.data == nullptr);
+        CHECK(replay.ReleaseFrameLease(&lease) == MLResult_InvalidParam);
+      }
+      // The buffer of the frame leased twice is still held by the second lease
+      CHECK(HoldsFrame(second));
+      CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+      CHECK(status.buffers_in_use == 1);
+      CHECK(replay.ReleaseFrameLease(&second) == MLResult_Ok);
+      CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+      CHECK(status.buffers_in_use == 0);
+      CHECK(status.buffers_leased == 0);
+      CHECK(replay.Disconnect() == MLResult_Ok);
+    }
+  }
+
+  void TestExhaustion() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    WorldCameraReplay::OutputSettings output = Output(2, 1);
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) == MLResult_Ok);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+
+    // Every data object outstanding
+    std::vector<MLWorldCameraData *> held;
+    MLWorldCameraData *data = nullptr;
+    for (size_t i = 0; i < WorldCameraReplay::kDataCapacity; ++i) {
+      CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+      held.push_back(data);
+    }
+    CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_AllocFailed);
+    WorldCameraReplay::PoolStatus status;
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.exhausted_polls == 1);
+    CHECK(status.data_in_use == WorldCameraReplay::kDataCapacity);
+    CHECK(status.data_peak == WorldCameraReplay::kDataCapacity);
+
+    // Every lease held
+    std::vector<WorldCameraReplay::FrameLease> leases(WorldCameraReplay::kMaxLeases);
+    for (WorldCameraReplay::FrameLease &lease : leases) {
+      CHECK(replay.AcquireFrameLease(&held[0]->frames[0], &lease) == MLResult_Ok);
+    }
+    WorldCameraReplay::FrameLease extra;
+    CHECK(replay.AcquireFrameLease(&held[0]->frames[0], &extra) == MLResult_UnspecifiedFailure);
+    for (MLWorldCameraData *outstanding : held) {
+      CHECK(replay.ReleaseCameraData(outstanding) == MLResult_Ok);
+    }
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.buffers_in_use == 1);
+    CHECK(status.buffers_leased == 1);
+    for (WorldCameraReplay::FrameLease &lease : leases) {
+      CHECK(replay.ReleaseFrameLease(&lease) == MLResult_Ok);
+    }
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.buffers_in_use == 0);
+
+    CHECK(replay.Disconnect() == MLResult_Ok);
+
+    // Full buffered polls of every stream take every buffer, so the next one drops its frames
+    constexpr size_t kFullPollFrames = kWorldCameraStreamCount * WorldCameraReplay::kMaxQueueDepth;
+    static_assert(WorldCameraReplay::kBufferCapacity % kFullPollFrames == 0, "buffers hold whole polls");
+    static_assert(WorldCameraReplay::kBufferCapacity / kFullPollFrames < WorldCameraReplay::kDataCapacity,
+                  "data objects outlast buffers");
+    output = Output(2, WorldCameraReplay::kMaxQueueDepth);
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) == MLResult_Ok);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+    held.clear();
+    for (size_t i = 0; i < WorldCameraReplay::kBufferCapacity / kFullPollFrames; ++i) {
+      CHECK(replay.GetBufferedWorldCameraData(0, &data) == MLResult_Ok);
+      CHECK(data->frame_count == kFullPollFrames);
+      held.push_back(data);
+    }
+    CHECK(replay.GetBufferedWorldCameraData(0, &data) == MLResult_Timeout);
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.buffers_in_use == WorldCameraReplay::kBufferCapacity);
+    CHECK(status.exhausted_frames == kFullPollFrames);
+    for (MLWorldCameraData *outstanding : held) {
+      CHECK(replay.ReleaseCameraData(outstanding) == MLResult_Ok);
+    }
+    CHECK(replay.GetBufferedWorldCameraData(0, &data) == MLResult_Ok);
+    CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // Polls on one thread and releases leases on several others, checking every leased
+  // buffer still holds its frame when it is released.
+  void TestConcurrentRelease(uint32_t downscale) {
+    constexpr size_t kPolls = 5000;
+    constexpr size_t kReleaseThreads = 3;
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    const WorldCameraReplay::OutputSettings output = Output(downscale, 2);
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) == MLResult_Ok);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+
+    std::mutex mutex;
+    std::deque<WorldCameraReplay::FrameLease> in_flight;
+    std::atomic<bool> done{false};
+    std::atomic<size_t> corrupted{0};
+    std::atomic<size_t> released{0};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kReleaseThreads; ++t) {
+      threads.emplace_back([&]() {
+        while (true) {
+          WorldCameraReplay::FrameLease lease;
+          {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (in_flight.empty()) {
+              if (done.load()) {
+                return;
+              }
+              lease.lease_handle = ML_INVALID_HANDLE;
+            } else {
+              lease = in_flight.front();
+              in_flight.pop_front();
+            }
+          }
+          if (lease.lease_handle == ML_INVALID_HANDLE) {
+            std::this_thread::yield();
+            continue;
+          }
+          if (!HoldsFrame(lease)) {
+            ++corrupted;
+          }
+          CHECK(replay.ReleaseFrameLease(&lease) == MLResult_Ok);
+          ++released;
+        }
+      });
+    }
+
+    size_t acquired = 0;
+    for (size_t poll = 0; poll < kPolls; ++poll) {
+      MLWorldCameraData *data = nullptr;
+      const MLResult result = replay.GetBufferedWorldCameraData(0, &data);
+      if (result != MLResult_Ok) {
+        // Every frame dropped because all buffers are leased
+        CHECK(result == MLResult_Timeout);
+        std::this_thread::yield();
+        continue;
+      }
+      for (uint8_t i = 0; i < data->frame_count; ++i) {
+        WorldCameraReplay::FrameLease lease;
+        while (replay.AcquireFrameLease(&data->frames[i], &lease) == MLResult_UnspecifiedFailure) {
+          // Every lease is held; wait for the release threads
+          std::this_thread::yield();
+        }
+        ++acquired;
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight.push_back(lease);
+      }
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+    done = true;
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    WorldCameraReplay::PoolStatus status;
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    std::printf("downscale %u: %zu leases released, %llu frames dropped, peak %u buffers in use\n", downscale,
+                released.load(), static_cast<unsigned long long>(status.exhausted_frames), status.buffers_peak);
+    CHECK(corrupted == 0);
+    CHECK(released == acquired);
+    CHECK(status.data_in_use == 0);
+    CHECK(status.buffers_in_use == 0);
+    CHECK(status.buffers_leased == 0);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+}
+
+int main() {
+  WriteSyntheticCapture(kCapturePath, SyntheticCapture());
+  TestLeaseOutlivesData();
+  TestExhaustion();
+  TestConcurrentRelease(1);
+  TestConcurrentRelease(2);
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,234 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Delivery metrics of WorldCameraReplay, from captures with known drops and jitter:
+  delivered, dropped and duplicated counts, the interval and latency histograms,
+  per cursor drop detection of subscriptions, callbacks, looping and reset.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_replay_metrics_test.wcap";
+  constexpr size_t kFramesPerStream = 60;
+  constexpr size_t kSkipEvery = 5;
+  constexpr MLTime kJitter = 1'500'000;
+  // Frame numbers skipped by the sensor in every stream
+  constexpr uint64_t kSkipped = (kFramesPerStream - 1) / kSkipEvery;
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  WorldCameraReplay::Metrics Metrics(const WorldCameraReplay &replay) {
+    WorldCameraReplay::Metrics metrics;
+    CHECK(replay.GetMetrics(&metrics) == MLResult_Ok);
+    return metrics;
+  }
+
+  uint64_t BinSum(const WorldCameraHistogram &histogram) {
+    uint64_t sum = 0;
+    for (uint64_t bin : histogram.bins) {
+      sum += bin;
+    }
+    return sum;
+  }
+
+  size_t Drain(WorldCameraReplay &replay) {
+    size_t polls = 0;
+    MLWorldCameraData *data = nullptr;
+    while (replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok) {
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+      ++polls;
+    }
+    return polls;
+  }
+
+  // Every frame delivered: drops are exactly the skipped frame numbers, intervals show the jitter.
+  void TestDropsAndJitter() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    CHECK(Metrics(replay).stream_count == 0);
+    Drain(replay);
+
+    const WorldCameraReplay::Metrics metrics = Metrics(replay);
+    CHECK(metrics.stream_count == kWorldCameraStreamCount);
+    const MLTime interval = SyntheticCapture().interval;
+    for (uint32_t i = 0; i < metrics.stream_count; ++i) {
+      const WorldCameraReplay::StreamMetrics &stream = metrics.streams[i];
+      CHECK(WorldCameraStreamIndex(stream.id, stream.frame_type) == i);
+      CHECK(stream.frames_delivered == kFramesPerStream);
+      CHECK(stream.frames_dropped == kSkipped);
+      CHECK(stream.frames_duplicated == 0);
+
+      const WorldCameraHistogram &intervals = stream.interval;
+      CHECK(intervals.bin_width == WorldCameraReplay::kIntervalBinWidth);
+      CHECK(intervals.count == kFramesPerStream - 1);
+      CHECK(BinSum(intervals) == intervals.count);
+      CHECK(intervals.min >= interval - 2 * kJitter && intervals.min < interval);
+      CHECK(intervals.max <= 2 * interval + 2 * kJitter && intervals.max > 2 * interval);
+      // Skips double the interval; everything else lies within the jitter of the nominal interval
+      size_t nominal = 0;
+      for (MLTime bin = (interval - 2 * kJitter) / intervals.bin_width;
+           bin <= (interval + 2 * kJitter) / intervals.bin_width; ++bin) {
+        nominal += intervals.bins[bin];
+      }
+      CHECK(nominal == intervals.count - kSkipped);
+      CHECK(intervals.bins[kWorldCameraHistogramBinCount - 1] == kSkipped);
+
+      CHECK(stream.latency.count == kFramesPerStream);
+      CHECK(stream.latency.min >= 0);
+    }
+
+    CHECK(replay.ResetMetrics() == MLResult_Ok);
+    CHECK(Metrics(replay).stream_count == 0);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    CHECK(replay.ResetMetrics() == MLResult_InvalidParam);
+  }
+
+  // With recorded timing, latest polls every few frames drop the frames in between.
+  void TestLatencyAndLatestDrops() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings) == MLResult_Ok);
+    const MLTime interval = SyntheticCapture().interval;
+    MLWorldCameraData *data = nullptr;
+    for (size_t poll = 0; poll < 10; ++poll) {
+      std::this_thread::sleep_for(std::chrono::nanoseconds(3 * interval));
+      if (replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok) {
+        CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+      }
+    }
+    const WorldCameraReplay::Metrics metrics = Metrics(replay);
+    CHECK(metrics.stream_count == kWorldCameraStreamCount);
+    for (uint32_t i = 0; i < metrics.stream_count; ++i) {
+      const WorldCameraReplay::StreamMetrics &stream = metrics.streams[i];
+      CHECK(stream.frames_delivered > 0 && stream.frames_delivered <= 10);
+      CHECK(stream.frames_dropped > stream.frames_delivered);
+      // A frame is picked up at most one poll period after it became due
+      CHECK(stream.latency.bin_width == WorldCameraReplay::kLatencyBinWidth);
+      CHECK(stream.latency.min >= 0);
+      CHECK(stream.latency.max < 3 * interval + 50'000'000);
+      CHECK(stream.latency.sum >= stream.latency.min * static_cast<MLTime>(stream.latency.count));
+    }
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // Each cursor detects its own drops: a subscription draining everything counts no more than the skips.
+  void TestSubscriptions() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    WorldCameraReplay::SubscriptionSettings subscription_settings;
+    subscription_settings.cameras = MLWorldCameraIdentifier_Left;
+    subscription_settings.mode = MLWorldCameraMode_LowExposure;
+    MLHandle subscription = ML_INVALID_HANDLE;
+    CHECK(replay.CreateSubscription(&subscription_settings, &subscription) == MLResult_Ok);
+    Drain(replay);
+    MLWorldCameraData *data = nullptr;
+    while (replay.GetSubscriptionData(subscription, 0, &data) == MLResult_Ok) {
+      CHECK(replay.ReleaseSubscriptionData(subscription, data) == MLResult_Ok);
+    }
+    const WorldCameraReplay::Metrics metrics = Metrics(replay);
+    CHECK(metrics.stream_count == kWorldCameraStreamCount);
+    for (uint32_t i = 0; i < metrics.stream_count; ++i) {
+      const WorldCameraReplay::StreamMetrics &stream = metrics.streams[i];
+      const bool subscribed =
+              stream.id == MLWorldCameraIdentifier_Left && stream.frame_type == MLWorldCameraFrameType_LowExposure;
+      CHECK(stream.frames_delivered == (subscribed ? 2 : 1) * kFramesPerStream);
+      CHECK(stream.frames_dropped == (subscribed ? 2 : 1) * kSkipped);
+    }
+    CHECK(replay.DestroySubscription(subscription) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // Frame numbers starting over with a loop are not drops.
+  void TestLoop() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) ==
+          MLResult_Ok);
+    MLWorldCameraData *data = nullptr;
+    for (size_t poll = 0; poll < 3 * kFramesPerStream; ++poll) {
+      CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+    const WorldCameraReplay::Metrics metrics = Metrics(replay);
+    for (uint32_t i = 0; i < metrics.stream_count; ++i) {
+      CHECK(metrics.streams[i].frames_delivered == 3 * kFramesPerStream);
+      CHECK(metrics.streams[i].frames_dropped == 3 * kSkipped);
+      CHECK(metrics.streams[i].frames_duplicated == 0);
+      CHECK(metrics.streams[i].interval.count == 3 * (kFramesPerStream - 1));
+    }
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // Callbacks record when they are invoked; a callback slower than the frame rate shows up as drops.
+  void TestCallbacks() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings) == MLResult_Ok);
+    std::atomic<size_t> frames{0};
+    WorldCameraReplay::Callbacks callbacks;
+    callbacks.queue_policy = WorldCameraReplay::QueuePolicy::DropNewest;
+    callbacks.on_data_available = [](const MLWorldCameraData *data, void *user_data) {
+      static_cast<std::atomic<size_t> *>(user_data)->fetch_add(data->frame_count);
+      std::this_thread::sleep_for(std::chrono::milliseconds(150));
+    };
+    CHECK(replay.SetCallbacks(&callbacks, &frames) == MLResult_Ok);
+    std::this_thread::sleep_for(std::chrono::milliseconds(900));
+    CHECK(replay.SetCallbacks(nullptr, nullptr) == MLResult_Ok);
+
+    const WorldCameraReplay::Metrics metrics = Metrics(replay);
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    for (uint32_t i = 0; i < metrics.stream_count; ++i) {
+      delivered += metrics.streams[i].frames_delivered;
+      dropped += metrics.streams[i].frames_dropped;
+      CHECK(metrics.streams[i].latency.count == metrics.streams[i].frames_delivered);
+    }
+    CHECK(delivered == frames);
+    // Frames arrive five times faster than the callback returns, so most are dropped from the full queue
+    CHECK(delivered > 0);
+    CHECK(dropped > delivered);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.frames_per_stream = kFramesPerStream;
+  capture.skip_every = kSkipEvery;
+  capture.jitter = kJitter;
+  WriteSyntheticCapture(kCapturePath, capture);
+  TestDropsAndJitter();
+  TestLatencyAndLatestDrops();
+  TestSubscriptions();
+  TestLoop();
+  TestCallbacks();
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,103 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Simulates a consumer that stalls periodically, e.g. on a slow frame, while the
+  replay delivers six 30 Hz streams at their recorded pace, and compares the drop
+  rate and latency of latest polls with buffered polls of two queue depths. Drops
+  and latency come from the replay's delivery metrics.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  const char *kCapturePath = "world_camera_replay_polling_benchmark.wcap";
+  constexpr auto kDuration = std::chrono::seconds(2);
+  constexpr auto kStallPeriod = std::chrono::milliseconds(200);
+
+  void Run(std::chrono::milliseconds stall, uint32_t queue_depth) {
+    WorldCameraReplay replay;
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::Recorded, true) == MLResult_Ok);
+    const bool buffered = queue_depth > 1;
+    WorldCameraReplay::OutputSettings output;
+    output.queue_depth.fill(queue_depth);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+
+    const Clock::time_point start = Clock::now();
+    Clock::time_point next_stall = start + kStallPeriod;
+    for (Clock::time_point now = start; now < start + kDuration; now = Clock::now()) {
+      if (now >= next_stall) {
+        std::this_thread::sleep_for(stall);
+        next_stall += kStallPeriod;
+      }
+      MLWorldCameraData *data = nullptr;
+      const MLResult result = buffered ? replay.GetBufferedWorldCameraData(5, &data)
+                                       : replay.GetLatestWorldCameraData(5, &data);
+      if (result == MLResult_Ok) {
+        CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+      } else {
+        CHECK(result == MLResult_Timeout);
+      }
+    }
+
+    WorldCameraReplay::Metrics metrics;
+    CHECK(replay.GetMetrics(&metrics) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    uint64_t delivered = 0, dropped = 0, latency_count = 0;
+    MLTime latency_sum = 0, latency_max = 0;
+    for (uint32_t i = 0; i < metrics.stream_count; ++i) {
+      const WorldCameraReplay::StreamMetrics &stream = metrics.streams[i];
+      delivered += stream.frames_delivered;
+      dropped += stream.frames_dropped;
+      latency_count += stream.latency.count;
+      latency_sum += stream.latency.sum;
+      latency_max = std::max(latency_max, stream.latency.max);
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), buffered ? "buffered, depth %u" : "latest", queue_depth);
+    std::printf("stall %3lld ms  %-18s %5llu delivered %5llu dropped (%5.1f%%)  latency mean %6.1f ms max %6.1f ms\n",
+                static_cast<long long>(stall.count()), name, static_cast<unsigned long long>(delivered),
+                static_cast<unsigned long long>(dropped),
+                delivered + dropped > 0 ? 100.0 * dropped / (delivered + dropped) : 0.0,
+                latency_count > 0 ? latency_sum / 1e6 / latency_count : 0.0, latency_max / 1e6);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.frames_per_stream = 60;
+  WriteSyntheticCapture(kCapturePath, capture);
+  std::printf("6 streams at 30 Hz, consumer stalls once every %lld ms\n",
+              static_cast<long long>(kStallPeriod.count()));
+  for (int stall_ms : {0, 50, 100, 150}) {
+    for (uint32_t queue_depth : {1u, 4u, 8u}) {
+      Run(std::chrono::milliseconds(stall_ms), queue_depth);
+    }
+  }
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,140 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Poses of WorldCameraReplay: lookups interpolate between the replayed frames of a
+  camera, only cover the newest WorldCameraPoseHistory::kCapacity of them and the
+  current loop, and follow the recorded timing.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_replay_pose_test.wcap";
+  constexpr size_t kFramesPerStream = 60;
+  constexpr float kTolerance = 1e-5f;
+
+  const SyntheticCapture kCapture = [] {
+    SyntheticCapture capture;
+    capture.frames_per_stream = kFramesPerStream;
+    return capture;
+  }();
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  // Nominal time of the normal exposure frame n, which the low exposure frame follows by a quarter interval
+  MLTime FrameTime(double n) {
+    return kCapture.first_timestamp + static_cast<MLTime>(n * kCapture.interval);
+  }
+
+  void Poll(WorldCameraReplay &replay, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+      MLWorldCameraData *data = nullptr;
+      CHECK(replay.GetLatestWorldCameraData(0, &data) == MLResult_Ok);
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+  }
+
+  bool IsPoseAt(const WorldCameraReplay &replay, MLWorldCameraIdentifier camera, MLTime time) {
+    MLTransform pose = {};
+    if (replay.GetPoseAtTime(camera, time, &pose) != MLResult_Ok) {
+      return false;
+    }
+    const MLTransform expected = SyntheticPose(camera, time);
+    return std::fabs(pose.position.x - expected.position.x) < kTolerance &&
+           std::fabs(pose.position.y - expected.position.y) < kTolerance && pose.rotation.w == 1.0f;
+  }
+
+  MLResult PoseResult(const WorldCameraReplay &replay, MLWorldCameraIdentifier camera, MLTime time) {
+    MLTransform pose = {};
+    return replay.GetPoseAtTime(camera, time, &pose);
+  }
+
+  void TestHistory() {
+    WorldCameraReplay replay;
+    MLTransform pose = {};
+    CHECK(replay.GetPoseAtTime(MLWorldCameraIdentifier_Left, FrameTime(0), &pose) == MLResult_InvalidParam);
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    CHECK(replay.GetPoseAtTime(MLWorldCameraIdentifier_All, FrameTime(0), &pose) == MLResult_InvalidParam);
+    CHECK(replay.GetPoseAtTime(MLWorldCameraIdentifier_Left, FrameTime(0), nullptr) == MLResult_InvalidParam);
+    CHECK(PoseResult(replay, MLWorldCameraIdentifier_Left, FrameTime(0)) == MLResult_Timeout);
+
+    // Every latest poll collects one frame of each stream, so 40 polls replay 80 frames
+    // per camera of which the history keeps the newest 64, frames 8 to 39
+    Poll(replay, 40);
+    for (MLWorldCameraIdentifier camera : {MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right,
+                                           MLWorldCameraIdentifier_Center}) {
+      CHECK(IsPoseAt(replay, camera, FrameTime(8)));
+      CHECK(IsPoseAt(replay, camera, FrameTime(20.1)));
+      CHECK(IsPoseAt(replay, camera, FrameTime(30.6)));
+      CHECK(IsPoseAt(replay, camera, FrameTime(39.25)));
+      CHECK(PoseResult(replay, camera, FrameTime(7.9)) == MLResult_Timeout);
+      CHECK(PoseResult(replay, camera, FrameTime(39.3)) == MLResult_Timeout);
+    }
+    // Every camera has its own history
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    SyntheticCapture left_only = kCapture;
+    left_only.cameras = MLWorldCameraIdentifier_Left;
+    WriteSyntheticCapture(kCapturePath, left_only);
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    Poll(replay, 10);
+    CHECK(IsPoseAt(replay, MLWorldCameraIdentifier_Left, FrameTime(5)));
+    CHECK(PoseResult(replay, MLWorldCameraIdentifier_Right, FrameTime(5)) == MLResult_Timeout);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    WriteSyntheticCapture(kCapturePath, kCapture);
+  }
+
+  void TestLoop() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) ==
+          MLResult_Ok);
+    Poll(replay, kFramesPerStream + 5);
+    // Only the frames of the second loop are in the history
+    CHECK(IsPoseAt(replay, MLWorldCameraIdentifier_Center, FrameTime(2.5)));
+    CHECK(PoseResult(replay, MLWorldCameraIdentifier_Center, FrameTime(kFramesPerStream - 2)) == MLResult_Timeout);
+  }
+
+  void TestRecorded() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::Recorded) == MLResult_Ok);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    // Without a single poll, frames that are due are in the history and later ones are not
+    CHECK(IsPoseAt(replay, MLWorldCameraIdentifier_Right, FrameTime(2.5)));
+    CHECK(PoseResult(replay, MLWorldCameraIdentifier_Right, FrameTime(50)) == MLResult_Timeout);
+  }
+}
+
+int main() {
+  WriteSyntheticCapture(kCapturePath, kCapture);
+  TestHistory();
+  TestLoop();
+  TestRecorded();
+  std::remove(kCapturePath);
+  return 0;
+}
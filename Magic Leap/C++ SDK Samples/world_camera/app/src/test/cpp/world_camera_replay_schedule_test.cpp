@@ -0,0 +1,156 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <array>
+#include <cstdio>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Exposure schedules of WorldCameraReplay: target rates thin the recorded frames of
+  each mode, modes recorded below their target keep every frame, invalid schedules
+  are rejected and a new connection delivers every frame again.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_replay_schedule_test.wcap";
+  // 10 s of frames at 30 Hz per camera and frame type, so every camera has 60 slots per second
+  constexpr size_t kFramesPerStream = 300;
+  constexpr double kSeconds = 10.0;
+
+  using StreamCounts = std::array<size_t, kWorldCameraStreamCount>;
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  // Buffered polls keep every frame due at once
+  void ConnectBuffered(WorldCameraReplay &replay) {
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    WorldCameraReplay::OutputSettings output;
+    output.queue_depth.fill(WorldCameraReplay::kMaxQueueDepth);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+  }
+
+  WorldCameraSchedule Schedule(float low_rate, float normal_rate) {
+    WorldCameraSchedule schedule;
+    for (auto &camera_rates : schedule.target_rate) {
+      camera_rates[0] = low_rate;
+      camera_rates[1] = normal_rate;
+    }
+    return schedule;
+  }
+
+  // Drains the replay, checking the frames of every stream arrive in order.
+  StreamCounts Drain(WorldCameraReplay &replay) {
+    StreamCounts counts = {};
+    std::array<int64_t, kWorldCameraStreamCount> last = {};
+    last.fill(-1);
+    MLWorldCameraData *data = nullptr;
+    while (replay.GetBufferedWorldCameraData(0, &data) == MLResult_Ok) {
+      for (uint8_t i = 0; i < data->frame_count; ++i) {
+        const MLWorldCameraFrame &frame = data->frames[i];
+        const size_t stream = WorldCameraStreamIndex(frame);
+        CHECK(stream < counts.size());
+        CHECK(frame.frame_number > last[stream]);
+        last[stream] = frame.frame_number;
+        ++counts[stream];
+      }
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+    return counts;
+  }
+
+  StreamCounts Replay(const WorldCameraSchedule *schedule) {
+    WorldCameraReplay replay;
+    ConnectBuffered(replay);
+    if (schedule) {
+      CHECK(replay.SetSchedule(schedule) == MLResult_Ok);
+    }
+    return Drain(replay);
+  }
+
+  bool IsNear(size_t count, double expected, double tolerance) {
+    return count >= expected - tolerance && count <= expected + tolerance;
+  }
+
+  void TestRates() {
+    // Low exposure is thinned to its target; normal exposure may take the remaining 50 Hz
+    // of slots but was only recorded at 30 Hz, so it keeps every frame
+    const WorldCameraSchedule schedule = Schedule(10.0f, 0.0f);
+    const StreamCounts counts = Replay(&schedule);
+    for (size_t camera = 0; camera < kWorldCameraCount; ++camera) {
+      std::printf("camera %zu: low %zu, normal %zu\n", camera, counts[camera * 2], counts[camera * 2 + 1]);
+      CHECK(IsNear(counts[camera * 2], 10.0 * kSeconds, 3.0));
+      CHECK(IsNear(counts[camera * 2 + 1], kFramesPerStream, 3.0));
+    }
+
+    const WorldCameraSchedule both = Schedule(5.0f, 20.0f);
+    const StreamCounts both_counts = Replay(&both);
+    for (size_t camera = 0; camera < kWorldCameraCount; ++camera) {
+      CHECK(IsNear(both_counts[camera * 2], 5.0 * kSeconds, 3.0));
+      CHECK(IsNear(both_counts[camera * 2 + 1], 20.0 * kSeconds, 3.0));
+    }
+  }
+
+  void TestInvalidSchedule() {
+    WorldCameraReplay replay;
+    WorldCameraSchedule schedule = Schedule(10.0f, 10.0f);
+    CHECK(replay.SetSchedule(&schedule) == MLResult_InvalidParam);
+    ConnectBuffered(replay);
+    CHECK(replay.SetSchedule(nullptr) == MLResult_InvalidParam);
+    schedule.target_rate[1][0] = -1.0f;
+    CHECK(replay.SetSchedule(&schedule) == MLResult_InvalidParam);
+    schedule = Schedule(10.0f, 10.0f);
+    schedule.priority_mode = static_cast<MLWorldCameraMode>(MLWorldCameraMode_LowExposure |
+                                                            MLWorldCameraMode_NormalExposure);
+    CHECK(replay.SetSchedule(&schedule) == MLResult_InvalidParam);
+    // Rejected schedules leave every frame scheduled
+    for (size_t count : Drain(replay)) {
+      CHECK(count == kFramesPerStream);
+    }
+  }
+
+  void TestConnectResetsSchedule() {
+    for (size_t count : Replay(nullptr)) {
+      CHECK(count == kFramesPerStream);
+    }
+    WorldCameraReplay replay;
+    const WorldCameraSchedule schedule = Schedule(1.0f, 1.0f);
+    ConnectBuffered(replay);
+    CHECK(replay.SetSchedule(&schedule) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    ConnectBuffered(replay);
+    for (size_t count : Drain(replay)) {
+      CHECK(count == kFramesPerStream);
+    }
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.frames_per_stream = kFramesPerStream;
+  WriteSyntheticCapture(kCapturePath, capture);
+  TestRates();
+  TestInvalidSchedule();
+  TestConnectResetsSchedule();
+  std::remove(kCapturePath);
+  return 0;
+}
@@ -0,0 +1,111 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Measures how subscriptions scale with the number of consumers: every consumer polls
+  its own subscription of all cameras on its own thread, replaying a looping capture as
+  fast as possible, and reports the frames it received and its poll latency.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  const char *kCapturePath = "world_camera_replay_subscription_benchmark.wcap";
+  constexpr auto kDuration = std::chrono::milliseconds(500);
+
+  struct Consumer {
+    MLHandle subscription = ML_INVALID_HANDLE;
+    size_t frames = 0;
+    std::vector<double> latencies_us;
+  };
+
+  void Run(size_t consumer_count) {
+    WorldCameraReplay replay;
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible, true) ==
+          MLResult_Ok);
+
+    WorldCameraReplay::SubscriptionSettings subscription_settings;
+    subscription_settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    std::vector<Consumer> consumers(consumer_count);
+    for (Consumer &consumer : consumers) {
+      CHECK(replay.CreateSubscription(&subscription_settings, &consumer.subscription) == MLResult_Ok);
+      consumer.latencies_us.reserve(1 << 20);
+    }
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (Consumer &consumer : consumers) {
+      threads.emplace_back([&replay, &consumer, &go]() {
+        while (!go.load(std::memory_order_acquire)) {
+          std::this_thread::yield();
+        }
+        const Clock::time_point end = Clock::now() + kDuration;
+        for (Clock::time_point now = Clock::now(); now < end;) {
+          MLWorldCameraData *data = nullptr;
+          CHECK(replay.GetSubscriptionData(consumer.subscription, 0, &data) == MLResult_Ok);
+          const Clock::time_point polled = Clock::now();
+          consumer.latencies_us.push_back(std::chrono::duration<double, std::micro>(polled - now).count());
+          consumer.frames += data->frame_count;
+          CHECK(replay.ReleaseSubscriptionData(consumer.subscription, data) == MLResult_Ok);
+          now = Clock::now();
+        }
+      });
+    }
+    go.store(true, std::memory_order_release);
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    size_t frames = 0;
+    std::vector<double> latencies_us;
+    for (Consumer &consumer : consumers) {
+      frames += consumer.frames;
+      latencies_us.insert(latencies_us.end(), consumer.latencies_us.begin(), consumer.latencies_us.end());
+      CHECK(replay.DestroySubscription(consumer.subscription) == MLResult_Ok);
+    }
+    CHECK(replay.Disconnect() == MLResult_Ok);
+    std::sort(latencies_us.begin(), latencies_us.end());
+    const double seconds = std::chrono::duration<double>(kDuration).count();
+    std::printf("%2zu consumers  %10.0f frames/s per consumer  %10.0f frames/s total  poll p99 %7.2f us\n",
+                consumer_count, frames / seconds / consumer_count, frames / seconds,
+                latencies_us.empty() ? 0.0 : latencies_us[latencies_us.size() * 99 / 100]);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.width = 640;
+  capture.height = 480;
+  WriteSyntheticCapture(kCapturePath, capture);
+  std::printf("%u hardware threads\n", std::thread::hardware_concurrency());
+  for (size_t consumers = 1; consumers <= WorldCameraReplay::kMaxSubscriptions; consumers *= 2) {
+    Run(consumers);
+  }
+  std::remove(kCapturePath);
+  return 0;
+}
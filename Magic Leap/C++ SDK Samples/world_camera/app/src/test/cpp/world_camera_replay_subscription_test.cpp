@@ -0,0 +1,241 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <array>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+
+/*
+  Subscriptions of WorldCameraReplay: concurrent consumers of different cameras each
+  see every frame of their streams exactly once and in order, handle checks, settings
+  changes and where a subscription starts with recorded timing.
+*/
+
+namespace {
+
+  const char *kCapturePath = "world_camera_replay_subscription_test.wcap";
+  constexpr size_t kFramesPerStream = 300;
+
+  MLWorldCameraSettings Settings() {
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.mode = MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure;
+    settings.cameras = MLWorldCameraIdentifier_All;
+    return settings;
+  }
+
+  WorldCameraReplay::SubscriptionSettings SubscriptionSettings(uint32_t cameras, uint32_t mode) {
+    WorldCameraReplay::SubscriptionSettings settings;
+    settings.cameras = cameras;
+    settings.mode = mode;
+    return settings;
+  }
+
+  bool IsSelected(const MLWorldCameraFrame &frame, uint32_t cameras, uint32_t mode) {
+    const uint32_t frame_mode = frame.frame_type == MLWorldCameraFrameType_LowExposure
+                                        ? MLWorldCameraMode_LowExposure
+                                        : MLWorldCameraMode_NormalExposure;
+    return (frame.id & cameras) != 0 && (frame_mode & mode) != 0;
+  }
+
+  // Drains a subscription, checking every frame of the selected streams arrives once, in order.
+  void Consume(WorldCameraReplay &replay, MLHandle subscription, uint32_t cameras, uint32_t mode) {
+    std::array<int64_t, kWorldCameraStreamCount> next = {};
+    MLWorldCameraData *data = nullptr;
+    while (replay.GetSubscriptionData(subscription, 0, &data) == MLResult_Ok) {
+      for (uint8_t i = 0; i < data->frame_count; ++i) {
+        const MLWorldCameraFrame &frame = data->frames[i];
+        CHECK(IsSelected(frame, cameras, mode));
+        const size_t stream = WorldCameraStreamIndex(frame);
+        CHECK(stream < next.size());
+        CHECK(frame.frame_number == next[stream]++);
+        CHECK(IsUniform(frame.frame_buffer, SyntheticPixel(frame.id, frame.frame_number)));
+      }
+      CHECK(replay.ReleaseSubscriptionData(subscription, data) == MLResult_Ok);
+    }
+    for (MLWorldCameraIdentifier camera : {MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right,
+                                           MLWorldCameraIdentifier_Center}) {
+      for (MLWorldCameraFrameType frame_type : {MLWorldCameraFrameType_LowExposure,
+                                                MLWorldCameraFrameType_NormalExposure}) {
+        MLWorldCameraFrame frame = {};
+        frame.id = camera;
+        frame.frame_type = frame_type;
+        const int64_t expected = IsSelected(frame, cameras, mode) ? static_cast<int64_t>(kFramesPerStream) : 0;
+        CHECK(next[WorldCameraStreamIndex(frame)] == expected);
+      }
+    }
+  }
+
+  void TestConcurrentConsumers() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+
+    struct Consumer {
+      uint32_t cameras;
+      uint32_t mode;
+      MLHandle subscription;
+    };
+    std::vector<Consumer> consumers = {
+            {MLWorldCameraIdentifier_Left, MLWorldCameraMode_NormalExposure, 0},
+            {MLWorldCameraIdentifier_Right | MLWorldCameraIdentifier_Center, MLWorldCameraMode_LowExposure, 0},
+            {MLWorldCameraIdentifier_All, MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure, 0},
+            {MLWorldCameraIdentifier_Center, MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure, 0},
+    };
+    for (Consumer &consumer : consumers) {
+      const WorldCameraReplay::SubscriptionSettings subscription_settings =
+              SubscriptionSettings(consumer.cameras, consumer.mode);
+      CHECK(replay.CreateSubscription(&subscription_settings, &consumer.subscription) == MLResult_Ok);
+    }
+    std::vector<std::thread> threads;
+    for (const Consumer &consumer : consumers) {
+      threads.emplace_back([&replay, consumer]() {
+        Consume(replay, consumer.subscription, consumer.cameras, consumer.mode);
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+
+    WorldCameraReplay::PoolStatus status;
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.data_in_use == 0);
+    CHECK(status.buffers_in_use == 0);
+    CHECK(status.exhausted_frames == 0);
+    for (const Consumer &consumer : consumers) {
+      CHECK(replay.DestroySubscription(consumer.subscription) == MLResult_Ok);
+    }
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  void TestHandles() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+
+    MLHandle subscription = ML_INVALID_HANDLE;
+    WorldCameraReplay::SubscriptionSettings subscription_settings =
+        SubscriptionSettings(0, MLWorldCameraMode_LowExposure);
+    CHECK(replay.CreateSubscription(&subscription_settings, &subscription) == MLResult_InvalidParam);
+    subscription_settings = SubscriptionSettings(MLWorldCameraIdentifier_Left, 0);
+    CHECK(replay.CreateSubscription(&subscription_settings, &subscription) == MLResult_InvalidParam);
+
+    // Every subscription in use
+    subscription_settings = WorldCameraReplay::SubscriptionSettings();
+    std::vector<MLHandle> subscriptions(WorldCameraReplay::kMaxSubscriptions);
+    for (MLHandle &created : subscriptions) {
+      CHECK(replay.CreateSubscription(&subscription_settings, &created) == MLResult_Ok);
+    }
+    CHECK(replay.CreateSubscription(&subscription_settings, &subscription) == MLResult_UnspecifiedFailure);
+
+    // Data objects belong to their subscription
+    MLWorldCameraData *data = nullptr;
+    CHECK(replay.GetSubscriptionData(subscriptions[0], 0, &data) == MLResult_Ok);
+    CHECK(replay.ReleaseSubscriptionData(subscriptions[1], data) == MLResult_InvalidParam);
+    CHECK(replay.ReleaseCameraData(data) == MLResult_InvalidParam);
+
+    // A frame of subscription data can be leased and outlives the subscription
+    WorldCameraReplay::FrameLease lease;
+    CHECK(replay.AcquireFrameLease(&data->frames[0], &lease) == MLResult_Ok);
+
+    // Each subscription has its own data objects
+    std::vector<MLWorldCameraData *> held;
+    for (size_t i = 1; i < WorldCameraReplay::kSubscriptionDataCapacity; ++i) {
+      CHECK(replay.GetSubscriptionData(subscriptions[0], 0, &data) == MLResult_Ok);
+      held.push_back(data);
+    }
+    CHECK(replay.GetSubscriptionData(subscriptions[0], 0, &data) == MLResult_AllocFailed);
+    CHECK(replay.GetSubscriptionData(subscriptions[1], 0, &data) == MLResult_Ok);
+    CHECK(replay.ReleaseSubscriptionData(subscriptions[1], data) == MLResult_Ok);
+
+    // Destroying releases outstanding data
+    for (MLHandle destroyed : subscriptions) {
+      CHECK(replay.DestroySubscription(destroyed) == MLResult_Ok);
+      CHECK(replay.DestroySubscription(destroyed) == MLResult_InvalidParam);
+      CHECK(replay.GetSubscriptionData(destroyed, 0, &data) == MLResult_InvalidParam);
+    }
+    WorldCameraReplay::PoolStatus status;
+    CHECK(replay.GetPoolStatus(&status) == MLResult_Ok);
+    CHECK(status.data_in_use == 0);
+    CHECK(status.buffers_in_use == 1);
+    CHECK(IsUniform(lease.frame_buffer, SyntheticPixel(lease.id, lease.frame_number)));
+    CHECK(replay.ReleaseFrameLease(&lease) == MLResult_Ok);
+    CHECK(replay.DestroySubscription(ML_INVALID_HANDLE) == MLResult_InvalidParam);
+    CHECK(replay.DestroySubscription(WorldCameraReplay::kMaxSubscriptions + 1) == MLResult_InvalidParam);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // Settings narrow what every subscription receives from the next poll on.
+  void TestUpdateSettings() {
+    WorldCameraReplay replay;
+    MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    const WorldCameraReplay::SubscriptionSettings subscription_settings = SubscriptionSettings(
+            MLWorldCameraIdentifier_All, MLWorldCameraMode_NormalExposure | MLWorldCameraMode_LowExposure);
+    MLHandle subscription = ML_INVALID_HANDLE;
+    CHECK(replay.CreateSubscription(&subscription_settings, &subscription) == MLResult_Ok);
+
+    MLWorldCameraData *data = nullptr;
+    CHECK(replay.GetSubscriptionData(subscription, 0, &data) == MLResult_Ok);
+    CHECK(data->frame_count == kWorldCameraStreamCount);
+    CHECK(replay.ReleaseSubscriptionData(subscription, data) == MLResult_Ok);
+
+    settings.cameras = MLWorldCameraIdentifier_Left;
+    settings.mode = MLWorldCameraMode_LowExposure;
+    CHECK(replay.UpdateSettings(&settings) == MLResult_Ok);
+    CHECK(replay.GetSubscriptionData(subscription, 0, &data) == MLResult_Ok);
+    CHECK(data->frame_count == 1);
+    CHECK(data->frames[0].id == MLWorldCameraIdentifier_Left);
+    CHECK(data->frames[0].frame_type == MLWorldCameraFrameType_LowExposure);
+    CHECK(data->frames[0].frame_number == 1);
+    CHECK(replay.ReleaseSubscriptionData(subscription, data) == MLResult_Ok);
+    CHECK(replay.DestroySubscription(subscription) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+
+  // With recorded timing a subscription does not see frames due before it was created.
+  void TestRecordedStart() {
+    WorldCameraReplay replay;
+    const MLWorldCameraSettings settings = Settings();
+    CHECK(replay.Connect(kCapturePath, &settings) == MLResult_Ok);
+    std::this_thread::sleep_for(std::chrono::nanoseconds(SyntheticCapture().interval * 3));
+    WorldCameraReplay::SubscriptionSettings subscription_settings;
+    MLHandle subscription = ML_INVALID_HANDLE;
+    CHECK(replay.CreateSubscription(&subscription_settings, &subscription) == MLResult_Ok);
+    MLWorldCameraData *data = nullptr;
+    CHECK(replay.GetSubscriptionData(subscription, 1000, &data) == MLResult_Ok);
+    CHECK(data->frame_count > 0);
+    for (uint8_t i = 0; i < data->frame_count; ++i) {
+      CHECK(data->frames[i].frame_number >= 3);
+    }
+    CHECK(replay.ReleaseSubscriptionData(subscription, data) == MLResult_Ok);
+    CHECK(replay.DestroySubscription(subscription) == MLResult_Ok);
+    CHECK(replay.Disconnect() == MLResult_Ok);
+  }
+}
+
+int main() {
+  SyntheticCapture capture;
+  capture.frames_per_stream = kFramesPerStream;
+  WriteSyntheticCapture(kCapturePath, capture);
+  TestConcurrentConsumers();
+  TestHandles();
+  TestUpdateSettings();
+  TestRecordedStart();
+  std::remove(kCapturePath);
+  return 0;
+}
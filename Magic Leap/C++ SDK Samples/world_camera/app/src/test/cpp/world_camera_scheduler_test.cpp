@@ -0,0 +1,155 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <cmath>
+#include <cstdio>
+
+#include "world_camera_scheduler.h"
+#include "world_camera_test.h"
+
+/*
+  SimulateWorldCameraSchedule: oversubscribed cameras are scaled down while the report
+  keeps the requested rates and the latency against them grows, rates of 0 share the
+  leftover slots, the priority mode wins ties, and invalid schedules report nothing.
+*/
+
+namespace {
+
+  constexpr MLTime kDuration = 10'000'000'000;
+  constexpr double kSeconds = 10.0;
+  constexpr uint32_t kBothModes = MLWorldCameraMode_LowExposure | MLWorldCameraMode_NormalExposure;
+
+  WorldCameraSchedule Schedule(float low_rate, float normal_rate,
+                               MLWorldCameraMode priority_mode = MLWorldCameraMode_Unknown) {
+    WorldCameraSchedule schedule;
+    for (auto &camera_rates : schedule.target_rate) {
+      camera_rates = {low_rate, normal_rate};
+    }
+    schedule.priority_mode = priority_mode;
+    return schedule;
+  }
+
+  bool IsNear(double value, double expected, double tolerance) {
+    return std::fabs(value - expected) <= tolerance;
+  }
+
+  // Longest a frame waits when its mode always gets a slot within one slot of being due
+  MLTime BoundedLatency(const WorldCameraSensorModel &sensor, size_t mode) {
+    return static_cast<MLTime>(2e9 / sensor.slot_rate) + sensor.exposure[mode] + sensor.readout;
+  }
+
+  void TestOversubscription() {
+    const WorldCameraSensorModel sensor;
+    const WorldCameraScheduleReport report =
+        SimulateWorldCameraSchedule(Schedule(40.0f, 40.0f), kBothModes, sensor, kDuration);
+    for (const auto &camera : report.modes) {
+      for (const WorldCameraScheduleReport::Mode &mode : camera) {
+        CHECK(mode.target_rate == 40.0);
+        CHECK(IsNear(mode.resolved_rate, 30.0, 1e-9));
+        CHECK(IsNear(mode.achieved_rate, 30.0, 0.2));
+        CHECK(IsNear(static_cast<double>(mode.frames), 30.0 * kSeconds, 2.0));
+        // Frames fall further behind the requested 40 Hz every second: the last one is due
+        // at 7.5 s and delivered at 10 s
+        CHECK(mode.max_latency > 2'000'000'000);
+        CHECK(mode.mean_latency > 1'000'000'000);
+      }
+    }
+
+    // Meeting the same rates leaves latency bounded by a slot
+    const WorldCameraScheduleReport met =
+        SimulateWorldCameraSchedule(Schedule(30.0f, 30.0f), kBothModes, sensor, kDuration);
+    for (const auto &camera : met.modes) {
+      for (size_t mode = 0; mode < WorldCameraExposureScheduler::kModeCount; ++mode) {
+        CHECK(camera[mode].target_rate == 30.0);
+        CHECK(IsNear(camera[mode].achieved_rate, 30.0, 0.2));
+        CHECK(camera[mode].max_latency <= BoundedLatency(sensor, mode));
+      }
+    }
+  }
+
+  void TestShareLeftover() {
+    const WorldCameraSensorModel sensor;
+    const WorldCameraScheduleReport report =
+        SimulateWorldCameraSchedule(Schedule(20.0f, 0.0f), kBothModes, sensor, kDuration);
+    for (const auto &camera : report.modes) {
+      CHECK(camera[0].target_rate == 20.0);
+      CHECK(IsNear(camera[0].achieved_rate, 20.0, 0.2));
+      // The leftover share requests nothing and is given the other 40 Hz
+      CHECK(camera[1].target_rate == 0.0);
+      CHECK(IsNear(camera[1].resolved_rate, 40.0, 1e-9));
+      CHECK(IsNear(camera[1].achieved_rate, 40.0, 0.2));
+      for (size_t mode = 0; mode < WorldCameraExposureScheduler::kModeCount; ++mode) {
+        CHECK(camera[mode].max_latency <= BoundedLatency(sensor, mode));
+      }
+    }
+
+    // Two leftover shares split every slot, and a single enabled mode takes them all
+    const WorldCameraScheduleReport shared =
+        SimulateWorldCameraSchedule(Schedule(0.0f, 0.0f), kBothModes, sensor, kDuration);
+    const WorldCameraScheduleReport single =
+        SimulateWorldCameraSchedule(Schedule(0.0f, 0.0f), MLWorldCameraMode_NormalExposure, sensor, kDuration);
+    for (size_t camera = 0; camera < kWorldCameraCount; ++camera) {
+      CHECK(IsNear(shared.modes[camera][0].achieved_rate, 30.0, 0.2));
+      CHECK(IsNear(shared.modes[camera][1].achieved_rate, 30.0, 0.2));
+      CHECK(single.modes[camera][0].frames == 0);
+      CHECK(IsNear(single.modes[camera][1].achieved_rate, 60.0, 0.2));
+    }
+  }
+
+  void TestPriorityMode() {
+    // At 30 Hz each both modes are due in every other slot, so every pair of slots is a tie
+    const WorldCameraSensorModel sensor;
+    const WorldCameraScheduleReport low = SimulateWorldCameraSchedule(
+            Schedule(30.0f, 30.0f, MLWorldCameraMode_LowExposure), kBothModes, sensor, kDuration);
+    const WorldCameraScheduleReport normal = SimulateWorldCameraSchedule(
+            Schedule(30.0f, 30.0f, MLWorldCameraMode_NormalExposure), kBothModes, sensor, kDuration);
+    for (size_t camera = 0; camera < kWorldCameraCount; ++camera) {
+      const MLTime low_wait = low.modes[camera][0].mean_latency - sensor.exposure[0] - sensor.readout;
+      const MLTime low_wait_unfavoured = normal.modes[camera][0].mean_latency - sensor.exposure[0] - sensor.readout;
+      const MLTime normal_wait = normal.modes[camera][1].mean_latency - sensor.exposure[1] - sensor.readout;
+      const MLTime normal_wait_unfavoured = low.modes[camera][1].mean_latency - sensor.exposure[1] - sensor.readout;
+      std::printf("camera %zu: low waits %lld ns favoured, %lld ns not; normal %lld ns favoured, %lld ns not\n",
+                  camera, static_cast<long long>(low_wait), static_cast<long long>(low_wait_unfavoured),
+                  static_cast<long long>(normal_wait), static_cast<long long>(normal_wait_unfavoured));
+      CHECK(low_wait < low_wait_unfavoured);
+      CHECK(normal_wait < normal_wait_unfavoured);
+      // Priority only reorders the slots
+      CHECK(low.modes[camera][0].frames == normal.modes[camera][0].frames);
+      CHECK(low.modes[camera][1].frames == normal.modes[camera][1].frames);
+    }
+  }
+
+  void TestInvalidSchedule() {
+    const WorldCameraSensorModel sensor;
+    WorldCameraSchedule negative = Schedule(10.0f, 10.0f);
+    negative.target_rate[2][1] = -1.0f;
+    const WorldCameraSchedule both_priority = Schedule(
+            10.0f, 10.0f, static_cast<MLWorldCameraMode>(MLWorldCameraMode_LowExposure | MLWorldCameraMode_NormalExposure));
+    for (const WorldCameraSchedule &schedule : {negative, both_priority}) {
+      const WorldCameraScheduleReport report = SimulateWorldCameraSchedule(schedule, kBothModes, sensor, kDuration);
+      for (const auto &camera : report.modes) {
+        for (const WorldCameraScheduleReport::Mode &mode : camera) {
+          CHECK(mode.frames == 0 && mode.target_rate == 0.0);
+        }
+      }
+    }
+  }
+}
+
+int main() {
+  TestOversubscription();
+  TestShareLeftover();
+  TestPriorityMode();
+  TestInvalidSchedule();
+  return 0;
+}
@@ -0,0 +1,171 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "world_camera_sequence_tracker.h"
+#include "world_camera_test.h"
+
+/*
+  Compares WorldCameraSequenceTracker with the dropped frame check it replaced, which
+  looked up the last frame number and the drop count of every frame in two
+  std::map<CameraIdModePair, ...>. Both see the 6 streams interleaved as polled, with
+  a frame dropped every 50 frames and one stream rolling over from INT64_MAX to 0.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+  using CameraIdModePair = std::pair<MLWorldCameraIdentifier, MLWorldCameraFrameType>;
+
+  constexpr size_t kFramesPerStream = 1'000'000;
+  constexpr size_t kDropEvery = 50;
+  constexpr int kRuns = 5;
+
+  constexpr std::array<MLWorldCameraIdentifier, 3> kCameras = {
+      MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Center, MLWorldCameraIdentifier_Right};
+  constexpr std::array<MLWorldCameraFrameType, 2> kFrameTypes = {MLWorldCameraFrameType_LowExposure,
+                                                                 MLWorldCameraFrameType_NormalExposure};
+
+  struct Frame {
+    MLWorldCameraIdentifier camera;
+    MLWorldCameraFrameType frame_type;
+    int64_t frame_number;
+  };
+
+  std::vector<Frame> MakeFrames() {
+    std::array<int64_t, 6> next = {0, 1000, 2000, 3000, 4000, INT64_MAX - 1000};
+    std::vector<Frame> frames;
+    frames.reserve(kFramesPerStream * next.size());
+    for (size_t i = 0; i < kFramesPerStream; ++i) {
+      for (size_t stream = 0; stream < next.size(); ++stream) {
+        if (i % kDropEvery == kDropEvery - 1) {
+          next[stream] = next[stream] == INT64_MAX ? 0 : next[stream] + 1;
+        }
+        frames.push_back({kCameras[stream / 2], kFrameTypes[stream % 2], next[stream]});
+        next[stream] = next[stream] == INT64_MAX ? 0 : next[stream] + 1;
+      }
+    }
+    return frames;
+  }
+
+  // CheckDroppedFrames of the sample before WorldCameraSequenceTracker, without the logging
+  class MapCheck {
+  public:
+    MapCheck() {
+      for (MLWorldCameraIdentifier camera : kCameras) {
+        for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+          last_frame_num_[{camera, frame_type}] = -1;
+          dropped_frame_count[{camera, frame_type}] = 0;
+        }
+      }
+    }
+
+    void Update(const Frame &frame) {
+      const CameraIdModePair camera_mode_pair = {frame.camera, frame.frame_type};
+      if (frame.frame_number < 0) {
+        return;
+      }
+      if (last_frame_num_[camera_mode_pair] != -1) {
+        if (frame.frame_number == last_frame_num_[camera_mode_pair]) {
+          return;
+        }
+        int64_t frame_num_diff;
+        if (frame.frame_number < last_frame_num_[camera_mode_pair]) {
+          frame_num_diff = (INT64_MAX - last_frame_num_[camera_mode_pair]) + frame.frame_number;
+          frame_num_diff += 1;
+        } else {
+          frame_num_diff = frame.frame_number - last_frame_num_[camera_mode_pair];
+        }
+        if (frame_num_diff > 1) {
+          dropped_frame_count[camera_mode_pair] = dropped_frame_count[camera_mode_pair] + frame_num_diff;
+        }
+      }
+      last_frame_num_[camera_mode_pair] = frame.frame_number;
+    }
+
+    int64_t Dropped() const {
+      int64_t dropped = 0;
+      for (const auto &[_, count] : dropped_frame_count) {
+        dropped += count;
+      }
+      return dropped;
+    }
+
+  private:
+    std::map<CameraIdModePair, int64_t> last_frame_num_;
+    std::map<CameraIdModePair, int> dropped_frame_count;
+  };
+
+  template <typename Run>
+  double BestNsPerFrame(size_t frame_count, Run run) {
+    double best = 0.0;
+    for (int i = 0; i < kRuns; ++i) {
+      const Clock::time_point start = Clock::now();
+      run();
+      const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / frame_count;
+      best = i == 0 ? ns : std::min(best, ns);
+    }
+    return best;
+  }
+}
+
+int main() {
+  const std::vector<Frame> frames = MakeFrames();
+
+  int64_t map_dropped = 0;
+  const double map_ns = BestNsPerFrame(frames.size(), [&frames, &map_dropped] {
+    MapCheck check;
+    for (const Frame &frame : frames) {
+      check.Update(frame);
+    }
+    map_dropped = check.Dropped();
+  });
+
+  uint64_t tracker_dropped = 0;
+  uint64_t tracker_gaps = 0;
+  const double tracker_ns = BestNsPerFrame(frames.size(), [&frames, &tracker_dropped, &tracker_gaps] {
+    WorldCameraSequenceTracker tracker;
+    for (const Frame &frame : frames) {
+      tracker.Update(frame.camera, frame.frame_type, frame.frame_number);
+    }
+    tracker_dropped = 0;
+    tracker_gaps = 0;
+    for (MLWorldCameraIdentifier camera : kCameras) {
+      for (MLWorldCameraFrameType frame_type : kFrameTypes) {
+        const WorldCameraSequenceTracker::StreamState &state = tracker.Stream(camera, frame_type);
+        tracker_dropped += state.dropped;
+        tracker_gaps += state.gap_count;
+      }
+    }
+  });
+
+  // The map check counted k dropped frames for a gap of k - 1 missing ones
+  CHECK(tracker_gaps == kWorldCameraStreamCount * (kFramesPerStream / kDropEvery));
+  CHECK(tracker_dropped == tracker_gaps);
+  CHECK(static_cast<uint64_t>(map_dropped) == tracker_dropped + tracker_gaps);
+
+  std::printf("%zu frames of %zu streams, one dropped every %zu\n", frames.size(), kWorldCameraStreamCount,
+              kDropEvery);
+  std::printf("std::map check   %6.2f ns/frame\n", map_ns);
+  std::printf("sequence tracker %6.2f ns/frame\n", tracker_ns);
+  std::printf("speedup %.1fx\n", map_ns / tracker_ns);
+  return 0;
+}
@@ -0,0 +1,129 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <cstdint>
+
+#include "world_camera_sequence_tracker.h"
+#include "world_camera_test.h"
+
+/*
+  WorldCameraSequenceTracker: in order frames, gaps, duplicates, invalid input,
+  frame number roll over, the gap history and resets, per stream.
+*/
+
+namespace {
+
+  using Result = WorldCameraSequenceTracker::Result;
+
+  constexpr MLWorldCameraIdentifier kLeft = MLWorldCameraIdentifier_Left;
+  constexpr MLWorldCameraFrameType kNormal = MLWorldCameraFrameType_NormalExposure;
+  constexpr MLWorldCameraFrameType kLow = MLWorldCameraFrameType_LowExposure;
+
+  void TestInOrderAndGaps() {
+    WorldCameraSequenceTracker tracker;
+    CHECK(tracker.Update(kLeft, kNormal, 10) == Result::First);
+    CHECK(tracker.Update(kLeft, kNormal, 11) == Result::InOrder);
+    WorldCameraFrameGap gap = {};
+    CHECK(tracker.Update(kLeft, kNormal, 15, &gap) == Result::Gap);
+    CHECK(gap.first == 12 && gap.last == 14);
+    CHECK(tracker.Update(kLeft, kNormal, 15) == Result::Duplicate);
+    CHECK(tracker.Update(kLeft, kNormal, -1) == Result::Invalid);
+
+    const WorldCameraSequenceTracker::StreamState &stream = tracker.Stream(kLeft, kNormal);
+    CHECK(stream.last_frame_number == 15);
+    CHECK(stream.frames == 3);
+    CHECK(stream.dropped == 3);
+    CHECK(stream.duplicates == 1);
+    CHECK(stream.invalid == 1);
+    CHECK(stream.gap_count == 1);
+    CHECK(tracker.LastGap(kLeft, kNormal)->first == 12);
+
+    // Streams are independent
+    CHECK(tracker.Stream(kLeft, kLow).frames == 0);
+    CHECK(!tracker.LastGap(kLeft, kLow));
+    CHECK(tracker.Update(kLeft, kLow, 100) == Result::First);
+    CHECK(tracker.Stream(MLWorldCameraIdentifier_Right, kNormal).frames == 0);
+
+    // Unknown cameras and frame types have no stream
+    CHECK(tracker.Update(MLWorldCameraIdentifier_All, kNormal, 1) == Result::Invalid);
+    CHECK(tracker.Update(kLeft, static_cast<MLWorldCameraFrameType>(7), 1) == Result::Invalid);
+    CHECK(tracker.Stream(MLWorldCameraIdentifier_All, kNormal).frames == 0);
+  }
+
+  void TestRollOver() {
+    WorldCameraSequenceTracker tracker;
+    CHECK(tracker.Update(kLeft, kNormal, INT64_MAX - 1) == Result::First);
+    CHECK(tracker.Update(kLeft, kNormal, INT64_MAX) == Result::InOrder);
+    CHECK(tracker.Update(kLeft, kNormal, 0) == Result::InOrder);
+    CHECK(tracker.Stream(kLeft, kNormal).dropped == 0);
+
+    // Gap across the roll over: INT64_MAX - 1, INT64_MAX and 0 are missing
+    CHECK(tracker.Update(MLWorldCameraIdentifier_Center, kLow, INT64_MAX - 2) == Result::First);
+    WorldCameraFrameGap gap = {};
+    CHECK(tracker.Update(MLWorldCameraIdentifier_Center, kLow, 1, &gap) == Result::Gap);
+    CHECK(gap.first == INT64_MAX - 1 && gap.last == 0);
+    CHECK(tracker.Stream(MLWorldCameraIdentifier_Center, kLow).dropped == 3);
+
+    // Gap ending right before the roll over
+    CHECK(tracker.Update(MLWorldCameraIdentifier_Right, kLow, INT64_MAX) == Result::First);
+    CHECK(tracker.Update(MLWorldCameraIdentifier_Right, kLow, 2, &gap) == Result::Gap);
+    CHECK(gap.first == 0 && gap.last == 1);
+    CHECK(tracker.Update(MLWorldCameraIdentifier_Right, kNormal, 5) == Result::First);
+    CHECK(tracker.Update(MLWorldCameraIdentifier_Right, kNormal, 0, &gap) == Result::Gap);
+    CHECK(gap.first == 6 && gap.last == INT64_MAX);
+  }
+
+  void TestGapHistory() {
+    WorldCameraSequenceTracker tracker;
+    int64_t frame_number = 0;
+    CHECK(tracker.Update(kLeft, kNormal, frame_number) == Result::First);
+    const size_t gaps = WorldCameraSequenceTracker::kGapHistory + 3;
+    for (size_t i = 0; i < gaps; ++i) {
+      frame_number += 2;
+      CHECK(tracker.Update(kLeft, kNormal, frame_number) == Result::Gap);
+    }
+    const WorldCameraSequenceTracker::StreamState &stream = tracker.Stream(kLeft, kNormal);
+    CHECK(stream.gap_count == gaps);
+    CHECK(stream.dropped == gaps);
+    CHECK(tracker.LastGap(kLeft, kNormal)->first == frame_number - 1);
+    // The history holds the latest gaps
+    for (const WorldCameraFrameGap &gap : stream.gaps) {
+      CHECK(gap.first == gap.last);
+      CHECK(gap.first > frame_number - 2 * static_cast<int64_t>(WorldCameraSequenceTracker::kGapHistory));
+    }
+  }
+
+  void TestReset() {
+    WorldCameraSequenceTracker tracker;
+    CHECK(tracker.Update(kLeft, kNormal, 1) == Result::First);
+    CHECK(tracker.Update(kLeft, kLow, 1) == Result::First);
+    tracker.Reset(kLeft, kNormal);
+    CHECK(tracker.Update(kLeft, kNormal, 50) == Result::First);
+    CHECK(tracker.Update(kLeft, kLow, 50) == Result::Gap);
+    tracker.ResetAll();
+    CHECK(tracker.Update(kLeft, kNormal, 10) == Result::First);
+    CHECK(tracker.Update(kLeft, kLow, 10) == Result::First);
+    // Counters survive a reset
+    CHECK(tracker.Stream(kLeft, kNormal).frames == 3);
+    CHECK(tracker.Stream(kLeft, kLow).dropped == 48);
+    tracker.Reset(MLWorldCameraIdentifier_All, kNormal);
+  }
+}
+
+int main() {
+  TestInOrderAndGaps();
+  TestRollOver();
+  TestGapHistory();
+  TestReset();
+  return 0;
+}
@@ -0,0 +1,133 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "world_camera_stats.h"
+#include "world_camera_test.h"
+
+/*
+  Measures ComputeWorldCameraFrameStats on a 1016x1016 frame with every row and with
+  row subsampling, reporting the cost per frame and how far the subsampled mean,
+  standard deviation and sharpness are from the full ones, against separate passes
+  for the histogram, the moments and the Laplacian as a reference.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  constexpr uint32_t kSize = 1016;
+  constexpr int kIterations = 200;
+
+  template <typename Compute>
+  double MillisecondsPerFrame(Compute compute) {
+    compute();
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+      compute();
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count() / kIterations;
+  }
+
+  // One pass per statistic, reading the frame three times
+  void MultiPass(const MLWorldCameraFrameBuffer &buffer, WorldCameraFrameStats *stats) {
+    *stats = {};
+    for (uint32_t y = 0; y < buffer.height; ++y) {
+      const uint8_t *row = buffer.data + static_cast<size_t>(y) * buffer.stride;
+      for (uint32_t x = 0; x < buffer.width; ++x) {
+        ++stats->histogram[row[x]];
+      }
+    }
+    uint64_t sum = 0, sum_squares = 0;
+    for (uint32_t y = 0; y < buffer.height; ++y) {
+      const uint8_t *row = buffer.data + static_cast<size_t>(y) * buffer.stride;
+      for (uint32_t x = 0; x < buffer.width; ++x) {
+        sum += row[x];
+        sum_squares += row[x] * row[x];
+      }
+    }
+    stats->pixel_count = static_cast<uint64_t>(buffer.width) * buffer.height;
+    stats->mean = static_cast<double>(sum) / stats->pixel_count;
+    stats->variance = static_cast<double>(sum_squares) / stats->pixel_count - stats->mean * stats->mean;
+    int64_t laplacian_sum = 0;
+    uint64_t laplacian_squares = 0;
+    for (uint32_t y = 1; y + 1 < buffer.height; ++y) {
+      const uint8_t *row = buffer.data + static_cast<size_t>(y) * buffer.stride;
+      const uint8_t *up = row - buffer.stride;
+      const uint8_t *down = row + buffer.stride;
+      for (uint32_t x = 1; x + 1 < buffer.width; ++x) {
+        const int32_t laplacian = 4 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x];
+        laplacian_sum += laplacian;
+        laplacian_squares += static_cast<uint64_t>(laplacian * laplacian);
+        ++stats->sharpness_count;
+      }
+    }
+    const double laplacian_mean = static_cast<double>(laplacian_sum) / stats->sharpness_count;
+    stats->sharpness = static_cast<double>(laplacian_squares) / stats->sharpness_count - laplacian_mean * laplacian_mean;
+  }
+
+  double RelativeError(double value, double reference) {
+    return std::fabs(value - reference) / std::fabs(reference);
+  }
+}
+
+int main() {
+  // A smooth gradient with noise, so the subsampled estimates have something to miss
+  std::vector<uint8_t> pixels(static_cast<size_t>(kSize) * kSize);
+  std::mt19937 random(17);
+  std::normal_distribution<double> noise(0.0, 12.0);
+  for (uint32_t y = 0; y < kSize; ++y) {
+    for (uint32_t x = 0; x < kSize; ++x) {
+      const double value = 40.0 + 160.0 * (x + y) / (2.0 * kSize) + noise(random);
+      pixels[static_cast<size_t>(y) * kSize + x] = static_cast<uint8_t>(std::lround(std::fmin(255.0, std::fmax(0.0, value))));
+    }
+  }
+  MLWorldCameraFrameBuffer buffer = {};
+  buffer.width = kSize;
+  buffer.height = kSize;
+  buffer.stride = kSize;
+  buffer.bytes_per_pixel = 1;
+  buffer.size = static_cast<uint32_t>(pixels.size());
+  buffer.data = pixels.data();
+
+  WorldCameraFrameStats reference;
+  const double multi_pass_ms = MillisecondsPerFrame([&] { MultiPass(buffer, &reference); });
+  std::printf("%ux%u frame\n", kSize, kSize);
+  std::printf("%-22s %7.3f ms/frame\n", "separate passes", multi_pass_ms);
+
+  WorldCameraFrameStats full = {};
+  for (uint32_t row_step : {1u, 2u, 4u, 8u}) {
+    WorldCameraFrameStats stats;
+    const double ms = MillisecondsPerFrame([&] { CHECK(ComputeWorldCameraFrameStats(buffer, row_step, &stats)); });
+    if (row_step == 1) {
+      full = stats;
+      CHECK(std::memcmp(full.histogram, reference.histogram, sizeof(full.histogram)) == 0);
+      CHECK(std::fabs(full.mean - reference.mean) < 1e-9);
+      CHECK(RelativeError(full.sharpness, reference.sharpness) < 1e-9);
+    }
+    char name[32];
+    std::snprintf(name, sizeof(name), "single pass, step %u", row_step);
+    std::printf("%-22s %7.3f ms/frame %6.2fx  error: mean %.4f%%, deviation %.4f%%, sharpness %.4f%%\n", name, ms,
+                multi_pass_ms / ms, 100.0 * RelativeError(stats.mean, full.mean),
+                100.0 * RelativeError(std::sqrt(stats.variance), std::sqrt(full.variance)),
+                100.0 * RelativeError(stats.sharpness, full.sharpness));
+  }
+  return 0;
+}
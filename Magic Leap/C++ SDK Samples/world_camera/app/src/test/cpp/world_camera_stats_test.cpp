@@ -0,0 +1,202 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "world_camera_stats.h"
+#include "world_camera_test.h"
+
+/*
+  Frame statistics: the single pass computation matches a direct evaluation of the
+  definitions on random images of every width, stride and row step, including rows
+  long enough to flush the vector accumulators, and gives the expected values on
+  uniform, checkerboard and blurred images.
+*/
+
+namespace {
+
+  MLWorldCameraFrameBuffer FrameBuffer(std::vector<uint8_t> &pixels, uint32_t width, uint32_t height,
+                                       uint32_t stride) {
+    pixels.resize(static_cast<size_t>(stride) * height);
+    MLWorldCameraFrameBuffer buffer = {};
+    buffer.width = width;
+    buffer.height = height;
+    buffer.stride = stride;
+    buffer.bytes_per_pixel = 1;
+    buffer.size = static_cast<uint32_t>(pixels.size());
+    buffer.data = pixels.data();
+    return buffer;
+  }
+
+  bool IsClose(double a, double b) {
+    return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b));
+  }
+
+  // Statistics straight from their definitions, without the single pass sums
+  WorldCameraFrameStats Reference(const MLWorldCameraFrameBuffer &buffer, uint32_t row_step) {
+    WorldCameraFrameStats stats = {};
+    std::vector<double> values;
+    std::vector<double> laplacians;
+    for (uint32_t y = 0; y < buffer.height; y += row_step) {
+      const uint8_t *row = buffer.data + static_cast<size_t>(y) * buffer.stride;
+      for (uint32_t x = 0; x < buffer.width; ++x) {
+        ++stats.histogram[row[x]];
+        values.push_back(row[x]);
+        if (y > 0 && y + 1 < buffer.height && x > 0 && x + 1 < buffer.width) {
+          const uint8_t *up = row - buffer.stride;
+          const uint8_t *down = row + buffer.stride;
+          laplacians.push_back(4.0 * row[x] - row[x - 1] - row[x + 1] - up[x] - down[x]);
+        }
+      }
+    }
+    const auto moments = [](const std::vector<double> &samples, double *mean, double *variance) {
+      *mean = 0.0;
+      for (double sample : samples) {
+        *mean += sample;
+      }
+      *mean /= samples.empty() ? 1.0 : samples.size();
+      *variance = 0.0;
+      for (double sample : samples) {
+        *variance += (sample - *mean) * (sample - *mean);
+      }
+      *variance /= samples.empty() ? 1.0 : samples.size();
+    };
+    double laplacian_mean = 0.0;
+    moments(values, &stats.mean, &stats.variance);
+    moments(laplacians, &laplacian_mean, &stats.sharpness);
+    stats.pixel_count = values.size();
+    stats.sharpness_count = laplacians.size();
+    return stats;
+  }
+
+  void CheckMatchesReference(const MLWorldCameraFrameBuffer &buffer, uint32_t row_step) {
+    WorldCameraFrameStats stats;
+    CHECK(ComputeWorldCameraFrameStats(buffer, row_step, &stats));
+    const WorldCameraFrameStats expected = Reference(buffer, row_step);
+    for (uint32_t bin = 0; bin < WorldCameraFrameStats::kBinCount; ++bin) {
+      CHECK(stats.histogram[bin] == expected.histogram[bin]);
+    }
+    CHECK(stats.pixel_count == expected.pixel_count);
+    CHECK(stats.sharpness_count == expected.sharpness_count);
+    CHECK(IsClose(stats.mean, expected.mean));
+    CHECK(IsClose(stats.variance, expected.variance));
+    CHECK(IsClose(stats.sharpness, expected.sharpness));
+  }
+
+  void TestRandomImages() {
+    std::mt19937 random(7);
+    std::uniform_int_distribution<int> pixel(0, 255);
+    std::vector<uint8_t> pixels;
+    for (uint32_t width = 1; width <= 70; ++width) {
+      for (uint32_t row_step : {1u, 2u, 4u}) {
+        const uint32_t height = 1 + width % 9;
+        const MLWorldCameraFrameBuffer buffer = FrameBuffer(pixels, width, height, width + width % 5);
+        for (auto &value : pixels) {
+          value = static_cast<uint8_t>(pixel(random));
+        }
+        CheckMatchesReference(buffer, row_step);
+      }
+    }
+    // Rows longer than the vector loops may run before flushing their 32-bit lanes
+    const MLWorldCameraFrameBuffer wide = FrameBuffer(pixels, 20000, 3, 20000);
+    for (auto &value : pixels) {
+      value = static_cast<uint8_t>(pixel(random) < 128 ? 0 : 255);
+    }
+    CheckMatchesReference(wide, 1);
+    std::fill(pixels.begin(), pixels.end(), 255);
+    CheckMatchesReference(wide, 1);
+  }
+
+  void TestSyntheticImages() {
+    constexpr uint32_t kSize = 64;
+    std::vector<uint8_t> pixels;
+    const MLWorldCameraFrameBuffer buffer = FrameBuffer(pixels, kSize, kSize, kSize);
+    WorldCameraFrameStats stats;
+
+    // A uniform image has no spread and no detail
+    std::fill(pixels.begin(), pixels.end(), 90);
+    CHECK(ComputeWorldCameraFrameStats(buffer, 1, &stats));
+    CHECK(stats.histogram[90] == kSize * kSize && stats.pixel_count == kSize * kSize);
+    CHECK(stats.mean == 90.0 && stats.variance == 0.0 && stats.sharpness == 0.0);
+    CHECK(stats.sharpness_count == (kSize - 2) * (kSize - 2));
+
+    // Every pixel of a 0/255 checkerboard differs from its four neighbours by 255
+    for (uint32_t y = 0; y < kSize; ++y) {
+      for (uint32_t x = 0; x < kSize; ++x) {
+        pixels[y * kSize + x] = (x + y) % 2 ? 255 : 0;
+      }
+    }
+    CHECK(ComputeWorldCameraFrameStats(buffer, 1, &stats));
+    CHECK(stats.histogram[0] == kSize * kSize / 2 && stats.histogram[255] == kSize * kSize / 2);
+    CHECK(stats.mean == 127.5);
+    CHECK(IsClose(stats.variance, 127.5 * 127.5));
+    CHECK(IsClose(stats.sharpness, 1020.0 * 1020.0));
+    const double checkerboard_sharpness = stats.sharpness;
+
+    // Blurring keeps the mean but lowers the sharpness
+    std::vector<uint8_t> blurred(pixels.size());
+    for (uint32_t y = 0; y < kSize; ++y) {
+      for (uint32_t x = 0; x < kSize; ++x) {
+        const uint32_t right = std::min(x + 1, kSize - 1);
+        blurred[y * kSize + x] = static_cast<uint8_t>((pixels[y * kSize + x] + pixels[y * kSize + right]) / 2);
+      }
+    }
+    pixels = blurred;
+    const MLWorldCameraFrameBuffer blurred_buffer = FrameBuffer(pixels, kSize, kSize, kSize);
+    CHECK(ComputeWorldCameraFrameStats(blurred_buffer, 1, &stats));
+    CHECK(std::fabs(stats.mean - 127.5) < 1.0);
+    CHECK(stats.sharpness < checkerboard_sharpness / 100);
+
+    // Row subsampling estimates the same statistics
+    std::mt19937 random(11);
+    std::normal_distribution<double> noise(100.0, 20.0);
+    for (auto &value : pixels) {
+      value = static_cast<uint8_t>(std::clamp(noise(random), 0.0, 255.0));
+    }
+    WorldCameraFrameStats sampled;
+    CHECK(ComputeWorldCameraFrameStats(blurred_buffer, 1, &stats));
+    CHECK(ComputeWorldCameraFrameStats(blurred_buffer, 4, &sampled));
+    CHECK(sampled.pixel_count == kSize * kSize / 4);
+    CHECK(std::fabs(sampled.mean - stats.mean) < 2.0);
+    CHECK(std::fabs(std::sqrt(sampled.variance) - std::sqrt(stats.variance)) < 2.0);
+  }
+
+  void TestInvalidBuffers() {
+    std::vector<uint8_t> pixels;
+    MLWorldCameraFrameBuffer buffer = FrameBuffer(pixels, 8, 8, 8);
+    WorldCameraFrameStats stats;
+    CHECK(!ComputeWorldCameraFrameStats(buffer, 1, nullptr));
+    buffer.bytes_per_pixel = 2;
+    CHECK(!ComputeWorldCameraFrameStats(buffer, 1, &stats));
+    buffer.bytes_per_pixel = 1;
+    buffer.width = 0;
+    CHECK(!ComputeWorldCameraFrameStats(buffer, 1, &stats));
+    buffer.width = 8;
+    buffer.data = nullptr;
+    CHECK(!ComputeWorldCameraFrameStats(buffer, 1, &stats));
+    // A row step of 0 samples every row
+    buffer = FrameBuffer(pixels, 8, 8, 8);
+    CHECK(ComputeWorldCameraFrameStats(buffer, 0, &stats));
+    CHECK(stats.pixel_count == 64);
+  }
+}
+
+int main() {
+  TestRandomImages();
+  TestSyntheticImages();
+  TestInvalidBuffers();
+  return 0;
+}
@@ -0,0 +1,100 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "world_camera_stereo.h"
+#include "world_camera_test.h"
+
+/*
+  Measures rectified pair throughput on one thread with 1016x1016 fisheye frames:
+  with a steady relative pose, so every pair reuses the cached remap tables, and with
+  the right camera drifting past the rebuild threshold on every pair. Each pair
+  includes staging the first frame, as Submit does for the frame waiting for its
+  partner, and remapping both images.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  constexpr uint32_t kSize = 1016;
+  constexpr auto kDuration = std::chrono::milliseconds(1000);
+  // Rebuilding takes long enough that the duration alone would time only a pair or two
+  constexpr uint64_t kMinPairs = 5;
+  constexpr MLTime kFrameInterval = 33'333'333;
+
+  MLWorldCameraFrame Frame(MLWorldCameraIdentifier camera, MLTime timestamp, float x, std::vector<uint8_t> &pixels) {
+    MLWorldCameraFrame frame = {};
+    frame.id = camera;
+    frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+    frame.timestamp = timestamp;
+    frame.camera_pose.rotation.w = 1.0f;
+    frame.camera_pose.position.x = x;
+    frame.intrinsics.width = kSize;
+    frame.intrinsics.height = kSize;
+    frame.intrinsics.focal_length = {360.0f, 360.0f};
+    frame.intrinsics.principal_point = {kSize / 2.0f, kSize / 2.0f};
+    frame.intrinsics.radial_distortion[0] = -0.02;
+    frame.intrinsics.radial_distortion[1] = 0.004;
+    frame.frame_buffer.width = kSize;
+    frame.frame_buffer.height = kSize;
+    frame.frame_buffer.stride = kSize;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = static_cast<uint32_t>(pixels.size());
+    frame.frame_buffer.data = pixels.data();
+    return frame;
+  }
+
+  void Run(const char *name, bool moving) {
+    std::vector<uint8_t> left_pixels(static_cast<size_t>(kSize) * kSize);
+    std::vector<uint8_t> right_pixels(left_pixels.size());
+    std::mt19937 random(7);
+    for (size_t i = 0; i < left_pixels.size(); ++i) {
+      left_pixels[i] = static_cast<uint8_t>(random());
+      right_pixels[i] = static_cast<uint8_t>(random());
+    }
+
+    WorldCameraStereoRectifier rectifier;
+    uint64_t checksum = 0;
+    MLTime timestamp = kFrameInterval;
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point end = start + kDuration;
+    Clock::time_point now = start;
+    for (; now < end || rectifier.PairCount() < kMinPairs; now = Clock::now()) {
+      // 1 mm per pair is twice the default translation threshold
+      const float right_x = moving ? 0.1f + 0.001f * (rectifier.PairCount() % 2) : 0.1f;
+      CHECK(!rectifier.Submit(Frame(MLWorldCameraIdentifier_Left, timestamp, 0.0f, left_pixels)));
+      CHECK(rectifier.Submit(Frame(MLWorldCameraIdentifier_Right, timestamp + 500'000, right_x, right_pixels)));
+      checksum += rectifier.RectifiedLeft().data[kSize * kSize / 2] + rectifier.RectifiedRight().data[kSize * kSize / 2];
+      timestamp += kFrameInterval;
+    }
+    const double seconds = std::chrono::duration<double>(now - start).count();
+    const double pairs = static_cast<double>(rectifier.PairCount());
+    std::printf("%-28s %7.1f pairs/s %7.2f ms/pair %7.1f Mpixel/s  %llu table builds (%llu)\n", name,
+                pairs / seconds, seconds * 1e3 / pairs, pairs * 2 * kSize * kSize / seconds / 1e6,
+                static_cast<unsigned long long>(rectifier.TableBuildCount()),
+                static_cast<unsigned long long>(checksum));
+  }
+}
+
+int main() {
+  std::printf("%ux%u pairs on one thread\n", kSize, kSize);
+  Run("cached tables", false);
+  Run("tables rebuilt every pair", true);
+  return 0;
+}
@@ -0,0 +1,301 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "world_camera_pose_history.h"
+#include "world_camera_stereo.h"
+#include "world_camera_test.h"
+
+/*
+  Stereo rectification: left and right frames are paired by timestamp, the right
+  pose is interpolated at the left timestamp when the history covers it, and pairs
+  that fall back to the right frame's own pose are flagged and counted. Points seen
+  by a rolled, toed in and vertically offset camera pair land on the same row of
+  both rectified images, and the cached remap tables are rebuilt exactly when the
+  relative pose moves past the thresholds or the intrinsics or stride change.
+*/
+
+namespace {
+
+  constexpr uint32_t kWidth = 64;
+  constexpr uint32_t kHeight = 48;
+  constexpr MLTime kLeftTime = 1'000'000'000;
+  // The right frame is captured half a millisecond after the left one
+  constexpr MLTime kRightTime = kLeftTime + 500'000;
+
+  MLTransform Pose(float x) {
+    MLTransform pose = {};
+    pose.rotation.w = 1.0f;
+    pose.position.x = x;
+    return pose;
+  }
+
+  // Rotation by angle radians about a unit axis, in the graphics convention of camera_pose
+  MLQuaternionf Rotation(double angle, double x, double y, double z) {
+    const double s = std::sin(angle / 2);
+    MLQuaternionf q;
+    q.x = static_cast<float>(x * s);
+    q.y = static_cast<float>(y * s);
+    q.z = static_cast<float>(z * s);
+    q.w = static_cast<float>(std::cos(angle / 2));
+    return q;
+  }
+
+  MLQuaternionf Compose(const MLQuaternionf &a, const MLQuaternionf &b) {
+    MLQuaternionf q;
+    q.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+    q.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+    q.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+    q.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+    return q;
+  }
+
+  MLWorldCameraFrame Frame(MLWorldCameraIdentifier camera, MLTime timestamp, const MLTransform &pose,
+                           std::vector<uint8_t> &pixels, uint32_t width = kWidth, uint32_t height = kHeight,
+                           float focal = 50.0f) {
+    if (pixels.size() != static_cast<size_t>(width) * height) {
+      pixels.assign(static_cast<size_t>(width) * height, 128);
+    }
+    MLWorldCameraFrame frame = {};
+    frame.id = camera;
+    frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+    frame.timestamp = timestamp;
+    frame.camera_pose = pose;
+    frame.intrinsics.width = width;
+    frame.intrinsics.height = height;
+    frame.intrinsics.focal_length = {focal, focal};
+    frame.intrinsics.principal_point = {width / 2.0f, height / 2.0f};
+    frame.frame_buffer.width = width;
+    frame.frame_buffer.height = height;
+    frame.frame_buffer.stride = width;
+    frame.frame_buffer.bytes_per_pixel = 1;
+    frame.frame_buffer.size = static_cast<uint32_t>(pixels.size());
+    frame.frame_buffer.data = pixels.data();
+    return frame;
+  }
+
+  MLWorldCameraFrame Frame(MLWorldCameraIdentifier camera, MLTime timestamp, float x, std::vector<uint8_t> &pixels) {
+    return Frame(camera, timestamp, Pose(x), pixels);
+  }
+
+  // Submits a pair whose right frame is 0.1 m right of the left one, returning whether it was rectified.
+  bool SubmitPair(WorldCameraStereoRectifier &rectifier) {
+    std::vector<uint8_t> left_pixels, right_pixels;
+    CHECK(!rectifier.Submit(Frame(MLWorldCameraIdentifier_Left, kLeftTime, 0.0f, left_pixels)));
+    return rectifier.Submit(Frame(MLWorldCameraIdentifier_Right, kRightTime, 0.1f, right_pixels));
+  }
+
+  // Projects a world point into the image of a camera with the fisheye model of
+  // BuildWorldCameraRemapTable and no distortion coefficients. Returns false behind the camera.
+  bool Project(const MLWorldCameraFrame &frame, const double point[3], double *u, double *v) {
+    const MLQuaternionf &q = frame.camera_pose.rotation;
+    const double x = q.x, y = q.y, z = q.z, w = q.w;
+    const double rotation[9] = {
+            1 - 2 * (y * y + z * z), 2 * (x * y - z * w), 2 * (x * z + y * w),
+            2 * (x * y + z * w), 1 - 2 * (x * x + z * z), 2 * (y * z - x * w),
+            2 * (x * z - y * w), 2 * (y * z + x * w), 1 - 2 * (x * x + y * y),
+    };
+    const double offset[3] = {point[0] - frame.camera_pose.position.x, point[1] - frame.camera_pose.position.y,
+                              point[2] - frame.camera_pose.position.z};
+    double camera[3];
+    for (int c = 0; c < 3; ++c) {
+      camera[c] = rotation[c] * offset[0] + rotation[3 + c] * offset[1] + rotation[6 + c] * offset[2];
+    }
+    // Graphics to image convention: y down, z forward
+    const double depth = -camera[2];
+    if (depth <= 0.0) {
+      return false;
+    }
+    const double a = camera[0] / depth, b = -camera[1] / depth;
+    const double radius = std::sqrt(a * a + b * b);
+    const double scale = radius > 1e-12 ? std::atan(radius) / radius : 1.0;
+    *u = frame.intrinsics.focal_length.x * a * scale + frame.intrinsics.principal_point.x;
+    *v = frame.intrinsics.focal_length.y * b * scale + frame.intrinsics.principal_point.y;
+    return true;
+  }
+
+  // Draws a Gaussian spot at the projection of point on a black image.
+  void RenderSpot(const MLWorldCameraFrame &frame, const double point[3], std::vector<uint8_t> &pixels,
+                  double *u, double *v) {
+    CHECK(Project(frame, point, u, v));
+    std::fill(pixels.begin(), pixels.end(), 0);
+    const uint32_t width = frame.frame_buffer.width;
+    for (uint32_t y = 0; y < frame.frame_buffer.height; ++y) {
+      for (uint32_t x = 0; x < width; ++x) {
+        const double d2 = (x - *u) * (x - *u) + (y - *v) * (y - *v);
+        pixels[static_cast<size_t>(y) * width + x] = static_cast<uint8_t>(std::lround(250.0 * std::exp(-d2 / 4.5)));
+      }
+    }
+  }
+
+  // Intensity weighted centroid of an image of a single spot.
+  void Centroid(const MLWorldCameraFrameBuffer &buffer, double *u, double *v) {
+    double sum = 0.0, sum_u = 0.0, sum_v = 0.0;
+    for (uint32_t y = 0; y < buffer.height; ++y) {
+      for (uint32_t x = 0; x < buffer.width; ++x) {
+        const double value = buffer.data[static_cast<size_t>(y) * buffer.stride + x];
+        sum += value;
+        sum_u += value * x;
+        sum_v += value * y;
+      }
+    }
+    CHECK(sum > 0.0);
+    *u = sum_u / sum;
+    *v = sum_v / sum;
+  }
+
+  void TestPairing() {
+    WorldCameraStereoRectifier rectifier;
+    std::vector<uint8_t> pixels;
+    CHECK(!rectifier.Submit(Frame(MLWorldCameraIdentifier_Center, kLeftTime, 0.0f, pixels)));
+    // Too far apart to pair
+    CHECK(!rectifier.Submit(Frame(MLWorldCameraIdentifier_Left, kLeftTime - 5'000'000, 0.0f, pixels)));
+    CHECK(SubmitPair(rectifier));
+    CHECK(rectifier.PairCount() == 1);
+    CHECK(rectifier.PairTimestamp() == kLeftTime);
+    CHECK(std::fabs(rectifier.Baseline() - 0.1) < 1e-6);
+    // Without a history the frame poses are used as they are, which is not a fallback
+    CHECK(!rectifier.PairPoseInterpolated());
+    CHECK(rectifier.PoseFallbackCount() == 0);
+    const MLWorldCameraFrameBuffer left = rectifier.RectifiedLeft();
+    CHECK(left.width == kWidth && left.height == kHeight && left.data);
+  }
+
+  void TestHistory() {
+    WorldCameraPoseHistory history;
+    WorldCameraStereoRectifier rectifier;
+    rectifier.SetPoseHistory(&history);
+
+    // The right camera moves 1 mm per ms, so at the left timestamp it is 0.5 mm short of its frame pose
+    CHECK(history.Add(MLWorldCameraIdentifier_Right, kLeftTime - 1'000'000, Pose(0.099f)));
+    CHECK(history.Add(MLWorldCameraIdentifier_Right, kRightTime, Pose(0.1005f)));
+    CHECK(SubmitPair(rectifier));
+    CHECK(rectifier.PairPoseInterpolated());
+    CHECK(std::fabs(rectifier.Baseline() - 0.1) < 1e-6);
+    CHECK(rectifier.PoseFallbackCount() == 0);
+
+    // A history ending before the left timestamp cannot be interpolated
+    history.Reset();
+    CHECK(history.Add(MLWorldCameraIdentifier_Right, kLeftTime - 2'000'000, Pose(0.098f)));
+    CHECK(history.Add(MLWorldCameraIdentifier_Right, kLeftTime - 1'000'000, Pose(0.099f)));
+    CHECK(SubmitPair(rectifier));
+    CHECK(!rectifier.PairPoseInterpolated());
+    CHECK(rectifier.PoseFallbackCount() == 1);
+    CHECK(std::fabs(rectifier.Baseline() - 0.1) < 1e-6);
+    CHECK(rectifier.PairCount() == 2);
+  }
+
+  void TestRowAlignment() {
+    constexpr uint32_t kSpotWidth = 160;
+    constexpr uint32_t kSpotHeight = 120;
+    constexpr float kFocal = 100.0f;
+    // The right camera is 10 cm to the right and 3 mm up, toed in by 2 degrees and rolled by 3
+    MLTransform right_pose = Pose(0.1f);
+    right_pose.position.y = 0.003f;
+    right_pose.rotation = Compose(Rotation(2.0 * M_PI / 180, 0, 1, 0), Rotation(3.0 * M_PI / 180, 0, 0, 1));
+    // Points in front of the pair, which looks down -z
+    const double points[][3] = {
+            {0.0, 0.0, -2.0}, {0.6, 0.2, -2.0}, {-0.4, 0.25, -2.5}, {0.25, -0.3, -1.5}, {-0.3, -0.2, -3.0}};
+
+    WorldCameraStereoRectifier rectifier;
+    std::vector<uint8_t> left_pixels(kSpotWidth * kSpotHeight), right_pixels(kSpotWidth * kSpotHeight);
+    double max_raw_row_error = 0.0;
+    MLTime timestamp = kLeftTime;
+    for (const double *point : points) {
+      const MLWorldCameraFrame left =
+              Frame(MLWorldCameraIdentifier_Left, timestamp, Pose(0.0f), left_pixels, kSpotWidth, kSpotHeight, kFocal);
+      const MLWorldCameraFrame right =
+              Frame(MLWorldCameraIdentifier_Right, timestamp + 500'000, right_pose, right_pixels, kSpotWidth,
+                    kSpotHeight, kFocal);
+      double left_u, left_v, right_u, right_v;
+      RenderSpot(left, point, left_pixels, &left_u, &left_v);
+      RenderSpot(right, point, right_pixels, &right_u, &right_v);
+      max_raw_row_error = std::max(max_raw_row_error, std::fabs(left_v - right_v));
+      CHECK(!rectifier.Submit(left));
+      CHECK(rectifier.Submit(right));
+      timestamp += 33'333'333;
+
+      Centroid(rectifier.RectifiedLeft(), &left_u, &left_v);
+      Centroid(rectifier.RectifiedRight(), &right_u, &right_v);
+      // The spot lies on the same row of both images, and the disparity is about f B / Z
+      const double disparity = left_u - right_u;
+      const double expected_disparity = kFocal * 0.1 / -point[2];
+      std::printf("spot at %5.2f m: rows %7.3f and %7.3f, disparity %6.3f px (about %6.3f)\n", -point[2], left_v,
+                  right_v, disparity, expected_disparity);
+      CHECK(std::fabs(left_v - right_v) < 0.25);
+      CHECK(disparity > expected_disparity * 0.8 && disparity < expected_disparity * 1.25);
+    }
+    // The raw images were misaligned by more than a pixel somewhere
+    CHECK(max_raw_row_error > 1.0);
+    CHECK(rectifier.TableBuildCount() == 1);
+  }
+
+  // Submits a pair with the given right pose and returns the table build count afterwards.
+  uint64_t SubmitPose(WorldCameraStereoRectifier &rectifier, const MLTransform &right_pose, MLTime *timestamp,
+                      float focal = 50.0f, uint32_t stride_padding = 0) {
+    std::vector<uint8_t> left_pixels, right_pixels;
+    MLWorldCameraFrame left = Frame(MLWorldCameraIdentifier_Left, *timestamp, Pose(0.0f), left_pixels);
+    MLWorldCameraFrame right = Frame(MLWorldCameraIdentifier_Right, *timestamp + 500'000, right_pose, right_pixels,
+                                     kWidth, kHeight, focal);
+    if (stride_padding > 0) {
+      right_pixels.assign(static_cast<size_t>(kWidth + stride_padding) * kHeight, 128);
+      right.frame_buffer.stride = kWidth + stride_padding;
+      right.frame_buffer.size = static_cast<uint32_t>(right_pixels.size());
+      right.frame_buffer.data = right_pixels.data();
+    }
+    CHECK(!rectifier.Submit(left));
+    CHECK(rectifier.Submit(right));
+    *timestamp += 33'333'333;
+    return rectifier.TableBuildCount();
+  }
+
+  void TestCacheThresholds() {
+    WorldCameraStereoRectifier::Settings settings;
+    settings.max_translation_change = 0.0005;
+    settings.max_rotation_change = 0.0005;
+    WorldCameraStereoRectifier rectifier(settings);
+    MLTime timestamp = kLeftTime;
+    CHECK(SubmitPose(rectifier, Pose(0.1f), &timestamp) == 1);
+    // Translation changes are measured from the pose the tables were built for, not the last one
+    CHECK(SubmitPose(rectifier, Pose(0.1004f), &timestamp) == 1);
+    CHECK(SubmitPose(rectifier, Pose(0.0996f), &timestamp) == 1);
+    CHECK(SubmitPose(rectifier, Pose(0.1006f), &timestamp) == 2);
+    CHECK(SubmitPose(rectifier, Pose(0.1006f), &timestamp) == 2);
+
+    MLTransform rotated = Pose(0.1006f);
+    rotated.rotation = Rotation(0.0004, 0, 1, 0);
+    CHECK(SubmitPose(rectifier, rotated, &timestamp) == 2);
+    rotated.rotation = Rotation(0.0004, 1, 0, 0);
+    CHECK(SubmitPose(rectifier, rotated, &timestamp) == 2);
+    rotated.rotation = Rotation(0.0006, 0, 0, 1);
+    CHECK(SubmitPose(rectifier, rotated, &timestamp) == 3);
+
+    // Any change of the intrinsics or of the stride the tables bake in rebuilds them
+    CHECK(SubmitPose(rectifier, rotated, &timestamp, 50.5f) == 4);
+    CHECK(SubmitPose(rectifier, rotated, &timestamp, 50.5f) == 4);
+    CHECK(SubmitPose(rectifier, rotated, &timestamp, 50.5f, 16) == 5);
+    CHECK(rectifier.PairCount() == 11);
+  }
+}
+
+int main() {
+  TestPairing();
+  TestHistory();
+  TestRowAlignment();
+  TestCacheThresholds();
+  return 0;
+}
@@ -0,0 +1,134 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <ml_world_camera.h>
+
+#include "world_camera_capture.h"
+#include "world_camera_stream.h"
+
+/*
+  Helpers shared by the host tests. Tests are plain executables that return non zero
+  on failure, so they run under ctest without a test framework.
+*/
+
+#define CHECK(condition)                                                          \
+  do {                                                                            \
+    if (!(condition)) {                                                           \
+      std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+      std::exit(1);                                                               \
+    }                                                                             \
+  } while (false)
+
+// Describes a capture of uniformly filled 8-bit frames, see WriteSyntheticCapture.
+struct SyntheticCapture {
+  uint32_t cameras = MLWorldCameraIdentifier_All;
+  size_t frames_per_stream = 30;
+  int64_t first_frame_number = 0;
+  MLTime first_timestamp = 1'000'000'000;
+  MLTime interval = 33'333'333;
+  // If not 0, one frame number is skipped after every skip_every frames, as if dropped by the sensor
+  size_t skip_every = 0;
+  // Largest deviation of a timestamp from its nominal time, in nanoseconds
+  MLTime jitter = 0;
+  uint32_t width = 64;
+  uint32_t height = 48;
+};
+
+// Value of every pixel of a synthetic frame.
+inline uint8_t SyntheticPixel(MLWorldCameraIdentifier camera, int64_t frame_number) {
+  return static_cast<uint8_t>(frame_number * 7 + WorldCameraIndex(camera) * 50);
+}
+
+// Position of a camera at time, moving 1 m/s along x; rotation is identity.
+inline MLTransform SyntheticPose(MLWorldCameraIdentifier camera, MLTime time) {
+  MLTransform pose = {};
+  pose.rotation.w = 1.0f;
+  pose.position.x = static_cast<float>(static_cast<double>(time) * 1e-9);
+  pose.position.y = static_cast<float>(WorldCameraIndex(camera));
+  return pose;
+}
+
+/*
+  Writes a capture to path with frames_per_stream frames of every selected camera in
+  both frame types. Frame k of a camera has frame number first_frame_number + n, with
+  n = k plus the numbers skipped before it, and is captured at first_timestamp +
+  n * interval, plus a quarter interval for low exposure frames so both types
+  interleave, plus a deterministic deviation of up to jitter. Returns the frames
+  written in the order they were written.
+*/
+inline std::vector<MLWorldCameraFrame> WriteSyntheticCapture(const char *path, const SyntheticCapture &capture) {
+  const MLWorldCameraIdentifier cameras[] = {MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Right,
+                                             MLWorldCameraIdentifier_Center};
+  const MLWorldCameraFrameType frame_types[] = {MLWorldCameraFrameType_NormalExposure,
+                                                MLWorldCameraFrameType_LowExposure};
+  const uint32_t size = capture.width * capture.height;
+  std::vector<uint8_t> pixels(size);
+  std::vector<MLWorldCameraFrame> frames;
+  WorldCameraCaptureWriter writer;
+  CHECK(writer.Open(path));
+  for (size_t k = 0; k < capture.frames_per_stream; ++k) {
+    for (MLWorldCameraFrameType frame_type : frame_types) {
+      for (MLWorldCameraIdentifier camera : cameras) {
+        if ((capture.cameras & camera) == 0) {
+          continue;
+        }
+        MLWorldCameraFrame frame = {};
+        frame.id = camera;
+        frame.frame_type = frame_type;
+        const size_t n = k + (capture.skip_every ? k / capture.skip_every : 0);
+        const MLTime deviation = capture.jitter * (static_cast<MLTime>((n * 7919 + camera) % 201) - 100) / 100;
+        frame.frame_number = capture.first_frame_number + static_cast<int64_t>(n);
+        frame.timestamp = capture.first_timestamp + static_cast<MLTime>(n) * capture.interval + deviation +
+                          (frame_type == MLWorldCameraFrameType_LowExposure ? capture.interval / 4 : 0);
+        frame.camera_pose = SyntheticPose(camera, frame.timestamp);
+        frame.intrinsics.width = capture.width;
+        frame.intrinsics.height = capture.height;
+        frame.intrinsics.focal_length = {100.0f, 100.0f};
+        frame.intrinsics.principal_point = {capture.width / 2.0f, capture.height / 2.0f};
+        frame.frame_buffer.width = capture.width;
+        frame.frame_buffer.height = capture.height;
+        frame.frame_buffer.stride = capture.width;
+        frame.frame_buffer.bytes_per_pixel = 1;
+        frame.frame_buffer.size = size;
+        pixels.assign(size, SyntheticPixel(camera, frame.frame_number));
+        frame.frame_buffer.data = pixels.data();
+        CHECK(writer.Append(frame));
+        frame.frame_buffer.data = nullptr;
+        frames.push_back(frame);
+      }
+    }
+  }
+  CHECK(writer.Close());
+  return frames;
+}
+
+// True if every pixel of an 8-bit frame buffer has value.
+inline bool IsUniform(const MLWorldCameraFrameBuffer &buffer, uint8_t value) {
+  for (uint32_t y = 0; y < buffer.height; ++y) {
+    const uint8_t *row = buffer.data + static_cast<size_t>(y) * buffer.stride;
+    for (uint32_t x = 0; x < buffer.width; ++x) {
+      if (row[x] != value) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
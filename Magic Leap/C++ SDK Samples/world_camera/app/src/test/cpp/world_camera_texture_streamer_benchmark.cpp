@@ -0,0 +1,280 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "world_camera_change_detector.h"
+#include "world_camera_memory_texture_backend.h"
+#include "world_camera_replay.h"
+#include "world_camera_test.h"
+#include "world_camera_texture_atlas.h"
+#include "world_camera_texture_streamer.h"
+
+/*
+  Measures the CPU side of preview uploads with the memory backend. Two 640x480
+  captures of the three cameras are replayed: a static scene with sensor noise and
+  the same scene with a bright object moving across it. WorldCameraChangeDetector
+  finds the dirty tiles of every frame, which are uploaded on one streamer while
+  another uploads full frames, and the pixels skipped are reported per second of the
+  30 Hz capture. Six streamers are also compared with a single atlas for all
+  streams. The backend copy stands in for the GPU transfer, so bytes transferred are
+  as relevant as the time.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  constexpr uint32_t kWidth = 640;
+  constexpr uint32_t kHeight = 480;
+  constexpr uint32_t kStride = 704;
+  constexpr size_t kFrames = 300;
+  constexpr size_t kReplayFrames = 150;
+  constexpr MLTime kInterval = 33'333'333;
+  constexpr uint32_t kObjectSize = 96;
+  // The object moves this many pixels right and down every frame
+  constexpr uint32_t kObjectStep = 6;
+
+  const char *kStaticPath = "world_camera_texture_streamer_benchmark_static.wcap";
+  const char *kMovingPath = "world_camera_texture_streamer_benchmark_moving.wcap";
+
+  constexpr std::array<MLWorldCameraIdentifier, kWorldCameraCount> kCameras = {
+      MLWorldCameraIdentifier_Left, MLWorldCameraIdentifier_Center, MLWorldCameraIdentifier_Right};
+
+  double Microseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+
+  // Textured background of a camera plus noise of +-1 that differs every frame, like a
+  // sensor looking at a static scene
+  uint8_t ScenePixel(size_t camera, uint32_t x, uint32_t y, size_t frame) {
+    const uint32_t texture = ((x / 8 + y / 8) % 2 ? 60 : 140) + (x * 3 + y * 5 + camera * 40) % 32;
+    const uint32_t noise = ((x * 7919 + y * 104729 + frame * 15485863) >> 4) % 3;
+    return static_cast<uint8_t>(texture + noise - 1);
+  }
+
+  // Writes kReplayFrames normal exposure frames of every camera, with the object drawn
+  // over the scene if moving
+  void WriteCapture(const char *path, bool moving) {
+    const uint32_t size = kWidth * kHeight;
+    std::vector<uint8_t> pixels(size);
+    WorldCameraCaptureWriter writer;
+    CHECK(writer.Open(path));
+    for (size_t k = 0; k < kReplayFrames; ++k) {
+      for (size_t camera = 0; camera < kCameras.size(); ++camera) {
+        for (uint32_t y = 0; y < kHeight; ++y) {
+          for (uint32_t x = 0; x < kWidth; ++x) {
+            pixels[y * kWidth + x] = ScenePixel(camera, x, y, k);
+          }
+        }
+        if (moving) {
+          const uint32_t left = static_cast<uint32_t>(k * kObjectStep + camera * 100) % (kWidth - kObjectSize);
+          const uint32_t top = static_cast<uint32_t>(k * kObjectStep) % (kHeight - kObjectSize);
+          for (uint32_t y = top; y < top + kObjectSize; ++y) {
+            memset(&pixels[y * kWidth + left], 240, kObjectSize);
+          }
+        }
+        MLWorldCameraFrame frame = {};
+        frame.id = kCameras[camera];
+        frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+        frame.frame_number = static_cast<int64_t>(k);
+        frame.timestamp = 1'000'000'000 + static_cast<MLTime>(k) * kInterval;
+        frame.camera_pose = SyntheticPose(frame.id, frame.timestamp);
+        frame.intrinsics.width = kWidth;
+        frame.intrinsics.height = kHeight;
+        frame.frame_buffer.width = kWidth;
+        frame.frame_buffer.height = kHeight;
+        frame.frame_buffer.stride = kWidth;
+        frame.frame_buffer.bytes_per_pixel = 1;
+        frame.frame_buffer.size = size;
+        frame.frame_buffer.data = pixels.data();
+        CHECK(writer.Append(frame));
+      }
+    }
+    CHECK(writer.Close());
+  }
+
+  struct Previews {
+    std::array<std::unique_ptr<WorldCameraTextureStreamer>, kWorldCameraCount> streamers;
+    std::array<const WorldCameraMemoryTextureBackend *, kWorldCameraCount> backends = {};
+
+    Previews() {
+      for (size_t camera = 0; camera < kWorldCameraCount; ++camera) {
+        auto backend = std::make_unique<WorldCameraMemoryTextureBackend>();
+        backends[camera] = backend.get();
+        streamers[camera] = std::make_unique<WorldCameraTextureStreamer>(std::move(backend));
+      }
+    }
+
+    uint64_t BytesTransferred() const {
+      uint64_t bytes = 0;
+      for (const WorldCameraMemoryTextureBackend *backend : backends) {
+        bytes += backend->BytesTransferred();
+      }
+      return bytes;
+    }
+  };
+
+  // Replays a capture as fast as possible, timing change detection, dirty tile uploads
+  // and full uploads of every frame separately
+  void Replay(const char *name, const char *path) {
+    WorldCameraReplay replay;
+    MLWorldCameraSettings settings;
+    MLWorldCameraSettingsInit(&settings);
+    settings.cameras = MLWorldCameraIdentifier_All;
+    CHECK(replay.Connect(path, &settings, WorldCameraReplay::Timing::AsFastAsPossible) == MLResult_Ok);
+    WorldCameraReplay::OutputSettings output;
+    output.queue_depth.fill(WorldCameraReplay::kMaxQueueDepth);
+    CHECK(replay.SetOutputSettings(&output) == MLResult_Ok);
+
+    WorldCameraChangeDetector detector;
+    Previews dirty;
+    Previews full;
+    Clock::duration detect_time = {};
+    Clock::duration dirty_time = {};
+    Clock::duration full_time = {};
+    size_t frames = 0;
+    uint64_t pixels = 0;
+    uint64_t skipped_pixels = 0;
+    MLWorldCameraData *data = nullptr;
+    while (replay.GetBufferedWorldCameraData(0, &data) == MLResult_Ok) {
+      for (uint8_t i = 0; i < data->frame_count; ++i) {
+        const MLWorldCameraFrame &frame = data->frames[i];
+        const size_t camera = WorldCameraIndex(frame.id);
+        CHECK(camera < kWorldCameraCount);
+        const Clock::time_point start = Clock::now();
+        const WorldCameraDirtyTiles *tiles = detector.Update(frame);
+        const Clock::time_point detected = Clock::now();
+        CHECK(tiles && dirty.streamers[camera]->Upload(frame.frame_buffer, *tiles));
+        const Clock::time_point uploaded = Clock::now();
+        CHECK(full.streamers[camera]->Upload(frame.frame_buffer));
+        full_time += Clock::now() - uploaded;
+        dirty_time += uploaded - detected;
+        detect_time += detected - start;
+
+        // Skipped pixels count the real size of the partial tiles of the last column and row
+        const uint64_t frame_pixels = static_cast<uint64_t>(frame.frame_buffer.width) * frame.frame_buffer.height;
+        uint64_t dirty_pixels = 0;
+        for (uint32_t row = 0; row < tiles->rows; ++row) {
+          for (uint32_t column = 0; column < tiles->columns; ++column) {
+            if (tiles->IsDirty(column, row)) {
+              const uint32_t x = column * WorldCameraDirtyTiles::kTileSize;
+              const uint32_t y = row * WorldCameraDirtyTiles::kTileSize;
+              dirty_pixels += static_cast<uint64_t>(std::min(WorldCameraDirtyTiles::kTileSize, tiles->width - x)) *
+                              std::min(WorldCameraDirtyTiles::kTileSize, tiles->height - y);
+            }
+          }
+        }
+        pixels += frame_pixels;
+        skipped_pixels += frame_pixels - dirty_pixels;
+        ++frames;
+      }
+      CHECK(replay.ReleaseCameraData(data) == MLResult_Ok);
+    }
+    CHECK(frames == kReplayFrames * kWorldCameraCount);
+
+    const double seconds = kReplayFrames * kInterval * 1e-9;
+    std::printf("%-8s %5.1f%% of pixels skipped  %6.1f Mpixels/s skipped  %9.0f bytes/frame dirty, %9.0f full\n",
+                name, 100.0 * skipped_pixels / pixels, skipped_pixels / seconds * 1e-6,
+                static_cast<double>(dirty.BytesTransferred()) / frames,
+                static_cast<double>(full.BytesTransferred()) / frames);
+    std::printf("%-8s detect %6.1f us/frame  upload dirty tiles %6.1f us/frame  upload full %6.1f us/frame\n", "",
+                Microseconds(detect_time) / frames, Microseconds(dirty_time) / frames,
+                Microseconds(full_time) / frames);
+  }
+
+  MLWorldCameraFrameBuffer FrameBuffer(std::vector<uint8_t> &pixels) {
+    MLWorldCameraFrameBuffer buffer = {};
+    buffer.width = kWidth;
+    buffer.height = kHeight;
+    buffer.stride = kStride;
+    buffer.bytes_per_pixel = 1;
+    buffer.size = static_cast<uint32_t>(pixels.size());
+    buffer.data = pixels.data();
+    return buffer;
+  }
+
+  // Marks every n-th tile dirty.
+  WorldCameraDirtyTiles DirtyTiles(uint32_t n) {
+    WorldCameraDirtyTiles tiles;
+    tiles.width = kWidth;
+    tiles.height = kHeight;
+    tiles.columns = (kWidth + WorldCameraDirtyTiles::kTileSize - 1) / WorldCameraDirtyTiles::kTileSize;
+    tiles.rows = (kHeight + WorldCameraDirtyTiles::kTileSize - 1) / WorldCameraDirtyTiles::kTileSize;
+    const size_t count = static_cast<size_t>(tiles.columns) * tiles.rows;
+    tiles.bits.assign((count + 63) / 64, 0);
+    for (size_t tile = 0; tile < count; tile += n) {
+      tiles.bits[tile / 64] |= uint64_t(1) << (tile % 64);
+      ++tiles.dirty_count;
+    }
+    return tiles;
+  }
+
+  void StreamersAndAtlas() {
+    std::vector<uint8_t> pixels(static_cast<size_t>(kStride) * kHeight, 128);
+    const MLWorldCameraFrameBuffer buffer = FrameBuffer(pixels);
+    const WorldCameraDirtyTiles tiles = DirtyTiles(4);
+
+    std::vector<std::unique_ptr<WorldCameraTextureStreamer>> streamers;
+    for (size_t stream = 0; stream < kWorldCameraStreamCount; ++stream) {
+      streamers.push_back(std::make_unique<WorldCameraTextureStreamer>(
+              std::make_unique<WorldCameraMemoryTextureBackend>()));
+      CHECK(streamers.back()->Upload(buffer));
+    }
+    Clock::time_point start = Clock::now();
+    for (size_t frame = 0; frame < kFrames; ++frame) {
+      for (auto &streamer : streamers) {
+        CHECK(streamer->Upload(buffer, tiles));
+      }
+    }
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kFrames;
+    std::printf("%-28s %8.1f us/frame %9zu uploads/frame\n", "6 streamers, 25% dirty", us, streamers.size());
+
+    WorldCameraAtlasLayout layout;
+    layout.cell_width = kWidth;
+    layout.cell_height = kHeight;
+    layout.columns = kWorldCameraCount;
+    layout.rows = 2;
+    WorldCameraTextureAtlas atlas(std::make_unique<WorldCameraMemoryTextureBackend>(), layout);
+    for (size_t cell = 0; cell < layout.CellCount(); ++cell) {
+      CHECK(atlas.Upload(cell, buffer));
+    }
+    atlas.Flush();
+    start = Clock::now();
+    for (size_t frame = 0; frame < kFrames; ++frame) {
+      for (size_t cell = 0; cell < layout.CellCount(); ++cell) {
+        CHECK(atlas.Upload(cell, buffer, tiles));
+      }
+      atlas.Flush();
+    }
+    us = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / kFrames;
+    std::printf("%-28s %8.1f us/frame %9d uploads/frame\n", "atlas, 25% dirty", us, 1);
+  }
+}
+
+int main() {
+  WriteCapture(kStaticPath, false);
+  WriteCapture(kMovingPath, true);
+  Replay("static", kStaticPath);
+  Replay("moving", kMovingPath);
+  StreamersAndAtlas();
+  std::remove(kStaticPath);
+  std::remove(kMovingPath);
+  return 0;
+}
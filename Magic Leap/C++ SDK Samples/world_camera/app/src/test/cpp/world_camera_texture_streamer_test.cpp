@@ -0,0 +1,223 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "world_camera_change_detector.h"
+#include "world_camera_memory_texture_backend.h"
+#include "world_camera_test.h"
+#include "world_camera_texture_atlas.h"
+#include "world_camera_texture_streamer.h"
+
+/*
+  Texture streaming through the memory backend: full and dirty tile uploads of
+  strided frames reproduce the frame in the texture, frames of another size are
+  rejected, and atlas cells are placed, cleared and flushed in one upload.
+*/
+
+namespace {
+
+  struct Image {
+    std::vector<uint8_t> pixels;
+    MLWorldCameraFrame frame = {};
+
+    Image(uint32_t width, uint32_t height, uint32_t stride) : pixels(static_cast<size_t>(stride) * height) {
+      frame.id = MLWorldCameraIdentifier_Left;
+      frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+      frame.frame_buffer.width = width;
+      frame.frame_buffer.height = height;
+      frame.frame_buffer.stride = stride;
+      frame.frame_buffer.bytes_per_pixel = 1;
+      frame.frame_buffer.size = static_cast<uint32_t>(pixels.size());
+      frame.frame_buffer.data = pixels.data();
+    }
+  };
+
+  // True if the width x height region of the texture at (x, y) holds the image.
+  bool Holds(const WorldCameraMemoryTextureBackend &backend, uint32_t x, uint32_t y, const Image &image) {
+    const MLWorldCameraFrameBuffer &buffer = image.frame.frame_buffer;
+    for (uint32_t row = 0; row < buffer.height; ++row) {
+      if (memcmp(backend.Texture() + static_cast<size_t>(y + row) * backend.Width() + x,
+                 buffer.data + static_cast<size_t>(row) * buffer.stride, buffer.width) != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void TestStreamer() {
+    std::mt19937 random(3);
+    Image image(100, 70, 112);
+    for (uint8_t &pixel : image.pixels) {
+      pixel = static_cast<uint8_t>(random());
+    }
+    auto owned = std::make_unique<WorldCameraMemoryTextureBackend>();
+    const WorldCameraMemoryTextureBackend &backend = *owned;
+    WorldCameraTextureStreamer streamer(std::move(owned));
+    WorldCameraChangeDetector detector;
+
+    const WorldCameraDirtyTiles *tiles = detector.Update(image.frame);
+    CHECK(tiles && streamer.Upload(image.frame.frame_buffer, *tiles));
+    CHECK(backend.Width() == 100 && backend.Height() == 70);
+    CHECK(Holds(backend, 0, 0, image));
+
+    // Change one tile per frame, including the partial ones at the right and bottom. Staging
+    // buffers hold stale frames, so the texture is only right if exactly the dirty rects were sent.
+    constexpr uint32_t kTileSize = WorldCameraDirtyTiles::kTileSize;
+    for (uint32_t frame = 0; frame < 8; ++frame) {
+      const uint32_t x = (frame % 4) * kTileSize;
+      const uint32_t y = (frame % 3) * kTileSize;
+      for (uint32_t row = y; row < std::min(y + kTileSize, 70u); ++row) {
+        memset(image.pixels.data() + row * image.frame.frame_buffer.stride + x, static_cast<int>(frame * 31 + 5),
+               std::min(kTileSize, 100 - x));
+      }
+      tiles = detector.Update(image.frame);
+      CHECK(tiles && tiles->dirty_count == 1);
+      const uint64_t transferred = backend.BytesTransferred();
+      CHECK(streamer.Upload(image.frame.frame_buffer, *tiles));
+      CHECK(Holds(backend, 0, 0, image));
+      CHECK(backend.BytesTransferred() - transferred <= kTileSize * kTileSize);
+    }
+
+    // Unchanged frames transfer nothing
+    tiles = detector.Update(image.frame);
+    CHECK(tiles && tiles->dirty_count == 0);
+    CHECK(streamer.Upload(image.frame.frame_buffer, *tiles));
+    CHECK(streamer.GetCounters().skipped == 1);
+
+    // Storage is sized by the first frame
+    Image other(64, 48, 64);
+    CHECK(!streamer.Upload(other.frame.frame_buffer));
+    CHECK(streamer.GetCounters().rejected == 1);
+    CHECK(streamer.GetCounters().uploads == 9);
+    CHECK(streamer.GetCounters().stalls == 0);
+
+    // Frames produced in place
+    uint8_t *staging = streamer.BeginUpload(100, 70, 100);
+    CHECK(staging);
+    memset(staging, 9, 100 * 70);
+    streamer.EndUpload();
+    Image nines(100, 70, 100);
+    nines.pixels.assign(nines.pixels.size(), 9);
+    CHECK(Holds(backend, 0, 0, nines));
+  }
+
+  void TestAtlas() {
+    WorldCameraAtlasLayout layout;
+    layout.cell_width = 40;
+    layout.cell_height = 30;
+    layout.columns = 3;
+    layout.rows = 2;
+    auto owned = std::make_unique<WorldCameraMemoryTextureBackend>();
+    const WorldCameraMemoryTextureBackend &backend = *owned;
+    WorldCameraTextureAtlas atlas(std::move(owned), layout);
+
+    std::vector<Image> images;
+    for (size_t cell = 0; cell < layout.CellCount(); ++cell) {
+      images.emplace_back(40, 30, 48);
+      for (size_t i = 0; i < images.back().pixels.size(); ++i) {
+        images.back().pixels[i] = static_cast<uint8_t>(cell * 40 + i % 13 + 1);
+      }
+      CHECK(atlas.Upload(cell, images.back().frame.frame_buffer));
+    }
+    atlas.Flush();
+    CHECK(backend.Width() == 120 && backend.Height() == 60);
+    for (size_t cell = 0; cell < layout.CellCount(); ++cell) {
+      const WorldCameraTextureRect rect = layout.Cell(cell);
+      CHECK(Holds(backend, rect.x, rect.y, images[cell]));
+    }
+    CHECK(atlas.GetCounters().uploads == 1);
+    CHECK(atlas.GetCounters().rects == layout.CellCount());
+
+    // A cleared cell is black, the others keep their frames
+    CHECK(atlas.Clear(4));
+    atlas.Flush();
+    Image black(40, 30, 40);
+    for (size_t cell = 0; cell < layout.CellCount(); ++cell) {
+      const WorldCameraTextureRect rect = layout.Cell(cell);
+      CHECK(Holds(backend, rect.x, rect.y, cell == 4 ? black : images[cell]));
+    }
+
+    // Frames larger than a cell are rejected; flushing without staged frames transfers nothing
+    Image large(41, 30, 41);
+    CHECK(!atlas.Upload(0, large.frame.frame_buffer));
+    const uint64_t transferred = backend.BytesTransferred();
+    atlas.Flush();
+    CHECK(backend.BytesTransferred() == transferred);
+    CHECK(atlas.GetCounters().uploads == 2);
+  }
+
+  void TestAtlasClear() {
+    WorldCameraAtlasLayout layout;
+    layout.cell_width = 20;
+    layout.cell_height = 10;
+    layout.columns = 2;
+    layout.rows = 1;
+    auto owned = std::make_unique<WorldCameraMemoryTextureBackend>();
+    const WorldCameraMemoryTextureBackend &backend = *owned;
+    WorldCameraTextureAtlas atlas(std::move(owned), layout);
+    Image first(20, 10, 20);
+    Image second(20, 10, 24);
+    for (size_t i = 0; i < first.pixels.size(); ++i) {
+      first.pixels[i] = static_cast<uint8_t>(i % 7 + 1);
+    }
+    for (size_t i = 0; i < second.pixels.size(); ++i) {
+      second.pixels[i] = static_cast<uint8_t>(i % 5 + 100);
+    }
+    CHECK(atlas.Upload(0, first.frame.frame_buffer));
+    CHECK(atlas.Upload(1, first.frame.frame_buffer));
+    atlas.Flush();
+
+    // A clear outside an upload is applied by the next flush, even without frames
+    CHECK(atlas.Clear(1));
+    CHECK(atlas.GetCounters().uploads == 1);
+    atlas.Flush();
+    Image black(20, 10, 20);
+    CHECK(Holds(backend, 0, 0, first));
+    CHECK(Holds(backend, 20, 0, black));
+    CHECK(atlas.GetCounters().uploads == 2);
+
+    // A frame staged after a clear replaces it within the same upload
+    CHECK(atlas.Clear(0));
+    CHECK(atlas.Upload(0, second.frame.frame_buffer));
+    atlas.Flush();
+    CHECK(Holds(backend, 0, 0, second));
+    CHECK(atlas.GetCounters().uploads == 3);
+
+    // A clear while an upload is begun goes into that upload
+    CHECK(atlas.Upload(1, first.frame.frame_buffer));
+    CHECK(atlas.Clear(0));
+    atlas.Flush();
+    CHECK(Holds(backend, 0, 0, black));
+    CHECK(Holds(backend, 20, 0, first));
+
+    // Nothing pending transfers nothing; invalid cells are rejected
+    const uint64_t transferred = backend.BytesTransferred();
+    atlas.Flush();
+    CHECK(backend.BytesTransferred() == transferred);
+    CHECK(!atlas.Clear(2));
+    atlas.Flush();
+    CHECK(atlas.GetCounters().uploads == 4);
+  }
+}
+
+int main() {
+  TestStreamer();
+  TestAtlas();
+  TestAtlasClear();
+  return 0;
+}
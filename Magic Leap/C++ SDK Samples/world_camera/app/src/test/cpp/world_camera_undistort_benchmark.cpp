@@ -0,0 +1,106 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "world_camera_test.h"
+#include "world_camera_undistort.h"
+
+/*
+  Compares RemapWorldCameraFrameBuffer, which uses AVX2 when the CPU supports it, with
+  the scalar reference on 1016x1016 fisheye frames, checks both produce the same
+  image, and reports the one time cost of building the table and the per frame cost
+  of WorldCameraUndistorter with its cache lookup.
+*/
+
+namespace {
+
+  using Clock = std::chrono::steady_clock;
+
+  constexpr uint32_t kSize = 1016;
+  constexpr int kIterations = 200;
+
+  double Milliseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  template <typename Remap>
+  double MillisecondsPerFrame(Remap remap) {
+    remap();
+    const Clock::time_point start = Clock::now();
+    for (int i = 0; i < kIterations; ++i) {
+      remap();
+    }
+    return Milliseconds(Clock::now() - start) / kIterations;
+  }
+}
+
+int main() {
+  MLWorldCameraFrame frame = {};
+  frame.id = MLWorldCameraIdentifier_Left;
+  frame.frame_type = MLWorldCameraFrameType_NormalExposure;
+  frame.intrinsics.width = kSize;
+  frame.intrinsics.height = kSize;
+  frame.intrinsics.focal_length = {360.0f, 360.0f};
+  frame.intrinsics.principal_point = {kSize / 2.0f, kSize / 2.0f};
+  frame.intrinsics.radial_distortion[0] = -0.02;
+  frame.intrinsics.radial_distortion[1] = 0.004;
+  frame.intrinsics.tangential_distortion[0] = 0.0005;
+  std::vector<uint8_t> pixels(static_cast<size_t>(kSize) * kSize);
+  std::mt19937 random(3);
+  for (uint8_t &pixel : pixels) {
+    pixel = static_cast<uint8_t>(random());
+  }
+  frame.frame_buffer.width = kSize;
+  frame.frame_buffer.height = kSize;
+  frame.frame_buffer.stride = kSize;
+  frame.frame_buffer.bytes_per_pixel = 1;
+  frame.frame_buffer.size = static_cast<uint32_t>(pixels.size());
+  frame.frame_buffer.data = pixels.data();
+
+  const Clock::time_point build_start = Clock::now();
+  const WorldCameraRemapTable table = BuildWorldCameraRemapTable(frame.intrinsics, kSize, frame.intrinsics);
+  const double build_ms = Milliseconds(Clock::now() - build_start);
+  CHECK(table.offsets.size() == pixels.size());
+
+  std::vector<uint8_t> vectorized(pixels.size()), scalar(pixels.size()), undistorted(pixels.size());
+  const double vectorized_ms =
+          MillisecondsPerFrame([&] { RemapWorldCameraFrameBuffer(table, frame.frame_buffer, vectorized.data(), kSize); });
+  const double scalar_ms = MillisecondsPerFrame(
+          [&] { RemapWorldCameraFrameBufferScalar(table, frame.frame_buffer, scalar.data(), kSize); });
+  WorldCameraUndistorter undistorter;
+  const double undistorter_ms =
+          MillisecondsPerFrame([&] { CHECK(undistorter.Undistort(frame, undistorted.data(), kSize)); });
+  CHECK(std::memcmp(vectorized.data(), scalar.data(), scalar.size()) == 0);
+  CHECK(std::memcmp(undistorted.data(), scalar.data(), scalar.size()) == 0);
+
+#if defined(__x86_64__) || defined(__i386__)
+  const bool avx2 = __builtin_cpu_supports("avx2");
+#else
+  const bool avx2 = false;
+#endif
+  const double megapixels = static_cast<double>(kSize) * kSize / 1e6;
+  std::printf("%ux%u, AVX2 %s\n", kSize, kSize, avx2 ? "available" : "not available");
+  std::printf("%-30s %8.2f ms\n", "table build", build_ms);
+  std::printf("%-30s %8.3f ms/frame %8.1f Mpixel/s\n", "scalar reference", scalar_ms, megapixels / scalar_ms * 1e3);
+  std::printf("%-30s %8.3f ms/frame %8.1f Mpixel/s  %5.2fx\n", avx2 ? "AVX2" : "dispatch (scalar)", vectorized_ms,
+              megapixels / vectorized_ms * 1e3, scalar_ms / vectorized_ms);
+  std::printf("%-30s %8.3f ms/frame %8.1f Mpixel/s\n", "undistorter with cached table", undistorter_ms,
+              megapixels / undistorter_ms * 1e3);
+  return 0;
+}
@@ -0,0 +1,171 @@
+// %BANNER_BEGIN%
+// ---------------------------------------------------------------------
+// %COPYRIGHT_BEGIN%
+// Copyright (c) 2022 Magic Leap, Inc. All Rights Reserved.
+// Use of this file is governed by the Software License Agreement,
+// located here: https://www.magicleap.com/software-license-agreement-ml2
+// Terms and conditions applicable to third-party materials accompanying
+// this distribution may also be found in the top-level NOTICE file
+// appearing herein.
+// %COPYRIGHT_END%
+// ---------------------------------------------------------------------
+// %BANNER_END%
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "world_camera_test.h"
+#include "world_camera_undistort.h"
+
+/*
+  Undistortion: the vectorized remap is bit exact with the scalar one, the table
+  follows the fisheye model, sources outside the image are blank, and the
+  undistorter caches one table per intrinsics and stride.
+*/
+
+namespace {
+
+  MLWorldCameraIntrinsics Intrinsics(uint32_t width, uint32_t height) {
+    MLWorldCameraIntrinsics intrinsics = {};
+    intrinsics.width = width;
+    intrinsics.height = height;
+    intrinsics.focal_length = {0.6f * width, 0.6f * width};
+    intrinsics.principal_point = {0.5f * width + 1.5f, 0.5f * height - 2.25f};
+    intrinsics.radial_distortion[0] = -0.02;
+    intrinsics.radial_distortion[1] = 0.01;
+    intrinsics.radial_distortion[2] = -0.004;
+    intrinsics.radial_distortion[3] = 0.0005;
+    intrinsics.tangential_distortion[0] = 0.001;
+    intrinsics.tangential_distortion[1] = -0.0007;
+    return intrinsics;
+  }
+
+  MLWorldCameraFrameBuffer FrameBuffer(std::vector<uint8_t> &pixels, uint32_t width, uint32_t height,
+                                       uint32_t stride) {
+    pixels.resize(static_cast<size_t>(stride) * height);
+    MLWorldCameraFrameBuffer buffer = {};
+    buffer.width = width;
+    buffer.height = height;
+    buffer.stride = stride;
+    buffer.bytes_per_pixel = 1;
+    buffer.size = static_cast<uint32_t>(pixels.size());
+    buffer.data = pixels.data();
+    return buffer;
+  }
+
+  // Source location of an output pixel, evaluated independently of the table builder.
+  bool Distort(const MLWorldCameraIntrinsics &intrinsics, const MLWorldCameraIntrinsics &output, double u, double v,
+               double *su, double *sv) {
+    const double a = (u - output.principal_point.x) / output.focal_length.x;
+    const double b = (v - output.principal_point.y) / output.focal_length.y;
+    const double r = std::hypot(a, b);
+    const double theta = std::atan(r);
+    double theta_d = theta;
+    for (int i = 0; i < 4; ++i) {
+      theta_d += intrinsics.radial_distortion[i] * std::pow(theta, 2 * i + 3);
+    }
+    const double x = r > 0.0 ? a * theta_d / r : a, y = r > 0.0 ? b * theta_d / r : b;
+    const double p1 = intrinsics.tangential_distortion[0], p2 = intrinsics.tangential_distortion[1];
+    const double xd = x + 2 * p1 * x * y + p2 * (x * x + y * y + 2 * x * x);
+    const double yd = y + p1 * (x * x + y * y + 2 * y * y) + 2 * p2 * x * y;
+    *su = intrinsics.focal_length.x * xd + intrinsics.principal_point.x;
+    *sv = intrinsics.focal_length.y * yd + intrinsics.principal_point.y;
+    return *su >= 0.0 && *su <= intrinsics.width - 1.0 && *sv >= 0.0 && *sv <= intrinsics.height - 1.0;
+  }
+
+  // Random images and output widths that leave every possible tail of a vector row.
+  void TestVectorizedMatchesScalar() {
+    std::mt19937 random(7);
+    const MLWorldCameraIntrinsics intrinsics = Intrinsics(123, 77);
+    std::vector<uint8_t> pixels;
+    const MLWorldCameraFrameBuffer source = FrameBuffer(pixels, 123, 77, 131);
+    for (uint8_t &pixel : pixels) {
+      pixel = static_cast<uint8_t>(random());
+    }
+    for (uint32_t width = 1; width <= 40; ++width) {
+      MLWorldCameraIntrinsics output = intrinsics;
+      output.width = width;
+      output.height = 9;
+      output.principal_point = {width / 2.0f, 4.0f};
+      const WorldCameraRemapTable table = BuildWorldCameraRemapTable(intrinsics, source.stride, output);
+      const uint32_t dst_stride = width + 3;
+      std::vector<uint8_t> vectorized(dst_stride * output.height, 0xAA), scalar(vectorized);
+      RemapWorldCameraFrameBuffer(table, source, vectorized.data(), dst_stride);
+      RemapWorldCameraFrameBufferScalar(table, source, scalar.data(), dst_stride);
+      CHECK(vectorized == scalar);
+    }
+    const WorldCameraRemapTable table = BuildWorldCameraRemapTable(intrinsics, source.stride, intrinsics);
+    std::vector<uint8_t> vectorized(123 * 77), scalar(vectorized.size());
+    RemapWorldCameraFrameBuffer(table, source, vectorized.data(), 123);
+    RemapWorldCameraFrameBufferScalar(table, source, scalar.data(), 123);
+    CHECK(vectorized == scalar);
+  }
+
+  // A horizontal ramp turns every output pixel into the source column it sampled.
+  void TestModel() {
+    const MLWorldCameraIntrinsics intrinsics = Intrinsics(200, 150);
+    std::vector<uint8_t> pixels;
+    const MLWorldCameraFrameBuffer source = FrameBuffer(pixels, 200, 150, 208);
+    for (uint32_t y = 0; y < source.height; ++y) {
+      for (uint32_t x = 0; x < source.stride; ++x) {
+        pixels[y * source.stride + x] = static_cast<uint8_t>(std::min(x, 255u));
+      }
+    }
+    // A wider output field of view, so the corners fall outside the source
+    MLWorldCameraIntrinsics output = intrinsics;
+    output.focal_length = {0.3f * intrinsics.width, 0.3f * intrinsics.width};
+    const WorldCameraRemapTable table = BuildWorldCameraRemapTable(intrinsics, source.stride, output);
+    std::vector<uint8_t> dst(output.width * output.height);
+    RemapWorldCameraFrameBuffer(table, source, dst.data(), output.width);
+    size_t inside = 0;
+    size_t outside = 0;
+    for (uint32_t v = 0; v < output.height; ++v) {
+      for (uint32_t u = 0; u < output.width; ++u) {
+        double su = 0.0;
+        double sv = 0.0;
+        const uint8_t value = dst[v * output.width + u];
+        if (Distort(intrinsics, output, u, v, &su, &sv)) {
+          CHECK(std::fabs(value - su) <= 1.0);
+          ++inside;
+        } else if (su < -1.0 || su > intrinsics.width || sv < -1.0 || sv > intrinsics.height) {
+          CHECK(value == 0);
+          ++outside;
+        }
+      }
+    }
+    CHECK(inside > output.width * output.height / 4);
+    CHECK(outside > 0);
+  }
+
+  void TestUndistorterCache() {
+    std::vector<uint8_t> pixels;
+    MLWorldCameraFrame frame = {};
+    frame.intrinsics = Intrinsics(64, 48);
+    frame.frame_buffer = FrameBuffer(pixels, 64, 48, 64);
+    std::vector<uint8_t> dst(64 * 48);
+    WorldCameraUndistorter undistorter;
+    CHECK(undistorter.Undistort(frame, dst.data(), 64));
+    CHECK(undistorter.Undistort(frame, dst.data(), 64));
+    CHECK(undistorter.CachedTableCount() == 1);
+
+    // The stride is baked into the table
+    frame.frame_buffer = FrameBuffer(pixels, 64, 48, 80);
+    CHECK(undistorter.Undistort(frame, dst.data(), 64));
+    CHECK(undistorter.CachedTableCount() == 2);
+    frame.intrinsics.radial_distortion[0] = 0.0;
+    CHECK(undistorter.Undistort(frame, dst.data(), 64));
+    CHECK(undistorter.CachedTableCount() == 3);
+
+    frame.frame_buffer.bytes_per_pixel = 2;
+    CHECK(!undistorter.Undistort(frame, dst.data(), 64));
+  }
+}
+
+int main() {
+  TestVectorizedMatchesScalar();
+  TestModel();
+  TestUndistorterCache();
+  return 0;
+}